@@ -36,6 +36,7 @@
 #include <FruityHal.h>
 #include <FruityMesh.h>
 #include "PathLossModel.h"
+#include "PointerRelocator.h"
 
 #include <malloc.h>
 #include <algorithm>
@@ -76,6 +77,7 @@ extern "C"{
 #include <BeaconingModule.h>
 #include <EnrollmentModule.h>
 #include <IoModule.h>
+#include <MeshAccessModule.h>
 
 #ifndef GITHUB_RELEASE
 #include <AssetModule.h>
@@ -109,7 +111,8 @@ using json = nlohmann::json;
 //#########################################################################################
 
 CherrySim* cherrySimInstance = nullptr; // Use this to access the simulator from C functions
-NRF_UART_Type* simUartPtr = nullptr;
+thread_local NodeEntry* CherrySim::currentNode = nullptr;
+thread_local NRF_UART_Type* simUartPtr = nullptr;
 bool meshGwCommunication = false;
 
 //This is normally populated by the linker script when compiling FruityMesh,
@@ -131,6 +134,37 @@ struct FlashFileHeader
     u32 amountOfNodes;
 };
 
+//Maximum simulated time that building the mesh and propagating the cluster sizes may take
+constexpr u32 PRECLUSTERING_TIMEOUT_MS = 60 * 1000;
+
+//Sizes of the BLE link layer and the L2CAP and ATT headers that are sent with each GATT packet, used for the airtime
+constexpr u32 LL_DEFAULT_MAX_TX_OCTETS = 27;
+constexpr u32 LL_ACCESS_ADDRESS_OCTETS = 4;
+constexpr u32 LL_HEADER_OCTETS = 2;
+constexpr u32 LL_MIC_OCTETS = 4;
+constexpr u32 LL_CRC_OCTETS = 3;
+constexpr u32 LL_INTER_FRAME_SPACE_US = 150;
+constexpr u32 L2CAP_HEADER_OCTETS = 4;
+constexpr u32 ATT_HEADER_OCTETS = 3;
+
+//Reported rssis are clamped to this value, see GetReceptionRssi
+constexpr float MAX_RECEPTION_RSSI = -11.0f;
+
+//Header of relocatable checkpoints, see TransferCheckpoint
+constexpr u32 CHECKPOINT_FILE_MAGIC_NUMBER = 0x50435343; //"CSCP"
+constexpr u32 CHECKPOINT_FILE_FORMAT_VERSION = 1;
+
+//Values of the link layer that are only needed for the packet capture
+constexpr u32 LL_DATA_ACCESS_ADDRESS_BASE = 0x50654C4C;
+constexpr u8 LL_ADVERTISING_CHANNEL = 37;
+constexpr u8 LL_NUM_DATA_CHANNELS = 37;
+constexpr u8 LL_LLID_CONTINUATION = 0x01;
+constexpr u8 LL_LLID_START = 0x02;
+constexpr u8 ATT_OPCODE_WRITE_REQUEST = 0x12;
+constexpr u8 ATT_OPCODE_WRITE_COMMAND = 0x52;
+constexpr u8 ATT_OPCODE_NOTIFICATION = 0x1B;
+constexpr u16 L2CAP_ATT_CHANNEL_ID = 0x0004;
+
 bool CherrySim::ShouldSimIvTrigger(u32 ivMs)
 {
     return (currentNode->state.timeMs % ivMs) == 0;
@@ -164,13 +198,13 @@ void CherrySim::StoreFlashToFile()
 
     for (u32 i = 0; i < GetTotalNodes(); i++)
     {
-        file.write((const char*)this->nodes[i].flash, SIM_MAX_FLASH_SIZE);
+        file.write((const char*)this->nodes[i].flash.GetData(), SIM_MAX_FLASH_SIZE);
     }
 }
 
-void CherrySim::LoadFlashFromFile()
+bool CherrySim::LoadFlashFromFile()
 {
-    if (simConfig.storeFlashToFile == "") return;
+    if (simConfig.storeFlashToFile == "") return false;
 
     std::ifstream infile(simConfig.storeFlashToFile, std::ifstream::binary);
 
@@ -178,7 +212,7 @@ void CherrySim::LoadFlashFromFile()
     if (!infile.good())
     {
         printf("WARNING: Flash was not loaded from file as the file '%s' did not exist!", simConfig.storeFlashToFile.c_str());
-        return;
+        return false;
     }
 
     infile.seekg(0, std::ios::end);
@@ -208,15 +242,406 @@ void CherrySim::LoadFlashFromFile()
         //This is NOT automatically performed here as it would be rather rude to just remove it in case the user accidentally
         //launched a different version of CherrySim or another config.
         SIMEXCEPTION(CorruptOrOutdatedSavefile);
-        return;
+        delete[] buffer;
+        return false;
     }
 
     for (u32 i = 0; i < GetTotalNodes(); i++)
     {
-        CheckedMemcpy(this->nodes[i].flash, buffer + SIM_MAX_FLASH_SIZE * i + sizeof(ffh), SIM_MAX_FLASH_SIZE);
+        this->nodes[i].flash.Load((const u8*)buffer + SIM_MAX_FLASH_SIZE * i + sizeof(ffh));
     }
 
     delete[] buffer;
+    return true;
+}
+
+//Copies the state of the simulation into the buffer or restores it from the buffer. The same function is used
+//for both directions so that the layout of the checkpoint can not diverge. Returns false without changing the
+//simulation if a relocatable checkpoint was stored by another build or with another amount of nodes. Throws if the
+//buffer is too small, as the simulation is only partially restored at this point and can not continue.
+//A checkpoint that is not relocatable restores the memory of the nodes to the addresses at which it was stored.
+//A relocatable checkpoint is restored into the current memory of the nodes instead. It starts with a header and
+//the addresses of all memory that the firmware state may point into, so that these pointers can be adjusted.
+bool CherrySim::TransferCheckpoint(std::vector<u8>& buffer, size_t offset, bool storing, bool relocatable)
+{
+    bool good = true;
+    const auto bytes = [&](void* data, size_t size) {
+        if (storing)
+        {
+            buffer.insert(buffer.end(), (const u8*)data, (const u8*)data + size);
+        }
+        else if (offset + size <= buffer.size())
+        {
+            CheckedMemcpy((u8*)data, buffer.data() + offset, size);
+            offset += size;
+        }
+        else
+        {
+            good = false;
+        }
+    };
+    const auto string = [&](std::string& value) {
+        u32 length = value.size();
+        bytes(&length, sizeof(length));
+        if (!storing) value.resize(good ? length : 0);
+        if (length > 0 && good) bytes(&value[0], length);
+    };
+    //Addresses are always stored with 64 bit so that the layout does not depend on the platform
+    const auto address = [&](const void* pointer) {
+        uint64_t value = (uintptr_t)pointer;
+        bytes(&value, sizeof(value));
+        return (uintptr_t)value;
+    };
+
+    PointerRelocator relocator;
+    std::vector<u32> moduleMemorySizes(GetTotalNodes());
+    if (relocatable)
+    {
+        uintptr_t executableBase = 0;
+        size_t executableSize = 0;
+        PointerRelocator::GetExecutableRegion(executableBase, executableSize);
+
+        const u32 expectedHeader[] = {
+            CHECKPOINT_FILE_MAGIC_NUMBER,
+            CHECKPOINT_FILE_FORMAT_VERSION,
+            FM_VERSION,
+            (u32)sizeof(void*),
+            (u32)sizeof(CherrySim),
+            (u32)sizeof(NodeEntry),
+            (u32)sizeof(GlobalState),
+            FruityHal::GetHalMemorySize(),
+            SIM_MAX_FLASH_SIZE,
+            (u32)executableSize,
+            GetTotalNodes(),
+        };
+        u32 header[sizeof(expectedHeader) / sizeof(expectedHeader[0])];
+        CheckedMemcpy(header, expectedHeader, sizeof(header));
+        bytes(header, sizeof(header));
+        if (!good || !std::equal(std::begin(header), std::end(header), std::begin(expectedHeader))) return false;
+
+        //The regions are read completely before anything is changed
+        const uintptr_t previousExecutableBase = address((const void*)executableBase);
+        const uintptr_t previousSimulatorBase = address(this);
+        const uintptr_t previousNodesBase = address(nodes);
+        std::vector<std::string> nodeConfigurations(GetTotalNodes());
+        std::vector<uintptr_t> previousModuleMemoryBases(GetTotalNodes());
+        std::vector<uintptr_t> previousHalMemoryBases(GetTotalNodes());
+        std::vector<uintptr_t> previousFlashBases(GetTotalNodes());
+        for (u32 i = 0; i < GetTotalNodes() && good; i++)
+        {
+            nodeConfigurations[i] = nodes[i].nodeConfiguration;
+            moduleMemorySizes[i] = nodes[i].gs.moduleAllocator.GetMemorySize();
+            string(nodeConfigurations[i]);
+            previousModuleMemoryBases[i] = address(nodes[i].moduleMemoryBlock);
+            bytes(&moduleMemorySizes[i], sizeof(moduleMemorySizes[i]));
+            previousHalMemoryBases[i] = address(nodes[i].gs.halMemory);
+            previousFlashBases[i] = address(nodes[i].flash.GetData());
+        }
+        if (!good) return false;
+
+        relocator.AddRegion(previousExecutableBase, executableBase, executableSize);
+        relocator.AddRegion(previousSimulatorBase, (uintptr_t)this, sizeof(CherrySim));
+        relocator.AddRegion(previousNodesBase, (uintptr_t)nodes, GetTotalNodes() * sizeof(NodeEntry));
+        for (u32 i = 0; i < GetTotalNodes(); i++)
+        {
+            NodeEntry& node = nodes[i];
+
+            //A node that runs another featureset than when the checkpoint was stored needs module memory of another size
+            if (!storing && (node.nodeConfiguration != nodeConfigurations[i] || node.gs.moduleAllocator.GetMemorySize() != moduleMemorySizes[i]))
+            {
+                node.nodeConfiguration = nodeConfigurations[i];
+                node.featuresetPointers = nullptr;
+                u32* moduleMemory = (u32*)node.moduleMemoryBlock;
+                if (!checkpoints.empty()) retainedNodeMemory.insert(moduleMemory);
+                else delete[] moduleMemory;
+                node.moduleMemoryBlock = (u8*)new u32[moduleMemorySizes[i] / sizeof(u32) + 1];
+            }
+
+            relocator.AddRegion(previousModuleMemoryBases[i], (uintptr_t)node.moduleMemoryBlock, moduleMemorySizes[i]);
+            relocator.AddRegion(previousHalMemoryBases[i], (uintptr_t)node.gs.halMemory, FruityHal::GetHalMemorySize());
+            relocator.AddRegion(previousFlashBases[i], (uintptr_t)node.flash.GetData(), node.flash.GetSize());
+        }
+    }
+
+    //Simulator state
+    nlohmann::json configJson = simConfig;
+    std::string configString = configJson.dump();
+    string(configString);
+    if (!storing && good) from_json(nlohmann::json::parse(configString), simConfig);
+    bytes(&simState, sizeof(simState));
+    bytes(&flashToFileWriteCycle, sizeof(flashToFileWriteCycle));
+    bytes(&globalBreakCounter, sizeof(globalBreakCounter));
+
+    std::vector<ReplayRecordEntry> replayEntries;
+    for (std::queue<ReplayRecordEntry> copy = replayRecordEntries; !copy.empty(); copy.pop()) replayEntries.push_back(copy.front());
+    u32 amountOfReplayEntries = replayEntries.size();
+    bytes(&amountOfReplayEntries, sizeof(amountOfReplayEntries));
+    if (!storing) replayEntries.resize(good ? amountOfReplayEntries : 0);
+    for (ReplayRecordEntry& entry : replayEntries)
+    {
+        bytes(&entry.index, sizeof(entry.index));
+        bytes(&entry.time, sizeof(entry.time));
+        string(entry.command);
+        bytes(&entry.isUartInput, sizeof(entry.isUartInput));
+    }
+    if (!storing)
+    {
+        replayRecordEntries = {};
+        for (const ReplayRecordEntry& entry : replayEntries) replayRecordEntries.push(entry);
+    }
+
+    for (u32 i = 0; i < GetTotalNodes() && good; i++)
+    {
+        NodeIndexSetter setter(i);
+        NodeEntry& node = *currentNode;
+
+        //The GlobalState contains the complete firmware state and is copied as a raw image. Only the terminal
+        //command queue and the current log line own heap memory, so they are destroyed before the image is
+        //restored and constructed again afterwards.
+        using TerminalCommandQueue = decltype(node.gs.terminal.terminalCommandQueue);
+        std::vector<TerminalCommandQueueEntry> terminalEntries;
+        std::string currentLogString;
+        if (storing)
+        {
+            for (TerminalCommandQueue copy = node.gs.terminal.terminalCommandQueue; !copy.empty(); copy.pop()) terminalEntries.push_back(copy.front());
+            currentLogString = node.gs.logger.currentString;
+        }
+        else
+        {
+            node.gs.terminal.terminalCommandQueue.~TerminalCommandQueue();
+            node.gs.logger.currentString.~basic_string();
+        }
+        void* halMemory = node.gs.halMemory;
+        bytes(&node.gs, sizeof(node.gs));
+        if (!storing)
+        {
+            relocator.Relocate(node.gs);
+            if (relocatable && (node.gs.halMemory != halMemory || node.gs.moduleAllocator.GetMemorySize() != moduleMemorySizes[i])) good = false;
+            new (&node.gs.terminal.terminalCommandQueue) TerminalCommandQueue();
+            new (&node.gs.logger.currentString) std::string();
+        }
+        u32 amountOfTerminalEntries = terminalEntries.size();
+        bytes(&amountOfTerminalEntries, sizeof(amountOfTerminalEntries));
+        if (!storing) terminalEntries.resize(good ? amountOfTerminalEntries : 0);
+        for (TerminalCommandQueueEntry& entry : terminalEntries)
+        {
+            string(entry.terminalCommand);
+            bytes(&entry.skipCrcCheck, sizeof(entry.skipCrcCheck));
+            if (!storing) node.gs.terminal.terminalCommandQueue.push(entry);
+        }
+        string(currentLogString);
+        if (!storing) node.gs.logger.currentString = currentLogString;
+
+        //Peripherals, SoftDevice and the memory of the modules and the hal
+        bytes(&node.ficr, sizeof(node.ficr));
+        bytes(&node.uicr, sizeof(node.uicr));
+        bytes(&node.gpio, sizeof(node.gpio));
+        bytes(&node.radio, sizeof(node.radio));
+        bytes(&node.state, sizeof(node.state));
+        bytes(&node.currentEvent, sizeof(node.currentEvent));
+        bytes(&node.retainedRamMemory, sizeof(node.retainedRamMemory));
+        bytes(&node.address, sizeof(node.address));
+        //The firmware state of a checkpoint that is not relocatable points into the module and hal memory of the boot
+        //that was current when storing. This memory is kept until the checkpoints are discarded, see ShutdownCurrentNode.
+        if (!relocatable) bytes(&node.moduleMemoryBlock, sizeof(node.moduleMemoryBlock));
+        if (good) bytes(node.moduleMemoryBlock, node.gs.moduleAllocator.GetMemorySize());
+        if (good) bytes(node.gs.halMemory, FruityHal::GetHalMemorySize());
+        if (!storing)
+        {
+            relocator.Relocate(node.state);
+            relocator.Relocate(node.currentEvent);
+            relocator.Relocate(node.retainedRamMemory);
+            relocator.Relocate(node.moduleMemoryBlock, node.gs.moduleAllocator.GetMemorySize());
+            relocator.Relocate(node.gs.halMemory, FruityHal::GetHalMemorySize());
+        }
+
+        //Simulator state of the node
+        bytes(&node.x, sizeof(node.x));
+        bytes(&node.y, sizeof(node.y));
+        bytes(&node.z, sizeof(node.z));
+        bytes(&node.currentFloorNumber, sizeof(node.currentFloorNumber));
+        bytes(&node.led1On, sizeof(node.led1On));
+        bytes(&node.led2On, sizeof(node.led2On));
+        bytes(&node.led3On, sizeof(node.led3On));
+        bytes(&node.nanoAmperePerMsTotal, sizeof(node.nanoAmperePerMsTotal));
+        bytes(&node.restartCounter, sizeof(node.restartCounter));
+        bytes(&node.simulatedFrames, sizeof(node.simulatedFrames));
+        bytes(&node.watchdogTimeout, sizeof(node.watchdogTimeout));
+        bytes(&node.lastWatchdogFeedTime, sizeof(node.lastWatchdogFeedTime));
+        bytes(&node.rebootReason, sizeof(node.rebootReason));
+        bytes(&node.bmgWasInit, sizeof(node.bmgWasInit));
+        bytes(&node.twiWasInit, sizeof(node.twiWasInit));
+        bytes(&node.Tlv49dA1b6WasInit, sizeof(node.Tlv49dA1b6WasInit));
+        bytes(&node.spiWasInit, sizeof(node.spiWasInit));
+        bytes(&node.lis2dh12WasInit, sizeof(node.lis2dh12WasInit));
+        bytes(&node.bme280WasInit, sizeof(node.bme280WasInit));
+        bytes(&node.discoveryAlwaysBusy, sizeof(node.discoveryAlwaysBusy));
+        bytes(&node.lis2dh12InertialInterruptEnabled, sizeof(node.lis2dh12InertialInterruptEnabled));
+        bytes(&node.lastMovementSimTimeMs, sizeof(node.lastMovementSimTimeMs));
+        bytes(&node.fakeDfuVersion, sizeof(node.fakeDfuVersion));
+        bytes(&node.fakeDfuVersionArmed, sizeof(node.fakeDfuVersionArmed));
+        bytes(&node.bleStackType, sizeof(node.bleStackType));
+        bytes(&node.bleStackMaxTotalConnections, sizeof(node.bleStackMaxTotalConnections));
+        bytes(&node.bleStackMaxPeripheralConnections, sizeof(node.bleStackMaxPeripheralConnections));
+        bytes(&node.bleStackMaxCentralConnections, sizeof(node.bleStackMaxCentralConnections));
+        bytes(node.sentPackets, sizeof(node.sentPackets));
+        bytes(node.routedPackets, sizeof(node.routedPackets));
+        bytes(&node.rnd, sizeof(node.rnd));
+        bytes(&node.parallelEventIdCount, sizeof(node.parallelEventIdCount));
+        bytes(&node.parallelPacketIdCount, sizeof(node.parallelPacketIdCount));
+        bytes(&node.timeslotRadioSignalCallback, sizeof(node.timeslotRadioSignalCallback));
+        if (!storing) relocator.Relocate(node.timeslotRadioSignalCallback);
+        bytes(&node.timeslotCloseSessionRequested, sizeof(node.timeslotCloseSessionRequested));
+        bytes(&node.timeslotRequested, sizeof(node.timeslotRequested));
+        bytes(&node.timeslotActive, sizeof(node.timeslotActive));
+
+        u32 amountOfEvents = node.eventQueue.size();
+        bytes(&amountOfEvents, sizeof(amountOfEvents));
+        if (!storing) node.eventQueue.resize(good ? amountOfEvents : 0);
+        for (u32 k = 0; k < node.eventQueue.size(); k++)
+        {
+            bytes(&node.eventQueue[k], sizeof(simBleEvent));
+            if (!storing) relocator.Relocate(node.eventQueue[k]);
+        }
+
+        std::vector<u32> interrupts;
+        for (std::queue<u32> copy = node.interruptQueue; !copy.empty(); copy.pop()) interrupts.push_back(copy.front());
+        u32 amountOfInterrupts = interrupts.size();
+        bytes(&amountOfInterrupts, sizeof(amountOfInterrupts));
+        if (!storing) interrupts.resize(good ? amountOfInterrupts : 0);
+        if (amountOfInterrupts > 0) bytes(interrupts.data(), interrupts.size() * sizeof(u32));
+        if (!storing)
+        {
+            node.interruptQueue = {};
+            for (u32 pin : interrupts) node.interruptQueue.push(pin);
+        }
+
+        std::vector<std::pair<u32, PinSettings>> pins(node.gpioInitializedPins.begin(), node.gpioInitializedPins.end());
+        u32 amountOfPins = pins.size();
+        bytes(&amountOfPins, sizeof(amountOfPins));
+        if (!storing) pins.resize(good ? amountOfPins : 0);
+        for (auto& pin : pins)
+        {
+            bytes(&pin.first, sizeof(pin.first));
+            bytes(&pin.second, sizeof(pin.second));
+            if (!storing) relocator.Relocate(pin.second);
+        }
+        if (!storing) node.gpioInitializedPins = std::map<u32, PinSettings>(pins.begin(), pins.end());
+
+        u32 amountOfImpossibleConnections = node.impossibleConnection.size();
+        bytes(&amountOfImpossibleConnections, sizeof(amountOfImpossibleConnections));
+        if (!storing) node.impossibleConnection.resize(good ? amountOfImpossibleConnections : 0);
+        if (amountOfImpossibleConnections > 0) bytes(node.impossibleConnection.data(), node.impossibleConnection.size() * sizeof(int));
+
+        //Only the pages of the flash that are not erased are stored
+        std::vector<u8> flashImage;
+        if (!storing) flashImage.resize(node.flash.GetSize(), 0xFF);
+        const u32 pageSize = FruityHal::GetCodePageSize();
+        for (u32 pageOffset = 0; pageOffset < node.flash.GetSize(); pageOffset += pageSize)
+        {
+            const u32 length = std::min(pageSize, node.flash.GetSize() - pageOffset);
+            u8* page = storing ? node.flash.GetData() + pageOffset : flashImage.data() + pageOffset;
+            u8 pageErased = storing && std::all_of(page, page + length, [](u8 value) { return value == 0xFF; });
+            bytes(&pageErased, sizeof(pageErased));
+            if (!pageErased) bytes(page, length);
+        }
+        if (!storing && good) node.flash.Load(flashImage.data());
+    }
+
+    if (!good)
+    {
+        SIMEXCEPTIONFORCE(IllegalStateException);
+    }
+    return true;
+}
+
+u32 CherrySim::StoreCheckpoint()
+{
+    std::vector<u8> buffer;
+    TransferCheckpoint(buffer, 0, true, false);
+    checkpoints.push_back(std::move(buffer));
+    return checkpoints.size() - 1;
+}
+
+void CherrySim::LoadCheckpoint(u32 checkpointId)
+{
+    if (checkpointId >= checkpoints.size())
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+        return;
+    }
+
+    //The memory of the current boot may be referenced by a later checkpoint, so it is kept as well
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        retainedNodeMemory.insert((u32*)nodes[i].moduleMemoryBlock);
+        retainedNodeMemory.insert((u32*)nodes[i].gs.halMemory);
+    }
+
+    TransferCheckpoint(checkpoints[checkpointId], 0, false, false);
+    UpdateCachesAfterCheckpointLoad();
+}
+
+void CherrySim::StoreCheckpointToFile(const std::string& path)
+{
+    std::vector<u8> buffer;
+    TransferCheckpoint(buffer, 0, true, true);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)buffer.data(), buffer.size());
+    if (!file)
+    {
+        SIMEXCEPTIONFORCE(FileException);
+    }
+}
+
+bool CherrySim::LoadCheckpointFromFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        printf("WARNING: Checkpoint was not loaded as the file '%s' did not exist!" EOL, path.c_str());
+        return false;
+    }
+    std::vector<u8> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (!TransferCheckpoint(buffer, 0, false, true))
+    {
+        //Checkpoint files are only valid for the build of the simulator that stored them and are not deleted
+        //automatically, as another build might have been launched by accident
+        SIMEXCEPTION(CorruptOrOutdatedSavefile);
+        return false;
+    }
+    UpdateCachesAfterCheckpointLoad();
+    return true;
+}
+
+//The spatial grid, the link budget cache and the clustering tracker are derived from the state of the nodes
+void CherrySim::UpdateCachesAfterCheckpointLoad()
+{
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        UpdateSpatialGrid(i);
+        UpdateLinkBudgetCache(i);
+        UpdateClusteringTracker(i);
+    }
+}
+
+void CherrySim::DiscardCheckpoints()
+{
+    checkpoints.clear();
+
+    //Only the memory that is not used by the current boot of a node is freed
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        retainedNodeMemory.erase((u32*)nodes[i].moduleMemoryBlock);
+        retainedNodeMemory.erase((u32*)nodes[i].gs.halMemory);
+    }
+    for (u32* memory : retainedNodeMemory)
+    {
+        delete[] memory;
+    }
+    retainedNodeMemory.clear();
 }
 
 #define AddSimulatedFeatureSet(featureset) \
@@ -440,10 +865,18 @@ CherrySim::CherrySim(const SimConfiguration &simConfig)
 #endif
         auto replayPath = simConfig.replayPath;
         const std::string replayFileContents = LoadFileContents(simConfig.replayPath.c_str());
-        CheckVersionFromReplayRecord(replayFileContents);
-        replayRecordEntries = ExtractReplayRecord(replayFileContents);
-        this->simConfig = ExtractSimConfigurationFromReplayRecord(replayFileContents);
+        if (ReplayJournal::IsReplayJournal(replayFileContents))
+        {
+            LoadReplayJournal(replayFileContents);
+        }
+        else
+        {
+            CheckVersionFromReplayRecord(replayFileContents);
+            replayRecordEntries = ExtractReplayRecord(replayFileContents);
+            this->simConfig = ExtractSimConfigurationFromReplayRecord(replayFileContents);
+        }
         this->simConfig.replayPath = replayPath; //Overwrite the replay path so that we know that we are currently in a replay
+        this->simConfig.replayJournalPath = ""; //The replay must not overwrite the journal of the recorded run
         if (this->simConfig.storeFlashToFile != "")
         {
             // Replaying a file that required persistent flash storage is currently not supported.
@@ -470,6 +903,7 @@ CherrySim::~CherrySim()
     StoreFlashToFile();
 
     //Clean up up all nodes
+    DiscardCheckpoints();
     for (u32 i = 0; i < GetTotalNodes(); i++) {
         NodeIndexSetter setter(i);
         ShutdownCurrentNode();
@@ -512,6 +946,18 @@ void CherrySim::Init()
         TerminalPrintHandler(versionString.c_str());
     }
 
+    if (simConfig.replayJournalPath != "")
+    {
+        nlohmann::json configJson = simConfig;
+        replayJournal = std::make_unique<ReplayJournal>(simConfig.replayJournalPath);
+        replayJournal->Append(ReplayJournalRecordType::CONFIGURATION, 0, 0, configJson.dump());
+    }
+
+    if (simConfig.pcapPath != "")
+    {
+        pcapWriter = std::make_unique<PcapWriter>(simConfig.pcapPath);
+    }
+
     //Generate a psuedo random number generator with a uniform distribution
     simState.rnd.SetSeed(simConfig.seed);
 
@@ -543,8 +989,15 @@ void CherrySim::Init()
     for (u32 i = 0; i<GetTotalNodes(); i++) {
         FlashNode(i);
     }
+    goldenFlashImages.clear();
 
-    LoadFlashFromFile();
+    //Identical flash pages (e.g. the MBR) are only kept once for all nodes until they are written. The flashed
+    //images already are, but flash that is loaded from a file has to be shared again.
+    if (LoadFlashFromFile()) {
+        for (u32 i = 0; i < GetTotalNodes(); i++) {
+            nodes[i].flash.SharePages();
+        }
+    }
 
     //Either use given positions from json or generate them randomly
     if (simConfig.importFromJson) {
@@ -657,7 +1110,12 @@ void CherrySim::ImportDataFromJson()
     json siteJson;
     json devicesJson;
 
-    if (simConfig.replayPath != "")
+    if (replayingJournal)
+    {
+        siteJson    = nlohmann::json::parse(replayJournalSiteJson);
+        devicesJson = nlohmann::json::parse(replayJournalDevicesJson);
+    }
+    else if (simConfig.replayPath != "")
     {
         const std::string replayFileContents = LoadFileContents(simConfig.replayPath.c_str());
         siteJson    = nlohmann::json::parse(ExtractAndCleanReplayToken(replayFileContents, "[!]SITE START:[!]",    "[!]SITE END[!]"));
@@ -686,6 +1144,12 @@ void CherrySim::ImportDataFromJson()
         TerminalPrintHandler(deviceString.c_str());
     }
 
+    if (replayJournal)
+    {
+        replayJournal->Append(ReplayJournalRecordType::SITE, 0, 0, siteJson.dump());
+        replayJournal->Append(ReplayJournalRecordType::DEVICES, 0, 0, devicesJson.dump());
+    }
+
     //Get some data from the site
     simConfig.mapWidthInMeters = siteJson["results"][0]["lengthInMeter"];
     simConfig.mapHeightInMeters = siteJson["results"][0]["heightInMeter"];
@@ -718,7 +1182,11 @@ void CherrySim::ImportPositionsAndDataFromJson()
 {
     json devicesJson;
 
-    if (simConfig.replayPath != "")
+    if (replayingJournal)
+    {
+        devicesJson = nlohmann::json::parse(replayJournalDevicesJson);
+    }
+    else if (simConfig.replayPath != "")
     {
         const std::string replayFileContents = LoadFileContents(simConfig.replayPath.c_str());
         devicesJson = nlohmann::json::parse(ExtractAndCleanReplayToken(replayFileContents, "[!]DEVICES START:[!]", "[!]DEVICES END[!]"));
@@ -1000,6 +1468,57 @@ SimConfiguration CherrySim::ExtractSimConfigurationFromReplayRecord(const std::s
     return nlohmann::json::parse(jsonString);
 }
 
+void CherrySim::LoadReplayJournal(const std::string& fileContents)
+{
+    std::vector<ReplayRecordEntry> entries;
+    bool configurationFound = false;
+    for (ReplayJournalRecord& record : ReplayJournal::Read(fileContents))
+    {
+        if (record.type == ReplayJournalRecordType::CONFIGURATION)
+        {
+            simConfig = nlohmann::json::parse(record.data);
+            configurationFound = true;
+        }
+        else if (record.type == ReplayJournalRecordType::SITE) replayJournalSiteJson = std::move(record.data);
+        else if (record.type == ReplayJournalRecordType::DEVICES) replayJournalDevicesJson = std::move(record.data);
+        else if (record.type == ReplayJournalRecordType::TERMINAL_COMMAND || record.type == ReplayJournalRecordType::UART_INPUT)
+        {
+            ReplayRecordEntry entry;
+            entry.index = record.nodeIndex;
+            entry.time = record.timeMs;
+            entry.command = std::move(record.data);
+            entry.isUartInput = record.type == ReplayJournalRecordType::UART_INPUT;
+            entries.push_back(std::move(entry));
+        }
+        else
+        {
+            //Unknown record type
+            SIMEXCEPTION(IllegalArgumentException);
+        }
+    }
+
+    if (!configurationFound)
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+    }
+
+    //Nodes that are simulated in parallel write their records in any order, but the records of each node are in order
+    std::stable_sort(entries.begin(), entries.end());
+    for (ReplayRecordEntry& entry : entries)
+    {
+        replayRecordEntries.push(std::move(entry));
+    }
+
+    replayingJournal = true;
+    //Unlike a log, the journal contains all inputs so that the replay does not have to wait for anything
+    simConfig.realTime = false;
+}
+
+void CherrySim::AppendToReplayJournal(ReplayJournalRecordType type, u32 nodeIndex, const std::string& data)
+{
+    if (replayJournal) replayJournal->Append(type, nodeIndex, simState.simTimeMs, data);
+}
+
 void CherrySim::CheckVersionFromReplayRecord(const std::string &fileContents)
 {
     const std::string versionString = ExtractReplayToken(fileContents, "[!]VERSION START:[!]", "[!]VERSION END[!]");
@@ -1074,6 +1593,12 @@ void CherrySim::SimulateStepForAllNodes()
     socketTerm->ProcessSockets();
 #endif
 
+    if (simConfig.skipIdleSimulationSteps) SkipIdleSimulationSteps();
+
+    PrepareSpatialGrid();
+    PrepareLinkBudgetCache();
+    PrepareClusteringTracker();
+
     int64_t sumOfAllSimulatedFrames = 0;
     for (u32 i = 0; i < GetTotalNodes(); i++) {
         NodeIndexSetter setter(i);
@@ -1081,6 +1606,10 @@ void CherrySim::SimulateStepForAllNodes()
         // Update the cached floor index using the current z-coordinate of the node
         currentNode->currentFloorNumber = FindFloorNumber(currentNode->z);
 
+        // Positions might have been written directly since the last step, e.g. by a test
+        UpdateSpatialGrid(i);
+        UpdateLinkBudgetCache(i);
+
         sumOfAllSimulatedFrames += currentNode->simulatedFrames;
     }
     const int64_t avgSimulatedFrames = sumOfAllSimulatedFrames / GetTotalNodes();
@@ -1088,61 +1617,78 @@ void CherrySim::SimulateStepForAllNodes()
     size_t s = replayRecordEntries.size(); //Meant to be used as a break point condition.
     while ((s = replayRecordEntries.size()) > 0 && replayRecordEntries.front().time <= simState.simTimeMs)
     {
-        NodeIndexSetter setter(replayRecordEntries.front().index);
-        GS->terminal.PutIntoTerminalCommandQueue(replayRecordEntries.front().command, false);
+        ReplayRecordEntry& entry = replayRecordEntries.front();
+        if (entry.isUartInput)
+        {
+            SendUartInput(&nodes[entry.index], (const u8*)entry.command.data(), entry.command.size());
+        }
+        else
+        {
+            NodeIndexSetter setter(entry.index);
+            GS->terminal.PutIntoTerminalCommandQueue(entry.command, false);
+        }
         replayRecordEntries.pop();
     }
 
-    //printf("-- %u --" EOL, simState.simTimeMs);
-    for (u32 i = 0; i < GetTotalNodes(); i++) {
+    if (simConfig.parallelStepThreads > 1)
+    {
+        SimulateStepForAllNodesInParallel(avgSimulatedFrames);
+    }
+    else
+    {
+        //printf("-- %u --" EOL, simState.simTimeMs);
+        for (u32 i = 0; i < GetTotalNodes(); i++) {
 #ifdef FM_NATIVE_RENDERER_ENABLED
-        if (bbeRenderer && bbeRenderer->isPaused()) break;
+            if (bbeRenderer && bbeRenderer->isPaused()) break;
 #endif
-        NodeIndexSetter setter(i);
-        bool simulateNode = true;
-        if (simConfig.simulateJittering)
-        {
-            const int64_t nodeSimualtedFramesBelowAverage = avgSimulatedFrames - currentNode->simulatedFrames;
-            // Sigmoid function, flipped on the Y-Axis.
-            const double probabilityToSkipNodeSimulation = 1.0 / (1 + std::exp((double)(nodeSimualtedFramesBelowAverage) * 0.1));
-            if (PSRNG(probabilityToSkipNodeSimulation * UINT32_MAX))
-            {
-                simulateNode = false;
-            }
-        }
-
-        if (simulateNode)
-        {
-            StackBaseSetter sbs;
+            NodeIndexSetter setter(i);
+            const bool simulateNode = !ShouldSkipCurrentNode(avgSimulatedFrames);
 
-            currentNode->simulatedFrames++;
-            SimulateMovement();
-            QueueInterrupts();
-            SimulateTimer();
-            SimulateTimeouts();
-            SimulateAdvertising();
-            SimulateConnections();
-            SimulateServiceDiscovery();
-            SimulateUartInterrupts();
-            SimulateTimeslot();
-            SimulateConnectionParameterUpdateRequestTimeout();
-            try {
-                FruityHal::EventLooper();
-                SimulateFlashCommit();
-                SimulateBatteryUsage();
-                SimulateWatchDog();
+            if (simulateNode && ShouldSkipIdleStepOfCurrentNode())
+            {
+                SkipIdleStepOfCurrentNode();
             }
-            catch (const NodeSystemResetException& e) {
-                //Node broke out of its current simulation and rebootet
-                if (simEventListener) simEventListener->CherrySimEventHandler("NODE_RESET");
+            else if (simulateNode)
+            {
+                StackBaseSetter sbs;
+
+                currentNode->simulatedFrames++;
+                SimulateMovement();
+                QueueInterrupts();
+                SimulateTimer();
+                SimulateTimeouts();
+                SimulateAdvertising();
+                SimulateConnections();
+                SimulateServiceDiscovery();
+                SimulateUartInterrupts();
+                SimulateTimeslot();
+                SimulateConnectionParameterUpdateRequestTimeout();
+                try {
+                    FruityHal::EventLooper();
+                    SimulateFlashCommit();
+                    SimulateBatteryUsage();
+                    SimulateWatchDog();
+                }
+                catch (const NodeSystemResetException& e) {
+                    //Node broke out of its current simulation and rebootet
+                    if (simEventListener) simEventListener->CherrySimEventHandler("NODE_RESET");
+                }
             }
-        }
 
-        globalBreakCounter++;
+            globalBreakCounter++;
+        }
     }
 
-    //Run a check on the current clustering state
-    if(simConfig.enableClusteringValidityCheck) CheckMeshingConsistency();
+    //Run a check on the current clustering state. It can only find a new mismatch if the clustering of a node changed,
+    //but it also runs periodically, together with an audit of the clustering tracker.
+    if (simConfig.enableClusteringValidityCheck)
+    {
+        clusteringValidityCheckCycle++;
+        const bool auditDue = clusteringValidityCheckCycle % clusteringAuditInterval == 0;
+        if (clusteringChangedSinceLastCheck || auditDue) CheckMeshingConsistency();
+        if (auditDue) AuditClusteringTracker();
+    }
+    clusteringChangedSinceLastCheck = false;
 
     simState.simTimeMs += simConfig.simTickDurationMs;
     
@@ -1150,6 +1696,8 @@ void CherrySim::SimulateStepForAllNodes()
     flashToFileWriteCycle++;
     if (flashToFileWriteCycle % flashToFileWriteInterval == 0) StoreFlashToFile();
 
+    if (replayJournal) replayJournal->Flush();
+
 #ifdef FM_NATIVE_RENDERER_ENABLED
     if (bbeRenderer && bbeRenderer->keepAlive())
     {
@@ -1181,6 +1729,159 @@ void CherrySim::SimulateStepForAllNodes()
     }
 }
 
+bool CherrySim::ShouldSkipCurrentNode(int64_t avgSimulatedFrames)
+{
+    if (!simConfig.simulateJittering) return false;
+
+    const int64_t nodeSimualtedFramesBelowAverage = avgSimulatedFrames - currentNode->simulatedFrames;
+    // Sigmoid function, flipped on the Y-Axis.
+    const double probabilityToSkipNodeSimulation = 1.0 / (1 + std::exp((double)(nodeSimualtedFramesBelowAverage) * 0.1));
+    return PSRNG(probabilityToSkipNodeSimulation * UINT32_MAX);
+}
+
+void CherrySim::SimulateStepForAllNodesInParallel(int64_t avgSimulatedFrames)
+{
+    const u32 totalNodes = GetTotalNodes();
+    if (threadPool == nullptr || threadPool->GetNumThreads() != simConfig.parallelStepThreads)
+    {
+        threadPool.reset();
+        threadPool = std::make_unique<SimThreadPool>(simConfig.parallelStepThreads);
+    }
+
+    //The radio simulation delivers packets and events between the nodes, so it runs sequentially in node order
+    nodeSimulatedInStep.assign(totalNodes, 0);
+    for (u32 i = 0; i < totalNodes; i++) {
+#ifdef FM_NATIVE_RENDERER_ENABLED
+        if (bbeRenderer && bbeRenderer->isPaused()) break;
+#endif
+        NodeIndexSetter setter(i);
+        if (ShouldSkipIdleStepOfCurrentNode())
+        {
+            SkipIdleStepOfCurrentNode();
+        }
+        else if (!ShouldSkipCurrentNode(avgSimulatedFrames))
+        {
+            StackBaseSetter sbs;
+
+            nodeSimulatedInStep[i] = 1;
+            currentNode->simulatedFrames++;
+            SimulateMovement();
+            QueueInterrupts();
+            SimulateTimeouts();
+            SimulateAdvertising();
+            SimulateConnections();
+            SimulateConnectionParameterUpdateRequestTimeout();
+        }
+
+        globalBreakCounter++;
+    }
+
+    //The firmware of each node only works on its own state and can therefore run concurrently
+    nodeExceptions.assign(totalNodes, nullptr);
+    parallelPhaseActive = true;
+    threadPool->Run(totalNodes, [this](u32 i) {
+        if (!nodeSimulatedInStep[i]) return;
+        try {
+            NodeIndexSetter setter(i);
+            StackBaseSetter sbs;
+            SimulateFirmwareOfCurrentNode();
+        }
+        catch (...) {
+            nodeExceptions[i] = std::current_exception();
+        }
+    });
+    parallelPhaseActive = false;
+
+    FinishParallelPhase();
+
+    for (u32 i = 0; i < totalNodes; i++) {
+        if (nodeSimulatedInStep[i]) UpdateClusteringTracker(i);
+    }
+
+    //Exceptions are rethrown in node order so that the same exception is reported on every run
+    for (const std::exception_ptr& exception : nodeExceptions)
+    {
+        if (exception) std::rethrow_exception(exception);
+    }
+}
+
+void CherrySim::SimulateFirmwareOfCurrentNode()
+{
+    SimulateTimer();
+    SimulateServiceDiscovery();
+    SimulateUartInterrupts();
+    SimulateTimeslot();
+    try {
+        FruityHal::EventLooper();
+        SimulateFlashCommit();
+        SimulateBatteryUsage();
+        SimulateWatchDog();
+    }
+    catch (const NodeSystemResetException& e) {
+        //Node broke out of its current simulation and rebootet
+        RunOrStage([this]() {
+            if (simEventListener) simEventListener->CherrySimEventHandler("NODE_RESET");
+        });
+    }
+}
+
+void CherrySim::FinishParallelPhase()
+{
+    const u32 totalNodes = GetTotalNodes();
+
+    //Skip the ids that were handed out by the nodes during the parallel phase
+    u32 maxEventIdCount = 0;
+    u32 maxPacketIdCount = 0;
+    for (u32 i = 0; i < totalNodes; i++)
+    {
+        maxEventIdCount = std::max(maxEventIdCount, nodes[i].parallelEventIdCount);
+        maxPacketIdCount = std::max(maxPacketIdCount, nodes[i].parallelPacketIdCount);
+        nodes[i].parallelEventIdCount = 0;
+        nodes[i].parallelPacketIdCount = 0;
+    }
+    simState.globalEventIdCounter += maxEventIdCount * totalNodes;
+    simState.globalPacketIdCounter += maxPacketIdCount * totalNodes;
+
+    for (u32 i = 0; i < totalNodes; i++)
+    {
+        if (nodes[i].stagedOperations.empty()) continue;
+
+        NodeIndexSetter setter(i);
+        std::vector<std::function<void(void)>> operations;
+        operations.swap(nodes[i].stagedOperations);
+        for (const auto& operation : operations)
+        {
+            operation();
+        }
+    }
+}
+
+bool CherrySim::IsParallelPhaseActive() const
+{
+    return parallelPhaseActive;
+}
+
+MersenneTwister& CherrySim::GetRnd()
+{
+    return parallelPhaseActive ? currentNode->rnd : simState.rnd;
+}
+
+u32 CherrySim::NextGlobalEventId()
+{
+    if (!parallelPhaseActive) return simState.globalEventIdCounter++;
+
+    //Ids of concurrently simulated nodes are interleaved by node index, which keeps them unique and
+    //increasing for each node independent of the thread scheduling
+    return simState.globalEventIdCounter + currentNode->parallelEventIdCount++ * GetTotalNodes() + currentNode->index;
+}
+
+u32 CherrySim::NextGlobalPacketId()
+{
+    if (!parallelPhaseActive) return simState.globalPacketIdCounter++;
+
+    return simState.globalPacketIdCounter + currentNode->parallelPacketIdCount++ * GetTotalNodes() + currentNode->index;
+}
+
 
 void LogThrownCherrySimException(std::type_index index)
 {
@@ -1193,6 +1894,7 @@ void LogThrownCherrySimException(std::type_index index)
 
 void CherrySim::LogThrownException(std::type_index index)
 {
+    std::lock_guard<std::mutex> lock(loggedExceptionsMutex);
     this->loggedExceptions.emplace(index);
 }
 
@@ -1224,6 +1926,7 @@ void CherrySim::DoSendTerminalCommand(const NodeEntry& nodeEntry, const std::str
 
 bool CherrySim::CheckExceptionWasThrown(std::type_index index)
 {
+    std::lock_guard<std::mutex> lock(loggedExceptionsMutex);
     if (loggedExceptions.find(index) != loggedExceptions.end()) {
         return true;
     }
@@ -1847,6 +2550,14 @@ void CherrySim::RegisterTerminalPrintListener(TerminalPrintListener* callback)
 //Called for all terminal output from all nodes
 void CherrySim::TerminalPrintHandler(const char* message)
 {
+    if (parallelPhaseActive)
+    {
+        //Output of concurrently simulated nodes is forwarded in node order at the end of the step
+        RunOrStage([this, bufferedMessage = std::string(message)]() {
+            TerminalPrintHandler(bufferedMessage.c_str());
+        });
+        return;
+    }
     if (simConfig.useLogAccumulator)
     {
         logAccumulator += std::string(message);
@@ -1869,6 +2580,10 @@ Redirects all pointers used by the FruityMesh implementation to point to the cor
 */
 void CherrySim::SetNode(u32 i)
 {
+    //The firmware only changes the clustering of the selected node (except for the parallel phase of a step, after
+    //which all simulated nodes are updated)
+    if (currentNode != nullptr && !parallelPhaseActive) UpdateClusteringTracker(currentNode->index);
+
     if (i == 0xFFFFFFFF)
     {
         currentNode       = nullptr;
@@ -1894,7 +2609,7 @@ void CherrySim::SetNode(u32 i)
     simFicrPtr = &(nodes[i].ficr);
     simUicrPtr = &(nodes[i].uicr);
     simGpioPtr = &(nodes[i].gpio);
-    simFlashPtr = nodes[i].flash;
+    simFlashPtr = nodes[i].flash.GetData();
     simUartPtr = &(nodes[i].state.uartType);
     simRadioPtr = &(nodes[i].radio);
 
@@ -2027,6 +2742,11 @@ void CherrySim::InitNode(u32 i)
     new (&nodes[i]) NodeEntry();
 
     nodes[i].Initialize(i);
+
+    //Each node gets its own random stream for parallel stepping, derived from the seed and the node index
+    u32 nodeSeed = simConfig.seed ^ ((i + 1) * 0x9E3779B9UL);
+    if (nodeSeed == 0) nodeSeed = 1;
+    nodes[i].rnd.SetSeed(nodeSeed);
 }
 
 void CherrySim::SetFeaturesets()
@@ -2187,10 +2907,6 @@ void CherrySim::FlashNode(u32 i) {
     nodes[i].uicr.BOOTLOADERADDR = ChipsetToBootloaderAddr(GetChipset_CherrySim());
 
     //##### Configure Flash
-    //Put some data where the bootloader is supposed to be (add a version number)
-    //TODO: Having a hardcoded 1024 is not a nice thing to do to give the offset of the bootloader version
-    *((u32*)&nodes[i].flash[currentNode->uicr.BOOTLOADERADDR + 1024]) = 123;
-
     //TODO: Currently, we only support one specific SoftDevice per chipset
     //This should be refactored to store the used BLE Stack as part of the featureset
     if (GetChipset_CherrySim() == Chipset::CHIP_NRF52) {
@@ -2200,15 +2916,29 @@ void CherrySim::FlashNode(u32 i) {
         nodes[i].bleStackType = BleStackType::NRF_SD_140_ANY;
     }
 
-    if (nodes[i].bleStackType == BleStackType::NRF_SD_132_ANY) {
-        CheckedMemcpy(simFlashPtr, s132_mbr_and_header_nrf52_v5_1_0, sizeof(s132_mbr_and_header_nrf52_v5_1_0));
-    }
-    else if (nodes[i].bleStackType == BleStackType::NRF_SD_140_ANY) {
-        CheckedMemcpy(simFlashPtr, s140_mbr_and_header_nrf52840_v6_1_0, sizeof(s140_mbr_and_header_nrf52840_v6_1_0));
-    }
+    //The flash image only depends on the chipset, so it is created once for all nodes with the same BLE stack.
+    //Every node then gets a copy-on-write clone of it instead of writing and sharing its pages again.
+    std::unique_ptr<SimFlash>& goldenFlash = goldenFlashImages[nodes[i].bleStackType];
+    if (goldenFlash == nullptr) {
+        goldenFlash = std::make_unique<SimFlash>(nodes[i].flash.GetSize());
+
+        //Put some data where the bootloader is supposed to be (add a version number)
+        //TODO: Having a hardcoded 1024 is not a nice thing to do to give the offset of the bootloader version
+        *((u32*)&(*goldenFlash)[currentNode->uicr.BOOTLOADERADDR + 1024]) = 123;
 
-    //TODO: Add app, softdevice, etc,... from .hex files into flash
-    //Afterwards, we can use the normal size calculation for addresses without redefining it
+        if (nodes[i].bleStackType == BleStackType::NRF_SD_132_ANY) {
+            CheckedMemcpy(goldenFlash->GetData(), s132_mbr_and_header_nrf52_v5_1_0, sizeof(s132_mbr_and_header_nrf52_v5_1_0));
+        }
+        else if (nodes[i].bleStackType == BleStackType::NRF_SD_140_ANY) {
+            CheckedMemcpy(goldenFlash->GetData(), s140_mbr_and_header_nrf52840_v6_1_0, sizeof(s140_mbr_and_header_nrf52840_v6_1_0));
+        }
+
+        //TODO: Add app, softdevice, etc,... from .hex files into flash
+        //Afterwards, we can use the normal size calculation for addresses without redefining it
+
+        goldenFlash->SharePages();
+    }
+    nodes[i].flash.CloneFrom(*goldenFlash);
 
     // Add license
     GenerateLicense(i);
@@ -2246,9 +2976,8 @@ void CherrySim::BootCurrentNode()
     //Reset our GPIO Peripheral
     CheckedMemset(simGpioPtr, 0x00, sizeof(NRF_GPIO_Type));
 
-    //Create a queue for events    if (simGlobalStatePtr != nullptr) {
-    currentNode->eventQueue.~deque();
-    new (&(currentNode->eventQueue)) std::deque<simBleEvent>();
+    //Empty the queue for events, its memory is reused
+    currentNode->eventQueue.clear();
 
     //Set the Ble stack parameters in the node so that we can use them later
     SetBleStack(currentNode);
@@ -2281,6 +3010,207 @@ void CherrySim::BootCurrentNode()
     if(Conf::GetInstance().terminalMode == TerminalMode::DISABLED) Conf::GetInstance().terminalMode = TerminalMode::PROMPT;
 }
 
+//Returns true if both memories only differ in the given byte offsets of words
+static bool IsEqualApartFromWords(const void* a, const void* b, u32 size, std::initializer_list<u32> ignoredWordOffsets)
+{
+    for (u32 offset = 0; offset < size; offset += sizeof(u32))
+    {
+        if (std::find(ignoredWordOffsets.begin(), ignoredWordOffsets.end(), offset) != ignoredWordOffsets.end()) continue;
+        if (memcmp((const u8*)a + offset, (const u8*)b + offset, std::min<u32>(sizeof(u32), size - offset)) != 0) return false;
+    }
+    return true;
+}
+
+//Returns true if booting both nodes for the first time only differs in their identity, so that one can be cloned from the other
+bool CherrySim::HaveSameBootInputs(const NodeEntry& representative, const NodeEntry& node)
+{
+    if (representative.nodeConfiguration != node.nodeConfiguration
+        || representative.featuresetPointers != node.featuresetPointers
+        || representative.bleStackType != node.bleStackType
+        || representative.restartCounter != 0
+        || node.restartCounter != 0
+        || representative.fakeDfuVersion != node.fakeDfuVersion
+        || representative.fakeDfuVersionArmed != node.fakeDfuVersionArmed)
+    {
+        return false;
+    }
+
+    //The device id, serial number, node key, network id, node id and network key are patched into a clone
+    constexpr u32 deviceId = offsetof(NRF_FICR_Type, DEVICEID);
+    constexpr u32 customer = offsetof(NRF_UICR_Type, CUSTOMER);
+    constexpr u32 word = sizeof(u32);
+    return IsEqualApartFromWords(&representative.ficr, &node.ficr, sizeof(NRF_FICR_Type), { deviceId, deviceId + word })
+        && IsEqualApartFromWords(&representative.uicr, &node.uicr, sizeof(NRF_UICR_Type), {
+            customer + 2 * word, customer + 3 * word,
+            customer + 4 * word, customer + 5 * word, customer + 6 * word, customer + 7 * word,
+            customer + 9 * word, customer + 10 * word, customer + 12 * word,
+            customer + 13 * word, customer + 14 * word, customer + 15 * word, customer + 16 * word })
+        && memcmp(&representative.retainedRamMemory, &node.retainedRamMemory, sizeof(node.retainedRamMemory)) == 0
+        && memcmp(representative.flash.GetData(), node.flash.GetData(), node.flash.GetSize()) == 0;
+}
+
+//Returns true if the booted current node took its identity from its UICR and from nowhere else (e.g. from a record
+//in its flash or from its featureset), so that the identity of its clones can be derived from their UICR as well
+bool CherrySim::IsCurrentNodeIdentityFromUicr() const
+{
+    const NRF_UICR_Type& uicr = currentNode->uicr;
+    const Conf& config = GS->config;
+    const auto& nodeConfiguration = GS->node.configuration;
+    const EnrollmentState defaultEnrollmentState = config.defaultNetworkId != 0 ? EnrollmentState::ENROLLED : EnrollmentState::NOT_ENROLLED;
+
+    return uicr.CUSTOMER[0] == UICR_SETTINGS_MAGIC_WORD
+        && uicr.CUSTOMER[10] != EMPTY_WORD
+        && uicr.CUSTOMER[12] != EMPTY_WORD
+        && config.defaultNodeId == uicr.CUSTOMER[10]
+        && config.GetSerialNumberIndex() == uicr.CUSTOMER[12]
+        && nodeConfiguration.nodeId == config.defaultNodeId
+        && nodeConfiguration.networkId == config.defaultNetworkId
+        && nodeConfiguration.enrollmentState == defaultEnrollmentState
+        && memcmp(nodeConfiguration.networkKey, config.defaultNetworkKey, sizeof(config.defaultNetworkKey)) == 0
+        && GS->recordStorage.GetRecordData((u16)ModuleId::CONFIG).length.GetRaw() == 0
+        && GS->recordStorage.GetRecordData(GS->node.recordStorageId).length.GetRaw() == 0;
+}
+
+//Gives the current node a copy of the booted representative, as if it had been booted itself
+void CherrySim::CloneBootedNodeIntoCurrentNode(NodeEntry& representative)
+{
+    NodeEntry& node = *currentNode;
+
+    //The GlobalState is copied as a raw image like in a checkpoint, the terminal command queue and the
+    //current log line own heap memory and are constructed again as copies
+    node.gs.~GlobalState();
+    CheckedMemcpy((u8*)&node.gs, (const u8*)&representative.gs, sizeof(GlobalState));
+
+    const u32 moduleMemoryBlockSize = representative.gs.moduleAllocator.GetMemorySize();
+    node.moduleMemoryBlock = (u8*)new u32[moduleMemoryBlockSize / sizeof(u32) + 1];
+    CheckedMemcpy(node.moduleMemoryBlock, representative.moduleMemoryBlock, moduleMemoryBlockSize);
+    const u32 halMemorySize = FruityHal::GetHalMemorySize() / sizeof(u32) + 1;
+    u32* halMemory = new u32[halMemorySize];
+    CheckedMemcpy(halMemory, representative.gs.halMemory, halMemorySize * sizeof(u32));
+
+    //Everything that points into the memory of the representative is moved to the memory of the node
+    PointerRelocator relocator;
+    relocator.AddRegion((uintptr_t)&representative, (uintptr_t)&node, sizeof(NodeEntry));
+    relocator.AddRegion((uintptr_t)representative.moduleMemoryBlock, (uintptr_t)node.moduleMemoryBlock, moduleMemoryBlockSize);
+    relocator.AddRegion((uintptr_t)representative.gs.halMemory, (uintptr_t)halMemory, FruityHal::GetHalMemorySize());
+    relocator.AddRegion((uintptr_t)representative.flash.GetData(), (uintptr_t)node.flash.GetData(), node.flash.GetSize());
+
+    relocator.Relocate(node.gs);
+    using TerminalCommandQueue = decltype(node.gs.terminal.terminalCommandQueue);
+    new (&node.gs.terminal.terminalCommandQueue) TerminalCommandQueue(representative.gs.terminal.terminalCommandQueue);
+    new (&node.gs.logger.currentString) std::string(representative.gs.logger.currentString);
+    relocator.Relocate(node.moduleMemoryBlock, moduleMemoryBlockSize);
+    relocator.Relocate(halMemory, FruityHal::GetHalMemorySize());
+
+    //Peripherals, SoftDevice and the simulator state that the boot changed
+    CheckedMemcpy(&node.gpio, &representative.gpio, sizeof(node.gpio));
+    CheckedMemcpy(&node.radio, &representative.radio, sizeof(node.radio));
+    node.state = representative.state;
+    relocator.Relocate(node.state);
+    node.currentEvent = representative.currentEvent;
+    relocator.Relocate(node.currentEvent);
+    node.retainedRamMemory = representative.retainedRamMemory;
+    relocator.Relocate(node.retainedRamMemory);
+    node.led1On = representative.led1On;
+    node.led2On = representative.led2On;
+    node.led3On = representative.led3On;
+    node.nanoAmperePerMsTotal = representative.nanoAmperePerMsTotal;
+    node.restartCounter = representative.restartCounter;
+    node.watchdogTimeout = representative.watchdogTimeout;
+    node.lastWatchdogFeedTime = representative.lastWatchdogFeedTime;
+    node.rebootReason = representative.rebootReason;
+    node.bmgWasInit = representative.bmgWasInit;
+    node.twiWasInit = representative.twiWasInit;
+    node.Tlv49dA1b6WasInit = representative.Tlv49dA1b6WasInit;
+    node.spiWasInit = representative.spiWasInit;
+    node.lis2dh12WasInit = representative.lis2dh12WasInit;
+    node.bme280WasInit = representative.bme280WasInit;
+    node.lis2dh12InertialInterruptEnabled = representative.lis2dh12InertialInterruptEnabled;
+    node.lastMovementSimTimeMs = representative.lastMovementSimTimeMs;
+    node.bleStackMaxTotalConnections = representative.bleStackMaxTotalConnections;
+    node.bleStackMaxPeripheralConnections = representative.bleStackMaxPeripheralConnections;
+    node.bleStackMaxCentralConnections = representative.bleStackMaxCentralConnections;
+    node.timeslotRadioSignalCallback = representative.timeslotRadioSignalCallback;
+    node.timeslotCloseSessionRequested = representative.timeslotCloseSessionRequested;
+    node.timeslotRequested = representative.timeslotRequested;
+    node.timeslotActive = representative.timeslotActive;
+
+    node.eventQueue.clear();
+    for (u32 i = 0; i < representative.eventQueue.size(); i++)
+    {
+        node.eventQueue.push_back(representative.eventQueue[i]);
+        relocator.Relocate(node.eventQueue[i]);
+        node.eventQueue[i].globalId = NextGlobalEventId();
+    }
+    node.interruptQueue = representative.interruptQueue;
+    node.gpioInitializedPins = representative.gpioInitializedPins;
+    for (auto& pin : node.gpioInitializedPins) relocator.Relocate(pin.second);
+
+    node.flash.Load(representative.flash.GetData());
+
+    //Derive the identity of the node from its UICR as the boot did for the representative (see IsCurrentNodeIdentityFromUicr)
+    Conf& config = Conf::GetInstance();
+    CheckedMemset(config.configuration.nodeKey, 0x11, sizeof(config.configuration.nodeKey));
+    config.defaultNetworkId = 0;
+    config.LoadDeviceConfiguration();
+
+    Node& meshNode = GS->node;
+    meshNode.configuration.enrollmentState = config.defaultNetworkId != 0 ? EnrollmentState::ENROLLED : EnrollmentState::NOT_ENROLLED;
+    meshNode.configuration.nodeId = config.defaultNodeId;
+    meshNode.configuration.networkId = config.defaultNetworkId;
+    CheckedMemcpy(meshNode.configuration.networkKey, config.defaultNetworkKey, sizeof(meshNode.configuration.networkKey));
+
+    //Same as in Node::ConfigurationLoadedHandler, which also draws the random boot number
+    GS->appTimerRandomOffsetDs = meshNode.configuration.nodeId % 100;
+    meshNode.randomBootNumber = Utility::GetRandomInteger();
+    meshNode.clusterId = meshNode.GenerateClusterID();
+    if (meshNode.meshAdvJobHandle != nullptr) meshNode.UpdateJoinMePacket();
+
+    MeshAccessModule* meshAccessModule = (MeshAccessModule*)meshNode.GetModuleById(ModuleId::MESH_ACCESS_MODULE);
+    if (meshAccessModule != nullptr) meshAccessModule->UpdateMeshAccessBroadcastPacket();
+
+    ChooseSimulatorTerminal();
+}
+
+void CherrySim::BootAllNodes()
+{
+    //Each node is cloned from the first node that has the same boot inputs, which must be booted itself
+    std::vector<u32> representatives(GetTotalNodes());
+    std::vector<u32> candidates;
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        representatives[i] = i;
+        if (!simConfig.cloneBootedNodes) continue;
+
+        for (u32 candidate : candidates)
+        {
+            if (HaveSameBootInputs(nodes[candidate], nodes[i]))
+            {
+                representatives[i] = candidate;
+                break;
+            }
+        }
+        if (representatives[i] == i) candidates.push_back(i);
+    }
+
+    clonedNodeCount = 0;
+    std::vector<bool> cloneable(GetTotalNodes(), false);
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        NodeIndexSetter setter(i);
+        if (representatives[i] != i && cloneable[representatives[i]])
+        {
+            CloneBootedNodeIntoCurrentNode(nodes[representatives[i]]);
+            clonedNodeCount++;
+        }
+        else
+        {
+            BootCurrentNode();
+            cloneable[i] = simConfig.cloneBootedNodes && IsCurrentNodeIdentityFromUicr();
+        }
+    }
+}
+
 void CherrySim::ErasePage(u32 pageAddress)
 {
     u32* p = (u32*)pageAddress;
@@ -2355,15 +3285,27 @@ void CherrySim::ResetCurrentNode(RebootReason rebootReason, bool throwException,
 }
 
 void CherrySim::ShutdownCurrentNode() {
-    //Clean up everything that is remaining
-    delete[] currentNode->moduleMemoryBlock;
+    //Cast is needed because the following passage from the C++ Standard:
+    //"This implies that an object cannot be deleted using a pointer of type void* because there are no objects of type void"
+    u32* halMemory = (u32*)GS->halMemory;
 
     //Delete all simulation step handlers
     CleanSimulationStepHandlers(currentNode);
 
-    //Cast is needed because the following passage from the C++ Standard:
-    //"This implies that an object cannot be deleted using a pointer of type void* because there are no objects of type void"
-    u32* halMemory = (u32*)GS->halMemory;
+    //Checkpoints point into the memory of the node, so it is only freed once they are discarded
+    //A node might be reset during the parallel phase, so the shared set is only modified once the phase is over
+    if (!checkpoints.empty())
+    {
+        u32* moduleMemory = (u32*)currentNode->moduleMemoryBlock;
+        RunOrStage([this, moduleMemory, halMemory]() {
+            retainedNodeMemory.insert(moduleMemory);
+            retainedNodeMemory.insert(halMemory);
+        });
+        return;
+    }
+
+    //Clean up everything that is remaining
+    delete[] currentNode->moduleMemoryBlock;
     delete[] halMemory;
 }
 
@@ -2471,6 +3413,9 @@ void CherrySim::SimCommitSomeFlashOperations(const uint8_t* failData, uint16_t n
 //Wenn eine andere node gerade eine verbindung zu diesem Partner aufbauen will, wird das advertisen der anderen node gestoppt, die verbindung wird
 //connected und es wird an beide nodes ein Event geschickt, dass sie nun verbunden sind
 void CherrySim::SimulateAdvertising() {
+    //While a preclustered mesh is built, the nodes must only connect along the given tree
+    if (preclusteringActive) return;
+
     //Check for other nodes that are scanning and send them the events
     if (currentNode->state.advertisingActive) {
         if (ShouldSimIvTrigger(currentNode->state.advertisingIntervalMs)) {
@@ -2478,71 +3423,142 @@ void CherrySim::SimulateAdvertising() {
             const u32 startIndex = (indexStep == 1 ? 0 : simState.rnd.NextU32() % indexStep);
             const u32 nodeCount = GetTotalNodes() - GetAssetNodes();
 
+            //Only nodes in the surrounding grid cells can be in range. All others would not pass the
+            //early out in GetReceptionRssi and would therefore neither receive the event nor consume
+            //a random number, so skipping them does not change the outcome of the simulation.
+            spatialGrid.GetCandidates(currentNode->GetXinMeters(), currentNode->GetYinMeters(), spatialGridCandidates);
+
+            if (simConfig.batchAdvertisingReception) {
+                SimulateAdvertisingBatch(indexStep, startIndex, nodeCount);
+                return;
+            }
+
             //Distribute the event to all nodes in range
-            for (u32 i = startIndex; i < nodeCount; i += indexStep) {
+            for (const u32 i : spatialGridCandidates) {
+                if (i >= nodeCount) break;
+                if (i < startIndex || (i - startIndex) % indexStep != 0) continue;
                 if (i != currentNode->index) {
                     //If the random value hits the probability, the event is sent
-                    const uint32_t probability = [this, indexStep, i] {
-                        const uint32_t rawProbability = CalculateReceptionProbabilityForAdvertisement(currentNode, &nodes[i]);
-                        if (simConfig.perfectReceptionProbabilityForAdvertising) {
-                            return rawProbability;
-                        }
-                        else {
-                            const uint32_t scaledProbability = indexStep * rawProbability;
-                            // Catch overflow (i.e. if the base probability was large enough that the
-                            // increase to balance our the index step took the probability over 1)
-                            if (scaledProbability / indexStep != rawProbability)
-                            {
-                                SIMEXCEPTIONFORCE(IllegalStateException);
-                            }
-                            return scaledProbability;
-                        }
-                    }();
-
-                    //If the other node is scanning
-                    if (nodes[i].state.scanningActive) {
-                        if (PSRNG(probability)) {
-                            simBleEvent s;
-                            s.globalId = simState.globalEventIdCounter++;
-                            s.bleEvent.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
-                            s.bleEvent.header.evt_len = s.globalId;
-                            s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
-
-                            CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.data, &currentNode->state.advertisingData, currentNode->state.advertisingDataLength);
-                            s.bleEvent.evt.gap_evt.params.adv_report.dlen = currentNode->state.advertisingDataLength;
-                            CheckedMemset(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr, 0, sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr));
-                            s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr_type = (u8)currentNode->address.addr_type;
-                            static_assert(sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr) == sizeof(currentNode->address.addr), "See next line.");
-                            CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr, &currentNode->address.addr, sizeof(currentNode->address.addr));
-                            //TODO: bleEvent.evt.gap_evt.params.adv_report.peer_addr = ...;
-                            s.bleEvent.evt.gap_evt.params.adv_report.rssi = (i8)GetReceptionRssi(currentNode, &nodes[i]);
-                            s.bleEvent.evt.gap_evt.params.adv_report.scan_rsp = 0;
-                            s.bleEvent.evt.gap_evt.params.adv_report.type = (u8)currentNode->state.advertisingType;
-
-                            nodes[i].eventQueue.push_back(s);
-                        }
-                    }
-                    //If the other node is connecting
-                    else if (nodes[i].state.connectingActive && currentNode->state.advertisingType == FruityHal::BleGapAdvType::ADV_IND) {
-                        //If the other node matches our partnerId we are connecting to
-                        if (memcmp(&nodes[i].state.connectingPartnerAddr, &currentNode->address, sizeof(FruityHal::BleGapAddr)) == 0) {
-                            if (PSRNG(probability)) {
-
-                                ConnectMasterToSlave(&nodes[i], currentNode);
-
-                                //Disable advertising for the own node, because this will be stopped after a connection is made
-                                //Then, Immediately return to not broadcast more packets
-                                currentNode->state.advertisingActive = false;
-                                return;
-                            }
-                        }
-                    }
+                    const uint32_t probability = ScaleAdvertisingReceptionProbability(CalculateReceptionProbabilityForAdvertisement(currentNode, &nodes[i]), indexStep);
+
+                    //Immediately return to not broadcast more packets once connected
+                    if (DeliverAdvertisement(&nodes[i], probability, nullptr)) return;
                 }
             }
         }
     }
 }
 
+//Computes the rssi of all receivers of the advertisement of the current node at once. Only nodes that are scanning or
+//connecting to the current node are considered, so the random numbers are drawn in a different order than by
+//SimulateAdvertising and the reported rssi is the same that decided about the reception.
+void CherrySim::SimulateAdvertisingBatch(u32 indexStep, u32 startIndex, u32 nodeCount)
+{
+    advertisingBatchReceivers.clear();
+    advertisingBatchRssiWithoutNoise.clear();
+    for (const u32 i : spatialGridCandidates) {
+        if (i >= nodeCount) break;
+        if (i < startIndex || (i - startIndex) % indexStep != 0) continue;
+        if (i == currentNode->index) continue;
+
+        const NodeEntry* receiver = &nodes[i];
+        const bool connecting = receiver->state.connectingActive
+            && currentNode->state.advertisingType == FruityHal::BleGapAdvType::ADV_IND
+            && memcmp(&receiver->state.connectingPartnerAddr, &currentNode->address, sizeof(FruityHal::BleGapAddr)) == 0;
+        if (!receiver->state.scanningActive && !connecting) continue;
+
+        const auto scanIntervalMs = receiver->state.connectingActive ? receiver->state.connectingIntervalMs : receiver->state.scanIntervalMs;
+        if (scanIntervalMs == 0 || IsOutOfRadioRange(currentNode, receiver)) continue;
+
+        advertisingBatchReceivers.push_back(i);
+        advertisingBatchRssiWithoutNoise.push_back(GetCachedReceptionRssiNoNoise(currentNode, receiver));
+    }
+
+    const u32 numReceivers = static_cast<u32>(advertisingBatchReceivers.size());
+    advertisingBatchRssi.resize(numReceivers);
+    ComputeRssiWithNoiseBatch(
+        advertisingBatchRssiWithoutNoise.data(),
+        numReceivers,
+        simConfig.rssiNoise ? &simState.rnd : nullptr,
+        rssiNoiseStddev,
+        rssiNoiseMean,
+        MAX_RECEPTION_RSSI,
+        advertisingBatchRssi.data());
+
+    for (u32 k = 0; k < numReceivers; k++) {
+        NodeEntry* receiver = &nodes[advertisingBatchReceivers[k]];
+        const uint32_t probability = ScaleAdvertisingReceptionProbability(CalculateReceptionProbabilityForAdvertisementFromRssi(receiver, advertisingBatchRssi[k]), indexStep);
+
+        if (DeliverAdvertisement(receiver, probability, &advertisingBatchRssi[k])) return;
+    }
+}
+
+//The probability is increased to balance out that only every indexStep-th node is considered
+uint32_t CherrySim::ScaleAdvertisingReceptionProbability(uint32_t rawProbability, u32 indexStep)
+{
+    if (simConfig.perfectReceptionProbabilityForAdvertising) {
+        return rawProbability;
+    }
+    else {
+        const uint32_t scaledProbability = indexStep * rawProbability;
+        // Catch overflow (i.e. if the base probability was large enough that the
+        // increase to balance our the index step took the probability over 1)
+        if (scaledProbability / indexStep != rawProbability)
+        {
+            SIMEXCEPTIONFORCE(IllegalStateException);
+        }
+        return scaledProbability;
+    }
+}
+
+//Delivers the advertisement of the current node to the receiver with the given probability, either as an advertising
+//report or by connecting to it. If rssi is nullptr, the reported rssi is computed separately. Returns true if the
+//receiver connected to the current node, which stops the advertising.
+bool CherrySim::DeliverAdvertisement(NodeEntry* receiver, uint32_t probability, const float* rssi)
+{
+    //If the other node is scanning
+    if (receiver->state.scanningActive) {
+        if (PSRNG(probability)) {
+            simBleEvent s;
+            s.globalId = NextGlobalEventId();
+            s.bleEvent.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
+            s.bleEvent.header.evt_len = s.globalId;
+            s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+
+            CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.data, &currentNode->state.advertisingData, currentNode->state.advertisingDataLength);
+            s.bleEvent.evt.gap_evt.params.adv_report.dlen = currentNode->state.advertisingDataLength;
+            CheckedMemset(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr, 0, sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr));
+            s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr_type = (u8)currentNode->address.addr_type;
+            static_assert(sizeof(s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr) == sizeof(currentNode->address.addr), "See next line.");
+            CheckedMemcpy(&s.bleEvent.evt.gap_evt.params.adv_report.peer_addr.addr, &currentNode->address.addr, sizeof(currentNode->address.addr));
+            //TODO: bleEvent.evt.gap_evt.params.adv_report.peer_addr = ...;
+            s.bleEvent.evt.gap_evt.params.adv_report.rssi = (i8)(rssi != nullptr ? *rssi : GetReceptionRssi(currentNode, receiver));
+            s.bleEvent.evt.gap_evt.params.adv_report.scan_rsp = 0;
+            s.bleEvent.evt.gap_evt.params.adv_report.type = (u8)currentNode->state.advertisingType;
+
+            receiver->eventQueue.push_back(s);
+
+            if (pcapWriter) CaptureAdvertisement(receiver, s.bleEvent.evt.gap_evt.params.adv_report.rssi);
+        }
+    }
+    //If the other node is connecting
+    else if (receiver->state.connectingActive && currentNode->state.advertisingType == FruityHal::BleGapAdvType::ADV_IND) {
+        //If the other node matches our partnerId we are connecting to
+        if (memcmp(&receiver->state.connectingPartnerAddr, &currentNode->address, sizeof(FruityHal::BleGapAddr)) == 0) {
+            if (PSRNG(probability)) {
+                if (pcapWriter) CaptureAdvertisement(receiver, (i8)(rssi != nullptr ? *rssi : GetCapturedReceptionRssi(currentNode, receiver)));
+
+                ConnectMasterToSlave(receiver, currentNode);
+
+                //Disable advertising for the own node, because this will be stopped after a connection is made
+                currentNode->state.advertisingActive = false;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 ble_gap_addr_t CherrySim::Convert(const FruityHal::BleGapAddr* address)
 {
     ble_gap_addr_t addr;
@@ -2625,11 +3641,15 @@ void CherrySim::ConnectMasterToSlave(NodeEntry* master, NodeEntry* slave)
     freeInConnection->isCentral = false;
     freeInConnection->lastReceivedPacketTimestampMs = simState.simTimeMs;
     freeInConnection->connectionSetupTimeMs = simState.simTimeMs;
+    freeInConnection->maxTxOctets = LL_DEFAULT_MAX_TX_OCTETS;
+    freeInConnection->currentPacketFragmentsSent = 0;
+    freeInConnection->nextConnectionEventTimeUs = (uint64_t)slave->state.timeMs * 1000;
+    freeInConnection->connParamUpdateRequestSent = false;
 
     //Generate an event for the current node
     simBleEvent s2;
     CheckedMemset(&s2, 0, sizeof(s2));
-    s2.globalId = simState.globalEventIdCounter++;
+    s2.globalId = NextGlobalEventId();
     s2.bleEvent.header.evt_id = BLE_GAP_EVT_CONNECTED;
     s2.bleEvent.header.evt_len = s2.globalId;
     s2.bleEvent.evt.gap_evt.conn_handle = simState.globalConnHandleCounter;
@@ -2679,6 +3699,10 @@ void CherrySim::ConnectMasterToSlave(NodeEntry* master, NodeEntry* slave)
     freeOutConnection->isCentral = true;
     freeOutConnection->lastReceivedPacketTimestampMs = simState.simTimeMs;
     freeOutConnection->connectionSetupTimeMs = simState.simTimeMs;
+    freeOutConnection->maxTxOctets = LL_DEFAULT_MAX_TX_OCTETS;
+    freeOutConnection->currentPacketFragmentsSent = 0;
+    freeOutConnection->nextConnectionEventTimeUs = (uint64_t)master->state.timeMs * 1000;
+    freeOutConnection->connParamUpdateRequestPending = false;
 
     //Save connection references
     freeInConnection->partnerConnection = freeOutConnection;
@@ -2687,7 +3711,7 @@ void CherrySim::ConnectMasterToSlave(NodeEntry* master, NodeEntry* slave)
     //Generate an event for the remote node
     simBleEvent s;
     CheckedMemset(&s, 0, sizeof(s));
-    s.globalId = simState.globalEventIdCounter++;
+    s.globalId = NextGlobalEventId();
     s.bleEvent.header.evt_id = BLE_GAP_EVT_CONNECTED;
     s.bleEvent.header.evt_len = s.globalId;
     s.bleEvent.evt.gap_evt.conn_handle = simState.globalConnHandleCounter;
@@ -2733,18 +3757,14 @@ u32 CherrySim::DisconnectSimulatorConnection(SoftdeviceConnection* connection, u
         SIMEXCEPTIONFORCE(IllegalStateException);
     }
 
-    //Clear the transmitbuffers for both nodes
-    CheckedMemset(connection->reliableBuffers, 0x00, sizeof(connection->reliableBuffers));
-    CheckedMemset(connection->unreliableBuffers, 0x00, sizeof(connection->unreliableBuffers));
-    CheckedMemset(partnerConnection->reliableBuffers, 0x00, sizeof(connection->reliableBuffers));
-    CheckedMemset(partnerConnection->unreliableBuffers, 0x00, sizeof(connection->unreliableBuffers));
-
     //#### Our own node
+    connection->reliableBuffers.Clear();
+    connection->unreliableBuffers.Clear();
     connection->connectionActive = false;
 
     simBleEvent s1;
     CheckedMemset(&s1, 0, sizeof(s1));
-    s1.globalId = simState.globalEventIdCounter++;
+    s1.globalId = NextGlobalEventId();
     s1.bleEvent.header.evt_id = BLE_GAP_EVT_DISCONNECTED;
     s1.bleEvent.header.evt_len = s1.globalId;
     s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
@@ -2752,16 +3772,24 @@ u32 CherrySim::DisconnectSimulatorConnection(SoftdeviceConnection* connection, u
     connection->owningNode->eventQueue.push_back(s1);
 
     //#### Remote node
-    partnerConnection->connectionActive = false;
+    //During parallel stepping, the partner is only disconnected at the end of the step. It might have
+    //disconnected or rebooted on its own in the meantime, in which case it already got its event.
+    RunOrStage([this, partnerNode, partnerConnection, hciReasonPartner]() {
+        if (!partnerConnection->connectionActive) return;
 
-    simBleEvent s2;
-    CheckedMemset(&s2, 0, sizeof(s2));
-    s2.globalId = simState.globalEventIdCounter++;
-    s2.bleEvent.header.evt_id = BLE_GAP_EVT_DISCONNECTED;
-    s2.bleEvent.header.evt_len = s2.globalId;
-    s2.bleEvent.evt.gap_evt.conn_handle = partnerConnection->connectionHandle;
-    s2.bleEvent.evt.gap_evt.params.disconnected.reason = hciReasonPartner;
-    partnerNode->eventQueue.push_back(s2);
+        partnerConnection->reliableBuffers.Clear();
+        partnerConnection->unreliableBuffers.Clear();
+        partnerConnection->connectionActive = false;
+
+        simBleEvent s2;
+        CheckedMemset(&s2, 0, sizeof(s2));
+        s2.globalId = NextGlobalEventId();
+        s2.bleEvent.header.evt_id = BLE_GAP_EVT_DISCONNECTED;
+        s2.bleEvent.header.evt_len = s2.globalId;
+        s2.bleEvent.evt.gap_evt.conn_handle = partnerConnection->connectionHandle;
+        s2.bleEvent.evt.gap_evt.params.disconnected.reason = hciReasonPartner;
+        partnerNode->eventQueue.push_back(s2);
+    });
 
     return NRF_SUCCESS;
 }
@@ -2772,7 +3800,7 @@ void CherrySim::SimulateTimeouts() {
 
         simBleEvent s;
         CheckedMemset(&s, 0, sizeof(s));
-        s.globalId = simState.globalEventIdCounter++;
+        s.globalId = NextGlobalEventId();
         s.bleEvent.header.evt_id = BLE_GAP_EVT_TIMEOUT;
         s.bleEvent.header.evt_len = s.globalId;
         s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
@@ -2800,7 +3828,14 @@ void CherrySim::SimulateUartInterrupts()
 
 void CherrySim::SendUartCommand(NodeId nodeId, const u8* message, u32 messageLength)
 {
-    SoftdeviceState* state = &(cherrySimInstance->FindUniqueNodeById(nodeId)->state);
+    NodeEntry* node = cherrySimInstance->FindUniqueNodeById(nodeId);
+    cherrySimInstance->AppendToReplayJournal(ReplayJournalRecordType::UART_INPUT, node->index, std::string((const char*)message, messageLength));
+    SendUartInput(node, message, messageLength);
+}
+
+void CherrySim::SendUartInput(NodeEntry* node, const u8* message, u32 messageLength)
+{
+    SoftdeviceState* state = &(node->state);
     u32 oldBufferLength = state->uartBufferLength;
 
     if (state->uartBufferLength + messageLength > state->uartBuffer.size()) {
@@ -2816,28 +3851,23 @@ void CherrySim::SendUartCommand(NodeId nodeId, const u8* message, u32 messageLen
 // Generates writes
 //#########################################################################################
 
-//This function compares the globalPacketIds of all packets in the reliable and unreliable buffers
+//This function compares the globalPacketIds of the oldest packets in the reliable and unreliable buffers
 //then, it returns the packet that was inserted first into one of these buffers and should therefore be sent
 SoftDeviceBufferedPacket* getNextPacketToWrite(SoftdeviceConnection* connection)
 {
-    u32 lowestGlobalId = UINT32_MAX;
-    SoftDeviceBufferedPacket* packet = nullptr;
+    SoftDeviceBufferedPacket* reliablePacket = connection->reliableBuffers.Front();
+    SoftDeviceBufferedPacket* unreliablePacket = connection->unreliableBuffers.Front();
 
-    //We only have 1 unreliable buffer in the Softdevice
-    if (connection->reliableBuffers[0].sender != nullptr) {
-        lowestGlobalId = connection->reliableBuffers[0].globalPacketId;
-        packet = connection->reliableBuffers + 0;
-    }
-
-    for (int k = 0; k < SIM_NUM_UNRELIABLE_BUFFERS; k++) {
-        if (connection->unreliableBuffers[k].sender != nullptr && connection->unreliableBuffers[k].globalPacketId < lowestGlobalId)
-        {
-            lowestGlobalId = connection->unreliableBuffers[k].globalPacketId;
-            packet = connection->unreliableBuffers + k;
-        }
-    }
+    if (reliablePacket == nullptr) return unreliablePacket;
+    if (unreliablePacket == nullptr) return reliablePacket;
+    return reliablePacket->globalPacketId < unreliablePacket->globalPacketId ? reliablePacket : unreliablePacket;
+}
 
-    return packet;
+//Removes a packet returned by getNextPacketToWrite from the softdevice buffer
+void removeWrittenPacket(SoftdeviceConnection* connection, SoftDeviceBufferedPacket* packet)
+{
+    if (packet == connection->reliableBuffers.Front()) connection->reliableBuffers.PopFront();
+    else connection->unreliableBuffers.PopFront();
 }
 
 void CherrySim::SendUnreliableTxCompleteEvent(NodeEntry* node, int connHandle, u8 packetCount)
@@ -2845,7 +3875,7 @@ void CherrySim::SendUnreliableTxCompleteEvent(NodeEntry* node, int connHandle, u
     if (packetCount > 0) {
         simBleEvent s2;
         CheckedMemset(&s2, 0, sizeof(s2));
-        s2.globalId = simState.globalEventIdCounter++;
+        s2.globalId = NextGlobalEventId();
         s2.bleEvent.header.evt_id = BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE;
         s2.bleEvent.header.evt_len = s2.globalId;
         s2.bleEvent.evt.gattc_evt.conn_handle = connHandle;
@@ -2855,6 +3885,159 @@ void CherrySim::SendUnreliableTxCompleteEvent(NodeEntry* node, int connHandle, u
     }
 }
 
+//Connection intervals are stored in truncated milliseconds but are always a multiple of 1.25 ms
+static u32 GetConnectionIntervalUs(const SoftdeviceConnection* connection)
+{
+    const u32 units = ((u32)connection->connectionInterval * 1000 + CONFIG_UNIT_1_25_MS - 1) / CONFIG_UNIT_1_25_MS;
+    return std::max<u32>(units, 6) * CONFIG_UNIT_1_25_MS;
+}
+
+//Returns the airtime of one exchange in a connection event, which is the data PDU with the given payload,
+//the empty PDU that acknowledges it and the inter frame spaces after both of them
+u32 CherrySim::GetLinkLayerExchangeAirtimeUs(const SoftdeviceConnection* connection, u32 payloadOctets) const
+{
+    const u32 phyMbps = simConfig.connectionPhyMbps == 2 ? 2 : 1;
+    const u32 preambleOctets = phyMbps;
+    const u32 micOctets = connection->connectionEncrypted ? LL_MIC_OCTETS : 0;
+    const u32 dataPduOctets = preambleOctets + LL_ACCESS_ADDRESS_OCTETS + LL_HEADER_OCTETS + payloadOctets + micOctets + LL_CRC_OCTETS;
+    const u32 emptyPduOctets = preambleOctets + LL_ACCESS_ADDRESS_OCTETS + LL_HEADER_OCTETS + LL_CRC_OCTETS;
+
+    return (dataPduOctets + emptyPduOctets) * 8 / phyMbps + 2 * LL_INTER_FRAME_SPACE_US;
+}
+
+static u32 GetL2capPacketOctets(const SoftDeviceBufferedPacket* packet)
+{
+    const u32 attValueLength = packet->isHvx ? (u32)(uintptr_t)packet->params.hvxParams.p_len : packet->params.writeParams.len;
+    return L2CAP_HEADER_OCTETS + ATT_HEADER_OCTETS + attValueLength;
+}
+
+//Simulates all connection events of a connection that took place since the last simulation step. The connections of
+//a node share the radio, so each event may only use its share of the connection interval, up to the event length.
+//The packets are fragmented according to the data length and a fragment that the partner does not receive is sent
+//again. As in the link layer, two consecutive fragments that are not received close the connection event.
+void CherrySim::SimulateConnectionEvents(SoftdeviceConnection* connection)
+{
+    //Simulate timeouts if messages can't be send anymore.
+    SoftDeviceBufferedPacket* oldestPacket = getNextPacketToWrite(connection);
+    if (oldestPacket != nullptr && simState.simTimeMs - oldestPacket->queueTimeMs > 30 * 1000)
+    {
+        DisconnectSimulatorConnection(connection, BLE_HCI_CONNECTION_TIMEOUT, BLE_HCI_CONNECTION_TIMEOUT);
+        return;
+    }
+
+    const u32 receptionProbability = CalculateReceptionProbabilityForConnection(connection->owningNode, connection->partner);
+    if (receptionProbability != 0)
+    {
+        connection->lastReceivedPacketTimestampMs = simState.simTimeMs;
+    }
+
+    // Simulate timeouts if there was no message received within connection interval
+    if (simState.simTimeMs >= connection->lastReceivedPacketTimestampMs + connection->connectionSupervisionTimeoutMs)
+    {
+        DisconnectSimulatorConnection(connection, BLE_HCI_CONNECTION_TIMEOUT, BLE_HCI_CONNECTION_TIMEOUT);
+        return;
+    }
+
+    const u32 intervalUs = GetConnectionIntervalUs(connection);
+    const u32 numConnections = std::max<u32>(GetNumSimConnections(currentNode), 1);
+    const u32 eventLengthUs = std::min(simConfig.connectionEventLengthUs, intervalUs / numConnections);
+    const uint64_t nodeTimeUs = (uint64_t)currentNode->state.timeMs * 1000;
+
+    for (; connection->nextConnectionEventTimeUs <= nodeTimeUs; connection->nextConnectionEventTimeUs += intervalUs)
+    {
+        const u32 eventAgeMs = (u32)((nodeTimeUs - connection->nextConnectionEventTimeUs) / 1000);
+        const u32 eventSimTimeMs = simState.simTimeMs > eventAgeMs ? simState.simTimeMs - eventAgeMs : 0;
+
+        u32 usedAirtimeUs = 0;
+        u32 packetsSent = 0;
+        u32 unreliablePacketsSent = 0;
+        u32 consecutiveCrcErrors = 0;
+        bool eventOpen = true;
+
+        while (eventOpen)
+        {
+            SoftDeviceBufferedPacket* packet = getNextPacketToWrite(connection);
+            if (packet == nullptr) break;
+            if (simConfig.connectionMaxPacketsPerEvent != 0 && packetsSent >= simConfig.connectionMaxPacketsPerEvent) break;
+
+            const u32 l2capOctets = GetL2capPacketOctets(packet);
+            const u32 numFragments = (l2capOctets + connection->maxTxOctets - 1) / connection->maxTxOctets;
+            const u32 fragmentOctets = connection->currentPacketFragmentsSent + 1u < numFragments
+                ? connection->maxTxOctets
+                : l2capOctets - (numFragments - 1) * connection->maxTxOctets;
+
+            //The first exchange of an event is always made so that long fragments can't stall the connection
+            const u32 airtimeUs = GetLinkLayerExchangeAirtimeUs(connection, fragmentOctets);
+            if (usedAirtimeUs > 0 && usedAirtimeUs + airtimeUs > eventLengthUs) break;
+            const uint64_t exchangeTimeUs = (uint64_t)eventSimTimeMs * 1000 + usedAirtimeUs;
+            usedAirtimeUs += airtimeUs;
+
+            const bool received = PSRNG(receptionProbability);
+            if (pcapWriter) CaptureConnectionFragment(connection, packet, connection->currentPacketFragmentsSent, exchangeTimeUs, received);
+            if (!received)
+            {
+                SIMSTATCOUNT("connectionCrcErrors");
+                consecutiveCrcErrors++;
+                if (consecutiveCrcErrors >= 2) break;
+                continue;
+            }
+            consecutiveCrcErrors = 0;
+
+            connection->currentPacketFragmentsSent++;
+            if (connection->currentPacketFragmentsSent < numFragments) continue;
+            connection->currentPacketFragmentsSent = 0;
+            packetsSent++;
+
+            SIMSTATAVG("connectionPacketLatencyMs", eventSimTimeMs > packet->queueTimeMs ? eventSimTimeMs - packet->queueTimeMs : 0);
+
+#ifdef FM_NATIVE_RENDERER_ENABLED
+            if (bbeRenderer)
+            {
+                bbeRenderer->addPacket(packet->sender, packet->receiver);
+            }
+#endif
+
+            //Notifications and unreliable writes
+            if (packet->isHvx || packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_CMD) {
+                if (packet->isHvx) GenerateNotification(packet);
+                else GenerateWrite(packet);
+                removeWrittenPacket(connection, packet);
+                unreliablePacketsSent++;
+            }
+            //Reliable Writes
+            else if (packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_REQ) {
+                //Send tx complete for all previous unreliable writes if there were any
+                SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, unreliablePacketsSent);
+                unreliablePacketsSent = 0;
+
+                GenerateWrite(packet);
+
+                simBleEvent s2;
+                CheckedMemset(&s2, 0, sizeof(s2));
+                s2.globalId = NextGlobalEventId();
+                s2.bleEvent.header.evt_id = BLE_GATTC_EVT_WRITE_RSP;
+                s2.bleEvent.header.evt_len = s2.globalId;
+                s2.bleEvent.evt.gattc_evt.conn_handle = connection->connectionHandle;
+                s2.bleEvent.evt.gattc_evt.gatt_status = (u16)FruityHal::BleGattEror::SUCCESS;
+                //Save the global packet id so that we can track where a packet was generated after we receive it
+                s2.additionalInfo = packet->globalPacketId;
+                currentNode->eventQueue.push_back(s2);
+
+                removeWrittenPacket(connection, packet);
+
+                //The write response is sent by the partner, so no more packets are sent in this connection event
+                eventOpen = false;
+            }
+            else {
+                SIMEXCEPTION(IllegalArgumentException);
+            }
+        }
+
+        //The tx complete events are generated once per connection event
+        SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, unreliablePacketsSent);
+    }
+}
+
 void CherrySim::SimulateConnections() {
     /* Currently, the simulation will only take one connection event to transmit a reliable packet and both the packet event and the ACK will be generated
     * at the same time. Also, all unreliable packets are always sent in one conneciton event.
@@ -2867,12 +4050,16 @@ void CherrySim::SimulateConnections() {
     //Simulate sending data for each connection individually
     for (int i = 0; i < currentNode->state.configuredTotalConnectionCount; i++) {
         SoftdeviceConnection* connection = &currentNode->state.connections[i];
-        if (connection->connectionActive) {
+        if (connection->connectionActive && simConfig.simulateConnectionEvents) {
+            SimulateConnectionEvents(connection);
+        }
+        else if (connection->connectionActive) {
 
             //FIXME: This implementation will currently not calculate a correct throughput for packets
             //if the interval is smaller than the simulation timestep, it will only simulate one connectionEvent
             //To fix this, we should calculate the throughput according to our documented measurements
             //depending on the number of connections, whether scanning / advertising are active, the eventLength and the interval
+            //The connection event simulation that is enabled with simulateConnectionEvents does this
 
             u16 connectionIntervalMs = connection->connectionInterval;
 
@@ -2933,18 +4120,20 @@ void CherrySim::SimulateConnections() {
                     }
 #endif
 
+                    if (pcapWriter) CaptureConnectionPacket(connection, packet, (uint64_t)simState.simTimeMs * 1000);
+
                     //Notifications
                     if (packet->isHvx) {
                         GenerateNotification(packet);
                         //Remove packet from softdevice buffer
-                        packet->sender = nullptr;
+                        removeWrittenPacket(connection, packet);
                         unreliablePacketsSent++;
                     }
                     //Unreliable Writes
                     else if (packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_CMD) {
                         GenerateWrite(packet);
                         //Remove packet from softdevice buffer
-                        packet->sender = nullptr;
+                        removeWrittenPacket(connection, packet);
                         unreliablePacketsSent++;
                     }
                     //Reliable Writes
@@ -2955,14 +4144,12 @@ void CherrySim::SimulateConnections() {
                         unreliablePacketsSent = 0;
 
                         GenerateWrite(packet);
-                        //Remove packet from softdevice buffer
-                        packet->sender = nullptr;
 
                         //Generate the event that the write was successful immediately
                         //TODO: Could be postponed a bit to better match the real world
                         simBleEvent s2;
                         CheckedMemset(&s2, 0, sizeof(s2));
-                        s2.globalId = simState.globalEventIdCounter++;
+                        s2.globalId = NextGlobalEventId();
                         s2.bleEvent.header.evt_id = BLE_GATTC_EVT_WRITE_RSP;
                         s2.bleEvent.header.evt_len = s2.globalId;
                         s2.bleEvent.evt.gattc_evt.conn_handle = connection->connectionHandle;
@@ -2971,6 +4158,9 @@ void CherrySim::SimulateConnections() {
                         s2.additionalInfo = packet->globalPacketId;
                         currentNode->eventQueue.push_back(s2);
 
+                        //Remove packet from softdevice buffer
+                        removeWrittenPacket(connection, packet);
+
 
 
                         //Do not send any more packets this connectionEvent as we need to wait for an ACK
@@ -2997,7 +4187,7 @@ void CherrySim::SimulateConnections() {
 
                 simBleEvent s;
                 CheckedMemset(&s, 0, sizeof(s));
-                s.globalId = simState.globalEventIdCounter++;
+                s.globalId = NextGlobalEventId();
                 s.bleEvent.header.evt_id = BLE_GAP_EVT_RSSI_CHANGED;
                 s.bleEvent.header.evt_len = s.globalId;
                 s.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
@@ -3046,7 +4236,7 @@ void CherrySim::GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket) {
 
     //Generate WRITE event at our partners side
     simBleEvent s;
-    s.globalId = simState.globalEventIdCounter++;
+    s.globalId = NextGlobalEventId();
     s.bleEvent.header.evt_id = BLE_GATTS_EVT_WRITE;
     s.bleEvent.header.evt_len = s.globalId;
 
@@ -3106,7 +4296,7 @@ void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
 
     //Generate HVX event at our partners side
     simBleEvent s;
-    s.globalId = simState.globalEventIdCounter++;
+    s.globalId = NextGlobalEventId();
     s.bleEvent.header.evt_id = BLE_GATTC_EVT_HVX;
     s.bleEvent.header.evt_len = s.globalId;
     s.bleEvent.evt.gattc_evt.conn_handle = conn_handle;
@@ -3122,6 +4312,99 @@ void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
     receiver->eventQueue.push_back(s);
 }
 
+//Writes the advertising packet of the current node as it was received by the given node
+void CherrySim::CaptureAdvertisement(NodeEntry* receiver, i8 rssi)
+{
+    u8 pdu[LL_HEADER_OCTETS + FH_BLE_GAP_ADDR_LEN + sizeof(currentNode->state.advertisingData)];
+
+    u8 pduType = 0;
+    switch (currentNode->state.advertisingType)
+    {
+        case FruityHal::BleGapAdvType::ADV_IND:         pduType = 0x00; break;
+        case FruityHal::BleGapAdvType::ADV_DIRECT_IND:  pduType = 0x01; break;
+        case FruityHal::BleGapAdvType::ADV_NONCONN_IND: pduType = 0x02; break;
+        case FruityHal::BleGapAdvType::ADV_SCAN_IND:    pduType = 0x06; break;
+    }
+    const bool randomAddress = currentNode->address.addr_type != FruityHal::BleGapAddrType::PUBLIC;
+    const u32 advertisingDataLength = std::min<u32>(currentNode->state.advertisingDataLength, sizeof(currentNode->state.advertisingData));
+
+    pdu[0] = pduType | (randomAddress ? 0x40 : 0x00);
+    pdu[1] = (u8)(FH_BLE_GAP_ADDR_LEN + advertisingDataLength);
+    CheckedMemcpy(pdu + LL_HEADER_OCTETS, currentNode->address.addr.data(), FH_BLE_GAP_ADDR_LEN);
+    CheckedMemcpy(pdu + LL_HEADER_OCTETS + FH_BLE_GAP_ADDR_LEN, currentNode->state.advertisingData, advertisingDataLength);
+
+    PcapBlePacket packet;
+    packet.accessAddress = PcapWriter::ADVERTISING_ACCESS_ADDRESS;
+    packet.crcInit = PcapWriter::ADVERTISING_CRC_INIT;
+    packet.channel = LL_ADVERTISING_CHANNEL;
+    packet.rssi = rssi;
+    packet.pdu = pdu;
+    packet.pduLength = LL_HEADER_OCTETS + FH_BLE_GAP_ADDR_LEN + advertisingDataLength;
+    pcapWriter->WritePacket(receiver->index, receiver->GetNodeId(), (uint64_t)simState.simTimeMs * 1000, packet);
+}
+
+//Writes one link layer fragment of a GATT packet as it was received by the partner. Fragments that were not received
+//are written with an invalid crc, just like a sniffer would report them.
+void CherrySim::CaptureConnectionFragment(const SoftdeviceConnection* connection, const SoftDeviceBufferedPacket* packet, u32 fragmentIndex, uint64_t timestampUs, bool received)
+{
+    //L2CAP header, ATT header and value of the whole packet
+    u8 l2capPacket[L2CAP_HEADER_OCTETS + ATT_HEADER_OCTETS + NRF_SDH_BLE_GATT_MAX_MTU_SIZE];
+    const u32 l2capOctets = GetL2capPacketOctets(packet);
+    const u16 l2capPayloadOctets = (u16)(l2capOctets - L2CAP_HEADER_OCTETS);
+    const u8* value = packet->isHvx ? packet->params.hvxParams.p_data : packet->params.writeParams.p_value;
+    const u16 handle = packet->isHvx ? packet->params.hvxParams.handle : packet->params.writeParams.handle;
+    u8 opcode = ATT_OPCODE_NOTIFICATION;
+    if (!packet->isHvx) opcode = packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_REQ ? ATT_OPCODE_WRITE_REQUEST : ATT_OPCODE_WRITE_COMMAND;
+
+    CheckedMemcpy(l2capPacket + 0, &l2capPayloadOctets, sizeof(l2capPayloadOctets));
+    CheckedMemcpy(l2capPacket + 2, &L2CAP_ATT_CHANNEL_ID, sizeof(L2CAP_ATT_CHANNEL_ID));
+    l2capPacket[4] = opcode;
+    CheckedMemcpy(l2capPacket + 5, &handle, sizeof(handle));
+    CheckedMemcpy(l2capPacket + L2CAP_HEADER_OCTETS + ATT_HEADER_OCTETS, value, l2capOctets - L2CAP_HEADER_OCTETS - ATT_HEADER_OCTETS);
+
+    const u32 fragmentOffset = fragmentIndex * connection->maxTxOctets;
+    if (fragmentOffset >= l2capOctets)
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+        return;
+    }
+    const u32 fragmentOctets = std::min<u32>(connection->maxTxOctets, l2capOctets - fragmentOffset);
+
+    u8 pdu[LL_HEADER_OCTETS + sizeof(l2capPacket)];
+    pdu[0] = fragmentIndex == 0 ? LL_LLID_START : LL_LLID_CONTINUATION;
+    pdu[1] = (u8)fragmentOctets;
+    CheckedMemcpy(pdu + LL_HEADER_OCTETS, l2capPacket + fragmentOffset, fragmentOctets);
+
+    //Access addresses and crc initialization values are not simulated, so they are derived from the connection handle
+    //that is the same on both sides of the connection
+    const u32 connectionHash = (u32)connection->connectionHandle * 0x9E3779B1;
+    const u32 setupTimeUs = connection->connectionSetupTimeMs * 1000;
+    const u16 eventCounter = (u16)((timestampUs > setupTimeUs ? timestampUs - setupTimeUs : 0) / GetConnectionIntervalUs(connection));
+
+    PcapBlePacket capturedPacket;
+    capturedPacket.accessAddress = LL_DATA_ACCESS_ADDRESS_BASE ^ connectionHash;
+    capturedPacket.crcInit = connectionHash >> 8;
+    capturedPacket.channel = (u8)(eventCounter % LL_NUM_DATA_CHANNELS);
+    capturedPacket.rssi = (i8)GetCapturedReceptionRssi(packet->sender, packet->receiver);
+    capturedPacket.eventCounter = eventCounter;
+    capturedPacket.crcOk = received;
+    capturedPacket.masterToSlave = connection->isCentral;
+    capturedPacket.phy2Mbps = simConfig.simulateConnectionEvents && simConfig.connectionPhyMbps == 2;
+    capturedPacket.pdu = pdu;
+    capturedPacket.pduLength = LL_HEADER_OCTETS + fragmentOctets;
+    pcapWriter->WritePacket(packet->receiver->index, packet->receiver->GetNodeId(), timestampUs, capturedPacket);
+}
+
+//Writes all link layer fragments of a GATT packet that was received in one piece
+void CherrySim::CaptureConnectionPacket(const SoftdeviceConnection* connection, const SoftDeviceBufferedPacket* packet, uint64_t timestampUs)
+{
+    const u32 numFragments = (GetL2capPacketOctets(packet) + connection->maxTxOctets - 1) / connection->maxTxOctets;
+    for (u32 i = 0; i < numFragments; i++)
+    {
+        CaptureConnectionFragment(connection, packet, i, timestampUs, true);
+    }
+}
+
 void CherrySim::StartServiceDiscovery(u16 connHandle, const ble_uuid_t &p_uuid, int discoveryTimeMs)
 {
     currentNode->state.connHandle = connHandle;
@@ -3392,6 +4675,7 @@ void CherrySim::SimulateConnectionParameterUpdateRequestTimeout()
 
         // After timing out the request is not pending anymore.
         connection.connParamUpdateRequestPending = false;
+        connection.partnerConnection->connParamUpdateRequestSent = false;
 
         // The request has timed out, generate an event on the _peripheral_ with
         // the current connection parameters (i.e. similar to when a request
@@ -3400,7 +4684,7 @@ void CherrySim::SimulateConnectionParameterUpdateRequestTimeout()
         const auto & peripheralConnection = *connection.partnerConnection;
 
         simBleEvent simEvent = {};
-        simEvent.globalId = cherrySimInstance->simState.globalEventIdCounter++;
+        simEvent.globalId = cherrySimInstance->NextGlobalEventId();
 
         auto & bleEvent = simEvent.bleEvent;
         bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE;
@@ -3427,11 +4711,174 @@ void CherrySim::SimulateTimer() {
     //Advance time of this node
     currentNode->state.timeMs += simConfig.simTickDurationMs;
 
-    if (ShouldSimIvTrigger(100L * MAIN_TIMER_TICK * 10 / ticksPerSecond)) {
+    if (ShouldSimIvTrigger(GetMainTimerIntervalMs())) {
         app_timer_handler(nullptr);
     }
 }
 
+u32 CherrySim::GetMainTimerIntervalMs() const
+{
+    return 100L * MAIN_TIMER_TICK * 10 / ticksPerSecond;
+}
+
+//Checks if the current node has nothing to do apart from its timers, advertising and the events of its
+//connections. An idle node does not need to be simulated in steps where none of these triggers.
+bool CherrySim::IsCurrentNodeIdle()
+{
+    const SoftdeviceState& state = currentNode->state;
+
+    if (!currentNode->eventQueue.empty() || !currentNode->interruptQueue.empty()) return false;
+    if (GS->terminal.HasTerminalQueueEntries()) return false;
+    if (state.uartReadIndex != state.uartBufferLength) return false;
+    if (state.numWaitingFlashOperations > 0) return false;
+    for (int i = 0; i < state.configuredTotalConnectionCount; i++)
+    {
+        const SoftdeviceConnection& connection = state.connections[i];
+        if (!connection.connectionActive) continue;
+        //Random connection losses are drawn in every step
+        if (simConfig.connectionTimeoutProbabilityPerSec != 0) return false;
+        //The request timeout is checked before the timer in parallel steps and would otherwise be noticed one timer tick late
+        if (connection.isCentral && connection.connParamUpdateRequestPending) return false;
+    }
+    if (currentNode->timeslotRequested || currentNode->timeslotActive || currentNode->timeslotCloseSessionRequested) return false;
+    if (currentNode->animation.IsStarted() || is_lis2dh12_moving_in_simulation()) return false;
+    if (GS->passsedTimeSinceLastTimerHandlerDs > 0 || GS->button1HoldTimeDs != 0) return false;
+    if (GS->numApplicationInterruptHandlers > 0 || GS->numMainContextHandlers > 0) return false;
+
+    return true;
+}
+
+//Returns the node time (state.timeMs) at which the current node has to be simulated again. For nodes
+//that are not idle, this is the time of the next step.
+u32 CherrySim::GetNextWakeUpTimeMsOfCurrentNode()
+{
+    const SoftdeviceState& state = currentNode->state;
+    const u32 timeMs = state.timeMs;
+    const u32 tickMs = simConfig.simTickDurationMs;
+    if (!IsCurrentNodeIdle()) return timeMs + tickMs;
+
+    //Timeouts are given in simulation time and are due in the first step whose simulation time reaches them
+    const auto simTimeToNodeTimeMs = [&](u32 simTimeMs) {
+        return timeMs + tickMs + (simTimeMs > simState.simTimeMs ? simTimeMs - simState.simTimeMs : 0);
+    };
+
+    const u32 timerIntervalMs = GetMainTimerIntervalMs();
+    u32 wakeUpTimeMs = (timeMs / timerIntervalMs + 1) * timerIntervalMs;
+
+    if (state.advertisingActive && state.advertisingIntervalMs > 0)
+    {
+        const u32 advertisingIntervalMs = state.advertisingIntervalMs;
+        wakeUpTimeMs = std::min(wakeUpTimeMs, (timeMs / advertisingIntervalMs + 1) * advertisingIntervalMs);
+    }
+
+    if (state.connectingActive)
+    {
+        wakeUpTimeMs = std::min(wakeUpTimeMs, simTimeToNodeTimeMs((u32)std::max(state.connectingTimeoutTimestampMs, 0)));
+    }
+
+    if (state.discoveryDoneTime != 0)
+    {
+        wakeUpTimeMs = std::min(wakeUpTimeMs, simTimeToNodeTimeMs(state.discoveryDoneTime + 1));
+    }
+
+    for (int i = 0; i < state.configuredTotalConnectionCount; i++)
+    {
+        SoftdeviceConnection& connection = currentNode->state.connections[i];
+        if (!connection.connectionActive) continue;
+
+        if (simConfig.simulateConnectionEvents)
+        {
+            wakeUpTimeMs = std::min(wakeUpTimeMs, (u32)((connection.nextConnectionEventTimeUs + 999) / 1000));
+
+            //Without connection events in between, the supervision timeout and the packet timeout are only noticed when they are due
+            wakeUpTimeMs = std::min(wakeUpTimeMs, simTimeToNodeTimeMs(connection.lastReceivedPacketTimestampMs + connection.connectionSupervisionTimeoutMs));
+            const SoftDeviceBufferedPacket* oldestPacket = getNextPacketToWrite(&connection);
+            if (oldestPacket != nullptr) wakeUpTimeMs = std::min(wakeUpTimeMs, simTimeToNodeTimeMs(oldestPacket->queueTimeMs + 30 * 1000 + 1));
+        }
+        else
+        {
+            //Must match the interval used by SimulateConnections
+            u16 connectionIntervalMs = connection.connectionInterval;
+            if (connectionIntervalMs == (int)7.5f) connectionIntervalMs = 10;
+            wakeUpTimeMs = std::min(wakeUpTimeMs, connection.lastConnectionTimestampMs + connectionIntervalMs);
+        }
+
+        if (connection.rssiMeasurementActive)
+        {
+            wakeUpTimeMs = std::min(wakeUpTimeMs, (timeMs / 5000 + 1) * 5000);
+        }
+    }
+
+    return std::max(wakeUpTimeMs, timeMs + tickMs);
+}
+
+//Real time and jittering rely on every node being simulated in every step and step callbacks expect it as well
+bool CherrySim::IsIdleStepSkippingPossible() const
+{
+    if (!simConfig.skipIdleSimulationSteps) return false;
+    if (simConfig.realTime || simConfig.simulateJittering || !simStepCallbacks.empty()) return false;
+#ifdef FM_NATIVE_RENDERER_ENABLED
+    if (bbeRenderer && bbeRenderer->isPaused()) return false;
+#endif
+    return true;
+}
+
+//Checks if the current node can skip the coming step because it only wakes up in one of the following steps.
+//This lets the nodes of a clustered mesh sleep between their connection events and timer ticks, even if the
+//other nodes are busy.
+bool CherrySim::ShouldSkipIdleStepOfCurrentNode()
+{
+    if (!IsIdleStepSkippingPossible()) return false;
+
+    return GetNextWakeUpTimeMsOfCurrentNode() > currentNode->state.timeMs + simConfig.simTickDurationMs;
+}
+
+//Only the time and the battery usage of a node change in a step in which it is idle
+void CherrySim::SkipIdleStepOfCurrentNode()
+{
+    currentNode->state.timeMs += simConfig.simTickDurationMs;
+    SimulateBatteryUsage();
+}
+
+//Advances the time of all nodes and of the simulation up to the step before the earliest wake up time of
+//any node. Only the battery usage is accounted for the skipped steps, everything else would have been a no-op.
+void CherrySim::SkipIdleSimulationSteps()
+{
+    if (!IsIdleStepSkippingPossible()) return;
+
+    const u32 tickMs = simConfig.simTickDurationMs;
+    u32 stepsToSkip = UINT32_MAX;
+
+    //Replay commands must be injected at the same step as without skipping
+    if (!replayRecordEntries.empty())
+    {
+        const u32 replayTimeMs = replayRecordEntries.front().time;
+        stepsToSkip = replayTimeMs > simState.simTimeMs ? (replayTimeMs - simState.simTimeMs) / tickMs : 0;
+    }
+
+    for (u32 i = 0; i < GetTotalNodes() && stepsToSkip > 0; i++)
+    {
+        NodeIndexSetter setter(i);
+        const u32 wakeUpTimeMs = GetNextWakeUpTimeMsOfCurrentNode();
+        //The node time is increased at the start of a step, so the step at the wake up time must be executed
+        const u32 idleSteps = (wakeUpTimeMs - currentNode->state.timeMs - 1) / tickMs;
+        stepsToSkip = std::min(stepsToSkip, idleSteps);
+    }
+
+    if (stepsToSkip == 0 || stepsToSkip == UINT32_MAX) return;
+
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        NodeIndexSetter setter(i);
+        for (u32 step = 0; step < stepsToSkip; step++)
+        {
+            SkipIdleStepOfCurrentNode();
+        }
+    }
+
+    simState.simTimeMs += stepsToSkip * tickMs;
+}
+
 void CherrySim::SimulateWatchDog()
 {
     if (simConfig.simulateWatchdog) {
@@ -3447,7 +4894,7 @@ struct InterruptGuard
 {
     //Protects us against interrupting inside an interrupt using RAII.
 
-    static inline bool currentlyInAnInterrupt = false;
+    static inline thread_local bool currentlyInAnInterrupt = false;
 
     InterruptGuard() {
         currentlyInAnInterrupt = true;
@@ -3595,9 +5042,9 @@ void CherrySim::CheckMeshingConsistency()
             SoftdeviceConnection* sc = &(node->state.connections[k]);
             if (!sc->connectionActive) continue;
 
-            SoftDeviceBufferedPacket* sp = &(sc->reliableBuffers[0]);
+            SoftDeviceBufferedPacket* sp = sc->reliableBuffers.Front();
 
-            if (sp->sender != nullptr)
+            if (sp != nullptr)
             {
                 ConnPacketHeader* header = (ConnPacketHeader*)sp->data;
 
@@ -3882,11 +5329,19 @@ void CherrySim::AddSimulationStepHandler(std::function<void(void)> lambda)
     LambdaWithHandle data;
     data.owningNode = currentNode;
     data.lambda = lambda;
-    simStepCallbacks.push_back(data);
+    RunOrStage([this, data]() {
+        simStepCallbacks.push_back(data);
+    });
 }
 
 void CherrySim::CleanSimulationStepHandlers(NodeEntry* nodeEntry)
 {
+    if (parallelPhaseActive)
+    {
+        RunOrStage([this, nodeEntry]() { CleanSimulationStepHandlers(nodeEntry); });
+        return;
+    }
+
     auto it = std::remove_if(simStepCallbacks.begin(), simStepCallbacks.end(),
         [nodeEntry](const auto& entry) {
             return nodeEntry == entry.owningNode;
@@ -3901,66 +5356,292 @@ void CherrySim::CleanSimulationStepHandlers(NodeEntry* nodeEntry)
 
 bool CherrySim::IsClusteringDone()
 {
-    u32 numNoneAssetNodes = GetTotalNodes() - GetAssetNodes();
-    std::set<ClusterId> clusterIds;
-    for (u32 i = 0; i < numNoneAssetNodes; i++) {
-        clusterIds.insert(nodes[i].gs.node.clusterId);
-        if ((u32)nodes[i].gs.node.GetClusterSize() != numNoneAssetNodes) {
-            return false;
+    if (clusteringTracker.GetNodeCount() == 0) PrepareClusteringTracker();
+    if (currentNode != nullptr) UpdateClusteringTracker(currentNode->index);
+    return clusteringTracker.IsClusteringDone();
+}
+
+bool CherrySim::IsClusteringDoneWithDifferentNetworkIds()
+{
+    if (clusteringTracker.GetNodeCount() == 0) PrepareClusteringTracker();
+    if (currentNode != nullptr) UpdateClusteringTracker(currentNode->index);
+    return clusteringTracker.GetNumNetworkIds() == clusteringTracker.GetNumClusters();
+}
+
+bool CherrySim::IsClusteringDoneWithExpectedNumberOfClusters(u32 clusterAmount)
+{
+    if (clusteringTracker.GetNodeCount() == 0) PrepareClusteringTracker();
+    if (currentNode != nullptr) UpdateClusteringTracker(currentNode->index);
+    return clusterAmount == clusteringTracker.GetNumClusters();
+}
+
+void CherrySim::PrepareClusteringTracker()
+{
+    const u32 numNoneAssetNodes = GetTotalNodes() - GetAssetNodes();
+    if (clusteringTracker.GetNodeCount() != numNoneAssetNodes)
+    {
+        clusteringTracker.Reset(numNoneAssetNodes);
+        for (u32 i = 0; i < numNoneAssetNodes; i++)
+        {
+            UpdateClusteringTracker(i);
         }
     }
-    return clusterIds.size() == 1;
 }
 
-struct ClusterNetworkPair {
-    u32 clusterId;
-    u32 networkId;
+void CherrySim::UpdateClusteringTracker(u32 nodeIndex)
+{
+    if (nodeIndex >= clusteringTracker.GetNodeCount()) return;
+
+    NodeClusteringState state;
+    state.clusterId = nodes[nodeIndex].gs.node.clusterId;
+    state.clusterSize = nodes[nodeIndex].gs.node.GetClusterSize();
+    state.networkId = nodes[nodeIndex].gs.node.configuration.networkId;
+    if (clusteringTracker.Update(nodeIndex, state)) clusteringChangedSinceLastCheck = true;
+}
+
+//Compares the clustering tracker with the clustering of all nodes, which would only differ if an update was missed
+void CherrySim::AuditClusteringTracker()
+{
+    const u32 numNoneAssetNodes = clusteringTracker.GetNodeCount();
+    std::set<ClusterId> clusterIds;
+    std::set<std::pair<ClusterId, NetworkId>> clusterAndNetworkIds;
+    std::set<NetworkId> networkIds;
+    bool allNodesHaveFullClusterSize = true;
+    for (u32 i = 0; i < numNoneAssetNodes; i++)
+    {
+        const Node& node = nodes[i].gs.node;
+        clusterIds.insert(node.clusterId);
+        clusterAndNetworkIds.insert({ node.clusterId, node.configuration.networkId });
+        networkIds.insert(node.configuration.networkId);
+        if ((u32)node.GetClusterSize() != numNoneAssetNodes) allNodesHaveFullClusterSize = false;
+    }
+    const bool clusteringDone = clusterIds.size() == 1 && allNodesHaveFullClusterSize;
 
-    bool operator==(const ClusterNetworkPair& other) {
-        return this->clusterId == other.clusterId && this->networkId == other.networkId;
+    if (clusteringDone != clusteringTracker.IsClusteringDone()
+        || clusterAndNetworkIds.size() != clusteringTracker.GetNumClusters()
+        || networkIds.size() != clusteringTracker.GetNumNetworkIds())
+    {
+        printf("-------- CLUSTERING TRACKER MISMATCH -----------" EOL);
+        SIMEXCEPTION(IllegalStateException);
     }
+}
+
+enum class PreclusteredEdgeState
+{
+    IN_PROGRESS,
+    DONE,
+    FAILED,
 };
 
-bool operator<(const ClusterNetworkPair& a, const ClusterNetworkPair& b) {
-    if (a.clusterId < b.clusterId) {
-        return true;
+//Tells the central of the edge to connect to the peripheral and establishes the SoftDevice connection right away
+//instead of waiting for the central to receive an advertising packet of the peripheral.
+static bool ConnectPreclusteredEdge(CherrySim* sim, NodeEntry* central, NodeEntry* peripheral)
+{
+    {
+        NodeIndexSetter setter(central->index);
+        FruityHal::BleGapAddr address = peripheral->address;
+        const ErrorType err = GS->cm.ConnectAsMaster(
+            peripheral->GetNodeId(),
+            &address,
+            peripheral->gs.node.meshService.sendMessageCharacteristicHandle.valueHandle,
+            Conf::GetInstance().meshMinConnectionInterval);
+        if (err != ErrorType::SUCCESS) return false;
     }
-    else if (a.clusterId > b.clusterId) {
-        return false;
+
+    NodeIndexSetter setter(peripheral->index);
+    sim->ConnectMasterToSlave(central, peripheral);
+
+    //Same as in SimulateAdvertising, connectable advertising is stopped by the SoftDevice once connected
+    if (peripheral->state.advertisingType == FruityHal::BleGapAdvType::ADV_IND) {
+        peripheral->state.advertisingActive = false;
     }
-    else {
-        if (a.networkId < b.networkId) {
+    return true;
+}
+
+static bool HasMeshConnectionTo(NodeEntry* node, const NodeEntry* partner, bool handshakeDone)
+{
+    NodeIndexSetter setter(node->index);
+    MeshConnections conns = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+    for (u32 i = 0; i < conns.count; i++) {
+        const MeshConnection* conn = conns.handles[i].GetConnection();
+        if (memcmp(&conn->partnerAddress, &partner->address, sizeof(partner->address)) == 0
+            && (!handshakeDone || conn->HandshakeDone())) {
             return true;
         }
-        else {
-            return false;
-        }
     }
-};
-bool CherrySim::IsClusteringDoneWithDifferentNetworkIds()
+    return false;
+}
+
+static PreclusteredEdgeState GetPreclusteredEdgeState(NodeEntry* central, NodeEntry* peripheral)
 {
-    std::set<u32> networkIds;
-    std::set<ClusterNetworkPair> clusterIds;
-    u32 numNoneAssetNodes = GetTotalNodes() - GetAssetNodes();
-    for (u32 i = 0; i < numNoneAssetNodes; i++)
+    //The pending connection of the central is already a MeshConnection, so if it is gone, the connection failed
+    if (!HasMeshConnectionTo(central, peripheral, false)) return PreclusteredEdgeState::FAILED;
+
+    //The central finishes its part of the handshake first, the peripheral as soon as it received the CLUSTER_ACK_2
+    if (HasMeshConnectionTo(central, peripheral, true) && HasMeshConnectionTo(peripheral, central, true)) {
+        return PreclusteredEdgeState::DONE;
+    }
+    return PreclusteredEdgeState::IN_PROGRESS;
+}
+
+std::vector<std::pair<u32, u32>> CherrySim::GenerateSpanningTree()
+{
+    //The tree is built breadth first, starting at the first node (usually the sink) so that it ends up with
+    //few hops to all other nodes. Each node takes the unconnected nodes with the best signal as its children
+    //until it has no free mesh out connections left.
+    const u32 numNoneAssetNodes = GetTotalNodes() - GetAssetNodes();
+    std::vector<std::pair<u32, u32>> edges;
+    if (numNoneAssetNodes == 0) return edges;
+
+    std::vector<bool> attached(numNoneAssetNodes, false);
+    std::deque<u32> parents;
+    attached[0] = true;
+    parents.push_back(0);
+
+    std::vector<std::pair<float, u32>> candidates;
+    while (!parents.empty())
+    {
+        const u32 parent = parents.front();
+        parents.pop_front();
+
+        candidates.clear();
+        for (u32 i = 0; i < numNoneAssetNodes; i++)
+        {
+            if (attached[i]) continue;
+            //Nodes of different networks would refuse the handshake
+            if (nodes[i].gs.node.configuration.networkId != nodes[parent].gs.node.configuration.networkId) continue;
+
+            const float rssi = std::min(GetReceptionRssiNoNoise(&nodes[parent], &nodes[i]), GetReceptionRssiNoNoise(&nodes[i], &nodes[parent]));
+            if (CalculateReceptionProbabilityFromRssi(rssi) == 0) continue;
+
+            candidates.push_back({ rssi, i });
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const std::pair<float, u32>& a, const std::pair<float, u32>& b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        });
+
+        const u32 numChildren = std::min<u32>(nodes[parent].gs.cm.freeMeshOutConnections, candidates.size());
+        for (u32 i = 0; i < numChildren; i++)
+        {
+            const u32 child = candidates[i].second;
+            attached[child] = true;
+            edges.push_back({ parent, child });
+            parents.push_back(child);
+        }
+    }
+
+    //Some nodes are out of range or can not be reached with the available connections
+    if (edges.size() != numNoneAssetNodes - 1)
     {
-        networkIds.insert(nodes[i].gs.node.configuration.networkId);
-        clusterIds.insert({ nodes[i].gs.node.clusterId, nodes[i].gs.node.configuration.networkId });
+        SIMEXCEPTION(IllegalStateException);
     }
 
-    return networkIds.size() == clusterIds.size();
+    return edges;
 }
 
-bool CherrySim::IsClusteringDoneWithExpectedNumberOfClusters(u32 clusterAmount)
+void CherrySim::BuildMeshFromSpanningTree(const std::vector<std::pair<u32, u32>>& edges, u32 timeoutMs)
 {
-    std::set<ClusterNetworkPair> clusterIds;
-    u32 numNoneAssetNodes = GetTotalNodes() - GetAssetNodes();
-    for (u32 i = 0; i < numNoneAssetNodes; i++)
+    if (timeoutMs == 0) SIMEXCEPTION(ZeroTimeoutNotSupportedException);
+
+    //Every node can only join the tree once. All nodes that never are a peripheral are roots of the tree.
+    std::vector<bool> attached(GetTotalNodes(), true);
+    for (const std::pair<u32, u32>& edge : edges)
+    {
+        if (edge.first >= GetTotalNodes() || edge.second >= GetTotalNodes() || edge.first == edge.second || !attached[edge.second])
+        {
+            SIMEXCEPTION(IllegalArgumentException);
+            return;
+        }
+        attached[edge.second] = false;
+    }
+
+    std::deque<std::pair<u32, u32>> openEdges(edges.begin(), edges.end());
+    std::vector<std::pair<u32, u32>> runningEdges;
+    std::vector<bool> busy(GetTotalNodes(), false);
+    const u32 startTimeMs = simState.simTimeMs;
+
+    //No advertising packets are delivered while the tree is built, so that the nodes do not find any other
+    //cluster to connect to and only the given connections are made.
+    preclusteringActive = true;
+
+    while (!openEdges.empty() || !runningEdges.empty())
     {
-        clusterIds.insert({ nodes[i].gs.node.clusterId, nodes[i].gs.node.configuration.networkId });
+        //A node can only be in one handshake at a time and the central must already be part of the tree, as
+        //the peripheral would otherwise not be the smaller cluster.
+        bool anyEdgeReady = false;
+        for (auto it = openEdges.begin(); it != openEdges.end();)
+        {
+            const u32 central = it->first;
+            const u32 peripheral = it->second;
+            if (!attached[central] || busy[central] || busy[peripheral])
+            {
+                ++it;
+                continue;
+            }
+            anyEdgeReady = true;
+            if (!ConnectPreclusteredEdge(this, &nodes[central], &nodes[peripheral]))
+            {
+                ++it;
+                continue;
+            }
+            busy[central] = true;
+            busy[peripheral] = true;
+            runningEdges.push_back(*it);
+            it = openEdges.erase(it);
+        }
+
+        //The edges contain a cycle
+        if (!anyEdgeReady && runningEdges.empty())
+        {
+            preclusteringActive = false;
+            SIMEXCEPTION(IllegalArgumentException);
+            return;
+        }
+
+        SimulateStepForAllNodes();
+
+        for (auto it = runningEdges.begin(); it != runningEdges.end();)
+        {
+            const PreclusteredEdgeState state = GetPreclusteredEdgeState(&nodes[it->first], &nodes[it->second]);
+            if (state == PreclusteredEdgeState::IN_PROGRESS)
+            {
+                ++it;
+                continue;
+            }
+            busy[it->first] = false;
+            busy[it->second] = false;
+            if (state == PreclusteredEdgeState::DONE) attached[it->second] = true;
+            else openEdges.push_back(*it); //Try again, e.g. if the connection was lost during the handshake
+            it = runningEdges.erase(it);
+        }
+
+        if (simState.simTimeMs - startTimeMs > timeoutMs)
+        {
+            preclusteringActive = false;
+            SIMEXCEPTION(TimeoutException);
+            return;
+        }
     }
 
-    return clusterAmount == clusterIds.size();
+    preclusteringActive = false;
+}
+
+void CherrySim::PreclusterNodes()
+{
+    const u32 startTimeMs = simState.simTimeMs;
+
+    BuildMeshFromSpanningTree(GenerateSpanningTree(), PRECLUSTERING_TIMEOUT_MS);
+
+    //The cluster sizes are still propagated through the mesh after the last handshake
+    while (!IsClusteringDone())
+    {
+        if (simState.simTimeMs - startTimeMs > PRECLUSTERING_TIMEOUT_MS)
+        {
+            SIMEXCEPTION(TimeoutException);
+            return;
+        }
+        SimulateStepForAllNodes();
+    }
 }
 
 //Allows us to activate or deactivate a terminal of a node
@@ -3990,12 +5671,17 @@ float CherrySim::GetDistanceBetween(const NodeEntry* nodeA, const NodeEntry* nod
     return dist;
 }
 
+bool CherrySim::IsOutOfRadioRange(const NodeEntry *sender, const NodeEntry *receiver) const
+{
+    return abs(sender->x - receiver->x) * simConfig.mapWidthInMeters > SIM_MAX_RADIO_RANGE_METERS
+        || abs(sender->y - receiver->y) * simConfig.mapHeightInMeters > SIM_MAX_RADIO_RANGE_METERS
+        || abs(sender->z - receiver->z) * simConfig.mapElevationInMeters > SIM_MAX_RADIO_RANGE_METERS;
+}
+
 float CherrySim::GetReceptionRssi(const NodeEntry *sender, const NodeEntry *receiver)
 {
     // Early out if the nodes are too far from each other to optimize the performance for bigger scenarios
-    if (    abs(sender->x - receiver->x) * simConfig.mapWidthInMeters > 50
-        ||  abs(sender->y - receiver->y) * simConfig.mapHeightInMeters > 50
-        ||  abs(sender->z - receiver->z) * simConfig.mapElevationInMeters > 50)
+    if (IsOutOfRadioRange(sender, receiver))
     {
         return -1000;
     }
@@ -4005,10 +5691,10 @@ float CherrySim::GetReceptionRssi(const NodeEntry *sender, const NodeEntry *rece
     // however (due to the nature of the computation) the RSSIs for nodes that are extremely close (or even
     // in the same location) will be better than -10, which would falsely lead to all advertisements being
     // rejected.
-    const auto clampRssi = [] (const float rssi) { return Utility::Clamp<float>(rssi, std::numeric_limits<float>::lowest(), -11.0f); };
+    const auto clampRssi = [] (const float rssi) { return Utility::Clamp<float>(rssi, std::numeric_limits<float>::lowest(), MAX_RECEPTION_RSSI); };
 
     // Compute the RSSI for transmissions between the two nodes
-    const float rssi = GetReceptionRssiNoNoise(sender, receiver);
+    const float rssi = GetCachedReceptionRssiNoNoise(sender, receiver);
 
     if (!simConfig.rssiNoise)
     {
@@ -4021,6 +5707,38 @@ float CherrySim::GetReceptionRssi(const NodeEntry *sender, const NodeEntry *rece
     return clampRssi(rssi + noise);
 }
 
+static i32 GetTxPowerDbm(const NodeEntry* node)
+{
+    return static_cast<i32>(node->gs.config.defaultDBmTX) + static_cast<i32>(node->gs.boardconf.configuration.calibratedTX);
+}
+
+//The rssi that is written into the packet capture if none was computed for the reception. It has no noise, because
+//drawing random numbers for the capture would change the outcome of the simulation.
+float CherrySim::GetCapturedReceptionRssi(const NodeEntry* sender, const NodeEntry* receiver)
+{
+    if (IsOutOfRadioRange(sender, receiver)) return -1000;
+
+    return std::min(GetCachedReceptionRssiNoNoise(sender, receiver), MAX_RECEPTION_RSSI);
+}
+
+float CherrySim::GetCachedReceptionRssiNoNoise(const NodeEntry* sender, const NodeEntry* receiver)
+{
+    //The rssi might be requested before the first simulation step prepared the cache
+    if (sender->index >= linkBudgetCache.GetNodeCount() || receiver->index >= linkBudgetCache.GetNodeCount())
+    {
+        return GetReceptionRssiNoNoise(sender, receiver);
+    }
+
+    const i32 txPowerDbm = GetTxPowerDbm(sender);
+    float rssi = 0;
+    if (!linkBudgetCache.Get(sender->index, receiver->index, txPowerDbm, rssi))
+    {
+        rssi = GetReceptionRssiNoNoise(sender, receiver);
+        linkBudgetCache.Put(sender->index, receiver->index, txPowerDbm, rssi);
+    }
+    return rssi;
+}
+
 float CherrySim::GetReceptionRssiNoNoise(const NodeEntry *sender, const NodeEntry *receiver)
 {
     // If either the sender or the receiver has the other marked as a impossibleConnection, the rssi is set to a unconnectable level.
@@ -4036,7 +5754,7 @@ float CherrySim::GetReceptionRssiNoNoise(const NodeEntry *sender, const NodeEntr
     const float distance = GetDistanceBetween(sender, receiver);
 
     const PathLossModelParameters parameters = {
-        .receivedPowerAtReferenceDistanceDbm = static_cast<float>(sender->gs.config.defaultDBmTX) + static_cast<float>(sender->gs.boardconf.configuration.calibratedTX),
+        .receivedPowerAtReferenceDistanceDbm = static_cast<float>(GetTxPowerDbm(sender)),
         .propagationConstant                 = propagationConstant,
     };
     const float rssiFromDistance = ComputeRssiFromDistance(distance, parameters);
@@ -4077,7 +5795,18 @@ uint32_t CherrySim::CalculateReceptionProbabilityForAdvertisement(const NodeEntr
         return 0;
     }
 
-    const auto rssiProbability = CalculateReceptionProbabilityFromRssi(GetReceptionRssi(sendingNode, receivingNode));
+    return CalculateReceptionProbabilityForAdvertisementFromRssi(receivingNode, GetReceptionRssi(sendingNode, receivingNode));
+}
+
+uint32_t CherrySim::CalculateReceptionProbabilityForAdvertisementFromRssi(const NodeEntry *receivingNode, float rssi)
+{
+    const auto scanIntervalMs = receivingNode->state.connectingActive ? receivingNode->state.connectingIntervalMs : receivingNode->state.scanIntervalMs;
+    if (scanIntervalMs == 0)
+    {
+        return 0;
+    }
+
+    const auto rssiProbability = CalculateReceptionProbabilityFromRssi(rssi);
 
     if (simConfig.perfectReceptionProbabilityForAdvertising && rssiProbability > 0)
     {
@@ -4222,6 +5951,8 @@ void CherrySim::SetPosition(u32 nodeIndex, float x, float y, float z)
         nodes[nodeIndex].y = y;
         nodes[nodeIndex].z = z;
         nodes[nodeIndex].lastMovementSimTimeMs = simState.simTimeMs;
+        UpdateSpatialGrid(nodeIndex);
+        UpdateLinkBudgetCache(nodeIndex);
     }
 }
 
@@ -4233,9 +5964,65 @@ void CherrySim::AddPosition(u32 nodeIndex, float x, float y, float z)
         nodes[nodeIndex].y += y;
         nodes[nodeIndex].z += z;
         nodes[nodeIndex].lastMovementSimTimeMs = simState.simTimeMs;
+        UpdateSpatialGrid(nodeIndex);
+        UpdateLinkBudgetCache(nodeIndex);
+    }
+}
+
+void CherrySim::PrepareSpatialGrid()
+{
+    //The cells are a bit bigger than the radio range so that rounding can never move a node in range out of the neighbouring cells
+    const float cellSizeInMeters = SIM_MAX_RADIO_RANGE_METERS + 1.0f;
+    const float widthInMeters = static_cast<float>(simConfig.mapWidthInMeters);
+    const float heightInMeters = static_cast<float>(simConfig.mapHeightInMeters);
+
+    if (!spatialGrid.IsConfiguredFor(cellSizeInMeters, widthInMeters, heightInMeters, GetTotalNodes()))
+    {
+        spatialGrid.Reset(cellSizeInMeters, widthInMeters, heightInMeters, GetTotalNodes());
+        for (u32 i = 0; i < GetTotalNodes(); i++)
+        {
+            UpdateSpatialGrid(i);
+        }
+    }
+}
+
+void CherrySim::UpdateSpatialGrid(u32 nodeIndex)
+{
+    //SetPosition might be called before the first simulation step prepared the grid
+    if (nodeIndex >= spatialGrid.GetNodeCount()) return;
+
+    spatialGrid.Update(nodeIndex, nodes[nodeIndex].GetXinMeters(), nodes[nodeIndex].GetYinMeters());
+}
+
+
+void CherrySim::PrepareLinkBudgetCache()
+{
+    LinkBudgetModelInputs modelInputs;
+    modelInputs.propagationConstant = propagationConstant;
+    modelInputs.mapWidthInMeters = simConfig.mapWidthInMeters;
+    modelInputs.mapHeightInMeters = simConfig.mapHeightInMeters;
+    modelInputs.mapElevationInMeters = simConfig.mapElevationInMeters;
+    modelInputs.ceilingAttenuationDb = simConfig.ceilingAttenuationDb;
+
+    if (!linkBudgetCache.IsConfiguredFor(GetTotalNodes(), modelInputs))
+    {
+        linkBudgetCache.Reset(GetTotalNodes(), modelInputs);
     }
 }
 
+void CherrySim::UpdateLinkBudgetCache(u32 nodeIndex)
+{
+    if (nodeIndex >= linkBudgetCache.GetNodeCount()) return;
+
+    LinkBudgetNodeInputs inputs;
+    inputs.x = nodes[nodeIndex].x;
+    inputs.y = nodes[nodeIndex].y;
+    inputs.z = nodes[nodeIndex].z;
+    inputs.floorNumber = nodes[nodeIndex].currentFloorNumber;
+    inputs.numImpossibleConnections = static_cast<u32>(nodes[nodeIndex].impossibleConnection.size());
+    linkBudgetCache.Update(nodeIndex, inputs);
+}
+
 
 void CherrySim::AddPacketToStats(PacketStat* statArray, PacketStat* packet)
 {
@@ -44,8 +44,18 @@ into all files in order to rewrite macros and other calls.
 #include <Terminal.h>
 #include <LedWrapper.h>
 #include <CherrySimTypes.h>
+#include <SpatialGrid.h>
+#include <LinkBudgetCache.h>
+#include <ClusteringTracker.h>
+#include <SimThreadPool.h>
+#include <ReplayJournal.h>
+#include <PcapWriter.h>
 #include <map>
+#include <set>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <exception>
 #include <string>
 
 struct ReplayRecordEntry
@@ -53,6 +63,7 @@ struct ReplayRecordEntry
     u32 index = 0;
     u32 time = 0;
     std::string command = "";
+    bool isUartInput = false; //If set, the command contains bytes that are received by the UART of the node
 
     bool operator<(const ReplayRecordEntry &other) const
     {
@@ -91,7 +102,7 @@ public:
     volatile bool receivedDataFromMeshGw = false;
     SimConfiguration simConfig; //The current configuration for the simulator
     SimulatorState simState; //The current state of the simulator
-    NodeEntry* currentNode = nullptr; //A pointer to the current node under simulation
+    static thread_local NodeEntry* currentNode; //A pointer to the current node under simulation, each simulation thread has its own
     NodeEntry* nodes = nullptr; //A pointer that points to the memory that holds the complete state of all nodes
     std::string logAccumulator;
 
@@ -161,6 +172,79 @@ TESTER_PUBLIC:
     };
     std::vector<LambdaWithHandle> simStepCallbacks;
 
+    //Stored checkpoints and the node memory of previous boots that they point into
+    std::vector<std::vector<u8>> checkpoints;
+    std::set<u32*> retainedNodeMemory;
+
+    //Buckets all nodes by position so that only nodes in radio range are visited for advertising
+    SpatialGrid spatialGrid;
+    std::vector<u32> spatialGridCandidates;
+    //Receivers of an advertisement in structure of arrays layout (see SimConfiguration::batchAdvertisingReception)
+    std::vector<u32> advertisingBatchReceivers;
+    std::vector<float> advertisingBatchRssiWithoutNoise;
+    std::vector<float> advertisingBatchRssi;
+    void PrepareSpatialGrid();
+    void UpdateSpatialGrid(u32 nodeIndex);
+
+    //Caches the rssi without noise between nodes in range, which only changes if one of them moves
+    LinkBudgetCache linkBudgetCache;
+    void PrepareLinkBudgetCache();
+    void UpdateLinkBudgetCache(u32 nodeIndex);
+
+    //Tracks the clustering of all nodes for IsClusteringDone, the state of a node is updated whenever it is left
+    ClusteringTracker clusteringTracker;
+    bool clusteringChangedSinceLastCheck = false;
+    u32 clusteringValidityCheckCycle = 0;
+    static constexpr u32 clusteringAuditInterval = 100; //The full clustering checks run at least every clusteringAuditInterval's simulation step.
+    void PrepareClusteringTracker();
+    void UpdateClusteringTracker(u32 nodeIndex);
+    void AuditClusteringTracker();
+    float GetCachedReceptionRssiNoNoise(const NodeEntry* sender, const NodeEntry* receiver);
+    float GetCapturedReceptionRssi(const NodeEntry* sender, const NodeEntry* receiver);
+
+    //Parallel stepping (see SimConfiguration::parallelStepThreads). Each step first simulates the radio of
+    //all nodes sequentially and then runs the firmware of all nodes on the thread pool. Operations that
+    //touch other nodes or global state are staged during the firmware phase and executed in node order
+    //afterwards, so that the result does not depend on the thread scheduling.
+    std::unique_ptr<SimThreadPool> threadPool;
+    bool parallelPhaseActive = false;
+    std::vector<u8> nodeSimulatedInStep;
+    std::vector<std::exception_ptr> nodeExceptions;
+    std::mutex loggedExceptionsMutex;
+    bool ShouldSkipCurrentNode(int64_t avgSimulatedFrames);
+    void SimulateStepForAllNodesInParallel(int64_t avgSimulatedFrames);
+
+    //Idle step skipping (see SimConfiguration::skipIdleSimulationSteps)
+    u32 GetMainTimerIntervalMs() const;
+    bool IsCurrentNodeIdle();
+    u32 GetNextWakeUpTimeMsOfCurrentNode();
+    bool IsIdleStepSkippingPossible() const;
+    bool ShouldSkipIdleStepOfCurrentNode();
+    void SkipIdleStepOfCurrentNode();
+    void SkipIdleSimulationSteps();
+
+    //Preclustering (see SimConfiguration::preclusterNodes)
+    bool preclusteringActive = false;
+    void SimulateFirmwareOfCurrentNode();
+    void FinishParallelPhase();
+
+    //Cloning of booted nodes (see SimConfiguration::cloneBootedNodes)
+    u32 clonedNodeCount = 0; //The amount of nodes that were cloned by the last BootAllNodes
+    static bool HaveSameBootInputs(const NodeEntry& representative, const NodeEntry& node);
+    bool IsCurrentNodeIdentityFromUicr() const;
+    void CloneBootedNodeIntoCurrentNode(NodeEntry& representative);
+
+    //Binary replay journal (see SimConfiguration::replayJournalPath)
+    std::unique_ptr<ReplayJournal> replayJournal;
+    bool replayingJournal = false;
+    std::string replayJournalSiteJson;
+    std::string replayJournalDevicesJson;
+    void LoadReplayJournal(const std::string& fileContents);
+    static void SendUartInput(NodeEntry* node, const u8* message, u32 messageLength);
+
+    //Packet capture (see SimConfiguration::pcapPath)
+    std::unique_ptr<PcapWriter> pcapWriter;
+
     std::map<std::string, MoveAnimation> loadedMoveAnimations;
     bool IsValidMoveAnimationJson(const nlohmann::json &json) const;
     MoveAnimation& AnimationGet(const std::string &name);
@@ -179,7 +263,9 @@ TESTER_PUBLIC:
     bool AnimationLoadJsonFromPath(const char* path);
 
     void StoreFlashToFile();
-    void LoadFlashFromFile();
+    bool LoadFlashFromFile(); //Returns true if the flash of all nodes was loaded
+    bool TransferCheckpoint(std::vector<u8>& buffer, size_t offset, bool storing, bool relocatable);
+    void UpdateCachesAfterCheckpointLoad();
     void PrepareSimulatedFeatureSets();
     void QueueInterrupts();
 
@@ -204,6 +290,23 @@ public:
     void SimulateStepForAllNodes(); //Simulates on timestep for all nodes
     void QuitSimulation();
 
+    //Checkpoints keep the complete state of the simulation in memory so that it can be rewound to them. They
+    //must be stored and loaded between two simulation steps and live until they are discarded (see CherrySim.adoc).
+    u32 StoreCheckpoint(); //Returns the id of the checkpoint
+    void LoadCheckpoint(u32 checkpointId);
+    void DiscardCheckpoints();
+    //Checkpoint files contain the same state, but are restored into the current memory of the nodes. They can be
+    //loaded by every CherrySim instance of the same build with the same amount of nodes, e.g. in another process.
+    void StoreCheckpointToFile(const std::string& path);
+    bool LoadCheckpointFromFile(const std::string& path); //Returns false if the file is missing or does not match
+
+    //Preclustering builds the mesh along a spanning tree by directly connecting the nodes of each edge instead
+    //of waiting for them to discover each other. Edges are pairs of node indices (central, peripheral). The
+    //nodes must be booted already. The handshakes still run in the firmware and take a few simulated seconds.
+    std::vector<std::pair<u32, u32>> GenerateSpanningTree();
+    void BuildMeshFromSpanningTree(const std::vector<std::pair<u32, u32>>& edges, u32 timeoutMs);
+    void PreclusterNodes(); //Builds a generated spanning tree and waits until the clustering is done
+
     //#### Terminal
     #ifdef TERMINAL_ENABLED
     TerminalCommandHandlerReturnType TerminalCommandHandler(const std::vector<std::string>& commandArgs);
@@ -211,6 +314,25 @@ public:
     void RegisterTerminalPrintListener(TerminalPrintListener* callback); // Register a class that will be notified when sth. is printed to the Terminal
     void TerminalPrintHandler(const char* message); //Called for all simulator output
 
+    //#### Parallel stepping
+    bool IsParallelPhaseActive() const;
+    MersenneTwister& GetRnd(); //The random number stream that must be used by the current node
+    u32 NextGlobalEventId();
+    u32 NextGlobalPacketId();
+
+    //Executes the operation immediately, or, while nodes are stepped in parallel, stages it for the current
+    //node. Must be used for everything that accesses other nodes or shared simulator state.
+    template<typename Operation>
+    void RunOrStage(Operation&& operation)
+    {
+        if (!parallelPhaseActive)
+        {
+            operation();
+            return;
+        }
+        currentNode->stagedOperations.emplace_back(std::forward<Operation>(operation));
+    }
+
     //#### Node Lifecycle
     u32 GetTotalNodes(bool countAgain = false) const; // returns number of all nodes i.e our nodes, vendor nodes and asset nodes
     u32 GetAssetNodes(bool countAgain = false) const; //iterates over all the nodes and calculate the node with device type Asset
@@ -222,11 +344,16 @@ public:
     void SetMasterPublicKey(const u8* key); //Used to set the key for testing against different keys
     const u8* GetMasterPublicKey(); //Returns the Master Public Key
     void FlashNode(u32 i); // Flashes a node with uicr and settings
+    std::map<BleStackType, std::unique_ptr<SimFlash>> goldenFlashImages; //The initial flash image for each BLE stack, only kept during Init
     void BootCurrentNode(); // Starts the node. ShutdownCurrentNode() must be called to clean up
+    void BootAllNodes(); // Boots all nodes for the first time, nodes may be cloned from a booted node (see SimConfiguration::cloneBootedNodes)
     void ResetCurrentNode(RebootReason rebootReason, bool throwException = true, bool powerLoss = false); //Resets a node and boots it again (Only call this after node was booted already)
     void ShutdownCurrentNode(); //Deletes the memory allocated by the node during runtime
     static void SendUartCommand(NodeId nodeId, const u8* message, u32 messageLength);
 
+    //Records an input of the given node in the replay journal if one is written
+    void AppendToReplayJournal(ReplayJournalRecordType type, u32 nodeIndex, const std::string& data);
+
     static int ChipsetToPageSize(Chipset chipset);
     static int ChipsetToCodeSize(Chipset chipset);
     static int ChipsetToApplicationSize(Chipset chipset);
@@ -263,6 +390,9 @@ public:
 
     //GAP Simulation
     void SimulateAdvertising();
+    void SimulateAdvertisingBatch(u32 indexStep, u32 startIndex, u32 nodeCount);
+    uint32_t ScaleAdvertisingReceptionProbability(uint32_t rawProbability, u32 indexStep);
+    bool DeliverAdvertisement(NodeEntry* receiver, uint32_t probability, const float* rssi);
     static ble_gap_addr_t Convert(const FruityHal::BleGapAddr* address);
     static FruityHal::BleGapAddr Convert(const ble_gap_addr_t* p_addr);
     void ConnectMasterToSlave(NodeEntry * master, NodeEntry* slave);
@@ -274,10 +404,17 @@ public:
 
     //GATT Simulation
     void SimulateConnections();
+    void SimulateConnectionEvents(SoftdeviceConnection* connection);
+    u32 GetLinkLayerExchangeAirtimeUs(const SoftdeviceConnection* connection, u32 payloadOctets) const;
     void SendUnreliableTxCompleteEvent(NodeEntry* node, int connHandle, u8 packetCount);
     void GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket);
     void GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket);
 
+    //Packet capture (see SimConfiguration::pcapPath)
+    void CaptureAdvertisement(NodeEntry* receiver, i8 rssi);
+    void CaptureConnectionFragment(const SoftdeviceConnection* connection, const SoftDeviceBufferedPacket* packet, u32 fragmentIndex, uint64_t timestampUs, bool received);
+    void CaptureConnectionPacket(const SoftdeviceConnection* connection, const SoftDeviceBufferedPacket* packet, uint64_t timestampUs);
+
     //GPIO Simulation
     void SetSimLed(bool state);
 
@@ -323,6 +460,7 @@ public:
     void ChooseSimulatorTerminal();
 
     float GetDistanceBetween(const NodeEntry * nodeA, const NodeEntry * nodeB);
+    bool IsOutOfRadioRange(const NodeEntry* sender, const NodeEntry* receiver) const;
     float GetReceptionRssi(const NodeEntry* sender, const NodeEntry* receiver);
     float GetReceptionRssiNoNoise(const NodeEntry* sender, const NodeEntry* receiver);
 
@@ -332,6 +470,7 @@ private:
 public:
     uint32_t CalculateReceptionProbabilityForConnection(const NodeEntry* sendingNode, const NodeEntry* receivingNode);
     uint32_t CalculateReceptionProbabilityForAdvertisement(const NodeEntry* sendingNode, const NodeEntry* receivingNode);
+    uint32_t CalculateReceptionProbabilityForAdvertisementFromRssi(const NodeEntry* receivingNode, float rssi);
 
     bool ShouldSimIvTrigger(u32 ivMs);
     bool ShouldSimConnectionIvTrigger(u32 ivMs, SoftdeviceConnection* connection);
@@ -0,0 +1,295 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "CherrySim.h"
+#include "CherrySimUtils.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "json.hpp"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/**
+The CherrySimBenchmark runs a fixed set of scenarios and reports the throughput and the memory
+consumption of the simulator as json. The results only depend on the seed, apart from the
+measured wall clock times, so that runs of different builds can be compared with each other.
+
+Usage: cherrySim_benchmark [--seed <seed>] [--scenario <name>]... [--output <path>] [--list]
+The results are written to cherrysim_benchmark.json if no output path is given.
+*/
+
+#ifdef CHERRYSIM_BENCHMARK_ENABLED
+
+struct BenchmarkScenario
+{
+    std::string name;
+    u32 numNodes;
+    u32 clusteringTimeoutMs;
+    //If bigger than 0, all nodes flood the mesh with DebugModule messages for this time after clustering
+    u32 floodDurationMs;
+};
+
+static const std::vector<BenchmarkScenario> benchmarkScenarios = {
+    { "clustering_50",      50,  1000 * 1000,          0 },
+    { "clustering_200",    200,  2000 * 1000,          0 },
+    { "clustering_1000",  1000,  4000 * 1000,          0 },
+    { "clustering_5000",  5000,  8000 * 1000,          0 },
+    { "flooding_200",      200,  2000 * 1000, 60 * 1000 },
+};
+
+//The output of the nodes is not of interest for the benchmark, it is simply dropped
+class BenchmarkListener : public TerminalPrintListener, public CherrySimEventListener
+{
+public:
+    void TerminalPrintHandler(NodeEntry* currentNode, const char* message) override {}
+    void CherrySimEventHandler(const char* eventType) override {}
+    void CherrySimBleEventHandler(NodeEntry* currentNode, simBleEvent* simBleEvent, u16 eventSize) override {}
+};
+
+//Peak resident set size of the whole process in KB, 0 if not supported on this platform
+static uint64_t GetPeakRssKb()
+{
+#ifdef __linux__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return (uint64_t)usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+//Current resident set size of the whole process in KB, 0 if not supported on this platform
+static uint64_t GetCurrentRssKb()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t totalPages = 0;
+    uint64_t residentPages = 0;
+    if (statm >> totalPages >> residentPages) return residentPages * (uint64_t)sysconf(_SC_PAGESIZE) / 1024;
+#endif
+    return 0;
+}
+
+static double SecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static SimConfiguration CreateBenchmarkSimConfiguration(const BenchmarkScenario& scenario, u32 seed)
+{
+    SimConfiguration simConfig;
+
+    simConfig.seed = seed;
+    //The node density is the same for all scenarios, each node gets an area of 20m x 20m on average
+    simConfig.mapWidthInMeters = (u32)std::ceil(20.0 * std::sqrt((double)scenario.numNodes));
+    simConfig.mapHeightInMeters = simConfig.mapWidthInMeters;
+    simConfig.mapElevationInMeters = 1;
+    simConfig.simTickDurationMs = 50;
+    simConfig.terminalId = 1; //Only the sink is used to send commands
+
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", scenario.numNodes - 1 });
+
+    simConfig.interruptProbability = UINT32_MAX / 10;
+    simConfig.sdBusyProbability = UINT32_MAX / 100;
+    simConfig.simulateAsyncFlash = true;
+    simConfig.asyncFlashCommitTimeProbability = UINT32_MAX / 10 * 9;
+
+    simConfig.defaultNetworkId = 10;
+    simConfig.disableNonCriticalExceptions = true;
+
+    return simConfig;
+}
+
+struct PhaseResult
+{
+    u32 steps = 0;
+    u32 simulatedMs = 0;
+    double wallSeconds = 0;
+};
+
+static nlohmann::json PhaseToJson(const PhaseResult& phase)
+{
+    nlohmann::json j;
+    j["steps"] = phase.steps;
+    j["simulatedSeconds"] = phase.simulatedMs / 1000.0;
+    j["wallSeconds"] = phase.wallSeconds;
+    j["stepsPerSecond"] = phase.wallSeconds > 0 ? phase.steps / phase.wallSeconds : 0;
+    j["simulatedSecondsPerWallSecond"] = phase.wallSeconds > 0 ? phase.simulatedMs / 1000.0 / phase.wallSeconds : 0;
+    return j;
+}
+
+static nlohmann::json RunScenario(const BenchmarkScenario& scenario, u32 seed)
+{
+    BenchmarkListener listener;
+    const uint64_t rssBeforeKb = GetCurrentRssKb();
+
+    const auto setupStart = std::chrono::steady_clock::now();
+    CherrySim* sim = new CherrySim(CreateBenchmarkSimConfiguration(scenario, seed));
+    sim->SetCherrySimEventListener(&listener);
+    sim->RegisterTerminalPrintListener(&listener);
+    sim->Init();
+    sim->BootAllNodes();
+    const double setupWallSeconds = SecondsSince(setupStart);
+    const uint64_t rssAfterBootKb = GetCurrentRssKb();
+
+    //Phase 1: Simulate until all nodes are in a single cluster or the timeout is reached
+    PhaseResult clustering;
+    auto phaseStart = std::chrono::steady_clock::now();
+    u32 phaseStartMs = sim->simState.simTimeMs;
+    bool clusteringDone = false;
+    while (!(clusteringDone = sim->IsClusteringDone()) && sim->simState.simTimeMs - phaseStartMs < scenario.clusteringTimeoutMs)
+    {
+        sim->SimulateStepForAllNodes();
+        clustering.steps++;
+    }
+    clustering.simulatedMs = sim->simState.simTimeMs - phaseStartMs;
+    clustering.wallSeconds = SecondsSince(phaseStart);
+
+    //Phase 2: Let all nodes broadcast unreliable flood messages with the DebugModule
+    PhaseResult flooding;
+    if (scenario.floodDurationMs > 0)
+    {
+        const std::string floodCommand = "action 0 debug flood 0 2 10 " + std::to_string(scenario.floodDurationMs / 1000 + 10);
+        sim->DoSendTerminalCommand(sim->nodes[0], floodCommand, false, true);
+
+        phaseStart = std::chrono::steady_clock::now();
+        phaseStartMs = sim->simState.simTimeMs;
+        while (sim->simState.simTimeMs - phaseStartMs < scenario.floodDurationMs)
+        {
+            sim->SimulateStepForAllNodes();
+            flooding.steps++;
+        }
+        flooding.simulatedMs = sim->simState.simTimeMs - phaseStartMs;
+        flooding.wallSeconds = SecondsSince(phaseStart);
+    }
+
+    PhaseResult total;
+    total.steps = clustering.steps + flooding.steps;
+    total.simulatedMs = clustering.simulatedMs + flooding.simulatedMs;
+    total.wallSeconds = clustering.wallSeconds + flooding.wallSeconds;
+
+    nlohmann::json result;
+    result["name"] = scenario.name;
+    result["nodes"] = sim->GetTotalNodes();
+    result["clusteringDone"] = clusteringDone;
+    result["setupWallSeconds"] = setupWallSeconds;
+    result["clustering"] = PhaseToJson(clustering);
+    if (scenario.floodDurationMs > 0) result["flooding"] = PhaseToJson(flooding);
+    result["total"] = PhaseToJson(total);
+    //The peak is measured for the whole process, run a single scenario per process to get isolated values
+    result["peakRssKb"] = GetPeakRssKb();
+    result["rssPerNodeKb"] = rssAfterBootKb > rssBeforeKb ? (double)(rssAfterBootKb - rssBeforeKb) / sim->GetTotalNodes() : 0;
+    result["nodeEntrySizeBytes"] = sizeof(NodeEntry);
+
+    delete sim;
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    u32 seed = 1;
+    std::string outputPath = "cherrysim_benchmark.json";
+    std::vector<std::string> scenarioNames;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string s = argv[i];
+        if (s == "--seed" && i + 1 < argc)
+        {
+            seed = Utility::StringToU32(argv[++i]);
+        }
+        else if (s == "--scenario" && i + 1 < argc)
+        {
+            scenarioNames.push_back(argv[++i]);
+        }
+        else if (s == "--output" && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else if (s == "--list")
+        {
+            for (const BenchmarkScenario& scenario : benchmarkScenarios) printf("%s" EOL, scenario.name.c_str());
+            return 0;
+        }
+        else
+        {
+            std::cerr << "Unknown parameter " << s << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<const BenchmarkScenario*> scenariosToRun;
+    for (const BenchmarkScenario& scenario : benchmarkScenarios)
+    {
+        if (scenarioNames.empty() || std::find(scenarioNames.begin(), scenarioNames.end(), scenario.name) != scenarioNames.end())
+        {
+            scenariosToRun.push_back(&scenario);
+        }
+    }
+    if (scenariosToRun.size() == 0 || (!scenarioNames.empty() && scenariosToRun.size() != scenarioNames.size()))
+    {
+        std::cerr << "Unknown scenario, use --list to get all available scenarios\n";
+        return 1;
+    }
+
+    //Logging of the nodes is disabled, the terminal of the sink still accepts commands
+    Terminal::stdioActive = false;
+
+    nlohmann::json results;
+    results["seed"] = seed;
+    results["scenarios"] = nlohmann::json::array();
+    for (const BenchmarkScenario* scenario : scenariosToRun)
+    {
+        printf("Running %s" EOL, scenario->name.c_str());
+        results["scenarios"].push_back(RunScenario(*scenario, seed));
+    }
+
+    //The json is not printed to stdout as the simulator itself prints some status messages there
+    std::ofstream outputFile(outputPath);
+    if (!outputFile)
+    {
+        std::cerr << "Could not open " << outputPath << "\n";
+        return 1;
+    }
+    outputFile << results.dump(4) << std::endl;
+    printf("Results written to %s" EOL, outputPath.c_str());
+
+    return 0;
+}
+#endif //CHERRYSIM_BENCHMARK_ENABLED
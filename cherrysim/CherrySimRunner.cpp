@@ -38,6 +38,9 @@
 #include <cmath>
 #include <regex>
 #include <cinttypes>
+#include <map>
+#include <algorithm>
+#include <typeinfo>
 
 #include "json.hpp"
 
@@ -49,9 +52,19 @@
 #include <emscripten.h>
 #endif
 
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 /**
 The CherrySimRunner is used to start the simulator in a forever running loop.
 Terminal input into all nodes is possible and visualization works using FruityMap.
+
+With --batch <numSeeds>, the runner instead simulates the configured scenario once per seed, starting with the
+configured seed, and writes a report to cherrysim_batch.json (see CherrySim.adoc).
+
+With --replay <path>, the runner replays a replay log or a binary replay journal.
 */
 
 static bool shortLived = false; //Used for making sure that the Runner is able to run on CI.
@@ -59,6 +72,253 @@ static std::chrono::high_resolution_clock::time_point startTime;
 extern bool meshGwCommunication;
 
 #ifdef CHERRYSIM_RUNNER_ENABLED
+//######################################## Batch ##########################################
+// Runs the same scenario with many seeds and writes an aggregated report
+//#########################################################################################
+
+struct BatchConfig
+{
+    u32 numSeeds = 0;
+    u32 numJobs = 0; //0: one job per hardware thread
+    u32 clusteringTimeoutMs = 1000 * 1000;
+    u32 durationMs = 0; //Simulated time after the clustering, the mesh must still be clustered afterwards
+    std::string outputPath = "cherrysim_batch.json";
+};
+
+//The output of the nodes is not of interest in a batch, it is simply dropped
+class BatchListener : public TerminalPrintListener, public CherrySimEventListener
+{
+public:
+    void TerminalPrintHandler(NodeEntry* currentNode, const char* message) override {}
+    void CherrySimEventHandler(const char* eventType) override {}
+    void CherrySimBleEventHandler(NodeEntry* currentNode, simBleEvent* simBleEvent, u16 eventSize) override {}
+};
+
+static nlohmann::json RunBatchSeed(const SimConfiguration& baseConfig, const BatchConfig& batchConfig, u32 seed)
+{
+    //Same as in CherrySimRunner::Simulate, these are correctly handled by FruityMesh
+    Exceptions::ExceptionDisabler<ErrorCodeUnknownException> ecue;
+    Exceptions::ExceptionDisabler<CRCMissingException> crcme;
+    Exceptions::ExceptionDisabler<CRCInvalidException> crcie;
+    Exceptions::ExceptionDisabler<CommandNotFoundException> cnfe;
+    Exceptions::ExceptionDisabler<TooManyArgumentsException> tmae;
+    Exceptions::ExceptionDisabler<ErrorLoggedException> ele;
+
+    SimConfiguration simConfig = baseConfig;
+    simConfig.seed = seed;
+    //Servers of concurrently running seeds must not block each others ports
+    simConfig.webServerPort = 0;
+    simConfig.socketServerPort = 0;
+    simConfig.logReplayCommands = false;
+    simConfig.realTime = false;
+    simConfig.playDelay = 0;
+
+    nlohmann::json result;
+    result["seed"] = seed;
+
+    BatchListener listener;
+    const auto startTime = std::chrono::steady_clock::now();
+    CherrySim* sim = nullptr;
+    bool clusteringDone = false;
+    bool clusteredAtEnd = false;
+    try
+    {
+        sim = new CherrySim(simConfig);
+        sim->SetCherrySimEventListener(&listener);
+        sim->RegisterTerminalPrintListener(&listener);
+        sim->Init();
+        sim->nodes[0].uicr.CUSTOMER[11] = (u32)DeviceType::SINK; //Same as in CherrySimRunner::Init
+        sim->BootAllNodes();
+        if (simConfig.preclusterNodes)
+        {
+            sim->PreclusterNodes();
+        }
+
+        while (!(clusteringDone = sim->IsClusteringDone()) && sim->simState.simTimeMs < batchConfig.clusteringTimeoutMs)
+        {
+            sim->SimulateStepForAllNodes();
+        }
+        result["clusteringTimeMs"] = sim->simState.simTimeMs;
+
+        if (clusteringDone)
+        {
+            const u32 endTimeMs = sim->simState.simTimeMs + batchConfig.durationMs;
+            while (sim->simState.simTimeMs < endTimeMs)
+            {
+                sim->SimulateStepForAllNodes();
+            }
+            clusteredAtEnd = sim->IsClusteringDone();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        result["exception"] = typeid(e).name();
+        //The simulator might be in an inconsistent state after a node threw in the middle of a step, so it is
+        //not deleted. This only leaks memory if the seeds run sequentially.
+        sim = nullptr;
+    }
+
+    result["clusteringDone"] = clusteringDone;
+    result["clusteredAtEnd"] = clusteredAtEnd;
+    result["passed"] = clusteringDone && clusteredAtEnd && !result.contains("exception");
+    result["wallSeconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::map<std::string, int> counts;
+    std::map<std::string, int> avgCounts;
+    std::map<std::string, int> avgTotals;
+    sim_get_all_statistics(counts, avgCounts, avgTotals);
+    result["statistics"]["counts"] = counts;
+    result["statistics"]["avgCounts"] = avgCounts;
+    result["statistics"]["avgTotals"] = avgTotals;
+
+    delete sim;
+
+    return result;
+}
+
+#ifdef __linux__
+//Each seed runs in a forked process as the firmware of all nodes relies on global state. The child inherits the
+//already parsed configuration and writes its result to a file that is read by the parent after the child exited.
+static nlohmann::json CollectBatchSeedResult(const std::string& resultPath, u32 seed, int status)
+{
+    nlohmann::json result;
+    std::ifstream resultFile(resultPath);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && resultFile)
+    {
+        result = nlohmann::json::parse(resultFile, nullptr, false);
+    }
+    resultFile.close();
+    std::remove(resultPath.c_str());
+
+    if (result.is_discarded() || result.is_null())
+    {
+        //The child crashed, e.g. with a segmentation fault or an abort in a debug break
+        result = nlohmann::json();
+        result["seed"] = seed;
+        result["passed"] = false;
+        result["crashed"] = true;
+        if (WIFSIGNALED(status)) result["signal"] = WTERMSIG(status);
+    }
+    return result;
+}
+#endif
+
+static std::vector<nlohmann::json> RunBatchSeeds(const SimConfiguration& simConfig, const BatchConfig& batchConfig)
+{
+    std::vector<nlohmann::json> results;
+#ifdef __linux__
+    const u32 numJobs = batchConfig.numJobs > 0 ? batchConfig.numJobs : std::max(1u, std::thread::hardware_concurrency());
+    std::map<pid_t, u32> runningSeeds;
+    u32 nextSeedIndex = 0;
+
+    while (nextSeedIndex < batchConfig.numSeeds || !runningSeeds.empty())
+    {
+        while (nextSeedIndex < batchConfig.numSeeds && runningSeeds.size() < numJobs)
+        {
+            const u32 seed = simConfig.seed + nextSeedIndex;
+            nextSeedIndex++;
+
+            fflush(stdout);
+            const pid_t pid = fork();
+            if (pid < 0)
+            {
+                SIMEXCEPTIONFORCE(IllegalStateException);
+            }
+            if (pid == 0)
+            {
+                const nlohmann::json result = RunBatchSeed(simConfig, batchConfig, seed);
+                std::ofstream resultFile(batchConfig.outputPath + "." + std::to_string(seed) + ".tmp");
+                resultFile << result.dump() << std::endl;
+                resultFile.close();
+                //Skips the destructors of the global state that was copied from the parent
+                _exit(resultFile ? 0 : 1);
+            }
+            runningSeeds[pid] = seed;
+        }
+
+        int status = 0;
+        const pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) SIMEXCEPTIONFORCE(IllegalStateException);
+        auto it = runningSeeds.find(pid);
+        if (it == runningSeeds.end()) continue;
+
+        const u32 seed = it->second;
+        runningSeeds.erase(it);
+        results.push_back(CollectBatchSeedResult(batchConfig.outputPath + "." + std::to_string(seed) + ".tmp", seed, status));
+        printf("Seed %u %s (%u/%u)" EOL, seed, results.back()["passed"].get<bool>() ? "passed" : "FAILED", (u32)results.size(), batchConfig.numSeeds);
+    }
+
+    //Children finish in any order
+    std::sort(results.begin(), results.end(), [](const nlohmann::json& a, const nlohmann::json& b) {
+        return a["seed"].get<u32>() < b["seed"].get<u32>();
+    });
+#else
+    //Without fork, the seeds are simulated one after another in this process
+    for (u32 i = 0; i < batchConfig.numSeeds; i++)
+    {
+        sim_clear_statistics();
+        results.push_back(RunBatchSeed(simConfig, batchConfig, simConfig.seed + i));
+        printf("Seed %u %s (%u/%u)" EOL, simConfig.seed + i, results.back()["passed"].get<bool>() ? "passed" : "FAILED", i + 1, batchConfig.numSeeds);
+    }
+#endif
+    return results;
+}
+
+static int RunBatch(const SimConfiguration& simConfig, const BatchConfig& batchConfig)
+{
+    //Logging of the nodes is disabled for all seeds
+    Terminal::stdioActive = false;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const std::vector<nlohmann::json> results = RunBatchSeeds(simConfig, batchConfig);
+
+    nlohmann::json report;
+    std::vector<u32> clusteringTimesMs;
+    std::vector<u32> failedSeeds;
+    std::map<std::string, int> counts;
+    std::map<std::string, int> avgCounts;
+    std::map<std::string, int> avgTotals;
+    for (const nlohmann::json& result : results)
+    {
+        if (!result["passed"].get<bool>()) failedSeeds.push_back(result["seed"].get<u32>());
+        if (result.value("clusteringDone", false)) clusteringTimesMs.push_back(result["clusteringTimeMs"].get<u32>());
+        if (!result.contains("statistics")) continue;
+        for (const auto& entry : result["statistics"]["counts"].items()) counts[entry.key()] += entry.value().get<int>();
+        for (const auto& entry : result["statistics"]["avgCounts"].items()) avgCounts[entry.key()] += entry.value().get<int>();
+        for (const auto& entry : result["statistics"]["avgTotals"].items()) avgTotals[entry.key()] += entry.value().get<int>();
+    }
+    std::sort(clusteringTimesMs.begin(), clusteringTimesMs.end());
+
+    report["firstSeed"] = simConfig.seed;
+    report["seeds"] = batchConfig.numSeeds;
+    report["passed"] = batchConfig.numSeeds - failedSeeds.size();
+    report["failedSeeds"] = failedSeeds;
+    report["wallSeconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (!clusteringTimesMs.empty())
+    {
+        report["clusteringTimeMs"]["min"] = clusteringTimesMs.front();
+        report["clusteringTimeMs"]["median"] = clusteringTimesMs[clusteringTimesMs.size() / 2];
+        report["clusteringTimeMs"]["max"] = clusteringTimesMs.back();
+    }
+    report["statistics"]["counts"] = counts;
+    for (const auto& entry : avgCounts)
+    {
+        report["statistics"]["avg"][entry.first] = entry.second > 0 ? avgTotals[entry.first] / entry.second : 0;
+    }
+    report["results"] = results;
+
+    std::ofstream outputFile(batchConfig.outputPath);
+    if (!outputFile)
+    {
+        std::cerr << "Could not open " << batchConfig.outputPath << "\n";
+        return 1;
+    }
+    outputFile << report.dump(4) << std::endl;
+    printf("%u of %u seeds passed, report written to %s" EOL, (u32)(batchConfig.numSeeds - failedSeeds.size()), batchConfig.numSeeds, batchConfig.outputPath.c_str());
+
+    return failedSeeds.empty() ? 0 : 1;
+}
+
 int main(int argc, char** argv) {
     printf("#################################################" EOL
            "#                  CherrySim                    #" EOL
@@ -67,6 +327,7 @@ int main(int argc, char** argv) {
 
     CherrySimRunnerConfig runnerConfig = CherrySimRunner::CreateDefaultRunnerConfiguration();
     SimConfiguration simConfig = CherrySimRunner::CreateDefaultSimConfiguration();
+    BatchConfig batchConfig;
 
     for (int i = 0; i < argc; i++)
     {
@@ -168,12 +429,42 @@ int main(int argc, char** argv) {
         {
             Terminal::stdioActive = false;
         }
+        else if (s == "--batch" && i + 1 < argc)
+        {
+            batchConfig.numSeeds = Utility::StringToU32(argv[++i]);
+        }
+        else if (s == "--jobs" && i + 1 < argc)
+        {
+            batchConfig.numJobs = Utility::StringToU32(argv[++i]);
+        }
+        else if (s == "--clusteringTimeout" && i + 1 < argc)
+        {
+            batchConfig.clusteringTimeoutMs = Utility::StringToU32(argv[++i]) * 1000;
+        }
+        else if (s == "--duration" && i + 1 < argc)
+        {
+            batchConfig.durationMs = Utility::StringToU32(argv[++i]) * 1000;
+        }
+        else if (s == "--output" && i + 1 < argc)
+        {
+            batchConfig.outputPath = argv[++i];
+        }
+        else if (s == "--replay" && i + 1 < argc)
+        {
+            //The configuration is replaced by the one of the recorded run
+            simConfig.replayPath = argv[++i];
+        }
         else
         {
             if (i != 0) std::cerr << "WARNING: unknown parameter " << s << "\n";
         }
     }
 
+    if (batchConfig.numSeeds > 0)
+    {
+        return RunBatch(simConfig, batchConfig);
+    }
+
     printf(
         "#  Open your browser at http://localhost:%u/  #" EOL
         "#  to view the visualization of the simulation  #" EOL
@@ -352,9 +643,11 @@ void CherrySimRunner::Init()
 
 
     //Boot up all nodes
-    for (u32 i = 0; i < sim->GetTotalNodes(); i++) {
-        NodeIndexSetter setter(i);
-        sim->BootCurrentNode();
+    sim->BootAllNodes();
+
+    if (simConfig.preclusterNodes)
+    {
+        sim->PreclusterNodes();
     }
 
     if (shortLived)
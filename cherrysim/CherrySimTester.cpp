@@ -375,16 +375,21 @@ void CherrySimTester::Start()
         SIMEXCEPTION(IllegalStateException);
     }
 
-    //Boot up all nodes
-    for (u32 i = 0; i < sim->GetTotalNodes(); i++) {
 #ifdef GITHUB_RELEASE
+    for (u32 i = 0; i < sim->GetTotalNodes(); i++) {
         sim->nodes[i].nodeConfiguration = sim->RedirectFeatureset(sim->nodes[i].nodeConfiguration);
-#endif
-        NodeIndexSetter setter(i);
-        sim->BootCurrentNode();
     }
+#endif
+
+    //Boot up all nodes
+    sim->BootAllNodes();
 
     started = true;
+
+    if (sim->simConfig.preclusterNodes)
+    {
+        sim->PreclusterNodes();
+    }
 }
 
 void CherrySimTester::SimulateUntilClusteringDone(int timeoutMs, std::function<void()> executePerStep)
@@ -430,6 +435,7 @@ void CherrySimTester::SimulateBroadcastMessage(double x, double y, ble_gap_evt_a
 
     sim->currentNode->x = (float)x;
     sim->currentNode->y = (float)y;
+    sim->UpdateLinkBudgetCache(sim->currentNode->index);
     u32 numNoneAssetNodes = sim->GetTotalNodes() - sim->GetAssetNodes();
     for (u32 i = 0; i < numNoneAssetNodes; i++) {
         //If the other node is scanning
@@ -438,7 +444,7 @@ void CherrySimTester::SimulateBroadcastMessage(double x, double y, ble_gap_evt_a
             uint32_t probability = sim->CalculateReceptionProbabilityForAdvertisement(sim->currentNode, &(sim->nodes[i]));
             if (PSRNG(probability) || ignoreDropProb) {
                 simBleEvent s;
-                s.globalId = sim->simState.globalEventIdCounter++;
+                s.globalId = sim->NextGlobalEventId();
                 s.bleEvent.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
                 s.bleEvent.header.evt_len = s.globalId;
                 s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
@@ -542,6 +548,10 @@ void CherrySimTester::SimulateUntilRegexMessagesReceived(int timeoutMs, std::vec
     if (timeoutMs == 0) SIMEXCEPTION(ZeroTimeoutNotSupportedException);
     useRegex = true;
     awaitedTerminalOutputs = &messages;
+    for (SimulationMessage& message : messages)
+    {
+        message.PrepareRegex();
+    }
 
     _SimulateUntilMessageReceived(timeoutMs);
 }
@@ -877,10 +887,111 @@ void SimulationMessage::MakeFound(const std::string & messageComplete)
 
 bool SimulationMessage::MatchesRegex(const std::string & message)
 {
+    PrepareRegex();
+
+    //Most lines of terminal output do not contain the literals and are rejected without running the regex
+    for (const std::string& literal : requiredRegexLiterals)
+    {
+        if (message.find(literal) == std::string::npos) return false;
+    }
+
+    return std::regex_search(message, *compiledRegex);
+}
+
+void SimulationMessage::PrepareRegex()
+{
+    if (compiledRegex) return;
+
     //If you came here because of a std::regex_error, you might have missed escaping a special character such as {
     // use \{ instead
-    std::regex reg(messagePart);
-    return std::regex_search(message, reg);
+    compiledRegex = std::make_shared<const std::regex>(messagePart);
+    requiredRegexLiterals = GetRequiredRegexLiterals(messagePart);
+}
+
+std::vector<std::string> SimulationMessage::GetRequiredRegexLiterals(const std::string& regex)
+{
+    std::vector<std::string> literals;
+    std::string current;
+    const auto finishLiteral = [&]() {
+        if (!current.empty()) literals.push_back(current);
+        current.clear();
+    };
+
+    //\x, \u and \c are followed by operands that must not be taken as literals
+    const auto getEscapeOperandLength = [](char escaped) -> size_t {
+        if (escaped == 'x') return 2;
+        if (escaped == 'u') return 4;
+        if (escaped == 'c') return 1;
+        return 0;
+    };
+
+    //Only characters outside of groups and character classes are used as the content of a group might be optional
+    u32 groupDepth = 0;
+    bool inCharacterClass = false;
+    for (size_t i = 0; i < regex.size(); i++)
+    {
+        char c = regex[i];
+        if (inCharacterClass)
+        {
+            if (c == '\\')
+            {
+                if (i + 1 >= regex.size()) return {};
+                i += 1 + getEscapeOperandLength(regex[i + 1]);
+            }
+            else if (c == ']') inCharacterClass = false;
+            continue;
+        }
+
+        if (c == '\\')
+        {
+            if (i + 1 >= regex.size()) return {};
+            c = regex[++i];
+            //Escaped letters and digits are character classes, assertions, back references or character codes
+            if (!ispunct((unsigned char)c))
+            {
+                finishLiteral();
+                i += getEscapeOperandLength(c);
+                if (i >= regex.size()) return {};
+                continue;
+            }
+        }
+        else if (c == '|')
+        {
+            //None of the literals is required if the whole regex has alternatives
+            if (groupDepth == 0) return {};
+            continue;
+        }
+        else if (c == '[' || c == '(' || c == ')')
+        {
+            finishLiteral();
+            if (c == '[') inCharacterClass = true;
+            else if (c == '(') groupDepth++;
+            else if (groupDepth > 0) groupDepth--;
+            continue;
+        }
+        else if (c == '*' || c == '?' || c == '{')
+        {
+            //The quantified character might not occur at all
+            if (!current.empty()) current.pop_back();
+            finishLiteral();
+            if (c == '{')
+            {
+                i = regex.find('}', i);
+                if (i == std::string::npos) return {};
+            }
+            continue;
+        }
+        else if (c == '+' || c == '.' || c == '^' || c == '$')
+        {
+            finishLiteral();
+            continue;
+        }
+
+        if (groupDepth == 0) current += c;
+    }
+    finishLiteral();
+
+    return literals;
 }
 
 void SimulationMessage::PrintState() const
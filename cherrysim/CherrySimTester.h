@@ -32,6 +32,8 @@
 #include <CherrySim.h>
 
 #include <functional>
+#include <memory>
+#include <regex>
 #include <type_traits>
 
 constexpr int MAX_TERMINAL_OUTPUT = 1024;
@@ -99,6 +101,9 @@ private:
     bool               found           = false;
     // if false e.g. SimulateUntilMessagesReceived will throw an Exception should the message be received
     bool               shouldOccur = true;
+    // The messagePart compiled as a regex and the literals that every match must contain, see PrepareRegex
+    std::shared_ptr<const std::regex> compiledRegex;
+    std::vector<std::string>          requiredRegexLiterals;
 
     bool Matches(const std::string &message);
     void MakeFound(const std::string &messageComplete);
@@ -108,6 +113,12 @@ public:
     SimulationMessage(TerminalId, const std::string& messagePart, bool shouldOccur=true);
     SimulationMessage(NodeEntryPredicate predicate, const std::string& messagePart, bool shouldOccur=true);
     bool CheckAndSet(const std::string &message, bool useRegex);
+    /// Compiles the messagePart as a regex if that did not happen yet. Done once for all awaited messages
+    /// before simulating so that the regex is not compiled again for every line of terminal output.
+    void PrepareRegex();
+    /// Returns literal strings that are contained in every text matched by the given regex. Used to reject
+    /// most terminal output without running the regex. Returns fewer literals than possible if unsure.
+    static std::vector<std::string> GetRequiredRegexLiterals(const std::string& regex);
     bool IsFound() const;
     bool ShouldOccur() const { return shouldOccur; }
     const std::string& GetCompleteMessage() const;
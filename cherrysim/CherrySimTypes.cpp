@@ -62,6 +62,8 @@ void to_json(nlohmann::json& j, const SimConfiguration & config)
         { "devicesJsonPath"                          , config.devicesJsonPath                           },
         { "replayPath"                               , config.replayPath                                },
         { "logReplayCommands"                        , config.logReplayCommands                         },
+        { "replayJournalPath"                        , config.replayJournalPath                         },
+        { "pcapPath"                                 , config.pcapPath                                  },
         { "useLogAccumulator"                        , config.useLogAccumulator                         },
         { "defaultNetworkId"                         , config.defaultNetworkId                          },
         { "ignoreDeviceJsonEnrollments"              , config.ignoreDeviceJsonEnrollments               },
@@ -81,6 +83,16 @@ void to_json(nlohmann::json& j, const SimConfiguration & config)
         { "perfectReceptionProbabilityForConnection" , config.perfectReceptionProbabilityForConnection  },
         { "verboseCommands"                          , config.verboseCommands                           },
         { "simulateAdvertisingIndexStep"             , config.simulateAdvertisingIndexStep              },
+        { "batchAdvertisingReception"                , config.batchAdvertisingReception                 },
+        { "parallelStepThreads"                      , config.parallelStepThreads                       },
+        { "skipIdleSimulationSteps"                  , config.skipIdleSimulationSteps                   },
+        { "preclusterNodes"                          , config.preclusterNodes                           },
+        { "cloneBootedNodes"                         , config.cloneBootedNodes                          },
+        { "simulateConnectionEvents"                 , config.simulateConnectionEvents                  },
+        { "connectionEventLengthUs"                  , config.connectionEventLengthUs                   },
+        { "connectionPhyMbps"                        , config.connectionPhyMbps                         },
+        { "connectionMaxTxOctets"                    , config.connectionMaxTxOctets                     },
+        { "connectionMaxPacketsPerEvent"             , config.connectionMaxPacketsPerEvent              },
         { "disableNonCriticalExceptions"             , config.disableNonCriticalExceptions              },
         { "webServerPort"                            , config.webServerPort                             },
         { "socketServerPort"                         , config.socketServerPort                          },
@@ -119,6 +131,8 @@ void from_json(const nlohmann::json & j, SimConfiguration & config)
         else if(it.key() == "devicesJsonPath"                           ) config.devicesJsonPath                           = *it;
         else if(it.key() == "replayPath"                                ) config.replayPath                                = *it;
         else if(it.key() == "logReplayCommands"                         ) config.logReplayCommands                         = *it;
+        else if(it.key() == "replayJournalPath"                         ) config.replayJournalPath                         = *it;
+        else if(it.key() == "pcapPath"                                  ) config.pcapPath                                  = *it;
         else if(it.key() == "useLogAccumulator"                         ) config.useLogAccumulator                         = *it;
         else if(it.key() == "defaultNetworkId"                          ) config.defaultNetworkId                          = *it;
         else if(it.key() == "ignoreDeviceJsonEnrollments"               ) config.ignoreDeviceJsonEnrollments               = *it;
@@ -138,6 +152,16 @@ void from_json(const nlohmann::json & j, SimConfiguration & config)
         else if(it.key() == "perfectReceptionProbabilityForConnection"  ) config.perfectReceptionProbabilityForConnection  = *it;
         else if(it.key() == "verboseCommands"                           ) config.verboseCommands                           = *it;
         else if(it.key() == "simulateAdvertisingIndexStep"              ) config.simulateAdvertisingIndexStep              = *it;
+        else if(it.key() == "batchAdvertisingReception"                 ) config.batchAdvertisingReception                 = *it;
+        else if(it.key() == "parallelStepThreads"                       ) config.parallelStepThreads                       = *it;
+        else if(it.key() == "skipIdleSimulationSteps"                   ) config.skipIdleSimulationSteps                   = *it;
+        else if(it.key() == "preclusterNodes"                           ) config.preclusterNodes                           = *it;
+        else if(it.key() == "cloneBootedNodes"                          ) config.cloneBootedNodes                          = *it;
+        else if(it.key() == "simulateConnectionEvents"                  ) config.simulateConnectionEvents                  = *it;
+        else if(it.key() == "connectionEventLengthUs"                   ) config.connectionEventLengthUs                   = *it;
+        else if(it.key() == "connectionPhyMbps"                         ) config.connectionPhyMbps                         = *it;
+        else if(it.key() == "connectionMaxTxOctets"                     ) config.connectionMaxTxOctets                     = *it;
+        else if(it.key() == "connectionMaxPacketsPerEvent"              ) config.connectionMaxPacketsPerEvent              = *it;
         else if(it.key() == "disableNonCriticalExceptions"              ) config.disableNonCriticalExceptions              = *it;
         else if(it.key() == "webServerPort"                             ) config.webServerPort                             = *it;
         else if(it.key() == "socketServerPort"                          ) config.socketServerPort                          = *it;
@@ -156,8 +180,7 @@ void NodeEntry::Initialize(u32 nodeIndex)
     // Initialize UICR memory
     CheckedMemset(&uicr, 0xFF, sizeof(uicr));
 
-    // Initialize flash memory
-    CheckedMemset(&flash, 0xFF, sizeof(flash));
+    // Flash memory is already erased by the SimFlash constructor
     // TODO: We could load a softdevice and app image into flash, would that help for something?
 
     // Generate device address based on the id works for up to 65535 adresses
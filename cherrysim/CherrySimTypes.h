@@ -34,9 +34,13 @@
 #include <map>
 #include <array>
 #include <string>
+#include <functional>
+#include <vector>
 #include "MersenneTwister.h"
 #include "json.hpp"
 #include "MoveAnimation.h"
+#include "SimFlash.h"
+#include "SimRingQueue.h"
 
 extern "C" {
 #include <ble_hci.h>
@@ -51,16 +55,19 @@ extern CherrySim* cherrySimInstance;
 constexpr int SIM_EVT_QUEUE_SIZE = 50;
 constexpr int SIM_MAX_CONNECTION_NUM = 10; //Maximum total num of connections supported by the simulator
 
-constexpr int SIM_NUM_RELIABLE_BUFFERS   = 1;
-constexpr int SIM_NUM_UNRELIABLE_BUFFERS = 7;
+constexpr u32 SIM_NUM_RELIABLE_BUFFERS   = 1;
+constexpr u32 SIM_NUM_UNRELIABLE_BUFFERS = 7;
 
 constexpr int SIM_NUM_SERVICES = 6;
 constexpr int SIM_NUM_CHARS    = 5;
 
 constexpr int PACKET_STAT_SIZE = 10*1024;
 
-#define PSRNG(prob) (cherrySimInstance->simState.rnd.NextPsrng((prob)))
-#define PSRNGINT(min, max) ((u32)cherrySimInstance->simState.rnd.NextU32(min, max)) //Generates random int from min (inclusive) up to max (inclusive)
+//Nodes that are further apart than this on any axis can never receive each other
+constexpr float SIM_MAX_RADIO_RANGE_METERS = 50.0f;
+
+#define PSRNG(prob) (cherrySimInstance->GetRnd().NextPsrng((prob)))
+#define PSRNGINT(min, max) ((u32)cherrySimInstance->GetRnd().NextU32(min, max)) //Generates random int from min (inclusive) up to max (inclusive)
 
 //A BLE Event that is sent by the Simulator is wrapped
 struct simBleEvent {
@@ -97,6 +104,47 @@ struct SoftDeviceBufferedPacket {
 
 };
 
+//The packet buffers of a connection in the SoftDevice. Packets are sent in the order in which they were queued,
+//so the buffers are kept as a ring and the next packet to send is always at the front. The packets stay in their
+//slot while they are queued, as the params of a packet point into its own data.
+template<u32 N>
+struct SoftDevicePacketFifo {
+    SoftDeviceBufferedPacket packets[N] = {};
+    u32 head = 0;
+    u32 count = 0;
+
+    bool IsFull() const { return count == N; }
+    bool IsEmpty() const { return count == 0; }
+    u32 GetCount() const { return count; }
+
+    //Returns nullptr if the fifo is empty
+    SoftDeviceBufferedPacket* Front() { return count == 0 ? nullptr : &packets[head]; }
+
+    //Returns the slot for the next packet that must be filled by the caller or nullptr if all buffers are in use
+    SoftDeviceBufferedPacket* Push()
+    {
+        if (count == N) return nullptr;
+        SoftDeviceBufferedPacket* packet = &packets[(head + count) % N];
+        count++;
+        return packet;
+    }
+
+    void PopFront()
+    {
+        if (count == 0) return;
+        packets[head].sender = nullptr;
+        head = (head + 1) % N;
+        count--;
+    }
+
+    void Clear()
+    {
+        for (u32 i = 0; i < N; i++) packets[i] = {};
+        head = 0;
+        count = 0;
+    }
+};
+
 #pragma pack(push, 1)
 struct PacketStat {
     MessageType messageType = MessageType::INVALID;
@@ -129,8 +177,13 @@ struct SoftdeviceConnection {
     u32 connectionSetupTimeMs = 0;
     u32 lastConnectionTimestampMs = 0;
 
-    SoftDeviceBufferedPacket reliableBuffers[SIM_NUM_RELIABLE_BUFFERS] = {};
-    SoftDeviceBufferedPacket unreliableBuffers[SIM_NUM_UNRELIABLE_BUFFERS] = {};
+    SoftDevicePacketFifo<SIM_NUM_RELIABLE_BUFFERS> reliableBuffers;
+    SoftDevicePacketFifo<SIM_NUM_UNRELIABLE_BUFFERS> unreliableBuffers;
+
+    //Connection event simulation, only used if SimConfiguration::simulateConnectionEvents is set
+    u16 maxTxOctets = 0; //Maximum link layer payload, either the default or the negotiated data length
+    u16 currentPacketFragmentsSent = 0; //Number of link layer fragments of the next packet that were already acknowledged
+    uint64_t nextConnectionEventTimeUs = 0; //In the time of the owning node
 
     //Clustering validity
     i16 validityClusterSizeToSend;
@@ -139,6 +192,9 @@ struct SoftdeviceConnection {
     bool connParamUpdateRequestPending = false;
     u32 connParamUpdateRequestTimeoutDs = 0;
     FruityHal::BleGapConnParams connParamUpdateRequestParameters = {};
+    // Connection Parameter Update (only used when isCentral == false), set from the request until the central answered
+    // or the request timed out so that the peripheral never has to look at the central during parallel stepping
+    bool connParamUpdateRequestSent = false;
 };
 
 struct CharacteristicDB_t
@@ -262,9 +318,9 @@ struct NodeEntry {
     NRF_UICR_Type uicr;
     NRF_GPIO_Type gpio;
     NRF_RADIO_Type radio;
-    u8 flash[SIM_MAX_FLASH_SIZE];
+    SimFlash flash{ SIM_MAX_FLASH_SIZE };
     SoftdeviceState state;
-    std::deque<simBleEvent> eventQueue;
+    SimRingQueue<simBleEvent> eventQueue; //Keeps its memory over reboots, so that delivering events does not allocate
     simBleEvent currentEvent; //The event currently being processed, as a simBleEvent, this can have some additional data attached to it useful for debugging
     bool led1On = false;
     bool led2On = false;
@@ -309,6 +365,12 @@ struct NodeEntry {
 
     MoveAnimation animation;
 
+    //Parallel stepping
+    MersenneTwister rnd; //Random numbers drawn by the firmware while nodes are stepped in parallel
+    std::vector<std::function<void(void)>> stagedOperations; //Executed in node order at the end of the parallel phase
+    u32 parallelEventIdCount = 0;
+    u32 parallelPacketIdCount = 0;
+
     // Timeslot simulation
     nrf_radio_signal_callback_t timeslotRadioSignalCallback = nullptr;
     bool timeslotCloseSessionRequested = false;
@@ -410,6 +472,8 @@ struct SimConfiguration {
     std::string devicesJsonPath                    = "";
     std::string replayPath                         = ""; //If set, a replay is loaded from this path.
     bool        logReplayCommands                  = false; //If set, lines are logged out that can be used as input for the replay feature.
+    std::string replayJournalPath                  = ""; //If set, all inputs are written into a binary replay journal at this path that can be used as replayPath.
+    std::string pcapPath                           = ""; //If set, all received advertisements and connection packets are written into a pcapng capture at this path.
     bool        useLogAccumulator                  = false; //If set, all logs are written to CherrySim::logAccumulator
     u32         defaultNetworkId                   = 0;
     bool        ignoreDeviceJsonEnrollments        = false; //Set to true to not use the enrollment info from the devices json
@@ -420,7 +484,7 @@ struct SimConfiguration {
     bool        verbose                            = false;
     uint32_t    fastLaneToSimTimeMs                = 0; //Set to a value bigger than 0 to speed up the simulation until this simulation time was reached (disables terminal in the meantime)
 
-    bool        enableClusteringValidityCheck      = false; //Enable automatic checking of the clustering after each step
+    bool        enableClusteringValidityCheck      = false; //Enable automatic checking of the clustering after each step that changed it
     bool        enableSimStatistics                = false;
     std::string storeFlashToFile                   = "";
 
@@ -449,6 +513,46 @@ struct SimConfiguration {
     /// advertisement delivery, i.e. three means that a third of all nodes will be considered.
     uint32_t simulateAdvertisingIndexStep = 1;
 
+    /// If enabled, the rssi of all receivers of an advertisement is computed at once with vectorized noise
+    /// generation, and the reported rssi is the one that decided about the reception. Gives the same results
+    /// for a seed on every run, but different results than computing the receivers one by one.
+    bool batchAdvertisingReception = false;
+
+    /// Number of threads used to simulate the firmware of the nodes. With 0 or 1, all nodes are simulated
+    /// sequentially on the calling thread. Bigger values enable the parallel stepping which gives the same
+    /// results for a seed regardless of the thread count, but different results than sequential stepping.
+    uint32_t parallelStepThreads = 0;
+
+    /// If enabled, simulation steps in which no node has anything to do are skipped. Nodes are only considered
+    /// idle if they have no connections, no queued events and no other pending work, in which case the next
+    /// step that matters is the next main timer tick or advertising interval. Gives the same results for a
+    /// seed on every run, but different results than simulating every step.
+    bool skipIdleSimulationSteps = false;
+
+    /// If enabled, the nodes are connected along a generated spanning tree right after booting instead of
+    /// clustering through discovery (see CherrySim::PreclusterNodes). Useful for scenarios that are only
+    /// interested in the behaviour of an already clustered mesh.
+    bool preclusterNodes = false;
+
+    /// If enabled, only the first of all nodes that only differ in their identity (node id, serial number, node key and
+    /// network) is booted and the others get a copy of its booted firmware state and flash with their identity patched
+    /// into it (see CherrySim::BootAllNodes). Speeds up the start of big scenarios but the cloned nodes print no boot log.
+    bool cloneBootedNodes = false;
+
+    /// If enabled, every connection event of a connection is simulated at the actual connection interval instead
+    /// of sending a random amount of packets once per interval. Each event may use its share of the radio time, up to
+    /// the event length, for link layer packets whose airtime depends on the PHY and the negotiated data length.
+    /// Packets are retransmitted if the partner fails to receive them. Gives more realistic throughput and latency.
+    bool simulateConnectionEvents = false;
+    /// The maximum length of a connection event in microseconds, the SoftDevice is configured with 5 ms.
+    uint32_t connectionEventLengthUs = 5000;
+    /// The PHY used by connections in MBit/s, either 1 or 2.
+    uint32_t connectionPhyMbps = 1;
+    /// The maximum link layer payload in bytes that connections use after a data length update (27 - 251).
+    uint32_t connectionMaxTxOctets = 251;
+    /// The maximum number of packets that are sent in one connection event, 0 for no limit other than the event length.
+    uint32_t connectionMaxPacketsPerEvent = 0;
+
     void SetToPerfectConditions();
 };
 
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "ClusteringTracker.h"
+
+bool NodeClusteringState::operator==(const NodeClusteringState& other) const
+{
+    return clusterId == other.clusterId
+        && clusterSize == other.clusterSize
+        && networkId == other.networkId;
+}
+
+bool NodeClusteringState::operator!=(const NodeClusteringState& other) const
+{
+    return !(*this == other);
+}
+
+void ClusteringTracker::Reset(u32 nodeCount)
+{
+    //All nodes start with the same placeholder state until they are updated
+    stateOfNode.assign(nodeCount, NodeClusteringState());
+    nodesOfClusterId.clear();
+    nodesOfClusterAndNetworkId.clear();
+    nodesOfNetworkId.clear();
+    numNodesWithFullClusterSize = 0;
+    for (const NodeClusteringState& state : stateOfNode)
+    {
+        Add(state);
+    }
+}
+
+u32 ClusteringTracker::GetNodeCount() const
+{
+    return static_cast<u32>(stateOfNode.size());
+}
+
+bool ClusteringTracker::Update(u32 nodeIndex, const NodeClusteringState& state)
+{
+    NodeClusteringState& storedState = stateOfNode[nodeIndex];
+    if (storedState == state) return false;
+
+    Remove(storedState);
+    storedState = state;
+    Add(storedState);
+    return true;
+}
+
+bool ClusteringTracker::IsClusteringDone() const
+{
+    return nodesOfClusterId.size() == 1 && numNodesWithFullClusterSize == GetNodeCount();
+}
+
+u32 ClusteringTracker::GetNumClusters() const
+{
+    return static_cast<u32>(nodesOfClusterAndNetworkId.size());
+}
+
+u32 ClusteringTracker::GetNumNetworkIds() const
+{
+    return static_cast<u32>(nodesOfNetworkId.size());
+}
+
+uint64_t ClusteringTracker::GetClusterAndNetworkKey(const NodeClusteringState& state)
+{
+    return (static_cast<uint64_t>(state.clusterId) << 16) | state.networkId;
+}
+
+void ClusteringTracker::Add(const NodeClusteringState& state)
+{
+    nodesOfClusterId[state.clusterId]++;
+    nodesOfClusterAndNetworkId[GetClusterAndNetworkKey(state)]++;
+    nodesOfNetworkId[state.networkId]++;
+    if (state.clusterSize >= 0 && static_cast<u32>(state.clusterSize) == GetNodeCount()) numNodesWithFullClusterSize++;
+}
+
+void ClusteringTracker::Remove(const NodeClusteringState& state)
+{
+    //Counters that drop to zero are erased so that the size of the maps is the amount of distinct values
+    const auto decrement = [](auto& map, const auto& key) {
+        auto it = map.find(key);
+        if (--it->second == 0) map.erase(it);
+    };
+    decrement(nodesOfClusterId, state.clusterId);
+    decrement(nodesOfClusterAndNetworkId, GetClusterAndNetworkKey(state));
+    decrement(nodesOfNetworkId, state.networkId);
+    if (state.clusterSize >= 0 && static_cast<u32>(state.clusterSize) == GetNodeCount()) numNodesWithFullClusterSize--;
+}
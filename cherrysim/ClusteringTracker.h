@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "FmTypes.h"
+
+//The part of the state of a node that decides to which cluster it belongs
+struct NodeClusteringState
+{
+    ClusterId clusterId = 0;
+    ClusterSize clusterSize = 0;
+    NetworkId networkId = 0;
+
+    bool operator==(const NodeClusteringState& other) const;
+    bool operator!=(const NodeClusteringState& other) const;
+};
+
+//
+// Keeps track of the clustering of all nodes so that the simulator can tell if the clustering is done without
+// visiting all nodes. It counts the nodes of every clusterId, every pair of clusterId and networkId and every
+// networkId as well as the nodes that report a cluster size of all nodes. The counters are adjusted whenever the
+// state of a node is updated, which only costs a few hash map operations if the state of the node changed.
+//
+class ClusteringTracker
+{
+TESTER_PUBLIC:
+    std::vector<NodeClusteringState> stateOfNode;
+    std::unordered_map<ClusterId, u32> nodesOfClusterId;
+    std::unordered_map<uint64_t, u32> nodesOfClusterAndNetworkId;
+    std::unordered_map<NetworkId, u32> nodesOfNetworkId;
+    u32 numNodesWithFullClusterSize = 0;
+
+    static uint64_t GetClusterAndNetworkKey(const NodeClusteringState& state);
+    void Add(const NodeClusteringState& state);
+    void Remove(const NodeClusteringState& state);
+
+public:
+    /// Prepares the tracker for the given amount of nodes, which must then all be updated once.
+    void Reset(u32 nodeCount);
+
+    /// Returns the amount of nodes that the tracker was prepared for.
+    u32 GetNodeCount() const;
+
+    /// Stores the current state of the node. Returns true if it differs from the previous one.
+    bool Update(u32 nodeIndex, const NodeClusteringState& state);
+
+    /// Returns true if all nodes share a single clusterId and report a cluster size of all nodes.
+    bool IsClusteringDone() const;
+
+    /// Returns the amount of distinct pairs of clusterId and networkId.
+    u32 GetNumClusters() const;
+
+    /// Returns the amount of distinct networkIds.
+    u32 GetNumNetworkIds() const;
+};
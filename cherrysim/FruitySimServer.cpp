@@ -133,8 +133,9 @@ int FruitySimServer::StartServer(uint16_t port)
         return -1;
     }
 
-    void(*OnReq)(evhttp_request *req, void *) = [](evhttp_request *req, void *)
+    void(*OnReq)(evhttp_request *req, void *) = [](evhttp_request *req, void *arg)
     {
+        FruitySimServer* webserver = static_cast<FruitySimServer*>(arg);
         FILE* file = nullptr;
     
         auto *OutBuf = evhttp_request_get_output_buffer(req);
@@ -154,12 +155,11 @@ int FruitySimServer::StartServer(uint16_t port)
             responseBodyLength = 0;
         }
 
-        //GET /devices
+        //GET /devices or GET /devices?since=<version> to only receive the devices that changed after this version
         if (strstr(req->uri, "/devices") != nullptr && req->type == EVHTTP_REQ_GET)
         {
-            std::string devices = GenerateDevicesJson();
-    
-            evbuffer_add_printf(OutBuf, "%s", devices.c_str());
+            const char* since = strstr(req->uri, "since=");
+            webserver->WriteDevicesJson(OutBuf, since != nullptr ? strtoul(since + strlen("since="), nullptr, 10) : 0);
             evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/json");
         }
         //POST /devices
@@ -260,7 +260,7 @@ int FruitySimServer::StartServer(uint16_t port)
         evhttp_send_reply(req, HTTP_OK, "OK", OutBuf);
     };
     
-    evhttp_set_gencb(server->get(), OnReq, nullptr);
+    evhttp_set_gencb(server->get(), OnReq, this);
 #endif // SIM_SERVER_PRESENT
     return 0;
 }
@@ -278,6 +278,10 @@ FruitySimServer::~FruitySimServer()
 //to view the current state of the simulation while it is halted at a breakpoint
 void FruitySimServer::ProcessServerRequests()
 {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastRequestProcessing < MIN_REQUEST_PROCESSING_INTERVAL) return;
+    lastRequestProcessing = now;
+
     MersenneTwisterDisabler disabler;
 #if defined(SIM_SERVER_PRESENT)
     event_base_loop(eventBase, EVLOOP_NONBLOCK);
@@ -300,119 +304,197 @@ std::string FruitySimServer::GenerateSiteJson()
 }
 #endif // SIM_SERVER_PRESENT
 
+bool FruitySimServer::DeviceSnapshot::operator==(const DeviceSnapshot& other) const
+{
+    return x == other.x
+        && y == other.y
+        && ledOn == other.ledOn
+        && advertisingActive == other.advertisingActive
+        && advertisingData == other.advertisingData
+        && clusterId == other.clusterId
+        && clusterSize == other.clusterSize
+        && nodeId == other.nodeId
+        && connectionLossCounter == other.connectionLossCounter
+        && freeIn == other.freeIn
+        && freeOut == other.freeOut
+        && inConnectionPartner == other.inConnectionPartner
+        && inConnectionHasMasterBit == other.inConnectionHasMasterBit
+        && inConnectionPartnerHasMasterBit == other.inConnectionPartnerHasMasterBit
+        && hasInConnectionRssi == other.hasInConnectionRssi
+        && inConnectionRssi == other.inConnectionRssi
+        && connections == other.connections;
+}
+
 #if defined(SIM_SERVER_PRESENT)
-std::string FruitySimServer::GenerateDevicesJson()
+FruitySimServer::DeviceSnapshot FruitySimServer::TakeDeviceSnapshot(NodeEntry* node)
 {
-    MersenneTwisterDisabler disabler;
-    json devices;
-    devices["status"] = "success";
-    for (unsigned int i = 0; i < cherrySimInstance->GetTotalNodes(); i++) {
-        NodeIndexSetter nodeIndexSetter(i);
-        NodeEntry* node = &cherrySimInstance->nodes[i];
-        json device;
-
-        //Get the only handshaked inConnection
-        //TODO: The inConnection is only used to draw the direction arrow in the fruitymap, but currently
-        //the json only supports communicating 1 inConnection, this should be changed at some point so that
-        //Each connection can report its direction and masterBit
-        auto inConnections = node->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_IN);
-        MeshConnection* inConnection = nullptr;
-        for (int k = 0; k < inConnections.count; k++) {
-            if (inConnections.handles[k] && inConnections.handles[k].IsHandshakeDone()) {
-                inConnection = inConnections.handles[k].GetConnection();
-            }
+    DeviceSnapshot snapshot;
+    snapshot.x = node->x;
+    snapshot.y = node->y;
+    snapshot.ledOn = node->led1On || node->led2On || node->led3On;
+    snapshot.advertisingActive = node->state.advertisingActive;
+    if (node->state.advertisingActive) {
+        snapshot.advertisingData.assign((const char*)node->state.advertisingData, node->state.advertisingDataLength);
+    }
+    snapshot.clusterId = node->gs.node.clusterId;
+    snapshot.clusterSize = node->gs.node.GetClusterSize();
+    snapshot.nodeId = node->gs.node.configuration.nodeId;
+    snapshot.connectionLossCounter = node->gs.node.connectionLossCounter;
+    snapshot.freeIn = node->gs.cm.freeMeshInConnections;
+    snapshot.freeOut = node->gs.cm.freeMeshOutConnections;
+
+    //Get the only handshaked inConnection
+    //TODO: The inConnection is only used to draw the direction arrow in the fruitymap, but currently
+    //the json only supports communicating 1 inConnection, this should be changed at some point so that
+    //Each connection can report its direction and masterBit
+    auto inConnections = node->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_IN);
+    MeshConnection* inConnection = nullptr;
+    for (int k = 0; k < inConnections.count; k++) {
+        if (inConnections.handles[k] && inConnections.handles[k].IsHandshakeDone()) {
+            inConnection = inConnections.handles[k].GetConnection();
         }
+    }
 
-        //UUID is generated based on the node index
-        char uuid[50];
-        sprintf(uuid, "00000000-1111-2222-3333-00000000%04u", node->index);
-
-        device["uuid"] = uuid;
-        device["deviceId"] = node->gs.config.GetSerialNumber();
-        device["platform"] = "BLENODE";
-        device["ledOn"] = node->led1On || node->led2On || node->led3On;
-        device["inConnectionHasMasterBit"] = false;
-        device["inConnectionPartnerHasMasterBit"] = false;
-
+    if (inConnection != nullptr) {
         //Find out who has the master bit of the inConnection
-        if(inConnection != nullptr) device["inConnectionHasMasterBit"] = inConnection->connectionMasterBit == 1;
-
-        bool partnerHasMB = false;
-
-        if (inConnection != nullptr) {
-            SoftdeviceConnection* foundSoftdeviceConnection = cherrySimInstance->FindConnectionByHandle(node, inConnection->connectionHandle);
-            //We must check if the simulator connection still exists as it might have been cleaned up already
-            if (foundSoftdeviceConnection != nullptr) {
-                NodeEntry* partnerNode = foundSoftdeviceConnection->partner;
-                MeshConnections conn = partnerNode->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_OUT);
-                for (int k = 0; k < conn.count; k++) {
-                    if (conn.handles[k] && conn.handles[k].GetConnectionHandle() == inConnection->connectionHandle) {
-                        partnerHasMB = conn.handles[k].GetConnection()->connectionMasterBit;
-                    }
+        snapshot.inConnectionHasMasterBit = inConnection->connectionMasterBit == 1;
+        snapshot.inConnectionPartner = inConnection->partnerId;
+
+        //We must check if the simulator connection still exists as it might have been cleaned up already
+        //FIXME: This mixes fruitymesh and simulator connections, but should only use simulator data
+        SoftdeviceConnection* foundSoftdeviceConnection = cherrySimInstance->FindConnectionByHandle(node, inConnection->connectionHandle);
+        if (foundSoftdeviceConnection != nullptr) {
+            NodeEntry* partnerNode = foundSoftdeviceConnection->partner;
+            MeshConnections conn = partnerNode->gs.cm.GetMeshConnections(ConnectionDirection::DIRECTION_OUT);
+            for (int k = 0; k < conn.count; k++) {
+                if (conn.handles[k] && conn.handles[k].GetConnectionHandle() == inConnection->connectionHandle) {
+                    snapshot.inConnectionPartnerHasMasterBit = conn.handles[k].GetConnection()->connectionMasterBit;
                 }
             }
+
+            snapshot.hasInConnectionRssi = true;
+            snapshot.inConnectionRssi = (int)cherrySimInstance->GetReceptionRssiNoNoise(node, partnerNode);
         }
+    }
+    else {
+        snapshot.hasInConnectionRssi = true;
+        snapshot.inConnectionRssi = 0;
+    }
 
-        device["inConnectionPartnerHasMasterBit"] = partnerHasMB;
+    for (int j = 0; j < node->state.configuredTotalConnectionCount; j++) {
+        if (node->state.connections[j].connectionActive) {
+            snapshot.connections.push_back({ node->state.connections[j].connectionHandle, node->state.connections[j].partner->gs.node.configuration.nodeId });
+        }
+    }
 
-        device["connectionLossCounter"] = node->gs.node.connectionLossCounter;
-        device["inConnectionPartner"] = inConnection == nullptr ? 0 : inConnection->partnerId;
+    return snapshot;
+}
+#endif // SIM_SERVER_PRESENT
 
+#if defined(SIM_SERVER_PRESENT)
+std::string FruitySimServer::GenerateDeviceJson(NodeEntry* node, const DeviceSnapshot& snapshot)
+{
+    json device;
+
+    //UUID is generated based on the node index
+    char uuid[50];
+    sprintf(uuid, "00000000-1111-2222-3333-00000000%04u", node->index);
+
+    device["uuid"] = uuid;
+    device["deviceId"] = node->gs.config.GetSerialNumber();
+    device["platform"] = "BLENODE";
+    device["ledOn"] = snapshot.ledOn;
+    device["inConnectionHasMasterBit"] = snapshot.inConnectionHasMasterBit;
+    device["inConnectionPartnerHasMasterBit"] = snapshot.inConnectionPartnerHasMasterBit;
+    device["connectionLossCounter"] = snapshot.connectionLossCounter;
+    device["inConnectionPartner"] = snapshot.inConnectionPartner;
+    if (snapshot.hasInConnectionRssi) device["inConnectionRssi"] = snapshot.inConnectionRssi;
+
+    char advData[200];
+    if (snapshot.advertisingActive) {
+        Logger::ConvertBufferToHexString((const u8*)snapshot.advertisingData.data(), snapshot.advertisingData.size(), advData, sizeof(advData));
+    }
+    else {
+        sprintf(advData, "Not advertising");
+    }
 
-        //FIXME: This mixes fruitymesh and simulator connections, but should only use simulator data
-        if (inConnection != nullptr) {
-            SoftdeviceConnection* sdInConn = cherrySimInstance->FindConnectionByHandle(node, inConnection->connectionHandle);
-            if (sdInConn != nullptr) device["inConnectionRssi"] = (int)cherrySimInstance->GetReceptionRssiNoNoise(node, sdInConn->partner);
-        }
-        else {
-            device["inConnectionRssi"] = 0;
-        }
+    //Collect a bit more data about the node
+    char info[200];
+    sprintf(info, "%s,\nFeatureset: %s", advData, node->nodeConfiguration.c_str());
+
+    device["lastSentMessageTimestampMs"] = 0;
+    device["lastSentAdvertisingMessage"] = info;
+
+    device["details"] = {
+        {"platform", "BLENODE"},
+        {"clusterId", snapshot.clusterId},
+        {"clusterSize", snapshot.clusterSize},
+        {"nodeId", snapshot.nodeId},
+        {"serialNumber", node->gs.config.GetSerialNumber()},
+        {"connections", json::array()},
+        {"nonConnections", json::array()},
+        {"freeIn", snapshot.freeIn},
+        {"freeOut", snapshot.freeOut}
+    };
+    for (const auto& entry : snapshot.connections) {
+        json connection;
+        connection["handle"] = entry.first;
+        connection["rssi"] = 7;
+        connection["target"] = entry.second;
 
+        device["details"]["connections"].push_back(connection);
+    }
+    device["properties"] = {
+        {"onMap", "true"},
+        {"x", snapshot.x},
+        {"y", snapshot.y}
+    };
 
-        char advData[200];
-        if (node->state.advertisingActive) {
-            Logger::ConvertBufferToHexString(node->state.advertisingData, node->state.advertisingDataLength, advData, sizeof(advData));
-        }
-        else {
-            sprintf(advData, "Not advertising");
-        }
+    return device.dump();
+}
+#endif // SIM_SERVER_PRESENT
 
-        //Collect a bit more data about the node
-        char info[200];
-        sprintf(info, "%s,\nFeatureset: %s", advData, node->nodeConfiguration.c_str());
-
-        device["lastSentMessageTimestampMs"] = 0;
-        device["lastSentAdvertisingMessage"] = info;
-
-        device["details"] = {
-            {"platform", "BLENODE"},
-            {"clusterId", node->gs.node.clusterId},
-            {"clusterSize", node->gs.node.GetClusterSize()},
-            {"nodeId", node->gs.node.configuration.nodeId},
-            {"serialNumber", node->gs.config.GetSerialNumber()},
-            {"connections", json::array()},
-            {"nonConnections", json::array()},
-            {"freeIn", node->gs.cm.freeMeshInConnections},
-            {"freeOut", node->gs.cm.freeMeshOutConnections}
-        };
-        for (int j = 0; j < node->state.configuredTotalConnectionCount; j++) {
-            if (node->state.connections[j].connectionActive) {
-                json connection;
-                connection["handle"] = node->state.connections[j].connectionHandle;
-                connection["rssi"] = 7;
-                connection["target"] = node->state.connections[j].partner->gs.node.configuration.nodeId;
-
-                device["details"]["connections"].push_back(connection);
-            }
+#if defined(SIM_SERVER_PRESENT)
+void FruitySimServer::UpdateCachedDevices()
+{
+    MersenneTwisterDisabler disabler;
+    const u32 totalNodes = cherrySimInstance->GetTotalNodes();
+    if (cachedDevices.size() != totalNodes) cachedDevices.assign(totalNodes, CachedDevice());
+
+    for (u32 i = 0; i < totalNodes; i++) {
+        NodeIndexSetter nodeIndexSetter(i);
+        NodeEntry* node = &cherrySimInstance->nodes[i];
+        CachedDevice& device = cachedDevices[i];
+
+        DeviceSnapshot snapshot = TakeDeviceSnapshot(node);
+        if (device.json.empty() || !(snapshot == device.snapshot)) {
+            device.json = GenerateDeviceJson(node, snapshot);
+            device.snapshot = std::move(snapshot);
+            devicesVersion++;
+            device.version = devicesVersion;
         }
-        device["properties"] = {
-            {"onMap", "true"},
-            {"x", node->x},
-            {"y", node->y}
-        };
-        devices["result"].push_back(device);
     }
+}
+#endif // SIM_SERVER_PRESENT
 
-    return devices.dump(4);
+#if defined(SIM_SERVER_PRESENT)
+void FruitySimServer::WriteDevicesJson(evbuffer* out, uint32_t sinceVersion)
+{
+    UpdateCachedDevices();
+
+    //A client that knows a newer version than the server (e.g. because the simulation was restarted) gets all devices
+    if (sinceVersion > devicesVersion) sinceVersion = 0;
+
+    //The document is added to the output device by device instead of being assembled in a single string first
+    const std::string header = "{\"status\":\"success\",\"version\":" + std::to_string(devicesVersion) + ",\"result\":[";
+    evbuffer_add(out, header.data(), header.size());
+    bool firstDevice = true;
+    for (const CachedDevice& device : cachedDevices) {
+        if (device.version <= sinceVersion) continue;
+        if (!firstDevice) evbuffer_add(out, ",", 1);
+        evbuffer_add(out, device.json.data(), device.json.size());
+        firstDevice = false;
+    }
+    evbuffer_add(out, "]}", 2);
 }
 #endif // SIM_SERVER_PRESENT
@@ -29,21 +29,72 @@
 ////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include <FmTypes.h>
+
+struct NodeEntry;
+struct evbuffer;
 
 class FruitySimServer
 {
 public:
+    //Requests are processed at most this often so that a polling browser does not slow down the simulation
+    static constexpr std::chrono::milliseconds MIN_REQUEST_PROCESSING_INTERVAL{ 50 };
+
     explicit FruitySimServer(uint16_t port);
     ~FruitySimServer();
 
     //Call periodically so that the server can process requests
     void ProcessServerRequests();
 
+TESTER_PUBLIC:
+    //Everything that the json of a device is generated from, except for values that never change
+    struct DeviceSnapshot
+    {
+        float x = 0;
+        float y = 0;
+        bool ledOn = false;
+        bool advertisingActive = false;
+        std::string advertisingData;
+        uint32_t clusterId = 0;
+        int16_t clusterSize = 0;
+        uint16_t nodeId = 0;
+        uint16_t connectionLossCounter = 0;
+        uint8_t freeIn = 0;
+        uint8_t freeOut = 0;
+        uint16_t inConnectionPartner = 0;
+        bool inConnectionHasMasterBit = false;
+        bool inConnectionPartnerHasMasterBit = false;
+        bool hasInConnectionRssi = false;
+        int inConnectionRssi = 0;
+        std::vector<std::pair<uint16_t, uint16_t>> connections; //Handle and nodeId of the partner
+
+        bool operator==(const DeviceSnapshot& other) const;
+    };
+
+    //The json of a device is only generated again if its snapshot changed, which increases its version
+    struct CachedDevice
+    {
+        DeviceSnapshot snapshot;
+        uint32_t version = 0;
+        std::string json;
+    };
+
+    std::vector<CachedDevice> cachedDevices;
+    uint32_t devicesVersion = 0;
+
+    static DeviceSnapshot TakeDeviceSnapshot(NodeEntry* node);
+    static std::string GenerateDeviceJson(NodeEntry* node, const DeviceSnapshot& snapshot);
+    void UpdateCachedDevices();
+    void WriteDevicesJson(evbuffer* out, uint32_t sinceVersion);
+
 private:
+    std::chrono::steady_clock::time_point lastRequestProcessing;
+
     int StartServer(uint16_t port);
 
-    static std::string GenerateDevicesJson();
     static std::string GenerateSiteJson();
 };
-
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "LinkBudgetCache.h"
+
+bool LinkBudgetModelInputs::operator==(const LinkBudgetModelInputs& other) const
+{
+    return propagationConstant == other.propagationConstant
+        && mapWidthInMeters == other.mapWidthInMeters
+        && mapHeightInMeters == other.mapHeightInMeters
+        && mapElevationInMeters == other.mapElevationInMeters
+        && ceilingAttenuationDb == other.ceilingAttenuationDb;
+}
+
+bool LinkBudgetNodeInputs::operator==(const LinkBudgetNodeInputs& other) const
+{
+    return x == other.x
+        && y == other.y
+        && z == other.z
+        && floorNumber == other.floorNumber
+        && numImpossibleConnections == other.numImpossibleConnections;
+}
+
+void LinkBudgetCache::Reset(u32 nodeCount, const LinkBudgetModelInputs& modelInputs)
+{
+    tableOfSender.assign(nodeCount, std::vector<Entry>());
+    numUsedSlotsOfSender.assign(nodeCount, 0);
+    versionOfNode.assign(nodeCount, 0);
+    inputsOfNode.assign(nodeCount, LinkBudgetNodeInputs());
+    this->modelInputs = modelInputs;
+}
+
+bool LinkBudgetCache::IsConfiguredFor(u32 nodeCount, const LinkBudgetModelInputs& modelInputs) const
+{
+    return GetNodeCount() == nodeCount && this->modelInputs == modelInputs;
+}
+
+u32 LinkBudgetCache::GetNodeCount() const
+{
+    return static_cast<u32>(versionOfNode.size());
+}
+
+void LinkBudgetCache::Update(u32 nodeIndex, const LinkBudgetNodeInputs& inputs)
+{
+    if (inputsOfNode[nodeIndex] == inputs) return;
+
+    inputsOfNode[nodeIndex] = inputs;
+    Invalidate(nodeIndex);
+}
+
+void LinkBudgetCache::Invalidate(u32 nodeIndex)
+{
+    versionOfNode[nodeIndex]++;
+}
+
+u32 LinkBudgetCache::GetHomeSlot(u32 receiverIndex, u32 tableSize)
+{
+    //Fibonacci hashing spreads neighbouring indices, the table size is always a power of two
+    return (receiverIndex * 0x9E3779B1u) & (tableSize - 1);
+}
+
+bool LinkBudgetCache::IsValid(const Entry& entry, u32 senderIndex) const
+{
+    return entry.senderVersion == versionOfNode[senderIndex] && entry.receiverVersion == versionOfNode[entry.receiverIndex];
+}
+
+bool LinkBudgetCache::Get(u32 senderIndex, u32 receiverIndex, i32 senderTxPowerDbm, float& rssi) const
+{
+    const std::vector<Entry>& table = tableOfSender[senderIndex];
+    const u32 tableSize = static_cast<u32>(table.size());
+    if (tableSize == 0) return false;
+
+    for (u32 slot = GetHomeSlot(receiverIndex, tableSize); ; slot = (slot + 1) & (tableSize - 1))
+    {
+        const Entry& entry = table[slot];
+        if (entry.receiverIndex == EMPTY_SLOT) return false;
+        if (entry.receiverIndex == receiverIndex)
+        {
+            if (!IsValid(entry, senderIndex) || entry.senderTxPowerDbm != senderTxPowerDbm) return false;
+            rssi = entry.rssi;
+            return true;
+        }
+    }
+}
+
+void LinkBudgetCache::Put(u32 senderIndex, u32 receiverIndex, i32 senderTxPowerDbm, float rssi)
+{
+    //The load factor is kept at or below one half so that probing stays short and always finds an empty slot
+    if ((numUsedSlotsOfSender[senderIndex] + 1) * 2 > tableOfSender[senderIndex].size())
+    {
+        RemoveOutdatedEntriesAndGrow(senderIndex);
+    }
+
+    std::vector<Entry>& table = tableOfSender[senderIndex];
+    const u32 tableSize = static_cast<u32>(table.size());
+    u32 slot = GetHomeSlot(receiverIndex, tableSize);
+    while (table[slot].receiverIndex != EMPTY_SLOT && table[slot].receiverIndex != receiverIndex)
+    {
+        slot = (slot + 1) & (tableSize - 1);
+    }
+
+    Entry& entry = table[slot];
+    if (entry.receiverIndex == EMPTY_SLOT) numUsedSlotsOfSender[senderIndex]++;
+    entry.receiverIndex = receiverIndex;
+    entry.senderVersion = versionOfNode[senderIndex];
+    entry.receiverVersion = versionOfNode[receiverIndex];
+    entry.senderTxPowerDbm = senderTxPowerDbm;
+    entry.rssi = rssi;
+}
+
+void LinkBudgetCache::RemoveOutdatedEntriesAndGrow(u32 senderIndex)
+{
+    //Outdated entries belong to pairs where one of the nodes moved, possibly out of range, so they are dropped
+    //when rehashing. This keeps the table proportional to the number of nodes that are currently in range.
+    std::vector<Entry> validEntries;
+    for (const Entry& entry : tableOfSender[senderIndex])
+    {
+        if (entry.receiverIndex != EMPTY_SLOT && IsValid(entry, senderIndex)) validEntries.push_back(entry);
+    }
+
+    u32 tableSize = MIN_TABLE_SIZE;
+    while ((validEntries.size() + 1) * 4 > tableSize) tableSize *= 2;
+
+    std::vector<Entry>& table = tableOfSender[senderIndex];
+    table.assign(tableSize, Entry());
+    for (const Entry& entry : validEntries)
+    {
+        u32 slot = GetHomeSlot(entry.receiverIndex, tableSize);
+        while (table[slot].receiverIndex != EMPTY_SLOT) slot = (slot + 1) & (tableSize - 1);
+        table[slot] = entry;
+    }
+    numUsedSlotsOfSender[senderIndex] = static_cast<u32>(validEntries.size());
+}
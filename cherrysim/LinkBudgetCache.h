@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+
+#include "FmTypes.h"
+
+//The properties of the simulation that the deterministic part of the rssi between all nodes depends on
+struct LinkBudgetModelInputs
+{
+    float propagationConstant = 0;
+    u32 mapWidthInMeters = 0;
+    u32 mapHeightInMeters = 0;
+    u32 mapElevationInMeters = 0;
+    float ceilingAttenuationDb = 0;
+
+    bool operator==(const LinkBudgetModelInputs& other) const;
+};
+
+//The properties of a node that the deterministic part of the rssi to and from it depends on, except for its tx power
+struct LinkBudgetNodeInputs
+{
+    float x = 0;
+    float y = 0;
+    float z = 0;
+    i8 floorNumber = 0;
+    u32 numImpossibleConnections = 0;
+
+    bool operator==(const LinkBudgetNodeInputs& other) const;
+};
+
+//
+// Caches the rssi between pairs of nodes without the noise, i.e. the path loss and the attenuation of the floors.
+//
+// Each sender has a small open addressing table that is keyed by the receiver index, which is only filled for pairs
+// within radio range as the simulator does not compute the rssi of other pairs. Instead of searching the tables of
+// all partners when a node moves, every node has a version that is increased whenever its inputs change and entries
+// with an outdated version are ignored and eventually overwritten. The tx power of the sender is stored with each
+// entry as the firmware can change it at any time.
+//
+class LinkBudgetCache
+{
+TESTER_PUBLIC:
+    static constexpr u32 EMPTY_SLOT = 0xFFFFFFFF;
+    static constexpr u32 MIN_TABLE_SIZE = 8;
+
+    struct Entry
+    {
+        u32 receiverIndex = EMPTY_SLOT;
+        u32 senderVersion = 0;
+        u32 receiverVersion = 0;
+        i32 senderTxPowerDbm = 0;
+        float rssi = 0;
+    };
+
+    std::vector<std::vector<Entry>> tableOfSender;
+    std::vector<u32> numUsedSlotsOfSender;
+    std::vector<u32> versionOfNode;
+    std::vector<LinkBudgetNodeInputs> inputsOfNode;
+    LinkBudgetModelInputs modelInputs;
+
+    static u32 GetHomeSlot(u32 receiverIndex, u32 tableSize);
+    bool IsValid(const Entry& entry, u32 senderIndex) const;
+    void RemoveOutdatedEntriesAndGrow(u32 senderIndex);
+
+public:
+    /// Discards all entries and prepares the cache for the given amount of nodes and model.
+    void Reset(u32 nodeCount, const LinkBudgetModelInputs& modelInputs);
+
+    /// Returns true if the cache was last reset with exactly this amount of nodes and model.
+    bool IsConfiguredFor(u32 nodeCount, const LinkBudgetModelInputs& modelInputs) const;
+
+    /// Returns the amount of nodes that the cache was prepared for.
+    u32 GetNodeCount() const;
+
+    /// Invalidates all entries of the node if its inputs differ from the ones of the last call.
+    void Update(u32 nodeIndex, const LinkBudgetNodeInputs& inputs);
+
+    /// Invalidates all entries to and from the node.
+    void Invalidate(u32 nodeIndex);
+
+    /// Returns true and sets rssi if a valid entry for the pair with this tx power exists.
+    bool Get(u32 senderIndex, u32 receiverIndex, i32 senderTxPowerDbm, float& rssi) const;
+
+    /// Stores the rssi of the pair, replacing its previous entry.
+    void Put(u32 senderIndex, u32 receiverIndex, i32 senderTxPowerDbm, float rssi);
+};
@@ -58,3 +58,221 @@ float GenerateRssiNoise(MersenneTwister &rng, const float stddev, const float me
     // Scale to the requested standard deviation
     return mean + stddev * normal_a;
 }
+
+// The batch noise uses the Box-Muller transform like GenerateRssiNoise, but with the polynomial approximations of the
+// Cephes library for log and sin so that it can be evaluated on several receivers at once. The SSE2 and the scalar
+// implementation execute the same operations in the same order.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PATH_LOSS_MODEL_SSE2
+#define PATH_LOSS_MODEL_SSE2_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__i386__)
+// The simulator is built for 32 bit x86 where SSE2 is not enabled by default, but every CPU that runs it supports it
+#define PATH_LOSS_MODEL_SSE2
+#define PATH_LOSS_MODEL_SSE2_TARGET __attribute__((target("sse2")))
+#endif
+
+#ifdef PATH_LOSS_MODEL_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t NOISE_BATCH_LANES = 4;
+
+    constexpr float LOG_SQRT_HALF = 0.707106781186547524f;
+    constexpr float LOG_P0 = 7.0376836292E-2f;
+    constexpr float LOG_P1 = -1.1514610310E-1f;
+    constexpr float LOG_P2 = 1.1676998740E-1f;
+    constexpr float LOG_P3 = -1.2420140846E-1f;
+    constexpr float LOG_P4 = 1.4249322787E-1f;
+    constexpr float LOG_P5 = -1.6668057665E-1f;
+    constexpr float LOG_P6 = 2.0000714765E-1f;
+    constexpr float LOG_P7 = -2.4999993993E-1f;
+    constexpr float LOG_P8 = 3.3333331174E-1f;
+    constexpr float LOG_Q1 = -2.12194440e-4f;
+    constexpr float LOG_Q2 = 0.693359375f;
+
+    // Taylor series of sin, accurate to about 1e-7 on [-pi/2, pi/2]
+    constexpr float SIN_C3 = -1.6666666666666666e-1f;
+    constexpr float SIN_C5 = 8.3333333333333333e-3f;
+    constexpr float SIN_C7 = -1.9841269841269841e-4f;
+    constexpr float SIN_C9 = 2.7557319223985891e-6f;
+    constexpr float SIN_C11 = -2.5052108385441719e-8f;
+
+    constexpr float TWO_PI = 6.28318530717958647f;
+
+    // Maps the upper 24 bits of a random number to the open interval (0, 1), which is exact in float and never 0,
+    // so that the logarithm is always finite
+    float ToOpenUnitInterval(uint32_t random)
+    {
+        return (static_cast<float>(random >> 8) + 0.5f) * (1.0f / 16777216.0f);
+    }
+
+    float ApproximateLog(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 126);
+        bits = (bits & 0x007FFFFF) | 0x3F000000;
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+        // Moves the mantissa from [0.5, 1) to [sqrt(0.5) - 1, sqrt(2) - 1)
+        const bool belowSqrtHalf = mantissa < LOG_SQRT_HALF;
+        const float correction = belowSqrtHalf ? mantissa : 0.0f;
+        mantissa = mantissa - 1.0f;
+        exponent = exponent - (belowSqrtHalf ? 1.0f : 0.0f);
+        mantissa = mantissa + correction;
+
+        const float z = mantissa * mantissa;
+        float y = LOG_P0;
+        y = y * mantissa + LOG_P1;
+        y = y * mantissa + LOG_P2;
+        y = y * mantissa + LOG_P3;
+        y = y * mantissa + LOG_P4;
+        y = y * mantissa + LOG_P5;
+        y = y * mantissa + LOG_P6;
+        y = y * mantissa + LOG_P7;
+        y = y * mantissa + LOG_P8;
+        y = y * mantissa;
+        y = y * z;
+        y = y + exponent * LOG_Q1;
+        y = y - z * 0.5f;
+        float result = mantissa + y;
+        result = result + exponent * LOG_Q2;
+        return result;
+    }
+
+    // Returns sin(2 * pi * |uniform - 0.5| - pi / 2), which has the same distribution as cos(2 * pi * uniform)
+    float ApproximateBoxMullerAngle(float uniform)
+    {
+        const float x = (std::fabs(uniform - 0.5f) - 0.25f) * TWO_PI;
+        const float x2 = x * x;
+        float p = SIN_C11;
+        p = p * x2 + SIN_C9;
+        p = p * x2 + SIN_C7;
+        p = p * x2 + SIN_C5;
+        p = p * x2 + SIN_C3;
+        p = p * x2;
+        return x * p + x;
+    }
+
+    void ComputeNoisyRssiScalar(const float* rssiWithoutNoise, const float* uniformA, const float* uniformB, float stddev, float mean, float maxRssi, float* rssi)
+    {
+        for (uint32_t i = 0; i < NOISE_BATCH_LANES; i++)
+        {
+            const float radius = std::sqrt(ApproximateLog(uniformA[i]) * -2.0f);
+            const float normal = radius * ApproximateBoxMullerAngle(uniformB[i]);
+            const float noisyRssi = rssiWithoutNoise[i] + (stddev * normal + mean);
+            rssi[i] = std::min(noisyRssi, maxRssi);
+        }
+    }
+
+#ifdef PATH_LOSS_MODEL_SSE2
+    PATH_LOSS_MODEL_SSE2_TARGET
+    __m128 ApproximateLogSse2(__m128 x)
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128i bits = _mm_castps_si128(x);
+        __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+        __m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F000000)));
+
+        const __m128 belowSqrtHalf = _mm_cmplt_ps(mantissa, _mm_set1_ps(LOG_SQRT_HALF));
+        const __m128 correction = _mm_and_ps(mantissa, belowSqrtHalf);
+        mantissa = _mm_sub_ps(mantissa, one);
+        exponent = _mm_sub_ps(exponent, _mm_and_ps(one, belowSqrtHalf));
+        mantissa = _mm_add_ps(mantissa, correction);
+
+        const __m128 z = _mm_mul_ps(mantissa, mantissa);
+        __m128 y = _mm_set1_ps(LOG_P0);
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P1));
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P2));
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P3));
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P4));
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P5));
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P6));
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P7));
+        y = _mm_add_ps(_mm_mul_ps(y, mantissa), _mm_set1_ps(LOG_P8));
+        y = _mm_mul_ps(y, mantissa);
+        y = _mm_mul_ps(y, z);
+        y = _mm_add_ps(y, _mm_mul_ps(exponent, _mm_set1_ps(LOG_Q1)));
+        y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        __m128 result = _mm_add_ps(mantissa, y);
+        result = _mm_add_ps(result, _mm_mul_ps(exponent, _mm_set1_ps(LOG_Q2)));
+        return result;
+    }
+
+    PATH_LOSS_MODEL_SSE2_TARGET
+    __m128 ApproximateBoxMullerAngleSse2(__m128 uniform)
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 centered = _mm_andnot_ps(signMask, _mm_sub_ps(uniform, _mm_set1_ps(0.5f)));
+        const __m128 x = _mm_mul_ps(_mm_sub_ps(centered, _mm_set1_ps(0.25f)), _mm_set1_ps(TWO_PI));
+        const __m128 x2 = _mm_mul_ps(x, x);
+        __m128 p = _mm_set1_ps(SIN_C11);
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_C9));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_C7));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_C5));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_C3));
+        p = _mm_mul_ps(p, x2);
+        return _mm_add_ps(_mm_mul_ps(x, p), x);
+    }
+
+    PATH_LOSS_MODEL_SSE2_TARGET
+    void ComputeNoisyRssiSse2(const float* rssiWithoutNoise, const float* uniformA, const float* uniformB, float stddev, float mean, float maxRssi, float* rssi)
+    {
+        const __m128 radius = _mm_sqrt_ps(_mm_mul_ps(ApproximateLogSse2(_mm_loadu_ps(uniformA)), _mm_set1_ps(-2.0f)));
+        const __m128 normal = _mm_mul_ps(radius, ApproximateBoxMullerAngleSse2(_mm_loadu_ps(uniformB)));
+        const __m128 noise = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(stddev), normal), _mm_set1_ps(mean));
+        const __m128 noisyRssi = _mm_add_ps(_mm_loadu_ps(rssiWithoutNoise), noise);
+        _mm_storeu_ps(rssi, _mm_min_ps(noisyRssi, _mm_set1_ps(maxRssi)));
+    }
+#endif
+}
+
+void ComputeRssiWithNoiseBatch(const float* rssiWithoutNoise, uint32_t count, MersenneTwister* rng, float stddev, float mean, float maxRssi, float* rssi, bool forceScalar)
+{
+    if (rng == nullptr)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            rssi[i] = std::min(rssiWithoutNoise[i], maxRssi);
+        }
+        return;
+    }
+
+    for (uint32_t offset = 0; offset < count; offset += NOISE_BATCH_LANES)
+    {
+        // The last block is padded with values that are discarded
+        const uint32_t numLanes = std::min(count - offset, NOISE_BATCH_LANES);
+        float laneRssiWithoutNoise[NOISE_BATCH_LANES] = {};
+        float laneUniformA[NOISE_BATCH_LANES] = { 0.5f, 0.5f, 0.5f, 0.5f };
+        float laneUniformB[NOISE_BATCH_LANES] = { 0.5f, 0.5f, 0.5f, 0.5f };
+        float laneRssi[NOISE_BATCH_LANES];
+        for (uint32_t i = 0; i < numLanes; i++)
+        {
+            laneRssiWithoutNoise[i] = rssiWithoutNoise[offset + i];
+            laneUniformA[i] = ToOpenUnitInterval(rng->NextU32());
+            laneUniformB[i] = ToOpenUnitInterval(rng->NextU32());
+        }
+
+#ifdef PATH_LOSS_MODEL_SSE2
+        if (!forceScalar)
+        {
+            ComputeNoisyRssiSse2(laneRssiWithoutNoise, laneUniformA, laneUniformB, stddev, mean, maxRssi, laneRssi);
+        }
+        else
+#endif
+        {
+            ComputeNoisyRssiScalar(laneRssiWithoutNoise, laneUniformA, laneUniformB, stddev, mean, maxRssi, laneRssi);
+        }
+
+        for (uint32_t i = 0; i < numLanes; i++)
+        {
+            rssi[offset + i] = laneRssi[i];
+        }
+    }
+}
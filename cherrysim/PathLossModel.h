@@ -73,3 +73,10 @@ float ComputeRssiFromDistance(float distance, const PathLossModelParameters &par
 
 /// Generates a suitable RSSI noise sample.
 float GenerateRssiNoise(MersenneTwister &rng, float stddev, float mean);
+
+/// Computes the RSSI of count receivers of the same transmission at once, i.e. rssi[i] is the minimum of maxRssi and
+/// rssiWithoutNoise[i] plus a noise sample. No noise is added if rng is nullptr. The noise is drawn from rng in the
+/// order of the receivers (two random numbers each), so the result only depends on the state of rng. The samples are
+/// computed with approximations of log and sin that are evaluated on four receivers at once if SSE2 is available and
+/// therefore differ from the ones of GenerateRssiNoise. forceScalar is only meant for tests that compare both paths.
+void ComputeRssiWithNoiseBatch(const float* rssiWithoutNoise, uint32_t count, MersenneTwister* rng, float stddev, float mean, float maxRssi, float* rssi, bool forceScalar = false);
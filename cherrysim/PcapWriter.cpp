@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "PcapWriter.h"
+#include "Utility.h"
+
+constexpr size_t PCAP_WRITER_BUFFER_SIZE = 1024 * 1024;
+constexpr size_t PCAP_WRITER_MAX_PENDING_BUFFERS = 4;
+
+constexpr u32 PCAPNG_SECTION_HEADER_BLOCK = 0x0A0D0D0A;
+constexpr u32 PCAPNG_INTERFACE_DESCRIPTION_BLOCK = 0x00000001;
+constexpr u32 PCAPNG_ENHANCED_PACKET_BLOCK = 0x00000006;
+constexpr u32 PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr u16 PCAPNG_OPTION_END = 0;
+constexpr u16 PCAPNG_OPTION_IF_NAME = 2;
+
+constexpr u8 NORDIC_BLE_PROTOCOL_VERSION = 2;
+constexpr u8 NORDIC_BLE_EVENT_PACKET = 0x06;
+constexpr u8 NORDIC_BLE_PACKET_HEADER_LENGTH = 10;
+constexpr u8 NORDIC_BLE_FLAG_CRC_OK = 0x01;
+constexpr u8 NORDIC_BLE_FLAG_MASTER_TO_SLAVE = 0x02;
+constexpr u8 NORDIC_BLE_FLAG_PHY_2M = 0x10;
+
+static u32 GetPaddedLength(u32 length)
+{
+    return (length + 3) & ~3u;
+}
+
+PcapWriter::PcapWriter(const std::string& path)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        SIMEXCEPTIONFORCE(FileException);
+    }
+
+    currentBuffer.reserve(PCAP_WRITER_BUFFER_SIZE);
+
+    const u32 blockLength = 28;
+    AppendValue(PCAPNG_SECTION_HEADER_BLOCK);
+    AppendValue(blockLength);
+    AppendValue(PCAPNG_BYTE_ORDER_MAGIC);
+    AppendValue((u16)1); //Major version
+    AppendValue((u16)0); //Minor version
+    AppendValue((int64_t)-1); //Unknown section length
+    AppendValue(blockLength);
+
+    writerThread = std::thread(&PcapWriter::WriterLoop, this);
+}
+
+PcapWriter::~PcapWriter()
+{
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shuttingDown = true;
+    }
+    buffersPending.notify_all();
+    writerThread.join();
+}
+
+void PcapWriter::WriterLoop()
+{
+    while (true)
+    {
+        std::vector<u8> buffer;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            buffersPending.wait(lock, [this]() { return shuttingDown || !pendingBuffers.empty(); });
+            if (pendingBuffers.empty()) return;
+
+            buffer = std::move(pendingBuffers.front());
+            pendingBuffers.pop_front();
+            writing = true;
+        }
+
+        file.write((const char*)buffer.data(), buffer.size());
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            writing = false;
+            buffer.clear();
+            spareBuffers.push_back(std::move(buffer));
+        }
+        buffersWritten.notify_all();
+    }
+}
+
+void PcapWriter::HandOverCurrentBuffer(std::unique_lock<std::mutex>& lock)
+{
+    //Only wait for the disk if the writer thread falls behind
+    buffersWritten.wait(lock, [this]() { return pendingBuffers.size() < PCAP_WRITER_MAX_PENDING_BUFFERS; });
+
+    pendingBuffers.push_back(std::move(currentBuffer));
+    if (!spareBuffers.empty())
+    {
+        currentBuffer = std::move(spareBuffers.back());
+        spareBuffers.pop_back();
+    }
+    else
+    {
+        currentBuffer = std::vector<u8>();
+        currentBuffer.reserve(PCAP_WRITER_BUFFER_SIZE);
+    }
+    buffersPending.notify_one();
+}
+
+u32 PcapWriter::GetInterfaceId(u32 nodeIndex, NodeId nodeId)
+{
+    if (nodeIndex >= interfaceIds.size()) interfaceIds.resize(nodeIndex + 1, INVALID_INTERFACE_ID);
+    if (interfaceIds[nodeIndex] != INVALID_INTERFACE_ID) return interfaceIds[nodeIndex];
+
+    const std::string name = "node " + std::to_string(nodeId);
+    const u32 nameLength = (u32)name.size();
+    const u32 blockLength = 16 + 4 + GetPaddedLength(nameLength) + 4 + 4;
+    AppendValue(PCAPNG_INTERFACE_DESCRIPTION_BLOCK);
+    AppendValue(blockLength);
+    AppendValue(LINKTYPE_NORDIC_BLE);
+    AppendValue((u16)0); //Reserved
+    AppendValue((u32)0); //No snap length
+    AppendValue(PCAPNG_OPTION_IF_NAME);
+    AppendValue((u16)nameLength);
+    AppendBytes(name.data(), nameLength);
+    AppendPadding(GetPaddedLength(nameLength) - nameLength);
+    AppendValue(PCAPNG_OPTION_END);
+    AppendValue((u16)0);
+    AppendValue(blockLength);
+
+    interfaceIds[nodeIndex] = numInterfaces;
+    numInterfaces++;
+    return interfaceIds[nodeIndex];
+}
+
+void PcapWriter::AppendBytes(const void* data, u32 length)
+{
+    const u8* bytes = (const u8*)data;
+    currentBuffer.insert(currentBuffer.end(), bytes, bytes + length);
+}
+
+void PcapWriter::AppendPadding(u32 length)
+{
+    currentBuffer.resize(currentBuffer.size() + length, 0);
+}
+
+void PcapWriter::WritePacket(u32 nodeIndex, NodeId nodeId, uint64_t timestampUs, const PcapBlePacket& packet)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    const u32 interfaceId = GetInterfaceId(nodeIndex, nodeId);
+
+    //Board id, nRF Sniffer header, packet header and the packet from the access address to the crc
+    const u32 blePacketLength = 4 + packet.pduLength + 3;
+    const u32 capturedLength = 1 + 6 + NORDIC_BLE_PACKET_HEADER_LENGTH + blePacketLength;
+    const u32 blockLength = 28 + GetPaddedLength(capturedLength) + 4;
+
+    AppendValue(PCAPNG_ENHANCED_PACKET_BLOCK);
+    AppendValue(blockLength);
+    AppendValue(interfaceId);
+    AppendValue((u32)(timestampUs >> 32));
+    AppendValue((u32)timestampUs);
+    AppendValue(capturedLength);
+    AppendValue(capturedLength);
+
+    u8 flags = 0;
+    if (packet.crcOk) flags |= NORDIC_BLE_FLAG_CRC_OK;
+    if (packet.masterToSlave) flags |= NORDIC_BLE_FLAG_MASTER_TO_SLAVE;
+    if (packet.phy2Mbps) flags |= NORDIC_BLE_FLAG_PHY_2M;
+
+    AppendValue((u8)0); //Board id
+    AppendValue((u16)(NORDIC_BLE_PACKET_HEADER_LENGTH + blePacketLength));
+    AppendValue(NORDIC_BLE_PROTOCOL_VERSION);
+    AppendValue(packetCounter);
+    AppendValue(NORDIC_BLE_EVENT_PACKET);
+    AppendValue(NORDIC_BLE_PACKET_HEADER_LENGTH);
+    AppendValue(flags);
+    AppendValue(packet.channel);
+    AppendValue((u8)(-packet.rssi)); //The sniffer reports the rssi without its sign
+    AppendValue(packet.eventCounter);
+    AppendValue((u32)0); //Time since the previous packet, the timestamp of the block is used instead
+
+    AppendValue(packet.accessAddress);
+    AppendBytes(packet.pdu, packet.pduLength);
+    const u32 crc = CalculateCrc(packet.crcInit, packet.pdu, packet.pduLength);
+    AppendBytes(&crc, 3);
+
+    AppendPadding(GetPaddedLength(capturedLength) - capturedLength);
+    AppendValue(blockLength);
+
+    packetCounter++;
+
+    if (currentBuffer.size() >= PCAP_WRITER_BUFFER_SIZE) HandOverCurrentBuffer(lock);
+}
+
+void PcapWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (!currentBuffer.empty()) HandOverCurrentBuffer(lock);
+    buffersWritten.wait(lock, [this]() { return pendingBuffers.empty() && !writing; });
+    file.flush();
+}
+
+u32 PcapWriter::CalculateCrc(u32 crcInit, const u8* pdu, u32 pduLength)
+{
+    //The crc register is shifted with the least significant bit of each byte first, which is easiest
+    //to calculate with the bit order of the register and the polynomial reversed
+    u32 state = 0;
+    for (u32 i = 0; i < 24; i++)
+    {
+        if (crcInit & (1u << i)) state |= 1u << (23 - i);
+    }
+
+    for (u32 i = 0; i < pduLength; i++)
+    {
+        u8 byte = pdu[i];
+        for (u32 bit = 0; bit < 8; bit++)
+        {
+            const bool feedback = ((state ^ byte) & 1) != 0;
+            byte >>= 1;
+            state >>= 1;
+            if (feedback) state ^= 0xDA6000; //Reversed polynomial x^24 + x^10 + x^9 + x^6 + x^4 + x^3 + x + 1
+        }
+    }
+    return state;
+}
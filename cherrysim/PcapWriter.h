@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "FmTypes.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A link layer packet as it was received by a simulated node
+struct PcapBlePacket
+{
+    u32 accessAddress = 0;
+    u32 crcInit = 0;
+    u8 channel = 0;
+    i8 rssi = 0;
+    u16 eventCounter = 0;
+    bool crcOk = true;
+    bool masterToSlave = false;
+    bool phy2Mbps = false;
+    const u8* pdu = nullptr; //Link layer header and payload, the access address and crc are added by the writer
+    u32 pduLength = 0;
+};
+
+//
+// Writes the packets that the simulated nodes receive into a pcapng file that can be opened with Wireshark.
+// The packets use the link type of the nRF Sniffer (LINKTYPE_NORDIC_BLE, protocol version 2) so that the
+// FruityMesh dissector in util/wireshark can be used with the capture. Every node gets its own interface,
+// which is described in the file once the node receives its first packet.
+//
+// The packets are collected in large buffers that are written to the file by a background thread, so the
+// simulation only has to wait for the disk if it produces packets faster than they can be written.
+//
+class PcapWriter
+{
+private:
+    std::ofstream file;
+
+    std::mutex mutex;
+    std::condition_variable buffersPending;
+    std::condition_variable buffersWritten;
+    std::vector<u8> currentBuffer;
+    std::deque<std::vector<u8>> pendingBuffers;
+    std::vector<std::vector<u8>> spareBuffers;
+    bool writing = false;
+    bool shuttingDown = false;
+    std::thread writerThread;
+
+    std::vector<u32> interfaceIds; //Interface id of each node index, INVALID_INTERFACE_ID until it was described
+    u32 numInterfaces = 0;
+    u16 packetCounter = 0;
+
+    static constexpr u32 INVALID_INTERFACE_ID = 0xFFFFFFFF;
+
+    void WriterLoop();
+    void HandOverCurrentBuffer(std::unique_lock<std::mutex>& lock);
+    u32 GetInterfaceId(u32 nodeIndex, NodeId nodeId);
+
+    void AppendBytes(const void* data, u32 length);
+    template<typename T>
+    void AppendValue(T value) { AppendBytes(&value, sizeof(value)); }
+    void AppendPadding(u32 length);
+
+public:
+    static constexpr u16 LINKTYPE_NORDIC_BLE = 272;
+    static constexpr u32 ADVERTISING_ACCESS_ADDRESS = 0x8E89BED6;
+    static constexpr u32 ADVERTISING_CRC_INIT = 0x555555;
+
+    //Creates the capture file, existing files are overwritten
+    explicit PcapWriter(const std::string& path);
+    ~PcapWriter();
+    PcapWriter(const PcapWriter&) = delete;
+    PcapWriter& operator=(const PcapWriter&) = delete;
+
+    //Can be called from multiple threads
+    void WritePacket(u32 nodeIndex, NodeId nodeId, uint64_t timestampUs, const PcapBlePacket& packet);
+
+    //Blocks until all packets were written to the file
+    void Flush();
+
+    //Returns the link layer crc of the pdu in the order in which it is sent over the air
+    static u32 CalculateCrc(u32 crcInit, const u8* pdu, u32 pduLength);
+};
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "PointerRelocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <link.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+void PointerRelocator::AddRegion(uintptr_t previousBase, uintptr_t currentBase, size_t size)
+{
+    if (size == 0) return;
+
+    Region region;
+    region.previousBase = previousBase;
+    region.currentBase = currentBase;
+    region.size = size;
+    const auto position = std::upper_bound(regions.begin(), regions.end(), previousBase, [](uintptr_t base, const Region& other) {
+        return base < other.previousBase;
+    });
+    regions.insert(position, region);
+
+    if (previousBase != currentBase) anyRegionMoved = true;
+}
+
+void PointerRelocator::Relocate(void* data, size_t size) const
+{
+    if (!anyRegionMoved) return;
+
+    u8* memory = (u8*)data;
+    const size_t misalignment = (uintptr_t)memory % sizeof(uintptr_t);
+    const size_t firstOffset = misalignment == 0 ? 0 : sizeof(uintptr_t) - misalignment;
+    for (size_t offset = firstOffset; offset + sizeof(uintptr_t) <= size; offset += sizeof(uintptr_t))
+    {
+        uintptr_t value = 0;
+        std::memcpy(&value, memory + offset, sizeof(value));
+
+        //The region with the highest address that starts at or before the value is the only one it can point into
+        auto region = std::upper_bound(regions.begin(), regions.end(), value, [](uintptr_t pointer, const Region& other) {
+            return pointer < other.previousBase;
+        });
+        if (region == regions.begin()) continue;
+        --region;
+
+        //A pointer directly behind the region (e.g. the end of a buffer) belongs to the region as well
+        if (value - region->previousBase > region->size) continue;
+
+        value = value - region->previousBase + region->currentBase;
+        std::memcpy(memory + offset, &value, sizeof(value));
+    }
+}
+
+void PointerRelocator::GetExecutableRegion(uintptr_t& base, size_t& size)
+{
+    base = 0;
+    size = 0;
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    struct Region
+    {
+        uintptr_t begin = UINTPTR_MAX;
+        uintptr_t end = 0;
+    } region;
+    dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) -> int {
+        Region* region = (Region*)data;
+        for (int i = 0; i < info->dlpi_phnum; i++)
+        {
+            const ElfW(Phdr)& header = info->dlpi_phdr[i];
+            if (header.p_type != PT_LOAD) continue;
+            region->begin = std::min<uintptr_t>(region->begin, info->dlpi_addr + header.p_vaddr);
+            region->end = std::max<uintptr_t>(region->end, info->dlpi_addr + header.p_vaddr + header.p_memsz);
+        }
+        //The executable is always reported first
+        return 1;
+    }, &region);
+    if (region.begin < region.end)
+    {
+        base = region.begin;
+        size = region.end - region.begin;
+    }
+#elif defined(_WIN32)
+    const u8* module = (const u8*)GetModuleHandle(nullptr);
+    const IMAGE_DOS_HEADER* dosHeader = (const IMAGE_DOS_HEADER*)module;
+    const IMAGE_NT_HEADERS* ntHeaders = (const IMAGE_NT_HEADERS*)(module + dosHeader->e_lfanew);
+    base = (uintptr_t)module;
+    size = ntHeaders->OptionalHeader.SizeOfImage;
+#endif
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "FmTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// Adjusts the pointers in raw memory images of the firmware state after they were moved to other memory.
+// The firmware state contains pointers to code, to constant data and into the memory of the nodes, but
+// there is no type information that tells which of its values are pointers. Each region that such a
+// pointer may point into is therefore registered with its address in the memory image and its address
+// in the current memory and every pointer sized and aligned value that points into a registered region
+// is moved by the offset of that region. A value that is no pointer but happens to have the address of a
+// registered region would be changed as well, so the regions are kept as small as possible and nothing is
+// changed if no region moved.
+//
+class PointerRelocator
+{
+private:
+    struct Region
+    {
+        uintptr_t previousBase = 0;
+        uintptr_t currentBase = 0;
+        size_t size = 0;
+    };
+    std::vector<Region> regions; //Sorted by previousBase
+    bool anyRegionMoved = false;
+
+public:
+    //Registers a region of the given size that was at previousBase and is now at currentBase
+    void AddRegion(uintptr_t previousBase, uintptr_t currentBase, size_t size);
+
+    //Adjusts all pointers in the given memory that point into one of the regions at their previous address
+    void Relocate(void* data, size_t size) const;
+
+    template<typename T>
+    void Relocate(T& value) const
+    {
+        Relocate(&value, sizeof(T));
+    }
+
+    //Returns the memory that holds the code and the static data of the running executable. The region is
+    //empty on platforms that load the executable to the same address every time (e.g. Emscripten).
+    static void GetExecutableRegion(uintptr_t& base, size_t& size);
+};
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "ReplayJournal.h"
+#include "Config.h"
+#include "Utility.h"
+
+constexpr size_t REPLAY_JOURNAL_FILE_BUFFER_SIZE = 64 * 1024;
+
+ReplayJournal::ReplayJournal(const std::string& path)
+    : fileBuffer(REPLAY_JOURNAL_FILE_BUFFER_SIZE)
+{
+    //The buffer must be set before the file is opened
+    file.rdbuf()->pubsetbuf(fileBuffer.data(), fileBuffer.size());
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        SIMEXCEPTIONFORCE(FileException);
+    }
+
+    const u32 header[] = { MAGIC_NUMBER, FORMAT_VERSION, FM_VERSION };
+    file.write((const char*)header, sizeof(header));
+}
+
+ReplayJournal::~ReplayJournal()
+{
+    file.flush();
+}
+
+void ReplayJournal::Append(ReplayJournalRecordType type, u32 nodeIndex, u32 timeMs, const void* data, u32 length)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    const u8 typeValue = (u8)type;
+    file.write((const char*)&typeValue, sizeof(typeValue));
+    file.write((const char*)&nodeIndex, sizeof(nodeIndex));
+    file.write((const char*)&timeMs, sizeof(timeMs));
+    file.write((const char*)&length, sizeof(length));
+    if (length > 0) file.write((const char*)data, length);
+    unflushedRecords = true;
+}
+
+void ReplayJournal::Append(ReplayJournalRecordType type, u32 nodeIndex, u32 timeMs, const std::string& data)
+{
+    Append(type, nodeIndex, timeMs, data.data(), (u32)data.size());
+}
+
+void ReplayJournal::Flush()
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    if (!unflushedRecords) return;
+    file.flush();
+    unflushedRecords = false;
+}
+
+bool ReplayJournal::IsReplayJournal(const std::string& fileContents)
+{
+    u32 magicNumber = 0;
+    if (fileContents.size() < sizeof(magicNumber)) return false;
+    CheckedMemcpy(&magicNumber, fileContents.data(), sizeof(magicNumber));
+    return magicNumber == MAGIC_NUMBER;
+}
+
+std::vector<ReplayJournalRecord> ReplayJournal::Read(const std::string& fileContents)
+{
+    size_t offset = 0;
+    const auto read = [&](void* destination, size_t size) {
+        if (offset + size > fileContents.size())
+        {
+            //The journal is truncated
+            SIMEXCEPTIONFORCE(IllegalArgumentException);
+        }
+        CheckedMemcpy((u8*)destination, fileContents.data() + offset, size);
+        offset += size;
+    };
+
+    u32 header[3] = {};
+    read(header, sizeof(header));
+    if (header[0] != MAGIC_NUMBER || header[1] != FORMAT_VERSION || header[2] != FM_VERSION)
+    {
+        //Not a journal or written by a different version of the simulator or firmware
+        SIMEXCEPTIONFORCE(IllegalArgumentException);
+    }
+
+    std::vector<ReplayJournalRecord> records;
+    while (offset < fileContents.size())
+    {
+        ReplayJournalRecord record;
+        u8 typeValue = 0;
+        u32 length = 0;
+        read(&typeValue, sizeof(typeValue));
+        read(&record.nodeIndex, sizeof(record.nodeIndex));
+        read(&record.timeMs, sizeof(record.timeMs));
+        read(&length, sizeof(length));
+        record.type = (ReplayJournalRecordType)typeValue;
+        record.data.resize(length);
+        if (length > 0) read(&record.data[0], length);
+        records.push_back(std::move(record));
+    }
+
+    return records;
+}
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "FmTypes.h"
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class ReplayJournalRecordType : u8
+{
+    CONFIGURATION    = 0, //The SimConfiguration as json
+    SITE             = 1, //The imported site json
+    DEVICES          = 2, //The imported devices json
+    TERMINAL_COMMAND = 3, //A command that was executed by the terminal of a node
+    UART_INPUT       = 4, //Bytes that were received by the UART of a node
+};
+
+struct ReplayJournalRecord
+{
+    ReplayJournalRecordType type = ReplayJournalRecordType::CONFIGURATION;
+    u32 nodeIndex = 0;
+    u32 timeMs = 0;
+    std::string data;
+};
+
+//
+// A compact binary journal of all inputs of a simulation that do not follow from its seed, so that a run can be
+// replayed without parsing its log. The file starts with a header that is followed by the records:
+//   header: magic number (u32), journal format version (u32), FM_VERSION (u32)
+//   record: type (u8), node index (u32), simulation time in ms (u32), length of the data (u32), data
+// All values are written in the byte order of the host. The first records always contain the configuration
+// and, if the nodes were imported from json, the site and devices. A journal is written by the simulator if
+// SimConfiguration::replayJournalPath is set and can be replayed by setting it as the replayPath.
+//
+class ReplayJournal
+{
+private:
+    std::vector<char> fileBuffer; //Declared before the file so that it outlives the stream that flushes into it
+    std::ofstream file;
+    std::mutex writeMutex;
+    bool unflushedRecords = false;
+
+public:
+    static constexpr u32 MAGIC_NUMBER = 0x4A525343; //"CSRJ"
+    static constexpr u32 FORMAT_VERSION = 1;
+
+    //Creates the journal file, existing files are overwritten
+    explicit ReplayJournal(const std::string& path);
+    ~ReplayJournal();
+    ReplayJournal(const ReplayJournal&) = delete;
+    ReplayJournal& operator=(const ReplayJournal&) = delete;
+
+    //Can be called from multiple threads, records of the same node keep their order
+    void Append(ReplayJournalRecordType type, u32 nodeIndex, u32 timeMs, const void* data, u32 length);
+    void Append(ReplayJournalRecordType type, u32 nodeIndex, u32 timeMs, const std::string& data);
+
+    //Writes buffered records to the file, called after each simulation step so that a crash loses at most one step
+    void Flush();
+
+    static bool IsReplayJournal(const std::string& fileContents);
+
+    //Throws an IllegalArgumentException if the journal is truncated or was written by another firmware version
+    static std::vector<ReplayJournalRecord> Read(const std::string& fileContents);
+};
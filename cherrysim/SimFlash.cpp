@@ -0,0 +1,297 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "SimFlash.h"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix) && !defined(__EMSCRIPTEN__)
+#define SIM_FLASH_USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef SIM_FLASH_USE_MMAP
+namespace {
+    //All nodes map the same files, so the state of the files is process wide
+    struct SharedFlashFiles
+    {
+        std::mutex mutex;
+
+        //A file that only consists of erased bytes, grown on demand
+        FILE* erasedFile = nullptr;
+        u32 erasedSize = 0;
+
+        //Pages with identical content that are shared between the nodes, indexed by their hash
+        FILE* poolFile = nullptr;
+        u32 poolSize = 0;
+        std::unordered_map<u32, std::vector<u32>> poolOffsetsByHash;
+    };
+
+    SharedFlashFiles& GetSharedFlashFiles()
+    {
+        static SharedFlashFiles files;
+        return files;
+    }
+
+    u32 HashPage(const u8* page, u32 length)
+    {
+        //FNV-1a
+        u32 hash = 2166136261UL;
+        for (u32 i = 0; i < length; i++)
+        {
+            hash ^= page[i];
+            hash *= 16777619UL;
+        }
+        return hash;
+    }
+}
+#endif
+
+SimFlash::SimFlash(u32 size)
+    : size(size)
+{
+#ifdef SIM_FLASH_USE_MMAP
+    const u32 osPageSize = GetOsPageSize();
+    const u32 mappedSize = (size + osPageSize - 1) / osPageSize * osPageSize;
+    SharedFlashFiles& files = GetSharedFlashFiles();
+    {
+        std::lock_guard<std::mutex> lock(files.mutex);
+        if (files.erasedFile == nullptr) files.erasedFile = tmpfile();
+        if (files.erasedFile != nullptr && files.erasedSize < mappedSize)
+        {
+            const std::vector<u8> erased(mappedSize - files.erasedSize, 0xFF);
+            if (pwrite(fileno(files.erasedFile), erased.data(), erased.size(), files.erasedSize) == (ssize_t)erased.size())
+            {
+                files.erasedSize = mappedSize;
+            }
+        }
+        if (files.erasedFile != nullptr && files.erasedSize >= mappedSize)
+        {
+            void* mapping = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(files.erasedFile), 0);
+            if (mapping != MAP_FAILED)
+            {
+                data = (u8*)mapping;
+                isMapped = true;
+                return;
+            }
+        }
+    }
+#endif
+    //Fallback if the memory can not be mapped
+    data = new u8[size];
+    memset(data, 0xFF, size);
+}
+
+SimFlash::~SimFlash()
+{
+#ifdef SIM_FLASH_USE_MMAP
+    if (isMapped)
+    {
+        const u32 osPageSize = GetOsPageSize();
+        munmap(data, (size + osPageSize - 1) / osPageSize * osPageSize);
+        return;
+    }
+#endif
+    delete[] data;
+}
+
+u32 SimFlash::GetOsPageSize()
+{
+#ifdef SIM_FLASH_USE_MMAP
+    static const u32 osPageSize = (u32)sysconf(_SC_PAGESIZE);
+    return osPageSize;
+#else
+    return 4096;
+#endif
+}
+
+bool SimFlash::IsErased(const u8* page, u32 length)
+{
+    for (u32 i = 0; i < length; i++)
+    {
+        if (page[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+bool SimFlash::MapErased(u32 offset, u32 length)
+{
+#ifdef SIM_FLASH_USE_MMAP
+    //The erased page is mapped at its own offset so that neighbouring erased pages can be merged by the kernel
+    if (isMapped)
+    {
+        void* mapping = mmap(data + offset, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fileno(GetSharedFlashFiles().erasedFile), offset);
+        if (mapping != MAP_FAILED) return true;
+    }
+#endif
+    return false;
+}
+
+u8* SimFlash::GetData() const
+{
+    return data;
+}
+
+u32 SimFlash::GetSize() const
+{
+    return size;
+}
+
+u8& SimFlash::operator[](u32 index)
+{
+    return data[index];
+}
+
+void SimFlash::Erase(u32 offset, u32 length)
+{
+    const u32 osPageSize = GetOsPageSize();
+    const u32 end = offset + length;
+    u32 firstFullPage = (offset + osPageSize - 1) / osPageSize * osPageSize;
+    u32 lastFullPage = end / osPageSize * osPageSize;
+
+    if (firstFullPage >= lastFullPage || !MapErased(firstFullPage, lastFullPage - firstFullPage))
+    {
+        memset(data + offset, 0xFF, length);
+        return;
+    }
+
+    //Partial pages at the borders of the range are erased by hand
+    memset(data + offset, 0xFF, firstFullPage - offset);
+    memset(data + lastFullPage, 0xFF, end - lastFullPage);
+}
+
+void SimFlash::Load(const u8* image)
+{
+    const u32 osPageSize = GetOsPageSize();
+    for (u32 offset = 0; offset < size; offset += osPageSize)
+    {
+        const u32 length = offset + osPageSize <= size ? osPageSize : size - offset;
+        if (memcmp(data + offset, image + offset, length) == 0) continue;
+
+        if (IsErased(image + offset, length))
+        {
+            Erase(offset, length);
+        }
+        else
+        {
+            memcpy(data + offset, image + offset, length);
+        }
+    }
+}
+
+void SimFlash::SharePages()
+{
+#ifdef SIM_FLASH_USE_MMAP
+    sharedPages.clear();
+    allPagesShared = false;
+    if (!isMapped) return;
+
+    const u32 osPageSize = GetOsPageSize();
+    SharedFlashFiles& files = GetSharedFlashFiles();
+    std::lock_guard<std::mutex> lock(files.mutex);
+    if (files.poolFile == nullptr) files.poolFile = tmpfile();
+    if (files.poolFile == nullptr) return;
+    const int poolFd = fileno(files.poolFile);
+
+    allPagesShared = size % osPageSize == 0;
+    std::vector<u8> poolPage(osPageSize);
+    for (u32 offset = 0; offset + osPageSize <= size; offset += osPageSize)
+    {
+        u8* page = data + offset;
+        if (IsErased(page, osPageSize))
+        {
+            //Either still the shared erased page or a private copy that can be released
+            MapErased(offset, osPageSize);
+            continue;
+        }
+
+        //Look for an identical page in the pool or add this one
+        std::vector<u32>& candidates = files.poolOffsetsByHash[HashPage(page, osPageSize)];
+        u32 poolOffset = files.poolSize;
+        for (u32 candidate : candidates)
+        {
+            if (pread(poolFd, poolPage.data(), osPageSize, candidate) == (ssize_t)osPageSize
+                && memcmp(poolPage.data(), page, osPageSize) == 0)
+            {
+                poolOffset = candidate;
+                break;
+            }
+        }
+        if (poolOffset == files.poolSize)
+        {
+            if (pwrite(poolFd, page, osPageSize, poolOffset) != (ssize_t)osPageSize)
+            {
+                allPagesShared = false;
+                continue;
+            }
+            files.poolSize += osPageSize;
+            candidates.push_back(poolOffset);
+        }
+
+        //If the mapping fails (e.g. because the limit of mappings is reached), the private page is simply kept
+        if (mmap(page, osPageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, poolFd, poolOffset) != MAP_FAILED)
+        {
+            sharedPages.push_back({ offset, poolOffset });
+        }
+        else
+        {
+            allPagesShared = false;
+        }
+    }
+#endif
+}
+
+void SimFlash::CloneFrom(const SimFlash& golden)
+{
+#ifdef SIM_FLASH_USE_MMAP
+    if (isMapped && golden.isMapped && golden.allPagesShared && size == golden.size)
+    {
+        const u32 osPageSize = GetOsPageSize();
+        SharedFlashFiles& files = GetSharedFlashFiles();
+        std::lock_guard<std::mutex> lock(files.mutex);
+        bool cloned = true;
+        for (const std::pair<u32, u32>& page : golden.sharedPages)
+        {
+            if (mmap(data + page.first, osPageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fileno(files.poolFile), page.second) == MAP_FAILED)
+            {
+                cloned = false;
+                break;
+            }
+        }
+        if (cloned) return;
+    }
+#endif
+    //Also repairs a clone that could only be mapped partially
+    Load(golden.GetData());
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "FmTypes.h"
+
+//
+// The simulated flash memory of a single node.
+//
+// The firmware accesses flash through raw pointers, so the memory has to stay contiguous. On POSIX
+// systems it is therefore a private mapping of a process wide file that only contains erased
+// (0xFF) bytes. Pages are shared with every other node until they are written for the first time,
+// at which point the operating system creates a private copy. Erasing a page maps it back to the
+// erased file and SharePages() maps written pages with identical content (e.g. the MBR) to a shared
+// pool of pages, again as copy-on-write. On other platforms, the flash is a plain heap allocation.
+//
+class SimFlash
+{
+TESTER_PUBLIC:
+    u8* data = nullptr;
+    u32 size = 0;
+    bool isMapped = false;
+    std::vector<std::pair<u32, u32>> sharedPages; //Offsets in the flash and in the pool of the pages mapped by SharePages
+    bool allPagesShared = false; //True if SharePages mapped every page that is not erased
+
+    static u32 GetOsPageSize();
+    static bool IsErased(const u8* page, u32 length);
+    bool MapErased(u32 offset, u32 length);
+
+public:
+    explicit SimFlash(u32 size);
+    ~SimFlash();
+    SimFlash(const SimFlash&) = delete;
+    SimFlash& operator=(const SimFlash&) = delete;
+
+    u8* GetData() const;
+    u32 GetSize() const;
+    u8& operator[](u32 index);
+
+    //Sets the given range to 0xFF, whole pages are released back to the shared erased page
+    void Erase(u32 offset, u32 length);
+
+    //Copies a full image into the flash, erased pages of the image are not copied
+    void Load(const u8* image);
+
+    //Replaces written pages with copy-on-write mappings of identical pages that are shared between all nodes
+    void SharePages();
+
+    //Copies the golden flash into this erased flash. If the golden flash was not written since SharePages,
+    //its shared pages are mapped instead of copied and the pages that are erased are not even read.
+    void CloneFrom(const SimFlash& golden);
+};
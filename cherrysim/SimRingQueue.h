@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+#include <type_traits>
+
+#include "FmTypes.h"
+
+//
+// A FIFO queue that keeps its elements in a ring buffer.
+//
+// The buffer only grows and is reused after elements were removed, so a queue that is filled and
+// emptied all the time (e.g. the BLE event queue of a node) stops allocating memory once it reached
+// its peak size. Removed elements are not destroyed, which is why only trivially copyable types
+// are supported. The interface follows the subset of std::deque that the simulator uses.
+//
+template<typename T>
+class SimRingQueue
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Removed elements are not destroyed");
+
+private:
+    static constexpr u32 INITIAL_CAPACITY = 8;
+
+    std::vector<T> buffer;
+    u32 head = 0;
+    u32 count = 0;
+
+    u32 GetBufferIndex(u32 index) const
+    {
+        const u32 bufferIndex = head + index;
+        return bufferIndex < buffer.size() ? bufferIndex : bufferIndex - (u32)buffer.size();
+    }
+
+    void Grow()
+    {
+        std::vector<T> newBuffer(buffer.empty() ? INITIAL_CAPACITY : buffer.size() * 2);
+        for (u32 i = 0; i < count; i++) newBuffer[i] = buffer[GetBufferIndex(i)];
+        buffer.swap(newBuffer);
+        head = 0;
+    }
+
+public:
+    bool empty() const { return count == 0; }
+    u32 size() const { return count; }
+    u32 capacity() const { return (u32)buffer.size(); }
+
+    T& front() { return buffer[head]; }
+    const T& front() const { return buffer[head]; }
+    T& operator[](u32 index) { return buffer[GetBufferIndex(index)]; }
+    const T& operator[](u32 index) const { return buffer[GetBufferIndex(index)]; }
+
+    void push_back(const T& element)
+    {
+        if (count == buffer.size()) Grow();
+        buffer[GetBufferIndex(count)] = element;
+        count++;
+    }
+
+    void pop_front()
+    {
+        head = GetBufferIndex(1);
+        count--;
+    }
+
+    //Keeps the buffer so that it can be reused
+    void clear()
+    {
+        head = 0;
+        count = 0;
+    }
+
+    void resize(u32 newSize)
+    {
+        while (count < newSize) push_back(T());
+        count = newSize;
+    }
+};
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "SimThreadPool.h"
+
+SimThreadPool::SimThreadPool(u32 numThreads)
+{
+    for (u32 i = 1; i < numThreads; i++)
+    {
+        workers.emplace_back(&SimThreadPool::WorkerLoop, this);
+    }
+}
+
+SimThreadPool::~SimThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shuttingDown = true;
+    }
+    workAvailable.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+u32 SimThreadPool::GetNumThreads() const
+{
+    return static_cast<u32>(workers.size()) + 1;
+}
+
+void SimThreadPool::Run(u32 size, const std::function<void(u32)>& job)
+{
+    if (size == 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentJob = &job;
+        currentJobSize = size;
+        nextIndex = 0;
+        busyWorkers = static_cast<u32>(workers.size());
+        jobGeneration++;
+    }
+    workAvailable.notify_all();
+
+    ProcessIndices(job, size);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [this]() { return busyWorkers == 0; });
+    currentJob = nullptr;
+}
+
+void SimThreadPool::WorkerLoop()
+{
+    u32 processedGeneration = 0;
+    while (true)
+    {
+        const std::function<void(u32)>* job = nullptr;
+        u32 size = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [&]() { return shuttingDown || jobGeneration != processedGeneration; });
+            if (shuttingDown) return;
+
+            processedGeneration = jobGeneration;
+            job = currentJob;
+            size = currentJobSize;
+        }
+
+        ProcessIndices(*job, size);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busyWorkers--;
+        }
+        workDone.notify_one();
+    }
+}
+
+void SimThreadPool::ProcessIndices(const std::function<void(u32)>& job, u32 size)
+{
+    for (u32 i = nextIndex++; i < size; i = nextIndex++)
+    {
+        job(i);
+    }
+}
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FmTypes.h"
+
+//
+// A fixed set of worker threads that executes one indexed job at a time.
+//
+// Run() hands out the indices of a job to all workers (and the calling thread) and only returns
+// once every index was processed. The job must not throw, because exceptions cannot be propagated
+// from the worker threads. CherrySim uses this to step the firmware of all nodes concurrently.
+//
+class SimThreadPool
+{
+TESTER_PUBLIC:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+
+    const std::function<void(u32)>* currentJob = nullptr;
+    u32 currentJobSize = 0;
+    u32 jobGeneration = 0;
+    u32 busyWorkers = 0;
+    bool shuttingDown = false;
+    std::atomic<u32> nextIndex{ 0 };
+
+    void WorkerLoop();
+    void ProcessIndices(const std::function<void(u32)>& job, u32 size);
+
+public:
+    //The calling thread of Run() counts as one of the numThreads threads
+    explicit SimThreadPool(u32 numThreads);
+    ~SimThreadPool();
+    SimThreadPool(const SimThreadPool&) = delete;
+    SimThreadPool& operator=(const SimThreadPool&) = delete;
+
+    u32 GetNumThreads() const;
+
+    //Calls job(i) for every i in [0, size) and blocks until all calls returned
+    void Run(u32 size, const std::function<void(u32)>& job);
+};
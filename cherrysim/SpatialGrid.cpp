@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SpatialGrid::Reset(float cellSizeInMeters, float widthInMeters, float heightInMeters, u32 nodeCount)
+{
+    this->cellSizeInMeters = cellSizeInMeters;
+    this->widthInMeters = widthInMeters;
+    this->heightInMeters = heightInMeters;
+
+    numColumns = std::max<u32>(1, static_cast<u32>(std::ceil(widthInMeters / cellSizeInMeters)));
+    numRows = std::max<u32>(1, static_cast<u32>(std::ceil(heightInMeters / cellSizeInMeters)));
+
+    cells.clear();
+    cells.resize(numColumns * numRows);
+    cellOfNode.assign(nodeCount, INVALID_CELL);
+}
+
+bool SpatialGrid::IsConfiguredFor(float cellSizeInMeters, float widthInMeters, float heightInMeters, u32 nodeCount) const
+{
+    return this->cellSizeInMeters == cellSizeInMeters
+        && this->widthInMeters == widthInMeters
+        && this->heightInMeters == heightInMeters
+        && cellOfNode.size() == nodeCount;
+}
+
+u32 SpatialGrid::GetNodeCount() const
+{
+    return static_cast<u32>(cellOfNode.size());
+}
+
+u32 SpatialGrid::GetColumn(float xInMeters) const
+{
+    const float column = std::floor(xInMeters / cellSizeInMeters);
+    if (!(column > 0)) return 0; // Also catches NaN
+    if (column >= static_cast<float>(numColumns - 1)) return numColumns - 1;
+    return static_cast<u32>(column);
+}
+
+u32 SpatialGrid::GetRow(float yInMeters) const
+{
+    const float row = std::floor(yInMeters / cellSizeInMeters);
+    if (!(row > 0)) return 0; // Also catches NaN
+    if (row >= static_cast<float>(numRows - 1)) return numRows - 1;
+    return static_cast<u32>(row);
+}
+
+void SpatialGrid::RemoveFromCell(u32 nodeIndex, u32 cell)
+{
+    std::vector<u32>& entries = cells[cell];
+    const auto it = std::find(entries.begin(), entries.end(), nodeIndex);
+    if (it != entries.end())
+    {
+        *it = entries.back();
+        entries.pop_back();
+    }
+}
+
+void SpatialGrid::Update(u32 nodeIndex, float xInMeters, float yInMeters)
+{
+    const u32 cell = GetRow(yInMeters) * numColumns + GetColumn(xInMeters);
+    const u32 oldCell = cellOfNode[nodeIndex];
+    if (cell == oldCell) return;
+
+    if (oldCell != INVALID_CELL) RemoveFromCell(nodeIndex, oldCell);
+    cells[cell].push_back(nodeIndex);
+    cellOfNode[nodeIndex] = cell;
+}
+
+void SpatialGrid::GetCandidates(float xInMeters, float yInMeters, std::vector<u32>& candidates) const
+{
+    candidates.clear();
+
+    const u32 column = GetColumn(xInMeters);
+    const u32 row = GetRow(yInMeters);
+    const u32 firstColumn = column > 0 ? column - 1 : 0;
+    const u32 lastColumn = std::min(column + 1, numColumns - 1);
+    const u32 firstRow = row > 0 ? row - 1 : 0;
+    const u32 lastRow = std::min(row + 1, numRows - 1);
+
+    for (u32 r = firstRow; r <= lastRow; r++)
+    {
+        for (u32 c = firstColumn; c <= lastColumn; c++)
+        {
+            const std::vector<u32>& entries = cells[r * numColumns + c];
+            candidates.insert(candidates.end(), entries.begin(), entries.end());
+        }
+    }
+
+    //The simulation must visit nodes in index order to stay deterministic
+    std::sort(candidates.begin(), candidates.end());
+}
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+
+#include "FmTypes.h"
+
+//
+// A uniform grid over the simulated area that buckets node indices by their position.
+//
+// Each cell is at least as big as the maximum radio range, so all nodes that are within range of
+// a given position are located in the 3x3 block of cells around it. This allows the simulator to
+// only visit candidate receivers instead of iterating over all nodes for every transmission.
+// Positions outside of the map are clamped to the border cells, which keeps the candidate set a
+// superset of all nodes in range.
+//
+class SpatialGrid
+{
+TESTER_PUBLIC:
+    static constexpr u32 INVALID_CELL = 0xFFFFFFFF;
+
+    float cellSizeInMeters = 0;
+    float widthInMeters = 0;
+    float heightInMeters = 0;
+    u32 numColumns = 0;
+    u32 numRows = 0;
+
+    std::vector<std::vector<u32>> cells;
+    std::vector<u32> cellOfNode;
+
+    u32 GetColumn(float xInMeters) const;
+    u32 GetRow(float yInMeters) const;
+    void RemoveFromCell(u32 nodeIndex, u32 cell);
+
+public:
+    /// Discards all entries and prepares the grid for the given dimensions and amount of nodes.
+    void Reset(float cellSizeInMeters, float widthInMeters, float heightInMeters, u32 nodeCount);
+
+    /// Returns true if the grid was last reset with exactly these dimensions and amount of nodes.
+    bool IsConfiguredFor(float cellSizeInMeters, float widthInMeters, float heightInMeters, u32 nodeCount) const;
+
+    /// Returns the amount of nodes that the grid was prepared for.
+    u32 GetNodeCount() const;
+
+    /// Inserts the node into the cell of the given position or moves it there if it was already inserted.
+    void Update(u32 nodeIndex, float xInMeters, float yInMeters);
+
+    /// Fills candidates with the indices of all nodes in the cells around the given position in
+    /// ascending order. The result is a superset of all nodes within cellSizeInMeters on the x and y axis.
+    void GetCandidates(float xInMeters, float yInMeters, std::vector<u32>& candidates) const;
+};
@@ -52,8 +52,8 @@ class StackWatcher
     friend StackBaseSetter;
     friend StackWatcherDisabler;
 private:
-    static std::vector<const void*> stackBase;
-    static u32 disableValue;
+    static thread_local std::vector<const void*> stackBase;
+    static thread_local u32 disableValue;
 
 public:
     static void Check();
@@ -40,6 +40,8 @@
 #include <fstream>
 #include <limits>
 #include <optional>
+#include <mutex>
+#include <array>
 
 extern "C" {
 #include <app_timer.h>
@@ -57,24 +59,25 @@ All calls work in conjunction with helper methods and simulation routines define
 using json = nlohmann::json;
 
 //These variables are normally defined by the linker sections, so we need to define them here
-uint32_t __application_start_address;
-uint32_t __application_end_address;
-uint32_t __application_ram_start_address;
-uint32_t __start_conn_type_resolvers;
-uint32_t __stop_conn_type_resolvers;
-uint32_t __license_data_start_address;
+//They point into the memory of the current node and are therefore thread local like the other node pointers
+thread_local uint32_t __application_start_address;
+thread_local uint32_t __application_end_address;
+thread_local uint32_t __application_ram_start_address;
+thread_local uint32_t __start_conn_type_resolvers;
+thread_local uint32_t __stop_conn_type_resolvers;
+thread_local uint32_t __license_data_start_address;
 uint32_t __StackTop;
 uint32_t __StackLimit;
 
 //Pointer to FruityMesh state
-GlobalState* simGlobalStatePtr;
+thread_local GlobalState* simGlobalStatePtr;
 
 //nRF hardware abstraction
-NRF_FICR_Type* simFicrPtr;
-NRF_UICR_Type* simUicrPtr;
-NRF_GPIO_Type* simGpioPtr;
-NRF_RADIO_Type* simRadioPtr;
-uint8_t* simFlashPtr;
+thread_local NRF_FICR_Type* simFicrPtr;
+thread_local NRF_UICR_Type* simUicrPtr;
+thread_local NRF_GPIO_Type* simGpioPtr;
+thread_local NRF_RADIO_Type* simRadioPtr;
+thread_local uint8_t* simFlashPtr;
 
 
 //########################################### SoftDevice Call Redirection #####################################################
@@ -380,10 +383,10 @@ extern "C"
             //Was not initialized!
             SIMEXCEPTION(IllegalStateException);
         }
-        gyro->x = (uint16_t)cherrySimInstance->simState.rnd.NextU32();
-        gyro->y = (uint16_t)cherrySimInstance->simState.rnd.NextU32();
-        gyro->z = (uint16_t)cherrySimInstance->simState.rnd.NextU32();
-        gyro->sensortime = cherrySimInstance->simState.rnd.NextU32();
+        gyro->x = (uint16_t)cherrySimInstance->GetRnd().NextU32();
+        gyro->y = (uint16_t)cherrySimInstance->GetRnd().NextU32();
+        gyro->z = (uint16_t)cherrySimInstance->GetRnd().NextU32();
+        gyro->sensortime = cherrySimInstance->GetRnd().NextU32();
         return BMG250_OK;
     }
 
@@ -461,10 +464,10 @@ extern "C"
             //Was not initialized!
             SIMEXCEPTION(IllegalStateException);
         }
-        out->x = (uint16_t)cherrySimInstance->simState.rnd.NextU32();
-        out->y = (uint16_t)cherrySimInstance->simState.rnd.NextU32();
-        out->z = (uint16_t)cherrySimInstance->simState.rnd.NextU32();
-        out->temp = (uint16_t)cherrySimInstance->simState.rnd.NextU32();
+        out->x = (uint16_t)cherrySimInstance->GetRnd().NextU32();
+        out->y = (uint16_t)cherrySimInstance->GetRnd().NextU32();
+        out->z = (uint16_t)cherrySimInstance->GetRnd().NextU32();
+        out->temp = (uint16_t)cherrySimInstance->GetRnd().NextU32();
         return 0;
     }
 
@@ -728,9 +731,9 @@ extern "C"
         if (is_lis2dh12_moving_in_simulation())
         {
             //TODO: Use realistic values
-            buffer->i16bit[0] = (i16)cherrySimInstance->simState.rnd.NextU32();
-            buffer->i16bit[1] = (i16)cherrySimInstance->simState.rnd.NextU32();
-            buffer->i16bit[2] = (i16)cherrySimInstance->simState.rnd.NextU32();
+            buffer->i16bit[0] = (i16)cherrySimInstance->GetRnd().NextU32();
+            buffer->i16bit[1] = (i16)cherrySimInstance->GetRnd().NextU32();
+            buffer->i16bit[2] = (i16)cherrySimInstance->GetRnd().NextU32();
         }
         else
         {
@@ -889,7 +892,7 @@ extern "C"
             SIMEXCEPTION(IllegalStateException);
         }
 
-        return cherrySimInstance->simState.rnd.NextU32() % (std::numeric_limits<u16>::max() * 512);
+        return cherrySimInstance->GetRnd().NextU32() % (std::numeric_limits<u16>::max() * 512);
     }
     int32_t bme280_get_temperature()
     {
@@ -899,7 +902,7 @@ extern "C"
             //Not initialized!
             SIMEXCEPTION(IllegalStateException);
         }
-        return ((int32_t)cherrySimInstance->simState.rnd.NextU32()) % std::numeric_limits<i16>::max();
+        return ((int32_t)cherrySimInstance->GetRnd().NextU32()) % std::numeric_limits<i16>::max();
     }
     uint32_t bme280_get_humidity()
     {
@@ -910,7 +913,7 @@ extern "C"
             SIMEXCEPTION(IllegalStateException);
         }
 
-        return cherrySimInstance->simState.rnd.NextU32() % (std::numeric_limits<u8>::max() * 1024);
+        return cherrySimInstance->GetRnd().NextU32() % (std::numeric_limits<u8>::max() * 1024);
     }
 
     uint32_t sd_ble_gap_connect(const ble_gap_addr_t* p_peer_addr, const ble_gap_scan_params_t* p_scan_params, const ble_gap_conn_params_t* p_conn_params, uint32_t)
@@ -1002,18 +1005,22 @@ extern "C"
         if (!connection->isCentral) SIMEXCEPTION(IllegalStateException); //Peripheral cannot start encryption
 
         //Send an event to the connection partner to request the key information
-        simBleEvent s1;
-        s1.globalId = cherrySimInstance->simState.globalEventIdCounter++;
-        s1.bleEvent.header.evt_id = BLE_GAP_EVT_SEC_INFO_REQUEST;
-        s1.bleEvent.header.evt_len = s1.globalId;
-        s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
-        ble_gap_addr_t address = CherrySim::Convert(&cherrySimInstance->currentNode->address);
-        CheckedMemcpy(&s1.bleEvent.evt.gap_evt.params.sec_info_request.peer_addr, &address, sizeof(ble_gap_addr_t));
-        s1.bleEvent.evt.gap_evt.params.sec_info_request.master_id = {}; //TODO: incomplete information
-        s1.bleEvent.evt.gap_evt.params.sec_info_request.enc_info = 0; //TODO: incomplete information
-        s1.bleEvent.evt.gap_evt.params.sec_info_request.id_info = 0; //TODO: incomplete information
-        s1.bleEvent.evt.gap_evt.params.sec_info_request.sign_info = 0; //TODO: incomplete information
-        connection->partner->eventQueue.push_back(s1);
+        cherrySimInstance->RunOrStage([connection]() {
+            if (!connection->connectionActive) return;
+
+            simBleEvent s1;
+            s1.globalId = cherrySimInstance->NextGlobalEventId();
+            s1.bleEvent.header.evt_id = BLE_GAP_EVT_SEC_INFO_REQUEST;
+            s1.bleEvent.header.evt_len = s1.globalId;
+            s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
+            ble_gap_addr_t address = CherrySim::Convert(&cherrySimInstance->currentNode->address);
+            CheckedMemcpy(&s1.bleEvent.evt.gap_evt.params.sec_info_request.peer_addr, &address, sizeof(ble_gap_addr_t));
+            s1.bleEvent.evt.gap_evt.params.sec_info_request.master_id = {}; //TODO: incomplete information
+            s1.bleEvent.evt.gap_evt.params.sec_info_request.enc_info = 0; //TODO: incomplete information
+            s1.bleEvent.evt.gap_evt.params.sec_info_request.id_info = 0; //TODO: incomplete information
+            s1.bleEvent.evt.gap_evt.params.sec_info_request.sign_info = 0; //TODO: incomplete information
+            connection->partner->eventQueue.push_back(s1);
+        });
 
         //Save the key that should be used for encrypting the connection
         CheckedMemcpy(cherrySimInstance->currentNode->state.currentLtkForEstablishingSecurity, p_enc_info->ltk, 16);
@@ -1031,41 +1038,48 @@ extern "C"
             return BLE_ERROR_INVALID_CONN_HANDLE;
         }
 
-        //Check if the encryption key matches
-        if (
-            memcmp(connection->partner->state.currentLtkForEstablishingSecurity, p_enc_info->ltk, 16) == 0
-        ) {
-            //Set our own conneciton to encrypted
-            connection->connectionEncrypted = true;
-            simBleEvent s1;
-            CheckedMemset(&s1, 0, sizeof(s1));
-            s1.globalId = cherrySimInstance->simState.globalEventIdCounter++;
-            s1.bleEvent.header.evt_id = BLE_GAP_EVT_CONN_SEC_UPDATE;
-            s1.bleEvent.header.evt_len = s1.globalId;
-            s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
-            s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
-            s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
-            s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 3;
-            cherrySimInstance->currentNode->eventQueue.push_back(s1);
-
-            //Set our own partners connection to encrypted
-            connection->partnerConnection->connectionEncrypted = true;
-            simBleEvent s2;
-            CheckedMemset(&s2, 0, sizeof(s2));
-            s2.globalId = cherrySimInstance->simState.globalEventIdCounter++;
-            s2.bleEvent.header.evt_id = BLE_GAP_EVT_CONN_SEC_UPDATE;
-            s2.bleEvent.header.evt_len = s2.globalId;
-            s2.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
-            s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
-            s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
-            s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 3;
-            connection->partner->eventQueue.push_back(s2);
-        }
-        //Keys do not match, generate a failure
-        else {
-            //Disconnect the connection with a MIC error
-            cherrySimInstance->DisconnectSimulatorConnection(connection, BLE_HCI_CONN_TERMINATED_DUE_TO_MIC_FAILURE, BLE_HCI_CONNECTION_TIMEOUT);
-        }
+        //The key of the partner is only compared at the end of the step during parallel stepping
+        std::array<u8, 16> ltk;
+        CheckedMemcpy(ltk.data(), p_enc_info->ltk, ltk.size());
+        cherrySimInstance->RunOrStage([connection, ltk]() {
+            if (!connection->connectionActive) return;
+
+            //Check if the encryption key matches
+            if (
+                memcmp(connection->partner->state.currentLtkForEstablishingSecurity, ltk.data(), 16) == 0
+            ) {
+                //Set our own conneciton to encrypted
+                connection->connectionEncrypted = true;
+                simBleEvent s1;
+                CheckedMemset(&s1, 0, sizeof(s1));
+                s1.globalId = cherrySimInstance->NextGlobalEventId();
+                s1.bleEvent.header.evt_id = BLE_GAP_EVT_CONN_SEC_UPDATE;
+                s1.bleEvent.header.evt_len = s1.globalId;
+                s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
+                s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
+                s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
+                s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 3;
+                cherrySimInstance->currentNode->eventQueue.push_back(s1);
+
+                //Set our own partners connection to encrypted
+                connection->partnerConnection->connectionEncrypted = true;
+                simBleEvent s2;
+                CheckedMemset(&s2, 0, sizeof(s2));
+                s2.globalId = cherrySimInstance->NextGlobalEventId();
+                s2.bleEvent.header.evt_id = BLE_GAP_EVT_CONN_SEC_UPDATE;
+                s2.bleEvent.header.evt_len = s2.globalId;
+                s2.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
+                s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
+                s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
+                s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 3;
+                connection->partner->eventQueue.push_back(s2);
+            }
+            //Keys do not match, generate a failure
+            else {
+                //Disconnect the connection with a MIC error
+                cherrySimInstance->DisconnectSimulatorConnection(connection, BLE_HCI_CONN_TERMINATED_DUE_TO_MIC_FAILURE, BLE_HCI_CONNECTION_TIMEOUT);
+            }
+        });
 
         return NRF_SUCCESS;
     }
@@ -1092,6 +1106,7 @@ extern "C"
             // request of the peripheral) the optional will hold the new
             // parameters.
             std::optional<ble_gap_conn_params_t> params;
+            const bool answersRequest = connection->connParamUpdateRequestPending;
             // If a connection parameter update request was pending on the
             // connection, the request can be either accepted or rejected.
             if (connection->connParamUpdateRequestPending)
@@ -1133,65 +1148,73 @@ extern "C"
                 params = *p_conn_params;
             }
 
-            // Fetch the partner connection.
-            SoftdeviceConnection * peripheralConnection = connection->partnerConnection;
+            // The partner is only updated at the end of the step during parallel stepping.
+            cherrySimInstance->RunOrStage([connection, params, answersRequest]() {
+                if (!connection->connectionActive) return;
 
-            // If new parameters are available, generate events on both, central
-            // and peripheral with the new parameters and change the parameters
-            // stored in the connection object.
-            if (params.has_value())
-            {
-                // Change the parameters in the connection objects.
-                connection->connectionInterval =
-                    UNITS_TO_MSEC(params->min_conn_interval, CONFIG_UNIT_1_25_MS);
-                peripheralConnection->connectionInterval =
-                    UNITS_TO_MSEC(params->min_conn_interval, CONFIG_UNIT_1_25_MS);
+                // Fetch the partner connection.
+                SoftdeviceConnection * peripheralConnection = connection->partnerConnection;
 
-                { // central event
-                    simBleEvent simEvent = {};
-                    simEvent.globalId = cherrySimInstance->simState.globalEventIdCounter++;
+                // The peripheral may send a new request once it got the answer.
+                if (answersRequest) peripheralConnection->connParamUpdateRequestSent = false;
 
-                    auto & bleEvent = simEvent.bleEvent;
-                    bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE;
-                    bleEvent.header.evt_len = simEvent.globalId;
-                    bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
-                    bleEvent.evt.gap_evt.params.conn_param_update.conn_params = *params;
+                // If new parameters are available, generate events on both, central
+                // and peripheral with the new parameters and change the parameters
+                // stored in the connection object.
+                if (params.has_value())
+                {
+                    // Change the parameters in the connection objects.
+                    connection->connectionInterval =
+                        UNITS_TO_MSEC(params->min_conn_interval, CONFIG_UNIT_1_25_MS);
+                    peripheralConnection->connectionInterval =
+                        UNITS_TO_MSEC(params->min_conn_interval, CONFIG_UNIT_1_25_MS);
+
+                    { // central event
+                        simBleEvent simEvent = {};
+                        simEvent.globalId = cherrySimInstance->NextGlobalEventId();
+
+                        auto & bleEvent = simEvent.bleEvent;
+                        bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE;
+                        bleEvent.header.evt_len = simEvent.globalId;
+                        bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
+                        bleEvent.evt.gap_evt.params.conn_param_update.conn_params = *params;
+
+                        connection->owningNode->eventQueue.push_back(simEvent);
+                    }
 
-                    connection->owningNode->eventQueue.push_back(simEvent);
-                }
+                    { // peripheral event
+                        simBleEvent simEvent = {};
+                        simEvent.globalId = cherrySimInstance->NextGlobalEventId();
+
+                        auto & bleEvent = simEvent.bleEvent;
+                        bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE;
+                        bleEvent.header.evt_len = simEvent.globalId;
+                        bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
+                        bleEvent.evt.gap_evt.params.conn_param_update.conn_params = *params;
 
-                { // peripheral event
+                        peripheralConnection->owningNode->eventQueue.push_back(simEvent);
+                    }
+                }
+                // If a request was rejected, generate an event on the peripheral.
+                else
+                {
                     simBleEvent simEvent = {};
-                    simEvent.globalId = cherrySimInstance->simState.globalEventIdCounter++;
+                    simEvent.globalId = cherrySimInstance->NextGlobalEventId();
 
                     auto & bleEvent = simEvent.bleEvent;
                     bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE;
                     bleEvent.header.evt_len = simEvent.globalId;
                     bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
-                    bleEvent.evt.gap_evt.params.conn_param_update.conn_params = *params;
+
+                    auto & connParams = bleEvent.evt.gap_evt.params.conn_param_update.conn_params;
+                    connParams.min_conn_interval = peripheralConnection->connectionInterval;
+                    connParams.max_conn_interval = peripheralConnection->connectionInterval;
+                    connParams.slave_latency = Conf::GetInstance().meshPeripheralSlaveLatency;
+                    connParams.conn_sup_timeout = Conf::meshConnectionSupervisionTimeout;
 
                     peripheralConnection->owningNode->eventQueue.push_back(simEvent);
                 }
-            }
-            // If a request was rejected, generate an event on the peripheral.
-            else
-            {
-                simBleEvent simEvent = {};
-                simEvent.globalId = cherrySimInstance->simState.globalEventIdCounter++;
-
-                auto & bleEvent = simEvent.bleEvent;
-                bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE;
-                bleEvent.header.evt_len = simEvent.globalId;
-                bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
-
-                auto & connParams = bleEvent.evt.gap_evt.params.conn_param_update.conn_params;
-                connParams.min_conn_interval = peripheralConnection->connectionInterval;
-                connParams.max_conn_interval = peripheralConnection->connectionInterval;
-                connParams.slave_latency = Conf::GetInstance().meshPeripheralSlaveLatency;
-                connParams.conn_sup_timeout = Conf::meshConnectionSupervisionTimeout;
-
-                peripheralConnection->owningNode->eventQueue.push_back(simEvent);
-            }
+            });
         }
         // Called on the peripheral.
         else
@@ -1199,8 +1222,9 @@ extern "C"
             // Fetch the partner connection.
             SoftdeviceConnection * centralConnection = connection->partnerConnection;
             // Check that no connection parameter update request is already
-            // pending.
-            if (centralConnection->connParamUpdateRequestPending)
+            // pending. This is tracked on our own side of the connection as
+            // the central cannot be inspected during parallel stepping.
+            if (connection->connParamUpdateRequestSent)
             {
                 return NRF_ERROR_BUSY;
             }
@@ -1209,29 +1233,36 @@ extern "C"
             {
                 return NRF_ERROR_INVALID_ADDR;
             }
-            // TODO: Check the constraints of the parameter values and
-            //       return NRF_ERROR_INVALID_PARAM if violated.
-            // Update the requested connection parameters.
-            auto &cpurp = centralConnection->connParamUpdateRequestParameters;
-            cpurp.minConnInterval = p_conn_params->min_conn_interval;
-            cpurp.maxConnInterval = p_conn_params->max_conn_interval;
-            cpurp.slaveLatency = p_conn_params->slave_latency;
-            cpurp.connSupTimeout = p_conn_params->conn_sup_timeout; 
-            // Compute the timeout and set the pending flag.
-            centralConnection->connParamUpdateRequestTimeoutDs =
-                centralConnection->owningNode->gs.appTimerDs + 20;
-            centralConnection->connParamUpdateRequestPending = true;
-            // Create the event on the central.
-            simBleEvent simEvent = {};
-            simEvent.globalId = cherrySimInstance->simState.globalEventIdCounter++;
-            auto & bleEvent = simEvent.bleEvent;
-            bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST;
-            bleEvent.header.evt_len = simEvent.globalId;
-            bleEvent.evt.gap_evt.conn_handle = centralConnection->connectionHandle;
-            bleEvent.evt.gap_evt.params.conn_param_update_request.conn_params =
-                *p_conn_params;
-            // Push the request event into the event queue of the central node.
-            centralConnection->owningNode->eventQueue.push_back(simEvent);
+            connection->connParamUpdateRequestSent = true;
+            // Only the central side is updated at the end of the step during parallel stepping.
+            const ble_gap_conn_params_t connParams = *p_conn_params;
+            cherrySimInstance->RunOrStage([connection, centralConnection, connParams]() {
+                if (!connection->connectionActive) return;
+
+                // TODO: Check the constraints of the parameter values and
+                //       return NRF_ERROR_INVALID_PARAM if violated.
+                // Update the requested connection parameters.
+                auto &cpurp = centralConnection->connParamUpdateRequestParameters;
+                cpurp.minConnInterval = connParams.min_conn_interval;
+                cpurp.maxConnInterval = connParams.max_conn_interval;
+                cpurp.slaveLatency = connParams.slave_latency;
+                cpurp.connSupTimeout = connParams.conn_sup_timeout; 
+                // Compute the timeout and set the pending flag.
+                centralConnection->connParamUpdateRequestTimeoutDs =
+                    centralConnection->owningNode->gs.appTimerDs + 20;
+                centralConnection->connParamUpdateRequestPending = true;
+                // Create the event on the central.
+                simBleEvent simEvent = {};
+                simEvent.globalId = cherrySimInstance->NextGlobalEventId();
+                auto & bleEvent = simEvent.bleEvent;
+                bleEvent.header.evt_id = BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST;
+                bleEvent.header.evt_len = simEvent.globalId;
+                bleEvent.evt.gap_evt.conn_handle = centralConnection->connectionHandle;
+                bleEvent.evt.gap_evt.params.conn_param_update_request.conn_params =
+                    connParams;
+                // Push the request event into the event queue of the central node.
+                centralConnection->owningNode->eventQueue.push_back(simEvent);
+            });
         }
 
         return NRF_SUCCESS;
@@ -1438,15 +1469,19 @@ extern "C"
         }
 
         connection->connectionMtu = clientRxMtu - FruityHal::ATT_HEADER_SIZE;
-        simBleEvent s1;
-        CheckedMemset(&s1, 0, sizeof(s1));
-        s1.globalId = cherrySimInstance->simState.globalEventIdCounter++;
-        s1.bleEvent.header.evt_id = BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST;
-        s1.bleEvent.header.evt_len = s1.globalId;
-        s1.bleEvent.evt.gatts_evt.conn_handle = connHandle;
-        s1.bleEvent.evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu = clientRxMtu;
+        cherrySimInstance->RunOrStage([connection, connHandle, clientRxMtu]() {
+            if (!connection->connectionActive) return;
+
+            simBleEvent s1;
+            CheckedMemset(&s1, 0, sizeof(s1));
+            s1.globalId = cherrySimInstance->NextGlobalEventId();
+            s1.bleEvent.header.evt_id = BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST;
+            s1.bleEvent.header.evt_len = s1.globalId;
+            s1.bleEvent.evt.gatts_evt.conn_handle = connHandle;
+            s1.bleEvent.evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu = clientRxMtu;
 
-        connection->partner->eventQueue.push_back(s1);
+            connection->partner->eventQueue.push_back(s1);
+        });
 
 
         return NRF_SUCCESS;
@@ -1462,6 +1497,23 @@ extern "C"
             return NRF_ERROR_BUSY;
         }
 
+        //The data length is only used by the connection event simulation
+        SoftdeviceConnection* connection = cherrySimInstance->FindConnectionByHandle(cherrySimInstance->currentNode, connHandle);
+        if (connection != nullptr) {
+            //Without parameters or with 0, the SoftDevice uses the biggest supported data length
+            u16 maxTxOctets = (u16)std::clamp<u32>(cherrySimInstance->simConfig.connectionMaxTxOctets, 27, 251);
+            if (p_dl_params != nullptr && p_dl_params->max_tx_octets != 0) {
+                maxTxOctets = std::min(maxTxOctets, p_dl_params->max_tx_octets);
+            }
+
+            // The partner is only updated at the end of the step during parallel stepping.
+            cherrySimInstance->RunOrStage([connection, maxTxOctets]() {
+                if (!connection->connectionActive) return;
+                connection->maxTxOctets = maxTxOctets;
+                connection->partnerConnection->maxTxOctets = maxTxOctets;
+            });
+        }
+
         return NRF_SUCCESS;
 
     }
@@ -1486,34 +1538,26 @@ extern "C"
 
         connection->connectionMtu = serverRxMtu - FruityHal::ATT_HEADER_SIZE;
 
+        cherrySimInstance->RunOrStage([connection, connHandle, serverRxMtu]() {
+            if (!connection->connectionActive) return;
 
-        simBleEvent s1;
-        CheckedMemset(&s1, 0, sizeof(s1));
-        s1.globalId = cherrySimInstance->simState.globalEventIdCounter++;
-        s1.bleEvent.header.evt_id = BLE_GATTC_EVT_EXCHANGE_MTU_RSP;
-        s1.bleEvent.header.evt_len = s1.globalId;
-        s1.bleEvent.evt.gattc_evt.conn_handle = connHandle;
-        s1.bleEvent.evt.gattc_evt.error_handle = BLE_GATT_HANDLE_INVALID;
-        s1.bleEvent.evt.gattc_evt.gatt_status = BLE_GATT_STATUS_SUCCESS;
-        s1.bleEvent.evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu = serverRxMtu;
+            simBleEvent s1;
+            CheckedMemset(&s1, 0, sizeof(s1));
+            s1.globalId = cherrySimInstance->NextGlobalEventId();
+            s1.bleEvent.header.evt_id = BLE_GATTC_EVT_EXCHANGE_MTU_RSP;
+            s1.bleEvent.header.evt_len = s1.globalId;
+            s1.bleEvent.evt.gattc_evt.conn_handle = connHandle;
+            s1.bleEvent.evt.gattc_evt.error_handle = BLE_GATT_HANDLE_INVALID;
+            s1.bleEvent.evt.gattc_evt.gatt_status = BLE_GATT_STATUS_SUCCESS;
+            s1.bleEvent.evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu = serverRxMtu;
 
-  
-        connection->partner->eventQueue.push_back(s1);
+            connection->partner->eventQueue.push_back(s1);
+        });
 
 
         return NRF_SUCCESS;
     }
 
-    SoftDeviceBufferedPacket* findFreePacketBuffer(SoftdeviceConnection* connection) {
-        START_OF_FUNCTION();
-        for (int i = 0; i < SIM_NUM_UNRELIABLE_BUFFERS; i++) {
-            if (connection->unreliableBuffers[i].sender == nullptr) {
-                return &connection->unreliableBuffers[i];
-            }
-        }
-        return nullptr;
-    }
-
     uint32_t sd_ble_gap_tx_power_set(int8_t tx_power)
     {
         START_OF_FUNCTION();
@@ -1561,24 +1605,21 @@ extern "C"
         //Fill either reliable or unreliable buffer with the packet
         SoftDeviceBufferedPacket* buffer = nullptr;
         if (p_write_params->write_op == BLE_GATT_OP_WRITE_REQ) {
-            //Check if the buffer is free to use
-            if (connection->reliableBuffers[0].sender == nullptr) {
-                buffer = &connection->reliableBuffers[0];
-            }
+            buffer = connection->reliableBuffers.Push();
         }
         else if (p_write_params->write_op == BLE_GATT_OP_WRITE_CMD) {
-            buffer = findFreePacketBuffer(connection);
+            buffer = connection->unreliableBuffers.Push();
         }
         else {
             SIMEXCEPTION(IllegalStateException);
         }
 
-        if (buffer == nullptr || buffer->sender != 0) {
+        if (buffer == nullptr) {
             return NRF_ERROR_RESOURCES;
         }
 
         //We save a global id for each packet that is sent, so that we can debug where a packet was generated
-        buffer->globalPacketId = cherrySimInstance->simState.globalPacketIdCounter++;
+        buffer->globalPacketId = cherrySimInstance->NextGlobalPacketId();
         buffer->sender = cherrySimInstance->currentNode;
         buffer->receiver = partnerNode;
         buffer->connHandle = conn_handle;
@@ -1606,12 +1647,14 @@ extern "C"
 
         logt("RS", "Erasing Page %u", page_number);
 
-        u32* p = (u32*)(FLASH_REGION_START_ADDRESS + (u32)page_number * FruityHal::GetCodePageSize());
-
-        for (u32 i = 0; i < FruityHal::GetCodePageSize() / 4; i++) {
-            p[i] = 0xFFFFFFFF;
+        if ((page_number + 1) * FruityHal::GetCodePageSize() > SIM_MAX_FLASH_SIZE)
+        {
+            SIMEXCEPTION(IllegalArgumentException);
+            return NRF_ERROR_INVALID_ADDR;
         }
 
+        cherrySimInstance->currentNode->flash.Erase(page_number * FruityHal::GetCodePageSize(), FruityHal::GetCodePageSize());
+
         //If the stack is initialized, it will generate an event for the operation, if not, it will only return syncronously
         if (cherrySimInstance->currentNode->state.initialized) {
             if (cherrySimInstance->simConfig.simulateAsyncFlash) {
@@ -1776,13 +1819,11 @@ extern "C"
             return NRF_ERROR_NOT_FOUND;
         }
 
-        auto simBleEvent = cherrySimInstance->currentNode->eventQueue.front();
-
         // Compute the number of bytes to copy from the event to the buffer.
         // The BLE events can contain more data than the native BLE event
         // structure, where the data member provides that overflow space.
         constexpr std::size_t eventSize =
-                sizeof(simBleEvent.bleEvent) + sizeof(simBleEvent.bleEventOverflowData);
+                sizeof(simBleEvent::bleEvent) + sizeof(simBleEvent::bleEventOverflowData);
 
         // TODO: The actual SoftDevice checks that the event actually fits
         //       into the buffer. If you compile this check in, the simulator
@@ -1806,15 +1847,19 @@ extern "C"
         }
 
         // We store the current event so that we can access it during debugging
-        // if we want to get more information.
-        cherrySimInstance->currentNode->currentEvent = simBleEvent;
+        // if we want to get more information. The event is copied directly out
+        // of the queue, the slot in the queue is reused afterwards.
+        cherrySimInstance->currentNode->currentEvent = cherrySimInstance->currentNode->eventQueue.front();
         cherrySimInstance->currentNode->eventQueue.pop_front();
+        auto& simBleEvent = cherrySimInstance->currentNode->currentEvent;
 
         if (cherrySimInstance->simEventListener != nullptr)
         {
-            cherrySimInstance->simEventListener->CherrySimBleEventHandler(
-                    cherrySimInstance->currentNode,
-                    &simBleEvent, sizeof(simBleEvent));
+            cherrySimInstance->RunOrStage([simBleEvent]() mutable {
+                cherrySimInstance->simEventListener->CherrySimBleEventHandler(
+                        cherrySimInstance->currentNode,
+                        &simBleEvent, sizeof(simBleEvent));
+            });
         }
 
         // [SD]: Update the pointee of p_len with the used number of bytes.
@@ -1999,14 +2044,13 @@ extern "C"
         }
 
         //Always uses the more sophisticated connection simulation, rather than sending packets immediately
-        SoftDeviceBufferedPacket* buffer = nullptr;
-        buffer = findFreePacketBuffer(connection);
+        SoftDeviceBufferedPacket* buffer = connection->unreliableBuffers.Push();
 
-        if (buffer == nullptr || buffer->sender != 0) {
+        if (buffer == nullptr) {
             return NRF_ERROR_RESOURCES;
         }
 
-        buffer->globalPacketId = cherrySimInstance->simState.globalPacketIdCounter++;
+        buffer->globalPacketId = cherrySimInstance->NextGlobalPacketId();
         buffer->sender = cherrySimInstance->currentNode;
         buffer->receiver = partnerNode;
         buffer->connHandle = conn_handle;
@@ -2115,9 +2159,13 @@ const char *__asan_default_options() {
 // These calls can be made within FruityMesh using the macros (e.g. SIMSTATCOUNT)
 //#########################################################################################
 
+//Statistics are collected by all nodes and might be written from multiple threads during parallel stepping
+static std::mutex simStatMutex;
+
 std::map<std::string, int> simStatCounts;
 void sim_collect_statistic_count(const char* key)
 {
+    std::lock_guard<std::mutex> lock(simStatMutex);
     simStatCounts[key] += 1;
 }
 
@@ -2125,17 +2173,30 @@ std::map<std::string, int> simStatAvgCounts;
 std::map<std::string, int> simStatAvgTotal;
 void sim_collect_statistic_avg(const char* key, int value)
 {
+    std::lock_guard<std::mutex> lock(simStatMutex);
     simStatAvgCounts[key] += 1;
     simStatAvgTotal[key] += value;
 }
 
 void sim_clear_statistics()
 {
+    std::lock_guard<std::mutex> lock(simStatMutex);
     simStatCounts.clear();
+    simStatAvgCounts.clear();
+    simStatAvgTotal.clear();
+}
+
+void sim_get_all_statistics(std::map<std::string, int>& counts, std::map<std::string, int>& avgCounts, std::map<std::string, int>& avgTotals)
+{
+    std::lock_guard<std::mutex> lock(simStatMutex);
+    counts = simStatCounts;
+    avgCounts = simStatAvgCounts;
+    avgTotals = simStatAvgTotal;
 }
 
 void sim_print_statistics()
 {
+    std::lock_guard<std::mutex> lock(simStatMutex);
     printf("------ COUNTS --------" EOL);
     std::map<std::string, int>::iterator it;
     for (it = simStatCounts.begin(); it != simStatCounts.end(); it++) {
@@ -2155,6 +2216,7 @@ void sim_print_statistics()
 
 int sim_get_statistics(const char* key)
 {
+    std::lock_guard<std::mutex> lock(simStatMutex);
     return simStatCounts[key];
 }
 
@@ -115,7 +115,7 @@ typedef class Node Node;
 typedef class GlobalState GlobalState;
 
 //We keep a pointer to our GlobalState, this state contains the whole state of a node as known to FruityMesh
-extern GlobalState* simGlobalStatePtr;
+extern thread_local GlobalState* simGlobalStatePtr;
 #define GS (simGlobalStatePtr)
 #endif //__cplusplus
 
@@ -152,6 +152,8 @@ extern "C" {
 #define ACTIVATE_CONN_PARAM_UPDATE         1
 #define ACTIVATE_CONN_PARAM_UPDATE_LOGGING 1
 
+#define ACTIVATE_UNICAST_ROUTING 1
+
 #define ACTIVATE_DEV_SENSOR_BROADCAST_MESSAGE 1
 
 #define ACTIVATE_LOGGING 1
@@ -773,13 +775,13 @@ extern int globalBreakCounter;
 
 //We keep a number of pointers to hardware peripherals so that our FruityMesh implementation
 //does not have to include the simulator. It will access all hardware using these pointers and we can
-//therefore redirect all access
-extern NRF_FICR_Type* simFicrPtr;
-extern NRF_UICR_Type* simUicrPtr;
-extern NRF_GPIO_Type* simGpioPtr;
-extern NRF_UART_Type* simUartPtr;
-extern NRF_RADIO_Type* simRadioPtr;
-extern uint8_t* simFlashPtr;
+//therefore redirect all access. They are thread local so that different nodes can be simulated on different threads
+extern thread_local NRF_FICR_Type* simFicrPtr;
+extern thread_local NRF_UICR_Type* simUicrPtr;
+extern thread_local NRF_GPIO_Type* simGpioPtr;
+extern thread_local NRF_UART_Type* simUartPtr;
+extern thread_local NRF_RADIO_Type* simRadioPtr;
+extern thread_local uint8_t* simFlashPtr;
 #define NRF_FICR (simFicrPtr)
 #define NRF_UICR (simUicrPtr)
 #define NRF_GPIO (simGpioPtr)
@@ -896,6 +898,14 @@ extern const uint8_t s140_mbr_and_header_nrf52840_v6_1_0[0x4000];
 }
 #endif
 
+#ifdef __cplusplus
+#include <map>
+#include <string>
+
+//Copies all statistics collected with SIMSTATCOUNT and SIMSTATAVG, e.g. to aggregate them over multiple simulations
+void sim_get_all_statistics(std::map<std::string, int>& counts, std::map<std::string, int>& avgCounts, std::map<std::string, int>& avgTotals);
+#endif
+
 
 #endif
 #endif /* SYSTEMTEST_H_ */
@@ -63,16 +63,26 @@ struct AutoSenseTableEntryBuilder
 #pragma pack(push)
 #pragma pack(1)
     AutoSenseTableEntryV0 entry = { 0 };
+    u8 functionParams[4] = { 0 };
 #pragma pack(pop)
+    u8 functionParamsLength = 0;
 
     AutoSenseTableEntryBuilder() {}
 
     std::string getEntry() const
     {
         char buffer[256];
-        Logger::ConvertBufferToHexString((const u8*)&entry, sizeof(entry), buffer, sizeof(buffer));
+        Logger::ConvertBufferToHexString((const u8*)&entry, sizeof(entry) + functionParamsLength, buffer, sizeof(buffer));
         return buffer;
     }
+
+    template<typename T>
+    void setThreshold(T threshold)
+    {
+        static_assert(sizeof(threshold) <= sizeof(functionParams), "Threshold does not fit!");
+        CheckedMemcpy(functionParams, &threshold, sizeof(threshold));
+        functionParamsLength = sizeof(threshold);
+    }
 };
 
 struct AutoActTableEntryBuilder
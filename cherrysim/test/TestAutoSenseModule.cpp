@@ -0,0 +1,172 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+
+#include <HelperFunctions.h>
+#include <CherrySimTester.h>
+#include <AutoSenseModule.h>
+
+//Provides no data by itself, the tests feed the samples directly to the AutoSenseModule.
+class TestAutoSenseDataProvider : public AutoSenseModuleDataProvider
+{
+public:
+    void RequestData(u16 component, u16 register_, u8 length, AutoSenseModuleDataConsumer* provideTo) override {}
+};
+
+static void FeedSamples(u16 register_, std::initializer_list<u16> samples)
+{
+    NodeIndexSetter setter(0);
+    AutoSenseModule* asMod = (AutoSenseModule*)GS->node.GetModuleById(ModuleId::AUTO_SENSE_MODULE);
+    for (u16 sample : samples)
+    {
+        asMod->ConsumeData(ModuleId::BEACONING_MODULE, 0, register_, sizeof(sample), (const u8*)&sample);
+    }
+}
+
+static AutoSenseTableEntryBuilder CreateEntry(u16 register_, AutoSenseFunction function)
+{
+    AutoSenseTableEntryBuilder ast;
+    ast.entry.destNodeId = 1;
+    ast.entry.moduleId = Utility::GetWrappedModuleId(ModuleId::BEACONING_MODULE);
+    ast.entry.component = 0;
+    ast.entry.register_ = register_;
+    ast.entry.length = 2;
+    ast.entry.dataType = DataTypeDescriptor::U16_LE;
+    //Polling would never happen during the test, the samples are fed manually
+    ast.entry.pollingIvDs = SEC_TO_DS(3600);
+    ast.entry.reportingIvDs = SEC_TO_DS(10);
+    ast.entry.reportFunction = function;
+    return ast;
+}
+
+TEST(TestAutoSenseModule, TestAggregateFunctions) {
+    TestAutoSenseDataProvider dataProvider;
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    //testerConfig.verbose = true;
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    {
+        NodeIndexSetter setter(0);
+        AutoSenseModule* asMod = (AutoSenseModule*)GS->node.GetModuleById(ModuleId::AUTO_SENSE_MODULE);
+        asMod->RegisterDataProvider(ModuleId::BEACONING_MODULE, &dataProvider);
+    }
+
+    //Aggregates need a numeric data type
+    {
+        AutoSenseTableEntryBuilder ast = CreateEntry(100, AutoSenseFunction::AVERAGE);
+        ast.entry.dataType = DataTypeDescriptor::RAW;
+        tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 0 %s", ast.getEntry().data());
+        tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":4,"index":0})");
+    }
+
+    //AVERAGE of 10, 20 and 60 is 30
+    tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 0 %s", CreateEntry(100, AutoSenseFunction::AVERAGE).getEntry().data());
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":0,"index":0})");
+    FeedSamples(100, { 10, 20, 60 });
+    tester.SimulateUntilMessageReceived(20 * 1000, 1, R"("register":"0x0064","payload":"HgA="})");
+
+    //MEDIAN of 5, 1 and 100 is 5
+    tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 1 %s", CreateEntry(101, AutoSenseFunction::MEDIAN).getEntry().data());
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":0,"index":1})");
+    FeedSamples(101, { 5, 1, 100 });
+    tester.SimulateUntilMessageReceived(20 * 1000, 1, R"("register":"0x0065","payload":"BQA="})");
+
+    //MEDIAN only covers the last 16 samples of the window, here 1 to 16, so the first ones have no effect
+    FeedSamples(101, { 1000, 1000, 1000, 1000, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 });
+    tester.SimulateUntilMessageReceived(20 * 1000, 1, R"("register":"0x0065","payload":"CQA="})");
+
+    //SUM saturates instead of wrapping around
+    tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 2 %s", CreateEntry(102, AutoSenseFunction::SUM).getEntry().data());
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":0,"index":2})");
+    FeedSamples(102, { 60000, 60000 });
+    tester.SimulateUntilMessageReceived(20 * 1000, 1, R"("register":"0x0066","payload":"//8="})");
+
+    //MEDIAN entries are limited by the sample storage of the featureset, one of them is already used by entry 1
+    const u32 amountOfMediansThatFit = AUTO_SENSE_MEDIAN_SAMPLE_STORAGE_SIZE / (sizeof(u16) * AutoSenseModule::MAX_AMOUNT_OF_MEDIAN_SAMPLES);
+    u32 entryIndex = 3;
+    for (u32 i = 1; i < amountOfMediansThatFit; i++, entryIndex++)
+    {
+        tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 %u %s", entryIndex, CreateEntry(100 + entryIndex, AutoSenseFunction::MEDIAN).getEntry().data());
+        tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":0,"index":%u})", entryIndex);
+    }
+    tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 %u %s", entryIndex, CreateEntry(100 + entryIndex, AutoSenseFunction::MEDIAN).getEntry().data());
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":6,"index":%u})", entryIndex);
+}
+
+TEST(TestAutoSenseModule, TestThreshold) {
+    TestAutoSenseDataProvider dataProvider;
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    //testerConfig.verbose = true;
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    {
+        NodeIndexSetter setter(0);
+        AutoSenseModule* asMod = (AutoSenseModule*)GS->node.GetModuleById(ModuleId::AUTO_SENSE_MODULE);
+        asMod->RegisterDataProvider(ModuleId::BEACONING_MODULE, &dataProvider);
+    }
+
+    //The threshold is mandatory
+    AutoSenseTableEntryBuilder ast = CreateEntry(100, AutoSenseFunction::THRESHOLD);
+    tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 0 %s", ast.getEntry().data());
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":3,"index":0})");
+
+    ast.setThreshold<u16>(50);
+    tester.SendTerminalCommand(1, "action this autosense set_autosense_entry 0 0 %s", ast.getEntry().data());
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"type":"set_autosense_entry_result","nodeId":1,"requestHandle":0,"module":15,"code":0,"index":0})");
+
+    //Values below the threshold are not sent, neither immediately nor periodically, also not the first one
+    FeedSamples(100, { 10 });
+    {
+        Exceptions::ExceptionDisabler<TimeoutException> te;
+        tester.SimulateUntilMessageReceived(20 * 1000, 1, R"("register":"0x0064","payload":"CgA="})");
+        ASSERT_TRUE(tester.sim->CheckExceptionWasThrown(typeid(TimeoutException)));
+    }
+    FeedSamples(100, { 20 });
+    {
+        Exceptions::ExceptionDisabler<TimeoutException> te;
+        tester.SimulateUntilMessageReceived(20 * 1000, 1, R"("register":"0x0064","payload":"FAA="})");
+        ASSERT_TRUE(tester.sim->CheckExceptionWasThrown(typeid(TimeoutException)));
+    }
+
+    //Crossing the threshold is sent immediately and repeated while the value stays above the threshold
+    FeedSamples(100, { 60 });
+    tester.SimulateUntilMessageReceived(1 * 1000, 1, R"("register":"0x0064","payload":"PAA="})");
+    tester.SimulateUntilMessageReceived(20 * 1000, 1, R"("register":"0x0064","payload":"PAA="})");
+
+    //Falling below the threshold is sent immediately as well
+    FeedSamples(100, { 40 });
+    tester.SimulateUntilMessageReceived(1 * 1000, 1, R"("register":"0x0064","payload":"KAA="})");
+}
@@ -225,3 +225,117 @@ TEST(TestChunkedPacketQueue, TestSimpleAllocations)
         }
     }
 }
+
+TEST(TestChunkedPacketQueue, TestInPlaceLookAheadAndPrefixedAdd)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+    simConfig.SetToPerfectConditions();
+    //testerConfig.verbose = true;
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    NodeIndexSetter setter(0);
+    MeshConnections connections = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+
+    ASSERT_EQ(connections.count, 1);
+
+    // Same as in TestSimpleAllocations, we only care about the ChunkedPacketQueue and won't simulate another step.
+    MeshConnection* conn = connections.handles[0].GetConnection();
+
+    ChunkedPacketQueue& queue = *conn->queue.GetQueueByPriority(DeliveryPriority::HIGH);
+    queue.SimReset();
+
+    std::array<u8, 1024> arr;
+    for (size_t i = 0; i < arr.size(); i++)
+    {
+        arr[i] = i;
+    }
+
+    // Messages that are added with a separate prefix must be the same as if they were added in one piece
+    // and the in place look ahead must return the same data as the copying one, as long as it is not split across chunks.
+    MersenneTwister mt(1);
+    u32 amountOfInPlacePeeks = 0;
+    for (u32 repeat = 0; repeat < 1000; repeat++)
+    {
+        const u16 size = mt.NextU32() % MAX_MESH_PACKET_SIZE + 1;
+        const u16 prefixSize = mt.NextU32() % (size + 1);
+        const u16 offset = mt.NextU32() % 100;
+        u32 messageHandle;
+        ASSERT_TRUE(queue.AddMessage(arr.data() + offset, prefixSize, arr.data() + offset + prefixSize, size - prefixSize, &messageHandle, false));
+
+        u8 peekBuffer[1024];
+        ASSERT_EQ(size, queue.PeekLookAhead(peekBuffer, sizeof(peekBuffer)));
+        ASSERT_EQ(0, memcmp(peekBuffer, arr.data() + offset, size));
+
+        const SizedData inPlace = queue.PeekLookAheadInPlace();
+        if (inPlace.data != nullptr)
+        {
+            amountOfInPlacePeeks++;
+            ASSERT_EQ(size, inPlace.length.GetRaw());
+            ASSERT_EQ(0, memcmp(inPlace.data, arr.data() + offset, size));
+        }
+        queue.IncrementLookAhead();
+        queue.PopPacket();
+        ASSERT_FALSE(queue.HasPackets());
+    }
+    ASSERT_GT(amountOfInPlacePeeks, 0u);
+
+    // Splitting must put the send data and a split header in front of each part of the payload, no matter
+    // if the send data is passed in front of the payload or separately.
+    const u16 payloadSizePerSplit = 20;
+    const u16 dataSizePerSplit = payloadSizePerSplit - SIZEOF_CONN_PACKET_SPLIT_HEADER;
+    const u8* separateSendData = arr.data() + 512;
+    for (u16 size = SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + 1; size < MAX_MESH_PACKET_SIZE; size++)
+    {
+        const u16 dataSize = size - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
+        const u8* data = arr.data() + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
+        for (int separate = 0; separate < 2; separate++)
+        {
+            const u8* sendData = separate ? separateSendData : arr.data();
+            u32 messageHandle;
+            if (separate)
+            {
+                ASSERT_TRUE(queue.SplitAndAddMessage(sendData, data, dataSize, payloadSizePerSplit, &messageHandle));
+            }
+            else
+            {
+                ASSERT_TRUE(queue.SplitAndAddMessage(arr.data(), size, payloadSizePerSplit, &messageHandle));
+            }
+
+            u8 peekBuffer[1024];
+            if (dataSize <= payloadSizePerSplit)
+            {
+                // Fits into a single packet, so it is queued unsplit.
+                ASSERT_EQ(queue.GetAmountOfPackets(), 1u);
+                ASSERT_EQ(queue.PeekPacket(peekBuffer, sizeof(peekBuffer)), size);
+                ASSERT_EQ(0, memcmp(peekBuffer, sendData, SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED));
+                ASSERT_EQ(0, memcmp(peekBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, data, dataSize));
+                queue.PopPacket();
+                ASSERT_FALSE(queue.HasPackets());
+                continue;
+            }
+
+            const u32 amountOfSplits = (dataSize + dataSizePerSplit - 1) / dataSizePerSplit;
+            ASSERT_EQ(queue.GetAmountOfPackets(), amountOfSplits);
+            for (u32 i = 0; i < amountOfSplits; i++)
+            {
+                const bool isLast = i == amountOfSplits - 1;
+                const u16 splitDataSize = isLast ? dataSize - dataSizePerSplit * i : dataSizePerSplit;
+                ASSERT_EQ(queue.PeekPacket(peekBuffer, sizeof(peekBuffer)), SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + SIZEOF_CONN_PACKET_SPLIT_HEADER + splitDataSize);
+                ASSERT_EQ(0, memcmp(peekBuffer, sendData, SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED));
+                const ConnPacketSplitHeader* splitHeader = (const ConnPacketSplitHeader*)(peekBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
+                ASSERT_EQ(splitHeader->splitMessageType, isLast ? MessageType::SPLIT_WRITE_CMD_END : MessageType::SPLIT_WRITE_CMD);
+                ASSERT_EQ(splitHeader->splitCounter, i);
+                ASSERT_EQ(0, memcmp(peekBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + SIZEOF_CONN_PACKET_SPLIT_HEADER, data + dataSizePerSplit * i, splitDataSize));
+                queue.PopPacket();
+            }
+            ASSERT_FALSE(queue.HasPackets());
+        }
+    }
+}
@@ -113,6 +113,30 @@ TEST_P(MultiStackFixture, TestBasicClustering) {
     printf("Average clustering time %d seconds" EOL, clusteringTimeTotalMs / clusteringIterations / 1000);
 }
 
+TEST(TestClustering, TestParallelSteppingIsDeterministic) {
+    //Tests that the parallel stepping clusters the nodes and gives the same result for a seed regardless of the thread count.
+    std::vector<u32> clusteringTimesMs;
+    std::vector<u32> globalEventIds;
+
+    for (u32 threads : { 2u, 4u }) {
+        CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+        SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        simConfig.seed = 7;
+        simConfig.parallelStepThreads = threads;
+        simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 10 });
+        simConfig.terminalId = -1;
+
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+        tester.SimulateUntilClusteringDone(1000 * 1000);
+        clusteringTimesMs.push_back(tester.sim->simState.simTimeMs);
+        globalEventIds.push_back(tester.sim->simState.globalEventIdCounter);
+    }
+
+    ASSERT_EQ(clusteringTimesMs[0], clusteringTimesMs[1]);
+    ASSERT_EQ(globalEventIds[0], globalEventIds[1]);
+}
+
 #if defined(PROD_SINK_NRF52) && defined(PROD_MESH_NRF52)
 //Tests that the exemplary devices.json and site.json for the github release still work
 TEST_P(MultiStackFixture, TestGithubExample) {
@@ -169,6 +193,71 @@ TEST_P(MultiStackFixture, TestSinglePointFailureNetwork) {
     constexpr u32 maxRecordedClusteringMedianMs = 48500; //The maximum median recorded over 1000 different seed offsets
     DoClusteringTestImportedFromJson(site, device, 5, 1000 * 1000, maxRecordedClusteringMedianMs * 2, GetParam());
 }
+
+TEST(TestClustering, TestPreclusteredRowNetwork) {
+    //Tests that preclustering connects the nodes along the row, which is the only possible spanning tree.
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.importFromJson = true;
+    simConfig.siteJsonPath = CherrySimUtils::GetNormalizedPath() + "/test/res/rownetwork/site.json";
+    simConfig.devicesJsonPath = CherrySimUtils::GetNormalizedPath() + "/test/res/rownetwork/devices.json";
+    simConfig.preclusterNodes = true;
+    simConfig.terminalId = -1;
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    //The mesh must be ready much faster than the recorded clustering median of the row network
+    ASSERT_TRUE(tester.sim->IsClusteringDone());
+    ASSERT_LT(tester.sim->simState.simTimeMs, 20 * 1000u);
+
+    //The mesh must stay clustered afterwards
+    tester.SimulateForGivenTime(10 * 1000);
+    ASSERT_TRUE(tester.sim->IsClusteringDone());
+}
+
+TEST(TestClustering, TestClusteringDoneFollowsNodeResets) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.enableClusteringValidityCheck = true;
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 9 });
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //The reset node is noticed as soon as it is no longer selected, without simulating another step
+    {
+        NodeIndexSetter setter(3);
+        tester.sim->ResetCurrentNode(RebootReason::UNKNOWN, false);
+    }
+    ASSERT_FALSE(tester.sim->IsClusteringDone());
+
+    //Runs past at least one audit of the clustering tracker
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    tester.SimulateGivenNumberOfSteps(CherrySim::clusteringAuditInterval);
+    ASSERT_TRUE(tester.sim->IsClusteringDone());
+}
+
+TEST(TestClustering, TestBuildMeshFromSpanningTreeWithCycle) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 2 });
+    simConfig.terminalId = -1;
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    //Neither node 1 nor node 2 is connected to the root of the tree
+    {
+        Exceptions::ExceptionDisabler<IllegalArgumentException> iae;
+        tester.sim->BuildMeshFromSpanningTree({ { 1, 2 }, { 2, 1 } }, 10 * 1000);
+        ASSERT_TRUE(tester.sim->CheckExceptionWasThrown(typeid(IllegalArgumentException)));
+    }
+}
 #endif
 
 TEST(TestClustering, TestClusteringWithManySdBusy) {
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+
+#include "ClusteringTracker.h"
+
+static NodeClusteringState GetTestState(ClusterId clusterId, ClusterSize clusterSize, NetworkId networkId = 1)
+{
+    NodeClusteringState state;
+    state.clusterId = clusterId;
+    state.clusterSize = clusterSize;
+    state.networkId = networkId;
+    return state;
+}
+
+TEST(TestClusteringTracker, TestClusteringIsDoneWithOneFullCluster) {
+    ClusteringTracker tracker;
+    tracker.Reset(3);
+    ASSERT_FALSE(tracker.IsClusteringDone());
+
+    ASSERT_TRUE(tracker.Update(0, GetTestState(10, 1)));
+    ASSERT_TRUE(tracker.Update(1, GetTestState(20, 1)));
+    ASSERT_TRUE(tracker.Update(2, GetTestState(30, 1)));
+    ASSERT_FALSE(tracker.IsClusteringDone());
+    ASSERT_EQ(tracker.GetNumClusters(), 3u);
+
+    //Unchanged states are not reported as changes
+    ASSERT_FALSE(tracker.Update(2, GetTestState(30, 1)));
+
+    tracker.Update(1, GetTestState(10, 2));
+    tracker.Update(0, GetTestState(10, 2));
+    ASSERT_EQ(tracker.GetNumClusters(), 2u);
+    ASSERT_FALSE(tracker.IsClusteringDone());
+
+    //All nodes share the clusterId, but the cluster size has not yet been propagated to all of them
+    tracker.Update(2, GetTestState(10, 3));
+    tracker.Update(1, GetTestState(10, 3));
+    ASSERT_EQ(tracker.GetNumClusters(), 1u);
+    ASSERT_FALSE(tracker.IsClusteringDone());
+
+    tracker.Update(0, GetTestState(10, 3));
+    ASSERT_TRUE(tracker.IsClusteringDone());
+
+    //A node that leaves the cluster is noticed right away
+    tracker.Update(1, GetTestState(40, 1));
+    ASSERT_FALSE(tracker.IsClusteringDone());
+    ASSERT_EQ(tracker.GetNumClusters(), 2u);
+}
+
+TEST(TestClusteringTracker, TestClustersAreCountedPerNetworkId) {
+    ClusteringTracker tracker;
+    tracker.Reset(4);
+    tracker.Update(0, GetTestState(10, 2, 1));
+    tracker.Update(1, GetTestState(10, 2, 1));
+    tracker.Update(2, GetTestState(20, 1, 2));
+    tracker.Update(3, GetTestState(30, 1, 2));
+    ASSERT_EQ(tracker.GetNumNetworkIds(), 2u);
+    ASSERT_EQ(tracker.GetNumClusters(), 3u);
+
+    tracker.Update(3, GetTestState(20, 2, 2));
+    tracker.Update(2, GetTestState(20, 2, 2));
+    ASSERT_EQ(tracker.GetNumNetworkIds(), 2u);
+    ASSERT_EQ(tracker.GetNumClusters(), 2u);
+
+    //The same clusterId in different networks counts as different clusters
+    tracker.Update(3, GetTestState(10, 1, 2));
+    ASSERT_EQ(tracker.GetNumClusters(), 3u);
+
+    //Resetting forgets all previous states
+    tracker.Reset(2);
+    ASSERT_EQ(tracker.GetNodeCount(), 2u);
+    ASSERT_EQ(tracker.GetNumClusters(), 1u);
+    ASSERT_FALSE(tracker.IsClusteringDone());
+}
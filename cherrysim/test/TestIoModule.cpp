@@ -365,4 +365,51 @@ TEST(TestIoModule, TestRegisterInToOutLink)
     tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"nodeId":1,"type":"component_sense","module":6,"requestHandle":0,"actionType":2,"component":"0x0000","register":"0x4E20","payload":"AQ=="})");
 }
 
+//Checks that AutoAct only acts on component_sense messages that match all filters of an entry
+TEST(TestIoModule, TestAutoActOnlyActsOnMatchingMessages)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    //testerConfig.verbose = true;
+
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52840_sdk17", 1 });
+    simConfig.SetToPerfectConditions();
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+
+    tester.Start();
+
+    //Configure AutoAct to relay register 0x1234 of component 7 into the first output register
+    AutoActTableEntryBuilder aat;
+    aat.entry.receiverNodeIdFilter = 0;
+    aat.entry.moduleIdFilter = Utility::GetWrappedModuleId(ModuleId::IO_MODULE);
+    aat.entry.componentFilter = 7;
+    aat.entry.registerFilter = 0x1234;
+    aat.entry.targetModuleId = Utility::GetWrappedModuleId(ModuleId::IO_MODULE);
+    aat.entry.targetComponent = 0;
+    aat.entry.targetRegister = IoModule::REGISTER_DIO_OUTPUT_STATE_START;
+    aat.entry.orgDataType = DataTypeDescriptor::U8_LE;
+    aat.entry.targetDataType = DataTypeDescriptor::U8_LE;
+    aat.entry.flags = 0;
+    aat.addFunctionNoop();
+
+    tester.SendTerminalCommand(1, "action this autoact set_autoact_entry 0 0 %s", aat.getEntry().data());
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, "set_autoact_entry_result");
+
+    //Messages that differ from the entry in the register, the component, the module or the receiver must be ignored
+    tester.SendTerminalCommand(1, "component_sense 0 6 0 7 0x1235 AQ==");
+    tester.SendTerminalCommand(1, "component_sense 0 6 0 8 0x1234 AQ==");
+    tester.SendTerminalCommand(1, "component_sense 0 3 0 7 0x1234 AQ==");
+    tester.SendTerminalCommand(1, "component_sense this 6 0 7 0x1234 AQ==");
+    tester.SimulateForGivenTime(1 * 1000);
+    tester.SendTerminalCommand(1, "component_act this 6 read 0 20000 01");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"nodeId":1,"type":"component_sense","module":6,"requestHandle":0,"actionType":2,"component":"0x0000","register":"0x4E20","payload":"AA=="})");
+
+    //A matching message sets the output
+    tester.SendTerminalCommand(1, "component_sense 0 6 0 7 0x1234 AQ==");
+    tester.SimulateForGivenTime(1 * 1000);
+    tester.SendTerminalCommand(1, "component_act this 6 read 0 20000 01");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, R"({"nodeId":1,"type":"component_sense","module":6,"requestHandle":0,"actionType":2,"component":"0x0000","register":"0x4E20","payload":"AQ=="})");
+}
+
 #endif //defined(PROD_MESH_NRF52840_SDK17)
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+
+#include "LinkBudgetCache.h"
+
+static LinkBudgetModelInputs GetTestModelInputs()
+{
+    LinkBudgetModelInputs modelInputs;
+    modelInputs.propagationConstant = 2.0f;
+    modelInputs.mapWidthInMeters = 100;
+    modelInputs.mapHeightInMeters = 100;
+    return modelInputs;
+}
+
+TEST(TestLinkBudgetCache, TestEntriesAreStoredPerPairAndTxPower) {
+    LinkBudgetCache cache;
+    cache.Reset(4, GetTestModelInputs());
+
+    float rssi = 0;
+    ASSERT_FALSE(cache.Get(0, 1, 4, rssi));
+
+    cache.Put(0, 1, 4, -70.5f);
+    ASSERT_TRUE(cache.Get(0, 1, 4, rssi));
+    ASSERT_EQ(rssi, -70.5f);
+
+    //The link budget is not symmetric, as the nodes can have different tx powers
+    ASSERT_FALSE(cache.Get(1, 0, 4, rssi));
+    ASSERT_FALSE(cache.Get(0, 2, 4, rssi));
+    ASSERT_FALSE(cache.Get(0, 1, 0, rssi));
+
+    cache.Put(0, 1, 0, -74.5f);
+    ASSERT_TRUE(cache.Get(0, 1, 0, rssi));
+    ASSERT_EQ(rssi, -74.5f);
+    ASSERT_FALSE(cache.Get(0, 1, 4, rssi));
+}
+
+TEST(TestLinkBudgetCache, TestMovedNodesInvalidateTheirEntries) {
+    LinkBudgetCache cache;
+    cache.Reset(3, GetTestModelInputs());
+
+    LinkBudgetNodeInputs inputs;
+    inputs.x = 0.5f;
+    inputs.y = 0.5f;
+    cache.Update(0, inputs);
+    cache.Update(1, inputs);
+    cache.Update(2, inputs);
+    cache.Put(0, 1, 0, -60.0f);
+    cache.Put(0, 2, 0, -61.0f);
+    cache.Put(1, 2, 0, -62.0f);
+
+    //Unchanged inputs keep the entries
+    cache.Update(1, inputs);
+    float rssi = 0;
+    ASSERT_TRUE(cache.Get(0, 1, 0, rssi));
+
+    //Moving a node invalidates the entries where it is the sender or the receiver
+    inputs.x = 0.6f;
+    cache.Update(1, inputs);
+    ASSERT_FALSE(cache.Get(0, 1, 0, rssi));
+    ASSERT_FALSE(cache.Get(1, 2, 0, rssi));
+    ASSERT_TRUE(cache.Get(0, 2, 0, rssi));
+    ASSERT_EQ(rssi, -61.0f);
+
+    cache.Invalidate(2);
+    ASSERT_FALSE(cache.Get(0, 2, 0, rssi));
+
+    cache.Put(0, 1, 0, -63.0f);
+    ASSERT_TRUE(cache.Get(0, 1, 0, rssi));
+    ASSERT_EQ(rssi, -63.0f);
+}
+
+TEST(TestLinkBudgetCache, TestOutdatedEntriesAreDropped) {
+    //Tests that the tables of the senders only grow with the number of valid entries
+    constexpr u32 nodeCount = 2000;
+    LinkBudgetCache cache;
+    cache.Reset(nodeCount, GetTestModelInputs());
+    ASSERT_TRUE(cache.IsConfiguredFor(nodeCount, GetTestModelInputs()));
+    ASSERT_FALSE(cache.IsConfiguredFor(nodeCount + 1, GetTestModelInputs()));
+
+    for (u32 i = 1; i < nodeCount; i++)
+    {
+        cache.Put(0, i, 0, -(float)i);
+    }
+    for (u32 i = 1; i < nodeCount; i++)
+    {
+        float rssi = 0;
+        ASSERT_TRUE(cache.Get(0, i, 0, rssi));
+        ASSERT_EQ(rssi, -(float)i);
+    }
+    ASSERT_TRUE(cache.tableOfSender[0].size() >= 2 * (nodeCount - 1));
+
+    //A sender that passes by all other nodes only ever has a few of them in range at the same time
+    constexpr u32 nodesInRange = 10;
+    for (u32 i = 2; i < nodeCount; i++)
+    {
+        cache.Put(1, i, 0, -(float)i);
+        if (i >= 2 + nodesInRange) cache.Invalidate(i - nodesInRange);
+    }
+    ASSERT_TRUE(cache.tableOfSender[1].size() <= 64);
+}
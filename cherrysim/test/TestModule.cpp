@@ -275,6 +275,40 @@ TEST(TestModule, TestGetModuleList) {
         "]}");
 }
 
+//Makes sure that events are only dispatched to the modules that subscribed to them
+TEST(TestModule, TestEventSubscriberTables) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    //testerConfig.verbose = true;
+    simConfig.nodeConfigName.insert({ "github_dev_nrf52", 1 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    NodeIndexSetter setter(0);
+    for (u32 event = 0; event < (u32)ModuleEvent::AMOUNT_OF_EVENTS; event++)
+    {
+        u32 expectedSubscribers = 0;
+        for (u32 i = 0; i < GS->amountOfModules; i++)
+        {
+            if (GS->activeModules[i]->subscribedEvents & ModuleEventMask((ModuleEvent)event)) expectedSubscribers++;
+        }
+        ASSERT_EQ(GS->GetAmountOfEventSubscribers((ModuleEvent)event), expectedSubscribers);
+        for (u32 i = 0; i < GS->GetAmountOfEventSubscribers((ModuleEvent)event); i++)
+        {
+            ASSERT_TRUE(GS->GetEventSubscriber((ModuleEvent)event, i)->subscribedEvents & ModuleEventMask((ModuleEvent)event));
+        }
+    }
+
+    //The node handles timer events, but no button presses
+    ASSERT_EQ(GS->GetEventSubscriber(ModuleEvent::TIMER, 0), &GS->node);
+    for (u32 i = 0; i < GS->GetAmountOfEventSubscribers(ModuleEvent::BUTTON); i++)
+    {
+        ASSERT_NE(GS->GetEventSubscriber(ModuleEvent::BUTTON, i), &GS->node);
+    }
+    //No module implements the GattDataTransmittedEventHandler
+    ASSERT_EQ(GS->GetAmountOfEventSubscribers(ModuleEvent::GATT_DATA_TRANSMITTED), 0u);
+}
+
 TEST(TestModule, TestConfigRemovalDuringUnenrollment) {
     CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
     SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
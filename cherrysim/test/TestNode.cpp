@@ -976,6 +976,92 @@ TEST(TestNode, TestCapabilitySending) {
     tester.SimulateUntilRegexMessagesReceived(100 * 1000, msgs);
 }
 
+//Tests that nodes learn through which connection another node can be reached and forget it once the cluster changes
+TEST(TestNode, TestUnicastRoutesAreLearned) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    //testerConfig.verbose = true;
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 9});
+    simConfig.SetToPerfectConditions();
+    simConfig.enableSimStatistics = true;
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //Counts how often the ping request with the given requestHandle was queued for sending by all nodes
+    auto countPingRequestsSent = [&](u8 requestHandle) {
+        u32 count = 0;
+        for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+        {
+            for (const PacketStat& stat : tester.sim->nodes[i].routedPackets)
+            {
+                if (stat.messageType == MessageType::MODULE_TRIGGER_ACTION
+                    && stat.moduleId == Utility::GetWrappedModuleId(ModuleId::NODE)
+                    && stat.requestHandle == requestHandle)
+                {
+                    count += stat.count;
+                }
+            }
+        }
+        return count;
+    };
+
+    //Unicast routing is opt-in, so without the featureset enabling it, nothing is learned
+    tester.SendTerminalCommand(1, "action 10 node ping 3");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"ping\",\"nodeId\":10,\"module\":0,\"requestHandle\":3}");
+    {
+        NodeIndexSetter setter(0);
+        ASSERT_FALSE(GS->cm.GetUnicastRoute(10).IsValid());
+    }
+    for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+    {
+        tester.sim->nodes[i].gs.config.enableUnicastRouting = true;
+    }
+
+    //The ping response of node 10 teaches all nodes on the way back the route to node 10
+    tester.SendTerminalCommand(1, "action 10 node ping");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"ping\",\"nodeId\":10,\"module\":0,\"requestHandle\":0}");
+    {
+        NodeIndexSetter setter(0);
+        MeshConnectionHandle route = GS->cm.GetUnicastRoute(10);
+        ASSERT_TRUE(route.IsValid());
+        ASSERT_TRUE(route.IsHandshakeDone());
+    }
+
+    //Follow the learned route from the sink to node 10
+    u32 routeHops = 0;
+    for (NodeEntry* node = &tester.sim->nodes[0]; node->GetNodeId() != 10; routeHops++)
+    {
+        NodeIndexSetter setter(node->index);
+        MeshConnectionHandle route = GS->cm.GetUnicastRoute(10);
+        ASSERT_TRUE(route.IsValid());
+        ASSERT_LT(routeHops, tester.sim->GetTotalNodes());
+        node = tester.sim->FindUniqueNodeById(route.GetPartnerId());
+        ASSERT_NE(node, nullptr);
+    }
+
+    //Directed packets must still reach the node through the learned route
+    tester.SendTerminalCommand(1, "action 10 node ping 1");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"ping\",\"nodeId\":10,\"module\":0,\"requestHandle\":1}");
+
+    //Without routes, the request was flooded into all branches of the mesh. With the learned route it is
+    //only sent once per hop, so no node in a different branch receives or relays it.
+    ASSERT_EQ(countPingRequestsSent(1), routeHops);
+    ASSERT_GT(countPingRequestsSent(3), routeHops);
+
+    //Once the cluster changes, the routes are forgotten
+    tester.SendTerminalCommand(1, "disconnect all");
+    tester.SimulateForGivenTime(1 * 1000);
+    {
+        NodeIndexSetter setter(0);
+        ASSERT_FALSE(GS->cm.GetUnicastRoute(10).IsValid());
+    }
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    tester.SendTerminalCommand(1, "action 10 node ping 2");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"ping\",\"nodeId\":10,\"module\":0,\"requestHandle\":2}");
+}
+
 TEST(TestNode, TestRapidDisconnections) {
     CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
     SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
@@ -35,6 +35,7 @@
 #include <Logger.h>
 #include <Utility.h>
 #include <string>
+#include <set>
 #include "ConnectionAllocator.h"
 #include "StatusReporterModule.h"
 #include "CherrySimUtils.h"
@@ -44,6 +45,10 @@
 #include "DebugModule.h"
 #include "PathLossModel.h"
 
+#if defined(SIM_SERVER_PRESENT)
+#include <event2/buffer.h>
+#endif
+
 extern "C"{
 #include <ccm_soft.h>
 }
@@ -363,6 +368,10 @@ TEST(TestOther, TestJsonConfigSerialization)
     new (&simConfig->replayPath) std::string;
     simConfig->replayPath = "path";
     simConfig->logReplayCommands = true;
+    new (&simConfig->replayJournalPath) std::string;
+    simConfig->replayJournalPath = "journal";
+    new (&simConfig->pcapPath) std::string;
+    simConfig->pcapPath = "capture.pcapng";
     simConfig->useLogAccumulator = true;
     simConfig->defaultNetworkId = 19;
     new (&simConfig->preDefinedPositions)std::vector<std::pair<double, double>>;
@@ -383,6 +392,15 @@ TEST(TestOther, TestJsonConfigSerialization)
     simConfig->perfectReceptionProbabilityForConnection = true;
     simConfig->verboseCommands = true;
     simConfig->simulateAdvertisingIndexStep = 32;
+    simConfig->batchAdvertisingReception = true;
+    simConfig->skipIdleSimulationSteps = true;
+    simConfig->preclusterNodes = true;
+    simConfig->cloneBootedNodes = true;
+    simConfig->simulateConnectionEvents = true;
+    simConfig->connectionEventLengthUs = 7500;
+    simConfig->connectionPhyMbps = 2;
+    simConfig->connectionMaxTxOctets = 123;
+    simConfig->connectionMaxPacketsPerEvent = 4;
 
     simConfig->disableNonCriticalExceptions = true;
     new (&simConfig->floorplanImage) std::string;
@@ -439,6 +457,8 @@ TEST(TestOther, TestJsonConfigSerialization)
     ASSERT_EQ(copy.devicesJsonPath, "bbb");
     ASSERT_EQ(copy.replayPath, "path");
     ASSERT_EQ(copy.logReplayCommands, true);
+    ASSERT_EQ(copy.replayJournalPath, "journal");
+    ASSERT_EQ(copy.pcapPath, "capture.pcapng");
     ASSERT_EQ(copy.useLogAccumulator, true);
     ASSERT_EQ(copy.defaultNetworkId, 19);
     ASSERT_EQ(copy.preDefinedPositions.size(), 3);
@@ -464,6 +484,15 @@ TEST(TestOther, TestJsonConfigSerialization)
     ASSERT_EQ(copy.perfectReceptionProbabilityForConnection, true);
     ASSERT_EQ(copy.verboseCommands, true);
     ASSERT_EQ(copy.simulateAdvertisingIndexStep, 32);
+    ASSERT_EQ(copy.batchAdvertisingReception, true);
+    ASSERT_EQ(copy.skipIdleSimulationSteps, true);
+    ASSERT_EQ(copy.preclusterNodes, true);
+    ASSERT_EQ(copy.cloneBootedNodes, true);
+    ASSERT_EQ(copy.simulateConnectionEvents, true);
+    ASSERT_EQ(copy.connectionEventLengthUs, 7500);
+    ASSERT_EQ(copy.connectionPhyMbps, 2);
+    ASSERT_EQ(copy.connectionMaxTxOctets, 123);
+    ASSERT_EQ(copy.connectionMaxPacketsPerEvent, 4);
 
 
     ASSERT_EQ(copy.disableNonCriticalExceptions, true);
@@ -477,6 +506,8 @@ TEST(TestOther, TestJsonConfigSerialization)
     simConfig->preDefinedPositions.~vector();
     simConfig->devicesJsonPath.~basic_string();
     simConfig->replayPath.~basic_string();
+    simConfig->replayJournalPath.~basic_string();
+    simConfig->pcapPath.~basic_string();
     simConfig->siteJsonPath.~basic_string();
     simConfig->floorplanImage.~basic_string();
 }
@@ -561,6 +592,98 @@ TEST(TestOther, TestReplay)
     ASSERT_TRUE(logAccumulatorReplay.find("[!]COMMAND EXECUTION START:[!]index:0,time:32350,cmd:action 0 enroll basic BBBBG 5 118 ED:24:56:91:4E:48:C1:E1:7B:7B:D9:22:17:AE:59:EF FE:47:59:4D:FA:06:61:49:52:28:FD:5B:84:CA:DB:F5 43:BF:7F:7C:7B:AB:B2:C8:C5:3B:22:EB:F3:49:3B:01 05:00:00:00:05:00:00:00:05:00:00:00:05:00:00:00 5 0 CRC: 2568303097[!]COMMAND EXECUTION END[!]") != std::string::npos);
     ASSERT_TRUE(logAccumulatorReplay.find("[!]COMMAND EXECUTION START:[!]index:0,time:42350,cmd:action 0 enroll basic BBBBG 5 118 ED:24:56:91:4E:48:C1:E1:7B:7B:D9:22:17:AE:59:EF FE:47:59:4D:FA:06:61:49:52:28:FD:5B:84:CA:DB:F5 43:BF:7F:7C:7B:AB:B2:C8:C5:3B:22:EB:F3:49:3B:01 05:00:00:00:05:00:00:00:05:00:00:00:05:00:00:00 5 0 CRC: 2568303097[!]COMMAND EXECUTION END[!]") != std::string::npos);
 }
+
+TEST(TestOther, TestReplayJournal)
+{
+    const std::string journalPath = "TestReplayJournal.bin";
+    const std::string uartCommand = "get_plugged_in\r";
+    constexpr u32 totalTimeMs = 1000 + 1234 + 500 + 5000;
+
+    //The logs contain pointers that differ between runs, so instead of comparing them, the sim times at which
+    //the output of the recorded commands appears are compared
+    const std::vector<std::string> outputsToTime = {
+        "Node BBBBJ (nodeId: 7)",                    //Output of the terminal command
+        "{\"type\":\"plugged_in\",\"nodeId\":1,",  //Output of the UART input
+    };
+    struct OutputTimes
+    {
+        std::vector<size_t> searchOffsets;
+        std::vector<std::vector<u32>> timesMs;
+    };
+    auto simulateAndTimeOutputs = [&](CherrySimTester& tester, u32 untilTimeMs, OutputTimes& outputTimes) {
+        outputTimes.searchOffsets.resize(outputsToTime.size(), 0);
+        outputTimes.timesMs.resize(outputsToTime.size());
+        while (tester.sim->simState.simTimeMs < untilTimeMs)
+        {
+            tester.sim->SimulateStepForAllNodes();
+            for (size_t i = 0; i < outputsToTime.size(); i++)
+            {
+                size_t position = 0;
+                while ((position = tester.sim->logAccumulator.find(outputsToTime[i], outputTimes.searchOffsets[i])) != std::string::npos)
+                {
+                    outputTimes.timesMs[i].push_back(tester.sim->simState.simTimeMs);
+                    outputTimes.searchOffsets[i] = position + outputsToTime[i].size();
+                }
+            }
+        }
+    };
+
+    OutputTimes recordingOutputTimes;
+    OutputTimes replayOutputTimes;
+
+    {
+        SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        simConfig.nodeConfigName.insert({ "prod_sink_nrf52",1 });
+        simConfig.nodeConfigName.insert({ "prod_mesh_nrf52",9 });
+        simConfig.replayJournalPath = journalPath;
+        simConfig.useLogAccumulator = true;
+        CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+
+        simulateAndTimeOutputs(tester, 1000, recordingOutputTimes);
+        tester.SendTerminalCommand(1, "action 0 status get_status");
+        simulateAndTimeOutputs(tester, 1000 + 1234, recordingOutputTimes);
+        tester.SendTerminalCommand(7, "status");
+        simulateAndTimeOutputs(tester, 1000 + 1234 + 500, recordingOutputTimes);
+        CherrySim::SendUartCommand(1, (const u8*)uartCommand.c_str(), uartCommand.size());
+        simulateAndTimeOutputs(tester, totalTimeMs, recordingOutputTimes);
+    }
+
+    const std::vector<ReplayJournalRecord> records = ReplayJournal::Read(CherrySim::LoadFileContents(journalPath.c_str()));
+    ASSERT_EQ(records[0].type, ReplayJournalRecordType::CONFIGURATION);
+    const auto statusRecord = std::find_if(records.begin(), records.end(), [](const ReplayJournalRecord& record) {
+        return record.type == ReplayJournalRecordType::TERMINAL_COMMAND && record.data == "status";
+    });
+    ASSERT_TRUE(statusRecord != records.end());
+    ASSERT_EQ(statusRecord->nodeIndex, 6u);
+    ASSERT_EQ(statusRecord->timeMs, 2250u);
+    const auto uartRecord = std::find_if(records.begin(), records.end(), [](const ReplayJournalRecord& record) {
+        return record.type == ReplayJournalRecordType::UART_INPUT;
+    });
+    ASSERT_TRUE(uartRecord != records.end());
+    ASSERT_EQ(uartRecord->nodeIndex, 0u);
+    ASSERT_EQ(uartRecord->timeMs, 2750u);
+    ASSERT_EQ(uartRecord->data, uartCommand);
+
+    {
+        CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+        SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        simConfig.replayPath = journalPath;
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+
+        simulateAndTimeOutputs(tester, totalTimeMs, replayOutputTimes);
+    }
+
+    //Both commands had an effect and the replay produced all output at exactly the same sim times
+    ASSERT_TRUE(std::any_of(recordingOutputTimes.timesMs[0].begin(), recordingOutputTimes.timesMs[0].end(), [](u32 timeMs) { return timeMs >= 2250; }));
+    ASSERT_TRUE(std::any_of(recordingOutputTimes.timesMs[1].begin(), recordingOutputTimes.timesMs[1].end(), [](u32 timeMs) { return timeMs >= 2750; }));
+    ASSERT_EQ(replayOutputTimes.timesMs, recordingOutputTimes.timesMs);
+
+    std::remove(journalPath.c_str());
+}
+
 #endif //PROD_SINK_NRF52
 
 
@@ -1391,6 +1514,81 @@ TEST(TestOther, TestPathLossModelNoiseIsStandardNormal)
     ASSERT_TRUE(std::abs(stddev - expected_stddev) < 0.01f);
 }
 
+TEST(TestOther, TestPathLossModelBatchNoiseIsStandardNormal)
+{
+    MersenneTwister rng{1};
+
+    const float expected_mean = 0.0f, expected_stddev = 1.0f;
+
+    //Odd count to also check the padded lanes of the last block
+    const std::size_t sampleCount = 1000001;
+    std::vector<float> rssiWithoutNoise(sampleCount, 0.0f);
+    std::vector<float> rssi(sampleCount);
+    ComputeRssiWithNoiseBatch(rssiWithoutNoise.data(), sampleCount, &rng, expected_stddev, expected_mean, 1000.0f, rssi.data());
+
+    float incremental_mean = 0.0f, variance_accumulator = 0.0f;
+    for (std::size_t index = 0; index < sampleCount; ++index)
+    {
+        const float value = rssi[index];
+
+        const float old_incremental_mean = incremental_mean;
+        incremental_mean += (value - incremental_mean) / static_cast<float>(index + 1);
+        variance_accumulator += (value - old_incremental_mean) * (value - incremental_mean);
+    }
+
+    const float stddev = std::sqrt(variance_accumulator / static_cast<float>(sampleCount));
+
+    ASSERT_TRUE(std::abs(incremental_mean - expected_mean) < 0.01f);
+    ASSERT_TRUE(std::abs(stddev - expected_stddev) < 0.01f);
+}
+
+TEST(TestOther, TestPathLossModelBatchNoiseIsDeterministic)
+{
+    std::vector<float> rssiWithoutNoise;
+    for (int i = 0; i < 103; i++) rssiWithoutNoise.push_back(-40.0f - i * 0.5f);
+
+    std::vector<float> simd(rssiWithoutNoise.size());
+    std::vector<float> scalar(rssiWithoutNoise.size());
+    std::vector<float> again(rssiWithoutNoise.size());
+    std::vector<float> noNoise(rssiWithoutNoise.size());
+    const u32 count = static_cast<u32>(rssiWithoutNoise.size());
+
+    MersenneTwister rngA{ 7 };
+    MersenneTwister rngB{ 7 };
+    MersenneTwister rngC{ 7 };
+    ComputeRssiWithNoiseBatch(rssiWithoutNoise.data(), count, &rngA, 3.0f, -1.0f, -45.0f, simd.data());
+    ComputeRssiWithNoiseBatch(rssiWithoutNoise.data(), count, &rngB, 3.0f, -1.0f, -45.0f, scalar.data(), true);
+    ComputeRssiWithNoiseBatch(rssiWithoutNoise.data(), count, &rngC, 3.0f, -1.0f, -45.0f, again.data());
+    ComputeRssiWithNoiseBatch(rssiWithoutNoise.data(), count, nullptr, 3.0f, -1.0f, -45.0f, noNoise.data());
+
+    //Both paths must consume the same random numbers
+    ASSERT_EQ(rngA.NextU32(), rngB.NextU32());
+
+    for (u32 i = 0; i < count; i++)
+    {
+        //The scalar path might be evaluated with a higher intermediate precision (x87)
+        ASSERT_NEAR(simd[i], scalar[i], 0.001f);
+        ASSERT_EQ(simd[i], again[i]);
+        ASSERT_LE(simd[i], -45.0f);
+        ASSERT_EQ(noNoise[i], std::min(rssiWithoutNoise[i], -45.0f));
+    }
+}
+
+TEST(TestOther, TestBatchAdvertisingReceptionClusters)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.batchAdvertisingReception = true;
+    simConfig.rssiNoise = true;
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 15 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    tester.SimulateUntilClusteringDone(100 * 1000);
+}
+
 TEST(TestOther, TestConnectionSupervisionTimeoutWillDisconnect) {
     CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
     //testerConfig.verbose = true;
@@ -1586,6 +1784,158 @@ TEST(TestOther, TestThroughput) {
     }
 }
 
+TEST(TestOther, TestConnectionEventAirtime) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    SoftdeviceConnection connection;
+
+    //Data PDU of 37 bytes, empty PDU of 10 bytes and two inter frame spaces
+    ASSERT_EQ(tester.sim->GetLinkLayerExchangeAirtimeUs(&connection, 27), 676u);
+
+    //The encrypted PDU carries an additional MIC
+    connection.connectionEncrypted = true;
+    ASSERT_EQ(tester.sim->GetLinkLayerExchangeAirtimeUs(&connection, 27), 708u);
+
+    //The 2M PHY uses a longer preamble but halves the time per byte
+    tester.sim->simConfig.connectionPhyMbps = 2;
+    ASSERT_EQ(tester.sim->GetLinkLayerExchangeAirtimeUs(&connection, 251), 1408u);
+}
+
+TEST(TestOther, TestThroughputWithConnectionEvents) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.SetToPerfectConditions();
+    simConfig.simulateConnectionEvents = true;
+    simConfig.simTickDurationMs = 15;
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    tester.SimulateUntilClusteringDone(50 * 1000);
+    tester.sim->FindNodeById(1)->gs.logger.DisableTag("CONN");
+    tester.sim->FindNodeById(2)->gs.logger.DisableTag("CONN");
+
+    tester.SendTerminalCommand(1, "action this debug flood 2 2 10000");
+
+    tester.SimulateUntilRegexMessageReceived(40 * 1000, 2, "Counted \\d+ flood payload bytes in \\d+ ms = \\d+ byte/s");
+    {
+        NodeIndexSetter setter(1);
+        DebugModule* test = (DebugModule*)tester.sim->FindNodeById(2)->gs.node.GetModuleById(ModuleId::DEBUG_MODULE);
+        ASSERT_TRUE(test->GetThroughputTestResult() >= 3900);
+    }
+}
+
+TEST(TestOther, TestPcapExport) {
+    const std::string pcapPath = "TestPcapExport.pcapng";
+    {
+        CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+        SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        simConfig.SetToPerfectConditions();
+        simConfig.simulateConnectionEvents = true;
+        simConfig.pcapPath = pcapPath;
+        simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+        simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+        tester.SimulateUntilClusteringDone(50 * 1000);
+    }
+
+    //Crc of an advertising pdu, calculated with the shift register of the specification
+    const u8 advertisingPdu[] = { 0x00, 0x06, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+    ASSERT_EQ(PcapWriter::CalculateCrc(PcapWriter::ADVERTISING_CRC_INIT, advertisingPdu, sizeof(advertisingPdu)), 0xF2F542u);
+
+    const std::string capture = CherrySim::LoadFileContents(pcapPath.c_str());
+    const auto readU32 = [&capture](size_t offset) {
+        u32 value = 0;
+        CheckedMemcpy(&value, capture.data() + offset, sizeof(value));
+        return value;
+    };
+    ASSERT_TRUE(capture.size() > 28);
+    ASSERT_EQ(readU32(0), 0x0A0D0D0Au);
+
+    u32 numInterfaces = 0;
+    u32 numJoinMePackets = 0;
+    u32 numDataPackets = 0;
+    for (size_t offset = 0; offset < capture.size(); offset += readU32(offset + 4))
+    {
+        //Every block must start and end with the same length, otherwise Wireshark rejects the file
+        const u32 blockLength = readU32(offset + 4);
+        ASSERT_TRUE(blockLength >= 12 && blockLength % 4 == 0);
+        ASSERT_TRUE(offset + blockLength <= capture.size());
+        ASSERT_EQ(readU32(offset + blockLength - 4), blockLength);
+
+        const u32 blockType = readU32(offset);
+        if (blockType == 1)
+        {
+            numInterfaces++;
+            ASSERT_EQ(readU32(offset + 8) & 0xFFFF, PcapWriter::LINKTYPE_NORDIC_BLE);
+        }
+        else if (blockType == 6)
+        {
+            const u32 capturedLength = readU32(offset + 20);
+            const u8* packet = (const u8*)capture.data() + offset + 28;
+            ASSERT_TRUE(readU32(offset + 8) < numInterfaces);
+            //The offsets of the manufacturer id and the FruityMesh identifier that are used by util/wireshark/fruitymesh.lua
+            if (readU32(offset + 28 + 17) == PcapWriter::ADVERTISING_ACCESS_ADDRESS)
+            {
+                if (capturedLength > 36 && packet[34] == 0x4D && packet[35] == 0x02 && packet[36] == 0xF0) numJoinMePackets++;
+            }
+            else
+            {
+                numDataPackets++;
+            }
+        }
+    }
+    ASSERT_EQ(numInterfaces, 2u);
+    ASSERT_TRUE(numJoinMePackets > 0);
+    ASSERT_TRUE(numDataPackets > 0);
+}
+
+TEST(TestOther, TestPcapExportKeepsTheSimulationDeterministic) {
+    const std::string pcapPath = "TestPcapExportDeterministic.pcapng";
+    const auto simulate = [](const std::string& path) {
+        CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+        SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        simConfig.rssiNoise = true;
+        simConfig.simulateConnectionEvents = true;
+        simConfig.pcapPath = path;
+        simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+        simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 4 });
+
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+        tester.SimulateUntilClusteringDone(100 * 1000);
+        const u32 clusteringDoneTimeMs = tester.sim->simState.simTimeMs;
+        tester.SimulateForGivenTime(10 * 1000);
+
+        std::vector<u32> result = {
+            clusteringDoneTimeMs,
+            tester.sim->simState.globalEventIdCounter,
+            tester.sim->simState.globalPacketIdCounter,
+            tester.sim->simState.rnd.NextU32(),
+        };
+        for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+        {
+            result.push_back(tester.sim->nodes[i].gs.node.clusterId);
+        }
+        return result;
+    };
+
+    //The captured rssis must not draw random numbers, otherwise the capture would change the simulated run
+    const std::vector<u32> withoutCapture = simulate("");
+    const std::vector<u32> withCapture = simulate(pcapPath);
+    ASSERT_EQ(withoutCapture, withCapture);
+    remove(pcapPath.c_str());
+}
+
 TEST(TestOther, TestNodeEntryFloorNumberComputation)
 {
     CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
@@ -1659,3 +2009,330 @@ TEST(TestOther, TestRssiPenaltyFromCeilingPenetration)
 
     ASSERT_NEAR(baseRssi - 20.0f, rssiWithAttenuation, 0.01f);
 }
+
+TEST(TestOther, TestLinkBudgetCacheFollowsMovement)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.SetToPerfectConditions();
+    simConfig.rssiNoise = false;
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 2 });
+    simConfig.mapWidthInMeters = 20;
+    simConfig.mapHeightInMeters = 20;
+    simConfig.preDefinedPositions = { {0.1, 0.5, 0.0}, {0.2, 0.5, 0.0}, };
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+    tester.SimulateGivenNumberOfSteps(1);
+
+    NodeEntry* nodeA = &tester.sim->nodes[0];
+    NodeEntry* nodeB = &tester.sim->nodes[1];
+    const float nearRssi = tester.sim->GetReceptionRssi(nodeA, nodeB);
+    ASSERT_EQ(nearRssi, std::min(tester.sim->GetReceptionRssiNoNoise(nodeA, nodeB), -11.0f));
+    ASSERT_EQ(tester.sim->GetReceptionRssi(nodeA, nodeB), nearRssi);
+
+    //Moving a node within a step must not return the cached rssi
+    tester.sim->SetPosition(1, 0.6f, 0.5f, 0.0f);
+    const float farRssi = tester.sim->GetReceptionRssi(nodeA, nodeB);
+    ASSERT_TRUE(farRssi < nearRssi);
+    ASSERT_EQ(farRssi, tester.sim->GetReceptionRssiNoNoise(nodeA, nodeB));
+
+    //Positions that are written directly are picked up in the next step
+    nodeB->x = 0.2f;
+    tester.SimulateGivenNumberOfSteps(1);
+    ASSERT_EQ(tester.sim->GetReceptionRssi(nodeA, nodeB), nearRssi);
+
+    //Changing the model discards all entries
+    tester.sim->propagationConstant = 2.5f;
+    tester.SimulateGivenNumberOfSteps(1);
+    ASSERT_TRUE(tester.sim->GetReceptionRssi(nodeA, nodeB) < nearRssi);
+}
+
+TEST(TestOther, TestSkipIdleSimulationSteps) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.skipIdleSimulationSteps = true;
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    tester.SimulateForGivenTime(1000);
+
+    //A single node has no partner to connect to, so most steps can be skipped
+    const u32 startTimeMs = tester.sim->simState.simTimeMs;
+    const u32 startAppTimerDs = tester.sim->nodes[0].gs.appTimerDs;
+    u32 numSteps = 0;
+    while (tester.sim->simState.simTimeMs < startTimeMs + 10 * 1000)
+    {
+        tester.sim->SimulateStepForAllNodes();
+        numSteps++;
+    }
+    ASSERT_LT(numSteps, 10 * 1000 / simConfig.simTickDurationMs);
+
+    //The timers must still fire as often as without skipping
+    const u32 passedAppTimerDs = tester.sim->nodes[0].gs.appTimerDs - startAppTimerDs;
+    ASSERT_GE(passedAppTimerDs, 98u);
+    ASSERT_LE(passedAppTimerDs, 102u);
+
+    //Terminal commands must be processed in the next step
+    tester.SendTerminalCommand(1, "action this status get_device_info");
+    tester.SimulateUntilMessageReceived(1000, 1, "\"type\":\"device_info\"");
+}
+
+TEST(TestOther, TestSkipIdleSimulationStepsInClusteredMesh) {
+    constexpr u32 numNodes = 4;
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.skipIdleSimulationSteps = true;
+    //The ruuvi featureset switches the mesh connections to an interval of 90 ms once they are established
+    simConfig.nodeConfigName.insert({ "prod_ruuvi_weather_nrf52", numNodes });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    //Connecting, service discovery and the connections themselves must not prevent the clustering
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    tester.SimulateForGivenTime(60 * 1000);
+
+    u32 numConnections = 0;
+    int64_t startSimulatedFrames = 0;
+    for (u32 i = 0; i < numNodes; i++)
+    {
+        const NodeEntry& node = tester.sim->nodes[i];
+        for (u32 k = 0; k < node.state.configuredTotalConnectionCount; k++)
+        {
+            if (!node.state.connections[k].connectionActive) continue;
+            ASSERT_EQ(node.state.connections[k].connectionInterval, 90);
+            numConnections++;
+        }
+        startSimulatedFrames += node.simulatedFrames;
+    }
+    ASSERT_EQ(numConnections, (numNodes - 1) * 2);
+
+    //The nodes are only simulated at their connection events, timer ticks and advertising intervals
+    const u32 startTimeMs = tester.sim->simState.simTimeMs;
+    tester.SimulateForGivenTime(10 * 1000);
+    const u32 numSteps = (tester.sim->simState.simTimeMs - startTimeMs) / simConfig.simTickDurationMs;
+
+    int64_t simulatedFrames = 0;
+    for (u32 i = 0; i < numNodes; i++)
+    {
+        ASSERT_EQ(tester.sim->nodes[i].gs.node.GetClusterSize(), (ClusterSize)numNodes);
+        simulatedFrames += tester.sim->nodes[i].simulatedFrames;
+    }
+    ASSERT_LT(simulatedFrames - startSimulatedFrames, (int64_t)numSteps * numNodes);
+}
+
+TEST(TestOther, TestCheckpointRestoresSimulation) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 4 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    const u32 checkpointId = tester.sim->StoreCheckpoint();
+    const u32 checkpointTimeMs = tester.sim->simState.simTimeMs;
+    const u32 checkpointRestartCounter = tester.sim->nodes[1].restartCounter;
+
+    //Reboot a node after the checkpoint so that the firmware state of the checkpoint points into memory of a previous boot
+    tester.SendTerminalCommand(2, "reset");
+    tester.SimulateForGivenTime(10 * 1000);
+    const u32 globalEventIdCounter = tester.sim->simState.globalEventIdCounter;
+    const u32 globalPacketIdCounter = tester.sim->simState.globalPacketIdCounter;
+    ASSERT_EQ(tester.sim->nodes[1].restartCounter, checkpointRestartCounter + 1);
+
+    tester.sim->LoadCheckpoint(checkpointId);
+    ASSERT_EQ(tester.sim->simState.simTimeMs, checkpointTimeMs);
+    ASSERT_EQ(tester.sim->nodes[1].restartCounter, checkpointRestartCounter);
+    ASSERT_EQ(tester.sim->nodes[0].gs.node.GetClusterSize(), 5);
+
+    //The restored simulation must continue exactly like the original one
+    tester.SendTerminalCommand(2, "reset");
+    tester.SimulateForGivenTime(10 * 1000);
+    ASSERT_EQ(tester.sim->simState.globalEventIdCounter, globalEventIdCounter);
+    ASSERT_EQ(tester.sim->simState.globalPacketIdCounter, globalPacketIdCounter);
+
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //The checkpoint can be loaded again until it is discarded
+    tester.sim->LoadCheckpoint(checkpointId);
+    ASSERT_EQ(tester.sim->simState.simTimeMs, checkpointTimeMs);
+    tester.sim->DiscardCheckpoints();
+    tester.SimulateForGivenTime(10 * 1000);
+    ASSERT_EQ(tester.sim->nodes[0].gs.node.GetClusterSize(), 5);
+}
+
+TEST(TestOther, TestCheckpointFileRestoresSimulation) {
+    const std::string checkpointPath = "TestCheckpointFile.bin";
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 4 });
+
+    //Everything that must be the same if two simulations continue in the same way
+    auto getSimulationState = [](CherrySimTester& tester) {
+        std::vector<u32> state = {
+            tester.sim->simState.simTimeMs,
+            tester.sim->simState.globalEventIdCounter,
+            tester.sim->simState.globalPacketIdCounter,
+            tester.sim->simState.rnd.NextU32(),
+        };
+        for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+        {
+            state.push_back(tester.sim->nodes[i].gs.node.clusterId);
+            state.push_back(tester.sim->nodes[i].gs.appTimerDs);
+        }
+        return state;
+    };
+
+    u32 checkpointTimeMs = 0;
+    std::vector<u32> expectedState;
+    {
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+        tester.SimulateUntilClusteringDone(100 * 1000);
+        tester.sim->StoreCheckpointToFile(checkpointPath);
+        checkpointTimeMs = tester.sim->simState.simTimeMs;
+        tester.SimulateForGivenTime(10 * 1000);
+        expectedState = getSimulationState(tester);
+
+        //Reboot all nodes while an in memory checkpoint keeps their previous memory, so that the memory of
+        //all nodes is at other addresses than when the checkpoint file was stored
+        tester.sim->StoreCheckpoint();
+        for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+        {
+            tester.SendTerminalCommand(i + 1, "reset");
+        }
+        tester.SimulateForGivenTime(10 * 1000);
+        ASSERT_NE(tester.sim->nodes[0].moduleMemoryBlock, nullptr);
+
+        ASSERT_TRUE(tester.sim->LoadCheckpointFromFile(checkpointPath));
+        ASSERT_EQ(tester.sim->simState.simTimeMs, checkpointTimeMs);
+        ASSERT_EQ(tester.sim->nodes[0].gs.node.GetClusterSize(), 5);
+        tester.SimulateForGivenTime(10 * 1000);
+        ASSERT_EQ(getSimulationState(tester), expectedState);
+    }
+
+    //Another simulation with the same configuration starts from the clustered mesh of the file
+    {
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+        ASSERT_TRUE(tester.sim->LoadCheckpointFromFile(checkpointPath));
+        ASSERT_EQ(tester.sim->simState.simTimeMs, checkpointTimeMs);
+        ASSERT_TRUE(tester.sim->IsClusteringDone());
+        tester.SimulateForGivenTime(10 * 1000);
+        ASSERT_EQ(getSimulationState(tester), expectedState);
+    }
+
+    //A simulation with another amount of nodes can not load the file and is left unchanged
+    {
+        SimConfiguration otherSimConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        otherSimConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+        otherSimConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 2 });
+        CherrySimTester tester = CherrySimTester(testerConfig, otherSimConfig);
+        tester.Start();
+        Exceptions::ExceptionDisabler<CorruptOrOutdatedSavefile> cos;
+        ASSERT_FALSE(tester.sim->LoadCheckpointFromFile(checkpointPath));
+        ASSERT_EQ(tester.sim->simState.simTimeMs, 0u);
+        tester.SimulateUntilClusteringDone(100 * 1000);
+    }
+
+    std::remove(checkpointPath.c_str());
+}
+
+TEST(TestOther, TestBootAllNodesClonesNodesWithTheSameBootInputs) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 9 });
+    simConfig.cloneBootedNodes = true;
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+
+    //A node with an enrollment in its flash has other boot inputs than the other mesh nodes
+    const u32 enrolledNodeIndex = 5;
+    NodeConfiguration config;
+    CheckedMemset(&config, 0x00, sizeof(config));
+    config.moduleId = ModuleId::NODE;
+    config.moduleVersion = NODE_MODULE_CONFIG_VERSION;
+    config.moduleActive = 1;
+    config.enrollmentState = EnrollmentState::ENROLLED;
+    config.nodeId = 33;
+    config.networkId = simConfig.defaultNetworkId;
+    config.bleAddress.addr_type = FruityHal::BleGapAddrType::INVALID;
+    {
+        NodeIndexSetter setter(enrolledNodeIndex);
+        tester.sim->WriteRecordToFlash((u16)ModuleId::NODE, (u8*)&config, offsetof(NodeConfiguration, dynamicGroupIds));
+    }
+
+    tester.Start();
+
+    //The sink, the first mesh node and the enrolled node are booted, the other mesh nodes are cloned
+    ASSERT_EQ(tester.sim->clonedNodeCount, 7u);
+
+    std::set<ClusterId> clusterIds;
+    for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+    {
+        NodeEntry& node = tester.sim->nodes[i];
+        ASSERT_EQ(node.gs.node.configuration.nodeId, i == enrolledNodeIndex ? 33 : i + 1);
+        ASSERT_EQ(node.gs.config.GetSerialNumberIndex(), node.uicr.CUSTOMER[12]);
+        clusterIds.insert(node.gs.node.clusterId);
+
+        //The firmware state of a clone must only point into its own memory
+        ASSERT_EQ(node.gs.activeModules[0], &node.gs.node);
+        ASSERT_EQ(node.gs.ramRetainStructPtr, &node.retainedRamMemory.ramRetainStruct);
+        for (u32 k = 1; k < node.gs.amountOfModules; k++)
+        {
+            ASSERT_GE((u8*)node.gs.activeModules[k], node.moduleMemoryBlock);
+            ASSERT_LT((u8*)node.gs.activeModules[k], node.moduleMemoryBlock + node.gs.moduleAllocator.GetMemorySize());
+        }
+    }
+    ASSERT_EQ(clusterIds.size(), tester.sim->GetTotalNodes());
+
+    tester.SimulateUntilClusteringDone(100 * 1000);
+}
+
+#if defined(SIM_SERVER_PRESENT)
+TEST(TestOther, TestSimServerDevicesAreSentIncrementally)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1});
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 2});
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    auto requestDevices = [&](u32 sinceVersion) {
+        evbuffer* out = evbuffer_new();
+        tester.sim->webserver->WriteDevicesJson(out, sinceVersion);
+        const size_t length = evbuffer_get_length(out);
+        const std::string body((const char*)evbuffer_pullup(out, -1), length);
+        evbuffer_free(out);
+        return nlohmann::json::parse(body);
+    };
+
+    //The first request contains all devices
+    nlohmann::json devices = requestDevices(0);
+    ASSERT_EQ(devices["result"].size(), 3u);
+    const u32 firstVersion = devices["version"];
+
+    //Nothing changed in between, so no device is sent again
+    ASSERT_EQ(requestDevices(firstVersion)["result"].size(), 0u);
+
+    //Only the moved node is sent to a client that knows the previous version
+    tester.sim->SetPosition(1, 0.9f, tester.sim->nodes[1].y, tester.sim->nodes[1].z);
+    devices = requestDevices(firstVersion);
+    ASSERT_EQ(devices["result"].size(), 1u);
+    ASSERT_EQ(devices["result"][0]["details"]["nodeId"], tester.sim->nodes[1].GetNodeId());
+    const u32 secondVersion = devices["version"];
+    ASSERT_GT(secondVersion, firstVersion);
+
+    //A client that is up to date gets an empty result
+    ASSERT_EQ(requestDevices(secondVersion)["result"].size(), 0u);
+
+    //A client that knows a newer version than the server gets all devices
+    ASSERT_EQ(requestDevices(secondVersion + 1)["result"].size(), 3u);
+}
+#endif // SIM_SERVER_PRESENT
@@ -773,6 +773,48 @@ TEST_F(TestRecordStorageFixture, TestRandomMultiRecordUpdates) {
     }
 }
 
+TEST_F(TestRecordStorageFixture, TestRecordIndexMatchesScan) {
+    NodeIndexSetter setter(0);
+    constexpr u16 numRecordIds = 40;
+
+    //Setup
+    CheckedMemset(startPage, 0xff, numPages*FruityHal::GetCodePageSize());
+    RepairPages();
+    cherrySimInstance->SimCommitFlashOperations();
+
+    u8 data[32];
+
+    //Saves, deactivations and the resulting defragmentations must all be reflected in the index
+    for (int i = 0; i < 1000; i++)
+    {
+        u16 randomRecordId = (Utility::GetRandomInteger() % numRecordIds) + 1;
+        if (Utility::GetRandomInteger() % 4 == 0) {
+            GS->recordStorage.DeactivateRecord(randomRecordId, nullptr, 0);
+        }
+        else {
+            CheckedMemset(data, (u8)Utility::GetRandomInteger(), sizeof(data));
+            GS->recordStorage.SaveRecord(randomRecordId, data, 4 + (Utility::GetRandomInteger() % 7) * 4, nullptr, 0);
+        }
+        cherrySimInstance->SimCommitFlashOperations();
+
+        for (u16 recordId = 1; recordId <= numRecordIds + 1; recordId++) {
+            ASSERT_EQ(GS->recordStorage.GetRecord(recordId), GS->recordStorage.FindRecordByScan(recordId));
+        }
+        ASSERT_EQ(GS->recordStorage.recordIndexState, RecordIndexState::VALID);
+    }
+
+    //If there are more records than the index can hold, lookups must still find all of them
+    for (u16 recordId = 1; recordId <= RECORD_STORAGE_INDEX_SIZE + 10; recordId++) {
+        GS->recordStorage.SaveRecord(recordId, data, 4, nullptr, 0);
+        cherrySimInstance->SimCommitFlashOperations();
+    }
+    ASSERT_EQ(GS->recordStorage.GetRecord(RECORD_STORAGE_INDEX_SIZE + 10), GS->recordStorage.FindRecordByScan(RECORD_STORAGE_INDEX_SIZE + 10));
+    ASSERT_EQ(GS->recordStorage.recordIndexState, RecordIndexState::OVERFLOWED);
+    for (u16 recordId = 1; recordId <= RECORD_STORAGE_INDEX_SIZE + 10; recordId++) {
+        ASSERT_NE(GS->recordStorage.GetRecord(recordId), nullptr);
+    }
+}
+
 //This makes sure that the FlashSorage will correctly process its queue, even if the BleStack was not initialized at some point
 #ifdef PROD_MESH_USB_NRF52840
 TEST(TestRecordStorage, TestFlashStorageBeforeBleStackInitBR14346)
@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "SimFlash.h"
+
+namespace {
+    constexpr u32 testFlashSize = 4096 * 16;
+
+    bool IsRangeErased(const SimFlash& flash, u32 offset, u32 length)
+    {
+        for (u32 i = offset; i < offset + length; i++)
+        {
+            if (flash.GetData()[i] != 0xFF) return false;
+        }
+        return true;
+    }
+}
+
+TEST(TestSimFlash, TestEraseRestoresErasedState) {
+    SimFlash flash(testFlashSize);
+    ASSERT_TRUE(IsRangeErased(flash, 0, testFlashSize));
+
+    for (u32 i = 0; i < testFlashSize; i++) flash[i] = (u8)i;
+
+    //Erase one full page and a range that is not aligned to pages
+    flash.Erase(4096, 4096);
+    flash.Erase(3 * 4096 + 100, 4096 + 200);
+
+    for (u32 i = 0; i < testFlashSize; i++)
+    {
+        const bool erased = (i >= 4096 && i < 2 * 4096) || (i >= 3 * 4096 + 100 && i < 4 * 4096 + 300);
+        ASSERT_EQ(flash.GetData()[i], erased ? 0xFF : (u8)i);
+    }
+
+    //Erased pages must be writable again
+    flash[4096] = 0x12;
+    ASSERT_EQ(flash.GetData()[4096], 0x12);
+    ASSERT_TRUE(IsRangeErased(flash, 4097, 4096 - 1));
+}
+
+TEST(TestSimFlash, TestSharedPagesAreCopiedOnWrite) {
+    SimFlash flashA(testFlashSize);
+    SimFlash flashB(testFlashSize);
+    for (u32 i = 0; i < 2 * 4096; i++)
+    {
+        flashA[i] = (u8)(i * 7);
+        flashB[i] = (u8)(i * 7);
+    }
+    flashA[5 * 4096] = 1;
+    flashB[5 * 4096] = 2;
+
+    flashA.SharePages();
+    flashB.SharePages();
+
+    for (u32 i = 0; i < 2 * 4096; i++)
+    {
+        ASSERT_EQ(flashA.GetData()[i], (u8)(i * 7));
+        ASSERT_EQ(flashB.GetData()[i], (u8)(i * 7));
+    }
+    ASSERT_EQ(flashA.GetData()[5 * 4096], 1);
+    ASSERT_EQ(flashB.GetData()[5 * 4096], 2);
+
+    //Writing to a shared page must not be visible in the other flash
+    flashA[10] = 0;
+    ASSERT_EQ(flashA.GetData()[10], 0);
+    ASSERT_EQ(flashB.GetData()[10], (u8)(10 * 7));
+    ASSERT_TRUE(IsRangeErased(flashB, 2 * 4096, 3 * 4096));
+}
+
+TEST(TestSimFlash, TestLoadCopiesImage) {
+    std::vector<u8> image(testFlashSize, 0xFF);
+    for (u32 i = 0; i < 4096; i++) image[4096 * 3 + i] = (u8)i;
+
+    SimFlash flash(testFlashSize);
+    for (u32 i = 0; i < testFlashSize; i++) flash[i] = 0;
+    flash.Load(image.data());
+
+    for (u32 i = 0; i < testFlashSize; i++)
+    {
+        ASSERT_EQ(flash.GetData()[i], image[i]);
+    }
+}
+
+TEST(TestSimFlash, TestCloneFromCopiesGoldenImage) {
+    SimFlash golden(testFlashSize);
+    for (u32 i = 0; i < 4096; i++) golden[i] = (u8)(i * 3);
+    golden[7 * 4096 + 5] = 0x42;
+    golden.SharePages();
+
+    SimFlash cloneA(testFlashSize);
+    SimFlash cloneB(testFlashSize);
+    cloneA.CloneFrom(golden);
+    cloneB.CloneFrom(golden);
+    for (u32 i = 0; i < testFlashSize; i++)
+    {
+        ASSERT_EQ(cloneA.GetData()[i], golden.GetData()[i]);
+        ASSERT_EQ(cloneB.GetData()[i], golden.GetData()[i]);
+    }
+
+    //Clones are independent of each other and of the golden image
+    cloneA[1] = 0;
+    cloneB.Erase(7 * 4096, 4096);
+    ASSERT_EQ(cloneA.GetData()[1], 0);
+    ASSERT_EQ(cloneB.GetData()[1], 3);
+    ASSERT_EQ(golden.GetData()[1], 3);
+    ASSERT_EQ(cloneA.GetData()[7 * 4096 + 5], 0x42);
+    ASSERT_TRUE(IsRangeErased(cloneB, 7 * 4096, 4096));
+    ASSERT_EQ(golden.GetData()[7 * 4096 + 5], 0x42);
+
+    //A golden image that was not shared is copied
+    SimFlash unsharedGolden(testFlashSize);
+    unsharedGolden[3 * 4096] = 0x17;
+    SimFlash cloneC(testFlashSize);
+    cloneC.CloneFrom(unsharedGolden);
+    ASSERT_EQ(cloneC.GetData()[3 * 4096], 0x17);
+    ASSERT_TRUE(IsRangeErased(cloneC, 0, 3 * 4096));
+}
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "SimRingQueue.h"
+
+TEST(TestSimRingQueue, TestOrderIsKeptWhileGrowingAndWrapping) {
+    SimRingQueue<u32> queue;
+    u32 nextPush = 0;
+    u32 nextPop = 0;
+
+    //Removing fewer elements than are added lets the queue grow while its head wraps around the buffer
+    for (u32 round = 0; round < 100; round++)
+    {
+        for (u32 i = 0; i < 3; i++) queue.push_back(nextPush++);
+        for (u32 i = 0; i < 2; i++)
+        {
+            ASSERT_EQ(queue.front(), nextPop++);
+            queue.pop_front();
+        }
+        ASSERT_EQ(queue.size(), nextPush - nextPop);
+        for (u32 i = 0; i < queue.size(); i++) ASSERT_EQ(queue[i], nextPop + i);
+    }
+
+    while (!queue.empty())
+    {
+        ASSERT_EQ(queue.front(), nextPop++);
+        queue.pop_front();
+    }
+    ASSERT_EQ(nextPop, nextPush);
+}
+
+TEST(TestSimRingQueue, TestMemoryIsReused) {
+    SimRingQueue<u32> queue;
+    for (u32 i = 0; i < 20; i++) queue.push_back(i);
+    const u32 capacity = queue.capacity();
+
+    queue.clear();
+    ASSERT_TRUE(queue.empty());
+
+    //Filling and emptying the queue below its peak size must not grow the buffer
+    for (u32 round = 0; round < 1000; round++)
+    {
+        for (u32 i = 0; i < 20; i++) queue.push_back(i);
+        for (u32 i = 0; i < 20; i++) queue.pop_front();
+    }
+    ASSERT_EQ(queue.capacity(), capacity);
+
+    queue.resize(5);
+    ASSERT_EQ(queue.size(), 5u);
+    ASSERT_EQ(queue[4], 0u);
+    queue.resize(2);
+    ASSERT_EQ(queue.size(), 2u);
+}
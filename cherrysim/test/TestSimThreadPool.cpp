@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#include "SimThreadPool.h"
+
+TEST(TestSimThreadPool, TestEveryIndexIsProcessedOnce) {
+    //Tests that each index of a job is handed out exactly once, also when reusing the pool for several jobs.
+    SimThreadPool pool(4);
+    ASSERT_EQ(pool.GetNumThreads(), 4u);
+
+    for (u32 size : { 1u, 3u, 1000u })
+    {
+        std::vector<std::atomic<u32>> calls(size);
+        pool.Run(size, [&calls](u32 i) { calls[i]++; });
+        for (u32 i = 0; i < size; i++)
+        {
+            ASSERT_EQ(calls[i].load(), 1u);
+        }
+    }
+}
+
+TEST(TestSimThreadPool, TestSingleThreadRunsOnCaller) {
+    //Tests that a pool with a single thread processes all indices in order on the calling thread.
+    SimThreadPool pool(1);
+    ASSERT_EQ(pool.GetNumThreads(), 1u);
+
+    std::vector<u32> order;
+    pool.Run(5, [&order](u32 i) { order.push_back(i); });
+    ASSERT_EQ(order, std::vector<u32>({ 0, 1, 2, 3, 4 }));
+
+    //An empty job must return immediately
+    pool.Run(0, [](u32) { FAIL(); });
+}
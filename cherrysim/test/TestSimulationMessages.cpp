@@ -96,4 +96,49 @@ TEST(TestSimulateMessages, TestMixedMessageTypes) {
         tester.SimulateUntilRegexMessagesReceived(10 * 1000, messages);
         ASSERT_TRUE(tester.sim->CheckExceptionWasThrown(typeid(TimeoutException)));
     }
-}
\ No newline at end of file
+}
+
+TEST(TestSimulateMessages, TestRequiredRegexLiterals) {
+    using Literals = std::vector<std::string>;
+
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("plain text"), Literals({ "plain text" }));
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("\\{\"nodeId\":2,\"type\":\"status\",\"module\":3.*"), Literals({ "{\"nodeId\":2,\"type\":\"status\",\"module\":3" }));
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("Counted \\d+ flood payload bytes in \\d+ ms"), Literals({ "Counted ", " flood payload bytes in ", " ms" }));
+
+    //Quantified characters, groups and character classes are not required
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("abc?d"), Literals({ "ab", "d" }));
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("ab+c"), Literals({ "ab", "c" }));
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("x(optional)?y[a-z]{2}z"), Literals({ "x", "y", "z" }));
+
+    //With alternatives, no literal is required, but alternatives in groups only affect the group
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("first|second"), Literals());
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("a(b|c)d"), Literals({ "a", "d" }));
+}
+
+TEST(TestSimulateMessages, TestRequiredRegexLiteralsWithCharacterCodes) {
+    using Literals = std::vector<std::string>;
+
+    //The operands of character codes and control characters are not literals
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("id\\x41end"), Literals({ "id", "end" }));
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("id\\u0041end"), Literals({ "id", "end" }));
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("id\\cJend"), Literals({ "id", "end" }));
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("id[\\x5D\\u005D]end"), Literals({ "id", "end" }));
+
+    //Incomplete character codes do not result in any literal
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("id\\x4"), Literals());
+    ASSERT_EQ(SimulationMessage::GetRequiredRegexLiterals("id\\u004"), Literals());
+
+    //The prefilter must not reject messages that the regex matches
+    SimulationMessage message(1, "node \\x41\\u0042 done");
+    ASSERT_FALSE(message.CheckAndSet("node AC done", true));
+    ASSERT_TRUE(message.CheckAndSet("node AB done", true));
+}
+
+TEST(TestSimulateMessages, TestRegexMatchingWithPrefilter) {
+    SimulationMessage message(1, "\\{\"nodeId\":\\d+,\"type\":\"(status|device_info)\"");
+
+    ASSERT_FALSE(message.CheckAndSet("{\"nodeId\":2,\"type\":\"reboot\"}", true));
+    ASSERT_FALSE(message.CheckAndSet("unrelated output", true));
+    ASSERT_TRUE(message.CheckAndSet("{\"nodeId\":2,\"type\":\"device_info\",\"module\":3}", true));
+    ASSERT_EQ(message.GetCompleteMessage(), "{\"nodeId\":2,\"type\":\"device_info\",\"module\":3}");
+}
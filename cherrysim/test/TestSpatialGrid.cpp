@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "SpatialGrid.h"
+
+TEST(TestSpatialGrid, TestCandidatesContainAllNodesInRange) {
+    //Tests that the candidates are sorted and contain every node that is within one cell size of the position.
+    constexpr float cellSize = 10.0f;
+    constexpr u32 nodeCount = 200;
+    SpatialGrid grid;
+    grid.Reset(cellSize, 100.0f, 60.0f, nodeCount);
+
+    std::vector<float> xs;
+    std::vector<float> ys;
+    for (u32 i = 0; i < nodeCount; i++)
+    {
+        xs.push_back(static_cast<float>((i * 37) % 100));
+        ys.push_back(static_cast<float>((i * 53) % 60));
+        grid.Update(i, xs[i], ys[i]);
+    }
+
+    std::vector<u32> candidates;
+    for (u32 i = 0; i < nodeCount; i++)
+    {
+        grid.GetCandidates(xs[i], ys[i], candidates);
+        ASSERT_TRUE(std::is_sorted(candidates.begin(), candidates.end()));
+        for (u32 k = 0; k < nodeCount; k++)
+        {
+            if (std::abs(xs[i] - xs[k]) <= cellSize && std::abs(ys[i] - ys[k]) <= cellSize)
+            {
+                ASSERT_TRUE(std::binary_search(candidates.begin(), candidates.end(), k));
+            }
+        }
+    }
+}
+
+TEST(TestSpatialGrid, TestMovedNodeChangesCell) {
+    //Tests that a moved node is only found at its new position.
+    SpatialGrid grid;
+    grid.Reset(10.0f, 100.0f, 100.0f, 2);
+    grid.Update(0, 5.0f, 5.0f);
+    grid.Update(1, 95.0f, 95.0f);
+
+    std::vector<u32> candidates;
+    grid.GetCandidates(5.0f, 5.0f, candidates);
+    ASSERT_EQ(candidates, std::vector<u32>({ 0 }));
+
+    grid.Update(1, 8.0f, 3.0f);
+    grid.GetCandidates(5.0f, 5.0f, candidates);
+    ASSERT_EQ(candidates, std::vector<u32>({ 0, 1 }));
+
+    grid.GetCandidates(95.0f, 95.0f, candidates);
+    ASSERT_TRUE(candidates.empty());
+}
+
+TEST(TestSpatialGrid, TestPositionsOutsideOfMapAreClamped) {
+    //Tests that nodes outside of the map are still found by nodes at the border of the map.
+    SpatialGrid grid;
+    grid.Reset(10.0f, 50.0f, 50.0f, 3);
+    grid.Update(0, -200.0f, -3.0f);
+    grid.Update(1, 2.0f, 2.0f);
+    grid.Update(2, 500.0f, 49.0f);
+
+    std::vector<u32> candidates;
+    grid.GetCandidates(1.0f, 1.0f, candidates);
+    ASSERT_EQ(candidates, std::vector<u32>({ 0, 1 }));
+
+    grid.GetCandidates(49.0f, 49.0f, candidates);
+    ASSERT_EQ(candidates, std::vector<u32>({ 2 }));
+}
+
+TEST(TestSpatialGrid, TestResetOnDimensionChange) {
+    SpatialGrid grid;
+    grid.Reset(10.0f, 100.0f, 100.0f, 5);
+    ASSERT_TRUE(grid.IsConfiguredFor(10.0f, 100.0f, 100.0f, 5));
+    ASSERT_FALSE(grid.IsConfiguredFor(10.0f, 120.0f, 100.0f, 5));
+    ASSERT_FALSE(grid.IsConfiguredFor(10.0f, 100.0f, 100.0f, 6));
+    ASSERT_EQ(grid.GetNodeCount(), 5u);
+}
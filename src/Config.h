@@ -199,6 +199,18 @@ static_assert(false, "Featureset was not defined, which is mandatory!");
 #define ADVERTISING_CONTROLLER_MAX_NUM_JOBS 4
 #endif
 
+//The number of nodeIds for which the ConnectionManager remembers the mesh connection that leads to them,
+//only used if ACTIVATE_UNICAST_ROUTING is set in the featureset, each entry needs 8 bytes of RAM
+#ifndef UNICAST_ROUTING_TABLE_SIZE
+#define UNICAST_ROUTING_TABLE_SIZE 32
+#endif
+
+//Bytes reserved by the AutoSenseModule for the samples of MEDIAN entries, each of them needs 16 times its length,
+//setting it to 0 disables the MEDIAN report function
+#ifndef AUTO_SENSE_MEDIAN_SAMPLE_STORAGE_SIZE
+#define AUTO_SENSE_MEDIAN_SAMPLE_STORAGE_SIZE 128
+#endif
+
 // ########### Flash Settings ##########################################
 // Number of pages used to store records, at least 2 are required for swapping
 #ifndef RECORD_STORAGE_NUM_PAGES
@@ -477,6 +489,11 @@ class Conf
         TerminalMode terminalMode : 8;
 
         bool enableSinkRouting = false;
+#if IS_ACTIVE(UNICAST_ROUTING)
+        //Packets to a single node are only sent to the mesh connection that the node was last heard from,
+        //must be enabled by the featureset
+        bool enableUnicastRouting = false;
+#endif
         // ########### TIMINGS ################################################
 
         //Mesh connection parameters (used when a connection is set up)
@@ -570,12 +587,12 @@ class Conf
 
 // Linker variables
 #if defined(SIM_ENABLED)
-    extern u32 __application_start_address;
-    extern u32 __application_end_address;
-    extern u32 __application_ram_start_address;
-    extern u32 __start_conn_type_resolvers;
-    extern u32 __stop_conn_type_resolvers;
-    extern u32 __license_data_start_address;
+    extern thread_local u32 __application_start_address;
+    extern thread_local u32 __application_end_address;
+    extern thread_local u32 __application_ram_start_address;
+    extern thread_local u32 __start_conn_type_resolvers;
+    extern thread_local u32 __stop_conn_type_resolvers;
+    extern thread_local u32 __license_data_start_address;
 #else
     extern u32 __application_start_address[]; //Variable is set in the linker script
     extern u32 __application_end_address[]; //Variable is set in the linker script
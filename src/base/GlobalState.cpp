@@ -125,3 +125,19 @@ void GlobalState::RegisterMainContextHandler(FruityHal::MainContextHandler handl
     mainContextHandlers[numMainContextHandlers] = handler;
     numMainContextHandlers++;
 }
+
+void GlobalState::BuildEventSubscriberTables()
+{
+    for (u32 event = 0; event < (u32)ModuleEvent::AMOUNT_OF_EVENTS; event++)
+    {
+        amountOfEventSubscribers[event] = 0;
+        for (u32 i = 0; i < amountOfModules; i++)
+        {
+            if (activeModules[i]->subscribedEvents & ModuleEventMask((ModuleEvent)event))
+            {
+                eventSubscribers[event][amountOfEventSubscribers[event]] = i;
+                amountOfEventSubscribers[event]++;
+            }
+        }
+    }
+}
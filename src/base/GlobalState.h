@@ -146,6 +146,20 @@ class GlobalState
         //########## Modules ###############
         u32 amountOfModules = 0;
         Module* activeModules[MAX_MODULE_COUNT] = {};
+
+        //For each ModuleEvent, the indices of the activeModules that subscribed to it
+        u8 eventSubscribers[(u32)ModuleEvent::AMOUNT_OF_EVENTS][MAX_MODULE_COUNT] = {};
+        u8 amountOfEventSubscribers[(u32)ModuleEvent::AMOUNT_OF_EVENTS] = {};
+        //Must be called once all modules are initialized
+        void BuildEventSubscriberTables();
+        u32 GetAmountOfEventSubscribers(ModuleEvent event) const
+        {
+            return amountOfEventSubscribers[(u32)event];
+        }
+        Module* GetEventSubscriber(ModuleEvent event, u32 index) const
+        {
+            return activeModules[eventSubscribers[(u32)event][index]];
+        }
         template<typename T>
         u32 InitializeModule(bool createModule, u16 recordId = RECORD_STORAGE_RECORD_ID_INVALID)
         {
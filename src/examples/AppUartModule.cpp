@@ -49,6 +49,7 @@ AppUartModule::AppUartModule()
     // sizeof configuration must be a multiple of 4 bytes
     vendorConfigurationPointer = &configuration;
     configurationLength = sizeof(AppUartModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER) | ModuleEventMask(ModuleEvent::GAP_DISCONNECTED);
 
     // Initialize the array of partners to all-invalid
     for (u8 ii = 0; ii < APP_UART_MAX_NUM_PARTNERS; ++ii)
@@ -43,6 +43,7 @@ PingModule::PingModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(PingModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER);
 
     //Set defaults
     ResetToDefaultConfiguration();
@@ -50,6 +50,7 @@ VendorTemplateModule::VendorTemplateModule()
     //sizeof configuration must be a multiple of 4 bytes
     vendorConfigurationPointer = &configuration;
     configurationLength = sizeof(VendorTemplateModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER);
 
     //Set defaults
     ResetToDefaultConfiguration();
@@ -103,8 +104,6 @@ enum class VendorTemplateComponent1Registers : u16
 
 void VendorTemplateModule::TimerEventHandler(u16 passedTimeDs)
 {
-    static u8 exampleCounter = 0;
-
     //Exemplary periodic reporting of a "sensor" value, switch on if desired
     if(false && SHOULD_IV_TRIGGER(GS->appTimerDs, passedTimeDs, SEC_TO_DS(5)))
     {
@@ -86,6 +86,9 @@ public:
     //Declare the configuration used for this module
     DECLARE_CONFIG_AND_PACKED_STRUCT(VendorTemplateModuleConfiguration);
 
+    //Value of the exemplary periodic "sensor" report, kept per module instance instead of in a static
+    u8 exampleCounter = 0;
+
     VendorTemplateModule();
 
     void ConfigurationLoadedHandler(u8* migratableConfig, u16 migratableConfigLength) override;
@@ -110,17 +110,13 @@ bool BaseConnection::QueueData(const BaseConnectionSendData &sendData, u8 const
 
 bool BaseConnection::QueueData(const BaseConnectionSendData &sendData, u8 const * data, bool fillTxBuffers, u32* messageHandle)
 {
-    const u32 bufferSize = SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + sendData.dataLength.GetRaw();
-    DYNAMIC_ARRAY(buffer, bufferSize);
-    CheckedMemset(buffer, 0, bufferSize);
+    //The data is written into the queue directly behind the packed send data, no intermediate buffer is needed
+    BaseConnectionSendDataPacked sendDataPacked;
+    CheckedMemset(&sendDataPacked, 0, sizeof(sendDataPacked));
+    sendDataPacked.characteristicHandle = sendData.characteristicHandle;
+    sendDataPacked.deliveryOption = (u8)sendData.deliveryOption;
 
-    BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)buffer;
-    sendDataPacked->characteristicHandle = sendData.characteristicHandle;
-    sendDataPacked->deliveryOption = (u8)sendData.deliveryOption;
-
-    CheckedMemcpy(buffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, data, sendData.dataLength.GetRaw());
-
-    const bool successfullyQueued = queue.SplitAndAddMessage(overwritePriority == DeliveryPriority::INVALID ? GetPriorityOfMessage(data, sendData.dataLength) : overwritePriority, buffer, bufferSize, connectionPayloadSize, messageHandle);
+    const bool successfullyQueued = queue.SplitAndAddMessage(overwritePriority == DeliveryPriority::INVALID ? GetPriorityOfMessage(data, sendData.dataLength) : overwritePriority, (u8*)&sendDataPacked, data, sendData.dataLength.GetRaw(), connectionPayloadSize, messageHandle);
 
     if(successfullyQueued){
         if (fillTxBuffers) FillTransmitBuffers();
@@ -170,13 +166,21 @@ void BaseConnection::FillTransmitBuffers()
         ChunkedPacketQueue* activeQueue = queuePriorityPair.queue;
         if (!activeQueue) return;
 
-        //Get the next packet from the packet queue that was not yet queued
+        //Get the next packet from the packet queue that was not yet queued. If the packet is stored
+        //contiguously and is not modified before sending, it is handed to the softdevice directly from the queue.
         DYNAMIC_ARRAY(queueBuffer, connectionMtu + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
-        const u16 packetLength = activeQueue->PeekLookAhead(queueBuffer, connectionMtu + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED) - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
+        SizedData packet = { nullptr, 0 };
+        if (!ModifiesDataBeforeTransmission()) packet = activeQueue->PeekLookAheadInPlace();
+        if (packet.data == nullptr || packet.length.GetRaw() > connectionMtu + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED)
+        {
+            packet.length = activeQueue->PeekLookAhead(queueBuffer, connectionMtu + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
+            packet.data = queueBuffer;
+        }
+        const u16 packetLength = packet.length.GetRaw() - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
 
         //Unpack data from sendQueue
-        BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)queueBuffer;
-        u8* data = (queueBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
+        BaseConnectionSendDataPacked* sendDataPacked = (BaseConnectionSendDataPacked*)packet.data;
+        u8* data = (packet.data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
 
         //The subclass is allowed to modify the packet before it is sent, it will place the modified packet into the data buffer.
         //This could be encryption of the data.
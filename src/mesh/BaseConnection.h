@@ -192,6 +192,8 @@ class BaseConnection
         virtual bool QueueVitalPrioData() { return false; };
         //Allows a subclass to process data closely before sending it
         virtual MessageLength ProcessDataBeforeTransmission(u8* message, MessageLength messageLength, MessageLength bufferLength);
+        //Must return true if ProcessDataBeforeTransmission modifies the message, packets are then copied out of the queue before sending
+        virtual bool ModifiesDataBeforeTransmission() const { return false; }
         //Called after data has been queued in the softdevice, pay attention that data points to the full packet in the queue
         //whereas sentData is the data that was really sent (e.g. the packet was split or preprocessed in some way before sending)
         virtual void PacketSuccessfullyQueuedWithSoftdevice(SizedData* sentData);
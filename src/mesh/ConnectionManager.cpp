@@ -501,6 +501,13 @@ ErrorType ConnectionManager::SendMeshMessageInternal(u8* data, u16 dataLength, b
             }
         }
 
+#if IS_ACTIVE(UNICAST_ROUTING)
+        //Otherwise use the connection that leads to the receiver if we know it
+        if (!receiverConn) {
+            receiverConn = GetUnicastRoute(packetHeader->receiver);
+        }
+#endif
+
         //Send to receiver or broadcast if not directly connected to us
         if(receiverConn){
             bool result = receiverConn.SendData(data, dataLength, reliable);
@@ -764,10 +771,14 @@ void ConnectionManager::GattcHandleValueEventHandler(const FruityHal::GattcHandl
 }
 
 //This method accepts connPackets and distributes it to all other mesh connections
-void ConnectionManager::RouteMeshData(BaseConnection* connection, BaseConnectionSendData* sendData, u8 const * data) const
+void ConnectionManager::RouteMeshData(BaseConnection* connection, BaseConnectionSendData* sendData, u8 const * data)
 {
     ConnPacketHeader const * packetHeader = (ConnPacketHeader const *) data;
 
+#if IS_ACTIVE(UNICAST_ROUTING)
+    LearnUnicastRoute(packetHeader->sender, connection);
+#endif
+
 
     /*#################### Modification ############################*/
     //We ask all our modules to decide if this packet should be routed, the modules could also modify the packet content
@@ -823,6 +834,19 @@ void ConnectionManager::RouteMeshData(BaseConnection* connection, BaseConnection
         if(packetHeader->messageType != MessageType::CLUSTER_INFO_UPDATE
             && packetHeader->messageType != MessageType::UPDATE_TIMESTAMP)
         {
+#if IS_ACTIVE(UNICAST_ROUTING)
+            //If we know the branch that leads to the receiver, the other mesh connections can be skipped
+            MeshConnectionHandle route = GetUnicastRoute(packetHeader->receiver);
+            if (route && route.GetConnection() != connection)
+            {
+                if (!(routingDecision & ROUTING_DECISION_BLOCK_TO_MESH))
+                {
+                    route.SendData(sendData, (const u8*)packetHeader);
+                }
+                routingDecision |= ROUTING_DECISION_BLOCK_TO_MESH;
+            }
+#endif
+
             //Send to all other connections
             BroadcastMeshData(connection, sendData, (const u8*)packetHeader, routingDecision);
         }
@@ -855,6 +879,71 @@ void ConnectionManager::BroadcastMeshData(const BaseConnection* ignoreConnection
     }
 }
 
+#if IS_ACTIVE(UNICAST_ROUTING)
+void ConnectionManager::LearnUnicastRoute(NodeId sender, const BaseConnection* connection)
+{
+    if (
+        !GS->config.enableUnicastRouting
+        || connection == nullptr
+        || connection->connectionType != ConnectionType::FRUITYMESH
+        || !connection->HandshakeDone()
+        || sender < NODE_ID_DEVICE_BASE
+        || sender >= NODE_ID_DEVICE_BASE + NODE_ID_DEVICE_BASE_SIZE
+        || sender == GS->node.configuration.nodeId
+    ) {
+        return;
+    }
+
+    //Update the existing route or replace the oldest one
+    UnicastRoute* route = &unicastRoutes[0];
+    for (u32 i = 0; i < UNICAST_ROUTING_TABLE_SIZE; i++)
+    {
+        if (unicastRoutes[i].nodeId == sender)
+        {
+            route = &unicastRoutes[i];
+            break;
+        }
+        if (unicastRoutes[i].nodeId == NODE_ID_BROADCAST || GS->appTimerDs - unicastRoutes[i].learnedTimeDs > GS->appTimerDs - route->learnedTimeDs)
+        {
+            route = &unicastRoutes[i];
+        }
+    }
+
+    route->nodeId = sender;
+    route->nextHopId = connection->partnerId;
+    route->learnedTimeDs = GS->appTimerDs;
+}
+
+MeshConnectionHandle ConnectionManager::GetUnicastRoute(NodeId receiver) const
+{
+    if (
+        !GS->config.enableUnicastRouting
+        || receiver < NODE_ID_DEVICE_BASE
+        || receiver >= NODE_ID_DEVICE_BASE + NODE_ID_DEVICE_BASE_SIZE
+    ) {
+        return MeshConnectionHandle();
+    }
+
+    for (u32 i = 0; i < UNICAST_ROUTING_TABLE_SIZE; i++)
+    {
+        if (unicastRoutes[i].nodeId != receiver) continue;
+
+        if (GS->appTimerDs - unicastRoutes[i].learnedTimeDs > UNICAST_ROUTE_MAX_AGE_DS) break;
+
+        MeshConnectionHandle conn = GetMeshConnectionToPartner(unicastRoutes[i].nextHopId);
+        if (conn && conn.IsHandshakeDone()) return conn;
+        break;
+    }
+
+    return MeshConnectionHandle();
+}
+
+void ConnectionManager::ClearUnicastRoutes()
+{
+    CheckedMemset(unicastRoutes, 0, sizeof(unicastRoutes));
+}
+#endif //IS_ACTIVE(UNICAST_ROUTING)
+
 bool ConnectionManager::IsReceiverOfNodeId(NodeId nodeId) const
 {
     //Check if we are part of the firmware group that should receive this image
@@ -64,6 +64,14 @@ class MeshAccessConnection;
 class BaseConnectionHandle;
 class CherrySim;
 
+//Stores through which directly connected partner a node was last heard from
+struct UnicastRoute
+{
+    NodeId nodeId;
+    NodeId nextHopId;
+    u32 learnedTimeDs;
+};
+
 /*
  * The ConnectionManager is the central place that manages the creation and deletion of all connections and also
  * provides management functionality for tasks that cannot be done without having access to multiple connections.
@@ -98,6 +106,17 @@ private:
 TESTER_PUBLIC:
     BaseConnection* allConnections[TOTAL_NUM_CONNECTIONS];
 
+    //Learned from the sender of packets received over mesh connections, as the mesh is a tree, packets
+    //to that node only have to be sent to this partner. Invalidated whenever the cluster changes.
+#if IS_ACTIVE(UNICAST_ROUTING)
+    static constexpr u32 UNICAST_ROUTE_MAX_AGE_DS = SEC_TO_DS(120);
+    UnicastRoute unicastRoutes[UNICAST_ROUTING_TABLE_SIZE] = {};
+
+    void LearnUnicastRoute(NodeId sender, const BaseConnection* connection);
+    //Returns the mesh connection that leads to the given node or an invalid handle if it is not known
+    MeshConnectionHandle GetUnicastRoute(NodeId receiver) const;
+#endif
+
 
 
 public:
@@ -163,9 +182,14 @@ public:
     // Returns false if data was not send for at least one connection
     bool BroadcastMeshPacket(u8* data, u16 dataLength, bool reliable) const;
 
-    void RouteMeshData(BaseConnection* connection, BaseConnectionSendData* sendData, u8 const * data) const;
+    void RouteMeshData(BaseConnection* connection, BaseConnectionSendData* sendData, u8 const * data);
     void BroadcastMeshData(const BaseConnection* ignoreConnection, BaseConnectionSendData* sendData, u8 const * data, RoutingDecision routingDecision) const;
 
+#if IS_ACTIVE(UNICAST_ROUTING)
+    //Forgets all learned unicast routes, must be called if the topology of the cluster changed
+    void ClearUnicastRoutes();
+#endif
+
     //Whether or not the node should receive and dispatch messages that are sent to the given nodeId
     bool IsReceiverOfNodeId(NodeId nodeId) const;
 
@@ -300,6 +300,9 @@ void BootModules()
 
     INITIALIZE_MODULES(true);
 
+    //Modules declare their event subscriptions in their constructors
+    GS->BuildEventSubscriberTables();
+
     //Start all Modules
     for (u32 i = 0; i < GS->amountOfModules; i++) {
         //Every board has the ability to overwrite the module configuration before
@@ -403,9 +406,10 @@ void DispatchButtonEvents(u8 buttonId, u32 buttonHoldTimeDs)
 {
 #if IS_ACTIVE(BUTTONS)
     logt("MAIN", "Button %u pressed %u ds", buttonId, buttonHoldTimeDs);
-    for(u32 i=0; i<GS->amountOfModules; i++){
-        if(GS->activeModules[i]->configurationPointer->moduleActive){
-            GS->activeModules[i]->ButtonHandler(buttonId, buttonHoldTimeDs);
+    for(u32 i=0; i<GS->GetAmountOfEventSubscribers(ModuleEvent::BUTTON); i++){
+        Module* module = GS->GetEventSubscriber(ModuleEvent::BUTTON, i);
+        if(module->configurationPointer->moduleActive){
+            module->ButtonHandler(buttonId, buttonHoldTimeDs);
         }
     }
 #endif
@@ -432,10 +436,11 @@ void DispatchTimerEvents(u16 passedTimeDs)
     GS->sig.TimerEventHandler(passedTimeDs);
 #endif
 
-    //Dispatch event to all modules
-    for(u32 i=0; i<GS->amountOfModules; i++){
-        if(GS->activeModules[i]->configurationPointer->moduleActive){
-            GS->activeModules[i]->TimerEventHandler(passedTimeDs);
+    //Dispatch event to all subscribed modules
+    for(u32 i=0; i<GS->GetAmountOfEventSubscribers(ModuleEvent::TIMER); i++){
+        Module* module = GS->GetEventSubscriber(ModuleEvent::TIMER, i);
+        if(module->configurationPointer->moduleActive){
+            module->TimerEventHandler(passedTimeDs);
         }
     }
 }
@@ -448,9 +453,10 @@ void DispatchEvent(const FruityHal::GapRssiChangedEvent & e)
 void DispatchEvent(const FruityHal::GapAdvertisementReportEvent & e)
 {
     ScanController::GetInstance().ScanEventHandler(e);
-    for (u32 i = 0; i < GS->amountOfModules; i++) {
-        if (GS->activeModules[i]->configurationPointer->moduleActive) {
-            GS->activeModules[i]->GapAdvertisementReportEventHandler(e);
+    for (u32 i = 0; i < GS->GetAmountOfEventSubscribers(ModuleEvent::GAP_ADVERTISEMENT_REPORT); i++) {
+        Module* module = GS->GetEventSubscriber(ModuleEvent::GAP_ADVERTISEMENT_REPORT, i);
+        if (module->configurationPointer->moduleActive) {
+            module->GapAdvertisementReportEventHandler(e);
         }
     }
 }
@@ -459,9 +465,10 @@ void DispatchEvent(const FruityHal::GapConnectedEvent & e)
 {
     GAPController::GetInstance().GapConnectedEventHandler(e);
     AdvertisingController::GetInstance().GapConnectedEventHandler(e);
-    for (u32 i = 0; i < GS->amountOfModules; i++) {
-        if (GS->activeModules[i]->configurationPointer->moduleActive) {
-            GS->activeModules[i]->GapConnectedEventHandler(e);
+    for (u32 i = 0; i < GS->GetAmountOfEventSubscribers(ModuleEvent::GAP_CONNECTED); i++) {
+        Module* module = GS->GetEventSubscriber(ModuleEvent::GAP_CONNECTED, i);
+        if (module->configurationPointer->moduleActive) {
+            module->GapConnectedEventHandler(e);
         }
     }
 }
@@ -470,9 +477,10 @@ void DispatchEvent(const FruityHal::GapDisconnectedEvent & e)
 {
     GAPController::GetInstance().GapDisconnectedEventHandler(e);
     AdvertisingController::GetInstance().GapDisconnectedEventHandler(e);
-    for (u32 i = 0; i < GS->amountOfModules; i++) {
-        if (GS->activeModules[i]->configurationPointer->moduleActive) {
-            GS->activeModules[i]->GapDisconnectedEventHandler(e);
+    for (u32 i = 0; i < GS->GetAmountOfEventSubscribers(ModuleEvent::GAP_DISCONNECTED); i++) {
+        Module* module = GS->GetEventSubscriber(ModuleEvent::GAP_DISCONNECTED, i);
+        if (module->configurationPointer->moduleActive) {
+            module->GapDisconnectedEventHandler(e);
         }
     }
 }
@@ -527,10 +535,10 @@ void DispatchEvent(const FruityHal::GattcHandleValueEvent & e)
 void DispatchEvent(const FruityHal::GattDataTransmittedEvent & e)
 {
     ConnectionManager::GetInstance().GattDataTransmittedEventHandler(e);
-    for (int i = 0; i < MAX_MODULE_COUNT; i++) {
-        if (GS->activeModules[i] != nullptr
-            && GS->activeModules[i]->configurationPointer->moduleActive) {
-            GS->activeModules[i]->GattDataTransmittedEventHandler(e);
+    for (u32 i = 0; i < GS->GetAmountOfEventSubscribers(ModuleEvent::GATT_DATA_TRANSMITTED); i++) {
+        Module* module = GS->GetEventSubscriber(ModuleEvent::GATT_DATA_TRANSMITTED, i);
+        if (module->configurationPointer->moduleActive) {
+            module->GattDataTransmittedEventHandler(e);
         }
     }
 }
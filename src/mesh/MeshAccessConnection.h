@@ -162,6 +162,7 @@ public:
 
     /*############### Sending ##################*/
     MessageLength ProcessDataBeforeTransmission(u8* message, MessageLength messageLength, MessageLength bufferLength) override final;
+    bool ModifiesDataBeforeTransmission() const override final { return true; }
     bool SendData(BaseConnectionSendData* sendData, u8 const * data, u32 * messageHandle=nullptr);
     bool SendData(u8 const * data, MessageLength dataLength, bool reliable, u32 * messageHandle=nullptr) override final;
     bool ShouldSendDataToNodeId(NodeId nodeId) const;
@@ -133,9 +133,10 @@ void MeshConnection::DisconnectAndRemove(AppDisconnectReason reason)
             connectedClusterId);
 
     //Call our lovely modules
-    for(u32 i=0; i<GS->amountOfModules; i++){
-        if(GS->activeModules[i]->configurationPointer->moduleActive){
-            GS->activeModules[i]->MeshConnectionChangedHandler(*this);
+    for(u32 i=0; i<GS->GetAmountOfEventSubscribers(ModuleEvent::MESH_CONNECTION_CHANGED); i++){
+        Module* module = GS->GetEventSubscriber(ModuleEvent::MESH_CONNECTION_CHANGED, i);
+        if(module->configurationPointer->moduleActive){
+            module->MeshConnectionChangedHandler(*this);
         }
     }
 
@@ -77,6 +77,7 @@ Node::Node()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(NodeConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER);
 }
 
 void Node::Init()
@@ -374,9 +375,10 @@ void Node::HandshakeDoneHandler(MeshConnection* connection, bool completedAsWinn
     SendClusterInfoUpdate(connection, nullptr);
 
     //Call our lovely modules
-    for(u32 i=0; i<GS->amountOfModules; i++){
-        if(GS->activeModules[i]->configurationPointer->moduleActive){
-            GS->activeModules[i]->MeshConnectionChangedHandler(*connection);
+    for(u32 i=0; i<GS->GetAmountOfEventSubscribers(ModuleEvent::MESH_CONNECTION_CHANGED); i++){
+        Module* module = GS->GetEventSubscriber(ModuleEvent::MESH_CONNECTION_CHANGED, i);
+        if(module->configurationPointer->moduleActive){
+            module->MeshConnectionChangedHandler(*connection);
         }
     }
 
@@ -2583,6 +2585,12 @@ void Node::SetClusterSize(ClusterSize clusterSize)
         clusterSizeChangeHandled = false;
         clusterSizeTransitionTimeoutDs = SEC_TO_DS((u32)Conf::GetInstance().clusterSizeDiscoveryChangeDelaySec);
     }
+
+#if IS_ACTIVE(UNICAST_ROUTING)
+    //Some branch of the tree was added or removed, so learned routes might point in the wrong direction
+    if (clusterSize != this->clusterSize) GS->cm.ClearUnicastRoutes();
+#endif
+
     this->clusterSize = clusterSize;
 }
 
@@ -411,6 +411,10 @@ void AutoActModule::RecordStorageEventHandler(u16 recordId, RecordStorageResultC
         SIMEXCEPTION(IllegalArgumentException); //LCOV_EXCL_LINE Unclear how to get in this state.
     }
     RecordStorageUserData* ud = (RecordStorageUserData*)userData;
+
+    //Whatever the result, the table might have changed
+    entryFilterDirty = true;
+
     if (userType == (u32)AutoActModuleTriggerAndResponseMessages::SET_ENTRY)
     {
         if (resultCode != RecordStorageResultCode::SUCCESS)
@@ -508,6 +512,7 @@ AutoActModule::AutoActModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(AutoActModuleConfiguration);
+    subscribedEvents = NO_MODULE_EVENTS;
 
     //Set defaults
     ResetToDefaultConfiguration();
@@ -768,10 +773,16 @@ void AutoActModule::MeshMessageReceivedHandler(BaseConnection* connection, BaseC
 
         if(headerRead)
         {
+            UpdateEntryFilter();
+
+            //Most messages do not match any entry and can be rejected without reading the table
+            const u8 hash = GetEntryFilterHash(receiverId, moduleId, component, registerAddress);
+            if ((entryFilterHashMask & (1UL << (hash % 32))) == 0) return;
+
             for (u32 i = 0; i < MAX_AMOUNT_OF_ENTRIES; i++)
             {
-                // FIXME: Quite a heavy performance hit currently. 
-                //        See https://repo.mwaysolutions.com/relution/fruitymesh/-/merge_requests/1409#note_336338
+                if (!entryFilterExists.get(i) || entryFilterHashes[i] != hash) continue;
+
                 const AutoActTableEntryV0* entry = getTableEntryV0(i);
                 if (entry) // Entry exists
                 {
@@ -841,6 +852,32 @@ void AutoActModule::MeshMessageReceivedHandler(BaseConnection* connection, BaseC
 #endif //IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
 }
 
+u8 AutoActModule::GetEntryFilterHash(NodeId receiverId, ModuleIdWrapper moduleId, u16 component, u16 registerAddress)
+{
+    u32 hash = (u32)receiverId;
+    hash = hash * 31 + (u32)moduleId;
+    hash = hash * 31 + component;
+    hash = hash * 31 + registerAddress;
+    return (u8)(hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24));
+}
+
+void AutoActModule::UpdateEntryFilter()
+{
+    if (!entryFilterDirty) return;
+    entryFilterDirty = false;
+
+    entryFilterHashMask = 0;
+    for (u32 i = 0; i < MAX_AMOUNT_OF_ENTRIES; i++)
+    {
+        const AutoActTableEntryV0* entry = getTableEntryV0(i);
+        entryFilterExists.set(i, entry != nullptr);
+        if (entry == nullptr) continue;
+
+        entryFilterHashes[i] = GetEntryFilterHash(entry->receiverNodeIdFilter, entry->moduleIdFilter, entry->componentFilter, entry->registerFilter);
+        entryFilterHashMask |= 1UL << (entryFilterHashes[i] % 32);
+    }
+}
+
 const AutoActTableEntryV0* AutoActModule::getTableEntryV0(u8 entryIndex)
 {
     SizedData data = GS->recordStorage.GetRecordData(RECORD_STORAGE_RECORD_ID_AUTO_ACT_ENTRIES_BASE + entryIndex);
@@ -198,6 +198,17 @@ TESTER_PUBLIC:
         u8 requestHandle;
     };
 
+    //RAM filter of the table so that most messages can be rejected without reading the entries from flash
+    //Each entry is represented by a hash of its filter fields and every hash sets one bit in the filterHashMask
+    bool entryFilterDirty = true;
+    u32 entryFilterHashMask = 0;
+    BitMask<MAX_AMOUNT_OF_ENTRIES> entryFilterExists;
+    u8 entryFilterHashes[MAX_AMOUNT_OF_ENTRIES] = {};
+
+    static u8 GetEntryFilterHash(NodeId receiverId, ModuleIdWrapper moduleId, u16 component, u16 registerAddress);
+    //Reads the table once the filter was invalidated by a write to the table
+    void UpdateEntryFilter();
+
     void RecordStorageEventHandler(u16 recordId, RecordStorageResultCode resultCode, u32 userType, u8* userData, u16 userDataLength) override final;
 
     void SendResponse(const AutoActModuleSetEntryResponse&   response, NodeId id, u8 requestHandle) const;
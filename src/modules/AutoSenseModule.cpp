@@ -36,6 +36,84 @@
 #include <Node.h>
 #include <IoModule.h>
 
+#if IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+static bool IsAggregateFunction(AutoSenseFunction function)
+{
+    return function == AutoSenseFunction::SUM
+        || function == AutoSenseFunction::MEDIAN
+        || function == AutoSenseFunction::AVERAGE
+        || function == AutoSenseFunction::MIN
+        || function == AutoSenseFunction::MAX;
+}
+
+// Returns 0 for data types that can't be aggregated.
+static u32 GetNumericSize(DataTypeDescriptor dataType)
+{
+    switch (dataType)
+    {
+    case DataTypeDescriptor::U8_LE:      return 1;
+    case DataTypeDescriptor::U16_LE:     return 2;
+    case DataTypeDescriptor::U32_LE:     return 4;
+    case DataTypeDescriptor::I8_LE:      return 1;
+    case DataTypeDescriptor::I16_LE:     return 2;
+    case DataTypeDescriptor::I32_LE:     return 4;
+    case DataTypeDescriptor::FLOAT32_LE: return 4;
+    default:                             return 0;
+    }
+}
+
+static double DecodeNumeric(const u8* data, DataTypeDescriptor dataType)
+{
+    //The data is not necessarily aligned, so it is copied first.
+    switch (dataType)
+    {
+    case DataTypeDescriptor::U8_LE:      { u8    value; CheckedMemcpy(&value, data, sizeof(value)); return value; }
+    case DataTypeDescriptor::U16_LE:     { u16   value; CheckedMemcpy(&value, data, sizeof(value)); return value; }
+    case DataTypeDescriptor::U32_LE:     { u32   value; CheckedMemcpy(&value, data, sizeof(value)); return value; }
+    case DataTypeDescriptor::I8_LE:      { i8    value; CheckedMemcpy(&value, data, sizeof(value)); return value; }
+    case DataTypeDescriptor::I16_LE:     { i16   value; CheckedMemcpy(&value, data, sizeof(value)); return value; }
+    case DataTypeDescriptor::I32_LE:     { i32   value; CheckedMemcpy(&value, data, sizeof(value)); return value; }
+    case DataTypeDescriptor::FLOAT32_LE: { float value; CheckedMemcpy(&value, data, sizeof(value)); return value; }
+    default:                             SIMEXCEPTION(IllegalArgumentException); return 0;
+    }
+}
+
+// Integers are rounded and saturated to the range of the data type, e.g. a SUM must not wrap around.
+static double RoundAndClamp(double value, double min, double max)
+{
+    value = value < 0 ? value - 0.5 : value + 0.5;
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+static void EncodeNumeric(double value, DataTypeDescriptor dataType, u8* output)
+{
+    switch (dataType)
+    {
+    case DataTypeDescriptor::U8_LE:      { u8    v = (u8) RoundAndClamp(value, 0, UINT8_MAX);          CheckedMemcpy(output, &v, sizeof(v)); break; }
+    case DataTypeDescriptor::U16_LE:     { u16   v = (u16)RoundAndClamp(value, 0, UINT16_MAX);         CheckedMemcpy(output, &v, sizeof(v)); break; }
+    case DataTypeDescriptor::U32_LE:     { u32   v = (u32)RoundAndClamp(value, 0, UINT32_MAX);         CheckedMemcpy(output, &v, sizeof(v)); break; }
+    case DataTypeDescriptor::I8_LE:      { i8    v = (i8) RoundAndClamp(value, INT8_MIN, INT8_MAX);    CheckedMemcpy(output, &v, sizeof(v)); break; }
+    case DataTypeDescriptor::I16_LE:     { i16   v = (i16)RoundAndClamp(value, INT16_MIN, INT16_MAX);  CheckedMemcpy(output, &v, sizeof(v)); break; }
+    case DataTypeDescriptor::I32_LE:     { i32   v = (i32)RoundAndClamp(value, INT32_MIN, INT32_MAX);  CheckedMemcpy(output, &v, sizeof(v)); break; }
+    case DataTypeDescriptor::FLOAT32_LE: { float v = (float)value;                                     CheckedMemcpy(output, &v, sizeof(v)); break; }
+    default:                             SIMEXCEPTION(IllegalArgumentException); break;
+    }
+}
+
+static u32 GetFunctionParamsLength(const AutoSenseTableEntryV0* tableEntry)
+{
+    if (tableEntry->reportFunction == AutoSenseFunction::THRESHOLD) return tableEntry->length;
+    return 0;
+}
+
+static const u8* GetFunctionParams(const AutoSenseTableEntryV0* tableEntry)
+{
+    return ((const u8*)tableEntry) + sizeof(AutoSenseTableEntryV0);
+}
+#endif //IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+
 AutoSenseModule::AutoSenseModule()
     : Module(ModuleId::AUTO_SENSE_MODULE, "autosense")
 {
@@ -45,6 +123,7 @@ AutoSenseModule::AutoSenseModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(AutoSenseModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER);
 
     GS->timeManager.AddTimeSyncedListener(this);
 
@@ -82,6 +161,11 @@ void AutoSenseModule::ConfigurationLoadedHandler(u8* migratableConfig, u16 migra
         {
             AddScheduleEvents(entryIndex, tableEntry);
             valueCache.registerSlot(entryIndex, tableEntry->length);
+            if (tableEntry->reportFunction == AutoSenseFunction::MEDIAN
+                && sampleCache.isEnoughSpaceLeftForSlotWithSize(tableEntry->length * MAX_AMOUNT_OF_MEDIAN_SAMPLES))
+            {
+                sampleCache.registerSlot(entryIndex, tableEntry->length * MAX_AMOUNT_OF_MEDIAN_SAMPLES);
+            }
         }
     }
     //Start the Module...
@@ -140,6 +224,22 @@ void AutoSenseModule::TimerEventHandler(u16 passedTimeDs)
         {
             // No special handling required.
         }
+        else if (IsAggregateFunction(tableEntry->reportFunction))
+        {
+            if (!FinishAggregate(entryIndex, tableEntry))
+            {
+                GS->logger.LogCustomCount(CustomErrorTypes::WARN_AUTO_SENSE_REPORT_WITHOUT_DATA);
+                continue; // No value was polled during this window, e.g. because polling is slower than reporting.
+            }
+        }
+        else if (tableEntry->reportFunction == AutoSenseFunction::THRESHOLD)
+        {
+            // Crossing the threshold was already sent when it happened.
+            if (!aboveThreshold.get(entryIndex))
+            {
+                continue;
+            }
+        }
         else
         {
             SIMEXCEPTION(IllegalStateException); // LCOV_EXCL_LINE Unclear how to get in this state.
@@ -351,6 +451,23 @@ bool AutoSenseModule::ConsumeData(ModuleIdWrapper moduleId, u16 component, u16 r
                 SendEntry(entryIndex, tableEntry);
             }
         }
+        else if (IsAggregateFunction(tableEntry->reportFunction))
+        {
+            AddSample(entryIndex, tableEntry, data);
+        }
+        else if (tableEntry->reportFunction == AutoSenseFunction::THRESHOLD)
+        {
+            const bool above = DecodeNumeric(data, tableEntry->dataType) >= DecodeNumeric(GetFunctionParams(tableEntry), tableEntry->dataType);
+            //Without a previous value, the threshold only counts as crossed if the value is at or above it
+            const bool previousAbove = anyValueRecorded.get(entryIndex) && aboveThreshold.get(entryIndex);
+            const bool crossed = above != previousAbove;
+            aboveThreshold.set(entryIndex, above);
+            CheckedMemcpy(writePointer, data, length);
+            if (crossed)
+            {
+                SendEntry(entryIndex, tableEntry);
+            }
+        }
         else
         {
             SIMEXCEPTION(IllegalStateException); //LCOV_EXCL_LINE Unclear how to get in this state.
@@ -378,7 +495,9 @@ const AutoSenseTableEntryV0* AutoSenseModule::getTableEntryV0(u8 entryIndex)
 {
 #if IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
     SizedData data = GS->recordStorage.GetRecordData(RECORD_STORAGE_RECORD_ID_AUTO_SENSE_ENTRIES_BASE + entryIndex);
-    if (data.data && data.length >= sizeof(AutoSenseTableEntryV0))
+    if (data.data
+        && data.length >= sizeof(AutoSenseTableEntryV0)
+        && data.length >= sizeof(AutoSenseTableEntryV0) + GetFunctionParamsLength((const AutoSenseTableEntryV0*)data.data))
     {
         return (const AutoSenseTableEntryV0*)data.data;
     }
@@ -401,6 +520,7 @@ void AutoSenseModule::RecordStorageEventHandler(u16 recordId, RecordStorageResul
         if (resultCode != RecordStorageResultCode::SUCCESS)
         {
             valueCache.unregisterSlot(ud->entryIndex);                                                                                             //LCOV_EXCL_LINE Unclear how to get in this state.
+            if (sampleCache.isSlotRegistered(ud->entryIndex)) sampleCache.unregisterSlot(ud->entryIndex);                                         //LCOV_EXCL_LINE Unclear how to get in this state.
             SendResponse(AutoSenseModuleSetEntryResponse{ TranslateRecordStorageCode(resultCode), ud->entryIndex }, ud->sender, ud->requestHandle); //LCOV_EXCL_LINE Unclear how to get in this state.
         }
         else
@@ -415,6 +535,8 @@ void AutoSenseModule::RecordStorageEventHandler(u16 recordId, RecordStorageResul
             {
                 pollSchedule.removeEvent(ud->entryIndex);
                 reportSchedule.removeEvent(ud->entryIndex);
+                ResetAggregate(ud->entryIndex);
+                aboveThreshold.set(ud->entryIndex, false);
 
                 AddScheduleEvents(ud->entryIndex, table);
             }
@@ -436,8 +558,11 @@ void AutoSenseModule::RecordStorageEventHandler(u16 recordId, RecordStorageResul
             pollSchedule.removeEvent(ud->entryIndex);
             reportSchedule.removeEvent(ud->entryIndex);
             valueCache.unregisterSlot(ud->entryIndex);
+            if (sampleCache.isSlotRegistered(ud->entryIndex)) sampleCache.unregisterSlot(ud->entryIndex);
             anyValueRecorded.set(ud->entryIndex, false);
             readyForSending.set(ud->entryIndex, false);
+            aboveThreshold.set(ud->entryIndex, false);
+            ResetAggregate(ud->entryIndex);
 
             if (userType == (u32)AutoSenseModuleTriggerAndResponseMessages::CLEAR_ENTRY)
             {
@@ -526,6 +651,100 @@ void AutoSenseModule::SendEntry(u8 entryIndex, const AutoSenseTableEntryV0* tabl
 #endif
 }
 
+void AutoSenseModule::AddSample(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry, const u8* data)
+{
+#if IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+    AggregateState& aggregate = aggregates[entryIndex];
+    const double sample = DecodeNumeric(data, tableEntry->dataType);
+
+    if (tableEntry->reportFunction == AutoSenseFunction::SUM
+        || tableEntry->reportFunction == AutoSenseFunction::AVERAGE)
+    {
+        aggregate.sum += (float)sample;
+    }
+    else if (tableEntry->reportFunction == AutoSenseFunction::MIN)
+    {
+        if (aggregate.sampleCount == 0 || sample < DecodeNumeric(aggregate.extreme, tableEntry->dataType)) CheckedMemcpy(aggregate.extreme, data, tableEntry->length);
+    }
+    else if (tableEntry->reportFunction == AutoSenseFunction::MAX)
+    {
+        if (aggregate.sampleCount == 0 || sample > DecodeNumeric(aggregate.extreme, tableEntry->dataType)) CheckedMemcpy(aggregate.extreme, data, tableEntry->length);
+    }
+    else if (tableEntry->reportFunction == AutoSenseFunction::MEDIAN)
+    {
+        // If the window holds more samples than we can store, the oldest ones are overwritten.
+        if (!sampleCache.isSlotRegistered(entryIndex)) return;
+        u8* samples = sampleCache.get(entryIndex);
+        CheckedMemcpy(samples + (aggregate.sampleCount % MAX_AMOUNT_OF_MEDIAN_SAMPLES) * tableEntry->length, data, tableEntry->length);
+    }
+    else
+    {
+        SIMEXCEPTION(IllegalArgumentException); //LCOV_EXCL_LINE Unclear how to get in this state.
+    }
+
+    if (aggregate.sampleCount < UINT16_MAX) aggregate.sampleCount++;
+#endif //IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+}
+
+bool AutoSenseModule::FinishAggregate(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry)
+{
+#if IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+    const AggregateState& aggregate = aggregates[entryIndex];
+    if (aggregate.sampleCount == 0) return false;
+
+    u8* writePointer = valueCache.get(entryIndex);
+    if (writePointer == nullptr) return false; //LCOV_EXCL_LINE Unclear how to get in this state.
+
+    double result = aggregate.sum;
+    if (tableEntry->reportFunction == AutoSenseFunction::AVERAGE)
+    {
+        result = (double)aggregate.sum / aggregate.sampleCount;
+    }
+    else if (tableEntry->reportFunction == AutoSenseFunction::MIN
+        || tableEntry->reportFunction == AutoSenseFunction::MAX)
+    {
+        CheckedMemcpy(writePointer, aggregate.extreme, tableEntry->length);
+        ResetAggregate(entryIndex);
+        return true;
+    }
+    else if (tableEntry->reportFunction == AutoSenseFunction::MEDIAN)
+    {
+        if (!sampleCache.isSlotRegistered(entryIndex)) return false;
+        const u8* samples = sampleCache.get(entryIndex);
+        const u32 amountOfSamples = aggregate.sampleCount < MAX_AMOUNT_OF_MEDIAN_SAMPLES ? aggregate.sampleCount : MAX_AMOUNT_OF_MEDIAN_SAMPLES;
+
+        // Insertion sort, the amount of samples is small.
+        double sorted[MAX_AMOUNT_OF_MEDIAN_SAMPLES];
+        for (u32 i = 0; i < amountOfSamples; i++)
+        {
+            const double sample = DecodeNumeric(samples + i * tableEntry->length, tableEntry->dataType);
+            u32 k = i;
+            for (; k > 0 && sorted[k - 1] > sample; k--)
+            {
+                sorted[k] = sorted[k - 1];
+            }
+            sorted[k] = sample;
+        }
+        if (amountOfSamples % 2 == 1) result = sorted[amountOfSamples / 2];
+        else                          result = (sorted[amountOfSamples / 2 - 1] + sorted[amountOfSamples / 2]) / 2;
+    }
+
+    EncodeNumeric(result, tableEntry->dataType, writePointer);
+
+    ResetAggregate(entryIndex);
+    return true;
+#else
+    return false;
+#endif //IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+}
+
+void AutoSenseModule::ResetAggregate(u8 entryIndex)
+{
+#if IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+    aggregates[entryIndex] = {};
+#endif //IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
+}
+
 void AutoSenseModule::AddScheduleEvents(u32 entryIndex, const AutoSenseTableEntryV0* table)
 {
 #if IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
@@ -669,7 +888,7 @@ void AutoSenseModule::ClearEntry(u8 entryIndex, NodeId sender, u8 requestHandle)
 #endif //IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
 }
 
-void AutoSenseModule::SetEntry(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry, u8 moduleVersion, NodeId sender, u8 requestHandle)
+void AutoSenseModule::SetEntry(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry, MessageLength tableEntryBufferSize, u8 moduleVersion, NodeId sender, u8 requestHandle)
 {
 #if IS_INACTIVE(ONLY_SINK_FUNCTIONALITY)
     if (entryIndex >= MAX_AMOUNT_OF_ENTRIES)
@@ -691,6 +910,12 @@ void AutoSenseModule::SetEntry(u8 entryIndex, const AutoSenseTableEntryV0* table
             tableEntry->reportFunction != AutoSenseFunction::LAST
             && tableEntry->reportFunction != AutoSenseFunction::ON_CHANGE_RATE_LIMITED
             && tableEntry->reportFunction != AutoSenseFunction::ON_CHANGE_WITH_PERIODIC_REPORT
+            && tableEntry->reportFunction != AutoSenseFunction::THRESHOLD
+            && !IsAggregateFunction(tableEntry->reportFunction)
+            )
+        || (
+            (IsAggregateFunction(tableEntry->reportFunction) || tableEntry->reportFunction == AutoSenseFunction::THRESHOLD)
+            && GetNumericSize(tableEntry->dataType) != tableEntry->length
             )
         || !Utility::IsValidModuleIdFormat(tableEntry->moduleId)
         )
@@ -698,6 +923,11 @@ void AutoSenseModule::SetEntry(u8 entryIndex, const AutoSenseTableEntryV0* table
         SendResponse(AutoSenseModuleSetEntryResponse{ AutoSenseModuleResponseCode::UNSUPPORTED_ENTRY_CONTENTS, entryIndex }, sender, requestHandle);
         return;
     }
+    if (tableEntryBufferSize != sizeof(AutoSenseTableEntryV0) + GetFunctionParamsLength(tableEntry))
+    {
+        SendResponse(AutoSenseModuleSetEntryResponse{ AutoSenseModuleResponseCode::UNSUPPORTED_ENTRY_SIZE, entryIndex }, sender, requestHandle);
+        return;
+    }
     bool foundMatchingDataProvider = false;
     for (u32 i = 0; i < MAX_AMOUNT_DATA_PROVIDERS; i++)
     {
@@ -719,14 +949,30 @@ void AutoSenseModule::SetEntry(u8 entryIndex, const AutoSenseTableEntryV0* table
         SendResponse(AutoSenseModuleSetEntryResponse{ AutoSenseModuleResponseCode::FAILED_TO_CREATE_VALUE_CACHE_ENTRY, entryIndex }, sender, requestHandle);
         return;
     }
+    if (sampleCache.isSlotRegistered(entryIndex))
+    {
+        sampleCache.unregisterSlot(entryIndex);
+    }
+    if (tableEntry->reportFunction == AutoSenseFunction::MEDIAN)
+    {
+        // The sample storage is sized by the featureset and might not have room for another MEDIAN entry.
+        if (!sampleCache.isEnoughSpaceLeftForSlotWithSize(tableEntry->length * MAX_AMOUNT_OF_MEDIAN_SAMPLES))
+        {
+            valueCache.unregisterSlot(entryIndex);
+            SendResponse(AutoSenseModuleSetEntryResponse{ AutoSenseModuleResponseCode::FAILED_TO_CREATE_VALUE_CACHE_ENTRY, entryIndex }, sender, requestHandle);
+            return;
+        }
+        sampleCache.registerSlot(entryIndex, tableEntry->length * MAX_AMOUNT_OF_MEDIAN_SAMPLES);
+    }
     RecordStorageUserData userData = {};
     userData.sender = sender;
     userData.entryIndex = entryIndex;
     userData.requestHandle = requestHandle;
-    RecordStorageResultCode code = GS->recordStorage.SaveRecord(RECORD_STORAGE_RECORD_ID_AUTO_SENSE_ENTRIES_BASE + entryIndex, (const u8*)tableEntry, sizeof(*tableEntry), this, (u32)AutoSenseModuleTriggerAndResponseMessages::SET_ENTRY, (u8*)&userData, sizeof(userData));
+    RecordStorageResultCode code = GS->recordStorage.SaveRecord(RECORD_STORAGE_RECORD_ID_AUTO_SENSE_ENTRIES_BASE + entryIndex, (const u8*)tableEntry, tableEntryBufferSize.GetRaw(), this, (u32)AutoSenseModuleTriggerAndResponseMessages::SET_ENTRY, (u8*)&userData, sizeof(userData));
     if (code != RecordStorageResultCode::SUCCESS)
     {
         valueCache.unregisterSlot(entryIndex);
+        if (sampleCache.isSlotRegistered(entryIndex)) sampleCache.unregisterSlot(entryIndex);
         SendResponse(AutoSenseModuleSetEntryResponse{ TranslateRecordStorageCode(code), entryIndex }, sender, requestHandle);
         return;
     }
@@ -753,13 +999,13 @@ void AutoSenseModule::MeshMessageReceivedHandler(BaseConnection* connection, Bas
             {
                 const AutoSenseModuleSetEntryMessage* msg = (const AutoSenseModuleSetEntryMessage*)packet->data;
                 u32 entrySize = sendData->dataLength.GetRaw() - SIZEOF_CONN_PACKET_MODULE - sizeof(AutoSenseModuleSetEntryMessage) + sizeof(AutoSenseModuleSetEntryMessage::data);
-                if (entrySize != sizeof(AutoSenseTableEntryV0))
+                if (entrySize < sizeof(AutoSenseTableEntryV0))
                 {
                     SendResponse(AutoSenseModuleSetEntryResponse{ AutoSenseModuleResponseCode::UNSUPPORTED_ENTRY_SIZE, msg->entryIndex }, packet->header.sender, packet->requestHandle);
                     return;
                 }
                 const AutoSenseTableEntryV0* tableEntry = (const AutoSenseTableEntryV0*)msg->data;
-                SetEntry(msg->entryIndex, tableEntry, msg->moduleVersion, packet->header.sender, packet->requestHandle);
+                SetEntry(msg->entryIndex, tableEntry, entrySize, msg->moduleVersion, packet->header.sender, packet->requestHandle);
             }
             else if (packet->actionType == (u8)AutoSenseModuleTriggerAndResponseMessages::GET_ENTRY && sendData->dataLength >= SIZEOF_CONN_PACKET_MODULE + sizeof(AutoSenseModuleGetEntryMessage))
             {
@@ -852,7 +1098,7 @@ void AutoSenseModule::MeshMessageReceivedHandler(BaseConnection* connection, Bas
                 tableEntry.pollingIvDs = SEC_TO_DS(10);
                 tableEntry.reportingIvDs = SEC_TO_DS(10);
                 tableEntry.reportFunction = AutoSenseFunction::ON_CHANGE_RATE_LIMITED;
-                SetEntry(0, &tableEntry, 0, packet->header.sender, packet->requestHandle);
+                SetEntry(0, &tableEntry, sizeof(tableEntry), 0, packet->header.sender, packet->requestHandle);
             }
             else if (packet->actionType == (u8)AutoSenseModuleTriggerAndResponseMessages::CLEAR_EXAMPLE)
             {
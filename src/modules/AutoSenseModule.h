@@ -66,17 +66,27 @@ enum class AutoSenseFunction : u8
     ON_CHANGE_RATE_LIMITED         = 1,
     ON_CHANGE_WITH_PERIODIC_REPORT = 2,
 
+    // The aggregate functions collect all polled values between two reports
+    // and only send the aggregated value once the report is due. They
+    // require a numeric dataType that matches the length of the entry.
+    // MEDIAN only covers the last 16 samples of the window.
+    SUM                            = 5,
+    MEDIAN                         = 7,
+    AVERAGE                        = 8,
+    MIN                            = 9,
+    MAX                            = 10,
+
+    // Sends the value immediately once it crosses the threshold (in both
+    // directions) and reports it periodically while it stays at or above
+    // the threshold. The threshold follows the entry as function parameter,
+    // encoded in the dataType of the entry.
+    THRESHOLD                      = 11,
+
     // These are already reserved so that multiple devs can
     // implement them while avoiding some merge conflicts.
     UNUSED_BUT_RESERVED_UNBUFFERED = 3,
     UNUSED_BUT_RESERVED_FIRST = 4,
-    UNUSED_BUT_RESERVED_SUM = 5,
     UNUSED_BUT_RESERVED_COUNT_AND_SUM = 6,
-    UNUSED_BUT_RESERVED_MEDIAN = 7,
-    UNUSED_BUT_RESERVED_AVERAGE = 8,
-    UNUSED_BUT_RESERVED_MIN = 9,
-    UNUSED_BUT_RESERVED_MAX = 10,
-    UNUSED_BUT_RESERVED_THRESHOLD = 11,
     UNUSED_BUT_RESERVED_RATE_LIMIT_THRESHOLD_PER_MIN = 12,
 };
 
@@ -109,7 +119,7 @@ struct AutoSenseTableEntryV0
     u16 pollingIvDs;
     u16 reportingIvDs;
     AutoSenseFunction reportFunction; // CAREFUL! V0 only supports a subset of functions
-    //u8 functionParams[]; // Currently unused, thus not implemented.
+    //u8 functionParams[]; // Only present for functions that take parameters, e.g. THRESHOLD.
 };
 STATIC_ASSERT_SIZE(AutoSenseTableEntryV0, 19);
 // This might be overly paranoid, but as these are persisted in
@@ -252,6 +262,28 @@ TESTER_PUBLIC:
     BitMask<MAX_AMOUNT_OF_ENTRIES> anyValueRecorded = {};
     BitMask<MAX_AMOUNT_OF_ENTRIES> readyForSending = {};
     SlotStorage<MAX_AMOUNT_OF_ENTRIES, 512> valueCache;
+
+    // State of the aggregate functions for the current report window.
+    static constexpr u32 MAX_AMOUNT_OF_MEDIAN_SAMPLES = 16;
+    struct AggregateState
+    {
+        union
+        {
+            float sum;     // SUM and AVERAGE
+            u8 extreme[4]; // MIN and MAX keep the raw sample so that integers stay exact
+        };
+        u16 sampleCount;
+    };
+    std::array<AggregateState, MAX_AMOUNT_OF_ENTRIES> aggregates = {};
+    // Only MEDIAN entries have a slot here, holding the last MAX_AMOUNT_OF_MEDIAN_SAMPLES raw samples.
+    SlotStorage<MAX_AMOUNT_OF_ENTRIES, AUTO_SENSE_MEDIAN_SAMPLE_STORAGE_SIZE> sampleCache;
+    BitMask<MAX_AMOUNT_OF_ENTRIES> aboveThreshold = {};
+
+    void AddSample(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry, const u8* data);
+    // Writes the aggregate of the current window to the valueCache and starts a new window.
+    // Returns false if no value was sampled during the window.
+    bool FinishAggregate(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry);
+    void ResetAggregate(u8 entryIndex);
 #endif
 
     const AutoSenseTableEntryV0* getTableEntryV0(u8 entryIndex);
@@ -320,7 +352,7 @@ public:
 
     void MeshMessageReceivedHandler(BaseConnection* connection, BaseConnectionSendData* sendData, ConnPacketHeader const * packetHeader) override;
 
-    void SetEntry(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry, u8 moduleVersion, NodeId sender, u8 requestHandle);
+    void SetEntry(u8 entryIndex, const AutoSenseTableEntryV0* tableEntry, MessageLength tableEntryBufferSize, u8 moduleVersion, NodeId sender, u8 requestHandle);
     void ClearEntry(u8 entryIndex, NodeId sender, u8 requestHandle);
     void ClearAllEntries(NodeId sender, u8 requestHandle);
 
@@ -55,6 +55,7 @@ BeaconingModule::BeaconingModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(BeaconingModuleConfiguration);
+    subscribedEvents = NO_MODULE_EVENTS;
 
     //Set defaults
     ResetToDefaultConfiguration();
@@ -67,6 +67,7 @@ DebugModule::DebugModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(DebugModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER) | ModuleEventMask(ModuleEvent::GAP_ADVERTISEMENT_REPORT) | ModuleEventMask(ModuleEvent::BUTTON);
 
     floodMode = FloodMode::OFF;
     packetsOut = 0;
@@ -531,8 +532,6 @@ void DebugModule::GapAdvertisementReportEventHandler(const FruityHal::GapAdverti
     }
 }
 
-u8 modeCounter = 0;
-
 #if IS_ACTIVE(BUTTONS)
 void DebugModule::ButtonHandler(u8 buttonId, u32 holdTimeDs)
 {
@@ -59,6 +59,7 @@ EnrollmentModule::EnrollmentModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(EnrollmentModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER) | ModuleEventMask(ModuleEvent::GAP_ADVERTISEMENT_REPORT) | ModuleEventMask(ModuleEvent::BUTTON);
 
     //Set defaults
     ResetToDefaultConfiguration();
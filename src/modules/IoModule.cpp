@@ -49,6 +49,7 @@ IoModule::IoModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(IoModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER);
 
     //Set defaults
     ResetToDefaultConfiguration();
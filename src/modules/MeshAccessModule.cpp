@@ -46,6 +46,7 @@ MeshAccessModule::MeshAccessModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(MeshAccessModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER) | ModuleEventMask(ModuleEvent::GAP_ADVERTISEMENT_REPORT) | ModuleEventMask(ModuleEvent::MESH_CONNECTION_CHANGED);
 
     discoveryJobHandle = nullptr;
     logNearby = false;
@@ -96,6 +96,26 @@ public:
 
 };
 
+//Events that are only dispatched to the modules that subscribed to them, see Module::subscribedEvents
+enum class ModuleEvent : u8
+{
+    TIMER                    = 0,
+    GAP_ADVERTISEMENT_REPORT = 1,
+    GAP_CONNECTED            = 2,
+    GAP_DISCONNECTED         = 3,
+    GATT_DATA_TRANSMITTED    = 4,
+    MESH_CONNECTION_CHANGED  = 5,
+    BUTTON                   = 6,
+    AMOUNT_OF_EVENTS         = 7,
+};
+
+constexpr u32 ModuleEventMask(ModuleEvent event)
+{
+    return 1UL << (u32)event;
+}
+constexpr u32 ALL_MODULE_EVENTS = (1UL << (u32)ModuleEvent::AMOUNT_OF_EVENTS) - 1;
+constexpr u32 NO_MODULE_EVENTS = 0;
+
 /*
  * The Module class can be subclassed for a number of purposes:
  * - Implement a driver for a sensor or an actuator
@@ -156,6 +176,11 @@ public:
     //This is automatically set to the moduleId for core modules, vendor modules must set this to a defined record storage id
     u16 recordStorageId = RECORD_STORAGE_RECORD_ID_INVALID;
 
+    //The ModuleEvents for which this module implements a handler, a module must be subscribed to an event to get its handler called.
+    //Should be set in the constructor as the subscriptions are collected once when booting the modules.
+    //Modules that do not declare their subscriptions receive all events.
+    u32 subscribedEvents = ALL_MODULE_EVENTS;
+
     //Can be checked to make sure that certain module settings are not modified during runtime
     //or that tasks are only performed once when starting the module for the first time
     bool moduleStarted = false;
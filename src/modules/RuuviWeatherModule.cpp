@@ -90,6 +90,7 @@ RuuviWeatherModule::RuuviWeatherModule()
     //sizeof configuration must be a multiple of 4 bytes
     vendorConfigurationPointer = &configuration;
     configurationLength = sizeof(RuuviWeatherModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER);
 
     //Set defaults
     ResetToDefaultConfiguration();
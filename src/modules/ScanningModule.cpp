@@ -60,6 +60,7 @@ ScanningModule::ScanningModule() :
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(ScanningModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER) | ModuleEventMask(ModuleEvent::GAP_ADVERTISEMENT_REPORT);
 
     //Initialize scanFilters as empty
     for (int i = 0; i < SCAN_FILTER_NUMBER; i++)
@@ -61,6 +61,7 @@ StatusReporterModule::StatusReporterModule()
     //sizeof configuration must be a multiple of 4 bytes
     configurationPointer = &configuration;
     configurationLength = sizeof(StatusReporterModuleConfiguration);
+    subscribedEvents = ModuleEventMask(ModuleEvent::TIMER) | ModuleEventMask(ModuleEvent::GAP_ADVERTISEMENT_REPORT) | ModuleEventMask(ModuleEvent::MESH_CONNECTION_CHANGED);
 
     //Set defaults
     ResetToDefaultConfiguration();
@@ -36,9 +36,17 @@
 #include "ChunkedPacketQueue.h"
 
 // Adds a message. Private as the method does not check for size or nullptrs, the caller has to do this.
-void ChunkedPacketQueue::AddMessageRaw(u8* data, u16 size)
+void ChunkedPacketQueue::AddMessageRaw(const u8* data, u16 size)
 {
     writeChunk->amountOfByteInThisChunk = Utility::NextMultipleOf(writeChunk->amountOfByteInThisChunk, sizeof(u32));
+    AppendRaw(data, size);
+    writeChunk->amountOfByteInThisChunk = Utility::NextMultipleOf(writeChunk->amountOfByteInThisChunk, sizeof(u32));
+}
+
+// Appends the data directly after the previously added data without any alignment so that
+// a message can be added in multiple parts. Same as with AddMessageRaw, the caller has to do all the checks.
+void ChunkedPacketQueue::AppendRaw(const u8* data, u16 size)
+{
     const u32 sizeLeftInCurrentWriteChunk = CONNECTION_QUEUE_MEMORY_CHUNK_SIZE > writeChunk->amountOfByteInThisChunk ? CONNECTION_QUEUE_MEMORY_CHUNK_SIZE - writeChunk->amountOfByteInThisChunk : 0;
 
     if (sizeLeftInCurrentWriteChunk >= size)
@@ -46,7 +54,6 @@ void ChunkedPacketQueue::AddMessageRaw(u8* data, u16 size)
         // The data fits completely in the current writeChunk
         CheckedMemcpy(writeChunk->data.data() + writeChunk->amountOfByteInThisChunk, data, size);
         writeChunk->amountOfByteInThisChunk += size;
-        writeChunk->amountOfByteInThisChunk = Utility::NextMultipleOf(writeChunk->amountOfByteInThisChunk, sizeof(u32));
     }
     else
     {
@@ -55,7 +62,6 @@ void ChunkedPacketQueue::AddMessageRaw(u8* data, u16 size)
         {
             CheckedMemcpy(writeChunk->data.data() + writeChunk->amountOfByteInThisChunk, data, sizeLeftInCurrentWriteChunk);
             writeChunk->amountOfByteInThisChunk += sizeLeftInCurrentWriteChunk;
-            writeChunk->amountOfByteInThisChunk = Utility::NextMultipleOf(writeChunk->amountOfByteInThisChunk, sizeof(u32));
         }
         ConnectionQueueMemoryChunk* newChunk = GS->connectionQueueMemoryAllocator.Allocate();
         if (!newChunk)
@@ -68,7 +74,6 @@ void ChunkedPacketQueue::AddMessageRaw(u8* data, u16 size)
         writeChunk = newChunk;
         CheckedMemcpy(writeChunk->data.data(), data + sizeLeftInCurrentWriteChunk, size - sizeLeftInCurrentWriteChunk);
         writeChunk->amountOfByteInThisChunk += size - sizeLeftInCurrentWriteChunk;
-        writeChunk->amountOfByteInThisChunk = Utility::NextMultipleOf(writeChunk->amountOfByteInThisChunk, sizeof(u32));
     }
 }
 
@@ -212,24 +217,40 @@ ChunkedPacketQueue::~ChunkedPacketQueue()
 
 bool ChunkedPacketQueue::SplitAndAddMessage(u8* data, const u16 size, const u16 payloadSizePerSplit, u32 * messageHandle)
 {
-    if (size > MAX_MESH_PACKET_SIZE + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED)
+    if (data == nullptr)
     {
         SIMEXCEPTION(IllegalArgumentException);
         return false;
     }
-    if (data == nullptr)
+    if (size < SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + 1)
     {
         SIMEXCEPTION(IllegalArgumentException);
         return false;
     }
-    if (size < SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + 1)
+    return SplitAndAddMessage(data, data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, size - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, payloadSizePerSplit, messageHandle);
+}
+
+bool ChunkedPacketQueue::SplitAndAddMessage(const u8* sendDataPacked, const u8* data, const u16 dataSize, const u16 payloadSizePerSplit, u32 * messageHandle)
+{
+    if (dataSize > MAX_MESH_PACKET_SIZE)
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+        return false;
+    }
+    if (sendDataPacked == nullptr || data == nullptr)
     {
         SIMEXCEPTION(IllegalArgumentException);
         return false;
     }
+    if (dataSize < 1)
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+        return false;
+    }
+    const u16 size = dataSize + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
     if (size <= payloadSizePerSplit + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED)
     {
-        return AddMessage(data, size, messageHandle, false);
+        return AddMessage(sendDataPacked, SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, data, dataSize, messageHandle, false);
     }
 
     const u32 amountOfSplits = Utility::MessageLengthToAmountOfSplitPackets(size, payloadSizePerSplit);
@@ -243,12 +264,11 @@ bool ChunkedPacketQueue::SplitAndAddMessage(u8* data, const u16 size, const u16
         return false;
     }
 
-    DYNAMIC_ARRAY(payloadBuffer, payloadSizePerSplit + SIZEOF_CONN_PACKET_SPLIT_HEADER + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
-    CheckedMemcpy(payloadBuffer, data, SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
-    data += SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
-    ConnPacketSplitHeader* resultHeader = (ConnPacketSplitHeader*)(payloadBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
-    u8* payload = payloadBuffer + SIZEOF_CONN_PACKET_SPLIT_HEADER + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
-    u16 sizeLeft = size - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
+    // Each split starts with the send data and the split header, followed by its part of the payload.
+    u8 splitPrefix[SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + SIZEOF_CONN_PACKET_SPLIT_HEADER];
+    CheckedMemcpy(splitPrefix, sendDataPacked, SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
+    ConnPacketSplitHeader* resultHeader = (ConnPacketSplitHeader*)(splitPrefix + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
+    u16 sizeLeft = dataSize;
     u8 splitCounter = 0;
 
     while (sizeLeft > 0)
@@ -268,11 +288,10 @@ bool ChunkedPacketQueue::SplitAndAddMessage(u8* data, const u16 size, const u16
             isSplit = false;
         }
         resultHeader->splitCounter = splitCounter++;
-        CheckedMemcpy(payload, data, sizeOfThisSplit);
+
+        const bool successfullyAdded = AddMessage(splitPrefix, sizeof(splitPrefix), data, sizeOfThisSplit, messageHandle, isSplit);
         data += sizeOfThisSplit;
         sizeLeft -= sizeOfThisSplit;
-
-        const bool successfullyAdded = AddMessage(payloadBuffer, sizeOfThisSplit + SIZEOF_CONN_PACKET_SPLIT_HEADER + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, messageHandle, isSplit);
         if (!successfullyAdded)
         {
             // Must never happen! A check happened earlier if we are able to allocate enough chunks for the message.
@@ -288,16 +307,22 @@ bool ChunkedPacketQueue::SplitAndAddMessage(u8* data, const u16 size, const u16
 
 bool ChunkedPacketQueue::AddMessage(u8* data, u16 size, u32 * messageHandle, bool isSplit)
 {
-    if (size > MAX_MESH_PACKET_SIZE)
+    return AddMessage(nullptr, 0, data, size, messageHandle, isSplit);
+}
+
+bool ChunkedPacketQueue::AddMessage(const u8* prefix, u16 prefixSize, const u8* data, u16 dataSize, u32 * messageHandle, bool isSplit)
+{
+    if (dataSize > MAX_MESH_PACKET_SIZE || prefixSize > MAX_MESH_PACKET_SIZE - dataSize)
     {
         SIMEXCEPTION(IllegalArgumentException);
         return false;
     }
-    if (data == nullptr)
+    if (data == nullptr || (prefix == nullptr && prefixSize > 0))
     {
         SIMEXCEPTION(IllegalArgumentException);
         return false;
     }
+    const u16 size = prefixSize + dataSize;
 
     // The following assumption is because the implementation never splits data over mutliple chunks. Thus, if one
     // chunk is completely full, the message must always be placable in a new chunk (as long as one is available).
@@ -319,7 +344,9 @@ bool ChunkedPacketQueue::AddMessage(u8* data, u16 size, u32 * messageHandle, boo
         header.size = size;
         header.isSplit = isSplit;
         AddMessageRaw((u8*)&header, sizeof(header));
-        AddMessageRaw(data, size);
+        if (prefixSize > 0) AppendRaw(prefix, prefixSize);
+        AppendRaw(data, dataSize);
+        writeChunk->amountOfByteInThisChunk = Utility::NextMultipleOf(writeChunk->amountOfByteInThisChunk, sizeof(u32));
         amountOfPackets++;
 
         if (lookAheadChunk->currentLookAheadHead == CONNECTION_QUEUE_MEMORY_CHUNK_SIZE)
@@ -347,7 +374,9 @@ bool ChunkedPacketQueue::AddMessage(u8* data, u16 size, u32 * messageHandle, boo
         header.handle = this->messageHandle;
         if (messageHandle != nullptr) *messageHandle = this->messageHandle;
         AddMessageRaw((u8*)&header, sizeof(header));
-        AddMessageRaw(data, size);
+        if (prefixSize > 0) AppendRaw(prefix, prefixSize);
+        AppendRaw(data, dataSize);
+        writeChunk->amountOfByteInThisChunk = Utility::NextMultipleOf(writeChunk->amountOfByteInThisChunk, sizeof(u32));
         amountOfPackets++;
 
         if (lookAheadChunk->currentLookAheadHead == CONNECTION_QUEUE_MEMORY_CHUNK_SIZE)
@@ -464,6 +493,34 @@ u16 ChunkedPacketQueue::PeekLookAhead(u8* outData, u16 outDataSize) const
     return PeekPacketRaw(outData, outDataSize, lookAheadChunk, lookAheadChunk->currentLookAheadHead);
 }
 
+SizedData ChunkedPacketQueue::PeekLookAheadInPlace()
+{
+    SizedData retVal = { nullptr, 0 };
+    if (!HasMoreToLookAhead())
+    {
+        SIMEXCEPTION(IllegalStateException);
+        return retVal;
+    }
+
+    const u32 head = lookAheadChunk->currentLookAheadHead;
+    const QueueEntryHeader* header = (const QueueEntryHeader*)(lookAheadChunk->data.data() + head);
+    if (header->reserved != 0 || header->size == 0)
+    {
+        SIMEXCEPTION(MemoryCorruptionException);
+        return retVal;
+    }
+    const u32 messageStartOffset = head + (header->isExtended ? sizeof(ExtendedQueueEntryHeader) : sizeof(QueueEntryHeader));
+    if (messageStartOffset + header->size > CONNECTION_QUEUE_MEMORY_CHUNK_SIZE)
+    {
+        // The message is split across two chunks and must be copied.
+        return retVal;
+    }
+
+    retVal.data = lookAheadChunk->data.data() + messageStartOffset;
+    retVal.length = header->size;
+    return retVal;
+}
+
 void ChunkedPacketQueue::IncrementLookAhead()
 {
     if (!HasMoreToLookAhead())
@@ -73,7 +73,8 @@ private:
         u32 head;
     };
 
-    void AddMessageRaw(u8* data, u16 size);
+    void AppendRaw(const u8* data, u16 size);
+    void AddMessageRaw(const u8* data, u16 size);
     u16 PeekPacketRaw(u8* outData, u16 outDataSize, const ConnectionQueueMemoryChunk* chunk, u32 head, u32* messageHandle=nullptr) const;
     ChunkHeadPair GetChunkHeadPairOfIndex(u16 index) const;
 
@@ -89,6 +90,8 @@ public:
     ChunkedPacketQueue& operator=(      ChunkedPacketQueue&& other) = delete;
     
     bool AddMessage(u8* data, u16 size, u32 * messageHandle, bool isSplit = false);
+    //Adds a single message that consists of the prefix directly followed by the data, without assembling it in a temporary buffer first.
+    bool AddMessage(const u8* prefix, u16 prefixSize, const u8* data, u16 size, u32 * messageHandle, bool isSplit);
     u16 PeekPacket      (u8* outData, u16 outDataSize, u32* messageHandle=nullptr) const;
     u16 RandomAccessPeek(u8* outData, u16 outDataSize, u16 index, u32* messageHandle=nullptr) const; //Careful, very expensive!
     void PopPacket();
@@ -96,10 +99,15 @@ public:
     bool IsCurrentlySendingSplitMessage() const;
 
     bool SplitAndAddMessage(u8* data, u16 size, u16 payloadSizePerSplit, u32 * messageHandle);
+    //Same as above, but the BaseConnectionSendDataPacked is passed separately from the data. The split headers are written directly into the queue.
+    bool SplitAndAddMessage(const u8* sendDataPacked, const u8* data, u16 dataSize, u16 payloadSizePerSplit, u32 * messageHandle);
 
     bool IsLookAheadAndReadSame() const;
     bool HasMoreToLookAhead() const;
     u16 PeekLookAhead(u8* outData, u16 outDataSize) const;
+    //Returns the next packet to look ahead without copying it. The data points into the queue memory and must not be modified,
+    //it is only valid until the packet is popped. If the packet is stored across two chunks, data is nullptr and PeekLookAhead must be used.
+    SizedData PeekLookAheadInPlace();
     void IncrementLookAhead();
     void RollbackLookAhead();
     bool IsRandomAccessIndexLookedAhead(u16 index) const;
@@ -77,6 +77,16 @@ ChunkedPriorityPacketQueue::ChunkedPriorityPacketQueue()
 }
 
 bool ChunkedPriorityPacketQueue::SplitAndAddMessage(DeliveryPriority prio, u8* data, u16 size, u16 payloadSizePerSplit, u32* messageHandle)
+{
+    if (data == nullptr || size < SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED)
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+        return false;
+    }
+    return SplitAndAddMessage(prio, data, data + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, size - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, payloadSizePerSplit, messageHandle);
+}
+
+bool ChunkedPriorityPacketQueue::SplitAndAddMessage(DeliveryPriority prio, const u8* sendDataPacked, const u8* data, u16 dataSize, u16 payloadSizePerSplit, u32* messageHandle)
 {
     if ((u32)prio >= AMOUNT_OF_SEND_QUEUE_PRIORITIES)
     {
@@ -85,9 +95,9 @@ bool ChunkedPriorityPacketQueue::SplitAndAddMessage(DeliveryPriority prio, u8* d
 
     constexpr u32 MAX_VITAL_SIZE = 20 + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED;
 
-    if (prio == DeliveryPriority::VITAL && size <= MAX_VITAL_SIZE)
+    if (prio == DeliveryPriority::VITAL && dataSize + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED <= MAX_VITAL_SIZE)
     {
-        return queues[(u32)DeliveryPriority::VITAL].AddMessage(data, size, messageHandle, false);
+        return queues[(u32)DeliveryPriority::VITAL].AddMessage(sendDataPacked, SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, data, dataSize, messageHandle, false);
     }
     else
     {
@@ -103,7 +113,7 @@ bool ChunkedPriorityPacketQueue::SplitAndAddMessage(DeliveryPriority prio, u8* d
             prio = DeliveryPriority::HIGH;
             logt("FATAL", "Vital queue message had to be queued with high prio queue because it was too large!");
         }
-        return queues[(u32)prio].SplitAndAddMessage(data, size, payloadSizePerSplit, messageHandle);
+        return queues[(u32)prio].SplitAndAddMessage(sendDataPacked, data, dataSize, payloadSizePerSplit, messageHandle);
     }
 }
 
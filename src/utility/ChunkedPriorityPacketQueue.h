@@ -63,6 +63,7 @@ public:
     ChunkedPriorityPacketQueue();
 
     bool SplitAndAddMessage(DeliveryPriority prio, u8* data, u16 size, u16 payloadSizePerSplit, u32* messageHandle);
+    bool SplitAndAddMessage(DeliveryPriority prio, const u8* sendDataPacked, const u8* data, u16 dataSize, u16 payloadSizePerSplit, u32* messageHandle);
     u32 GetAmountOfPackets() const;
     bool IsCurrentlySendingSplitMessage() const;
     QueuePriorityPair GetSendQueue();
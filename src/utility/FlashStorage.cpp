@@ -159,6 +159,8 @@ FlashStorageError FlashStorage::CacheAndWriteData(u32 const * source, u32* desti
 //Aborts the transaction in progress because of a flash fail
 void FlashStorage::AbortTransactionInProgress(FlashStorageError errorCode)
 {
+    GS->recordStorage.FlashStorageTaskFinishedHandler(*currentTask, errorCode);
+
     //Finally, call the callback of the failing task
     if (currentTask->header.callback != nullptr) {
         currentTask->header.callback->FlashStorageItemExecuted(currentTask, errorCode);
@@ -176,6 +178,7 @@ void FlashStorage::RemoveExecutingTask()
 
 void FlashStorage::OnCommandSuccessful()
 {
+    GS->recordStorage.FlashStorageTaskFinishedHandler(*currentTask, FlashStorageError::SUCCESS);
     if (currentTask->header.callback != nullptr) currentTask->header.callback->FlashStorageItemExecuted(currentTask, FlashStorageError::SUCCESS);
     RemoveExecutingTask();
 }
@@ -331,3 +334,8 @@ u16 FlashStorage::GetNumberOfActiveTasks() const
 {
     return taskQueue._numElements;
 }
+
+bool FlashStorage::IsTaskInProgress() const
+{
+    return currentTask != nullptr;
+}
@@ -161,6 +161,9 @@ class FlashStorage
         //Return the number of tasks
         u16 GetNumberOfActiveTasks() const;
 
+        //Returns true while a task is executed, the flash might already be partly modified in this case
+        bool IsTaskInProgress() const;
+
         //This system event handler must be called by the implementation
         void SystemEventHandler(FruityHal::SystemEvents sys_evt);
 };
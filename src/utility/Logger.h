@@ -60,6 +60,7 @@ constexpr int MAX_LOG_TAG_LENGTH = 11;
  */
 class Logger
 {
+    friend class CherrySim;
 public:
     enum class LogType : u8 {
         UART_COMMUNICATION,
@@ -60,6 +60,11 @@
  * the old page is erased and becomes the new swap page.
 
  * The implementation does currently only support updating a record up to 65000 times and 65000 erase cycles of the settings pages
+ *
+ * To avoid scanning all pages and calculating the crc of all records for every lookup, the location of
+ * the newest version of each record is kept in a RAM index. It is built from flash once it is needed and
+ * updated whenever the FlashStorage finished writing a record. Any other modification of the record pages
+ * (page headers, erasing) leads to a rebuild.
 
 */
 
@@ -82,6 +87,7 @@ RecordStorage::RecordStorage()
 void RecordStorage::Init()
 {
     startPage = (u8*)Utility::GetSettingsPageBaseAddress();
+    recordIndexState = RecordIndexState::INVALID;
     RepairPages();
     isInit = true;
 }
@@ -620,6 +626,8 @@ void RecordStorage::RepairPages()
 {
     if (repairStage == RepairStage::NO_REPAIR) {
         repairStage = RepairStage::ERASE_CORRUPT_PAGES;
+        //The pages are not necessarily modified through the FlashStorage in this case
+        recordIndexState = RecordIndexState::INVALID;
     }
 
     //If there are items in the flashStorage queue, we wait until we get called after the queue is empty
@@ -996,6 +1004,97 @@ SizedData RecordStorage::GetRecordData(u16 recordId) const
 //Will return the latest version of a record if its structure is valid
 //Will also return a record if it has been deactivated
 RecordStorageRecord* RecordStorage::GetRecord(u16 recordId) const
+{
+    //While a flash task is executed, the index is not yet updated with its changes
+    if (GS->flashStorage.IsTaskInProgress()) return FindRecordByScan(recordId);
+
+    if (recordIndexState == RecordIndexState::INVALID) BuildRecordIndex();
+    if (recordIndexState == RecordIndexState::OVERFLOWED) return FindRecordByScan(recordId);
+
+    const u16 position = FindRecordIndexPosition(recordId);
+    if (position < recordIndexLength && GetIndexedRecord(position)->recordId == recordId) {
+        return GetIndexedRecord(position);
+    }
+    return nullptr;
+}
+
+void RecordStorage::BuildRecordIndex() const
+{
+    recordIndexLength = 0;
+    recordIndexState = RecordIndexState::VALID;
+
+    //Go through all pages
+    for (u32 i = 0; i < RECORD_STORAGE_NUM_PAGES; i++)
+    {
+        //Check if this page is active
+        RecordStoragePage& page = getPage(i);
+        if (GetPageState(page) != RecordStoragePageState::ACTIVE) continue;
+
+        //Get first record
+        RecordStorageRecord* record = (RecordStorageRecord*)page.data;
+
+        //Iterate through all valid records, this is the only time that their crc is checked
+        while (IsRecordValid(page, record))
+        {
+            if (!AddToRecordIndex(record)) {
+                logt("RS", "Record index full");
+                recordIndexState = RecordIndexState::OVERFLOWED;
+                return;
+            }
+
+            record = (RecordStorageRecord*)((u8*)record + record->recordLength);
+        }
+    }
+}
+
+bool RecordStorage::AddToRecordIndex(RecordStorageRecord const * record) const
+{
+    const u16 offset = (u16)((const u8*)record - startPage);
+    const u16 position = FindRecordIndexPosition(record->recordId);
+
+    if (position < recordIndexLength && GetIndexedRecord(position)->recordId == record->recordId)
+    {
+        //The record with the biggest versionCounter is the valid one, for equal versions the first one in flash
+        RecordStorageRecord* indexedRecord = GetIndexedRecord(position);
+        if (record->versionCounter > indexedRecord->versionCounter
+            || (record->versionCounter == indexedRecord->versionCounter && offset < recordIndex[position]))
+        {
+            recordIndex[position] = offset;
+        }
+        return true;
+    }
+
+    if (recordIndexLength >= RECORD_STORAGE_INDEX_SIZE) return false;
+
+    for (u16 i = recordIndexLength; i > position; i--)
+    {
+        recordIndex[i] = recordIndex[i - 1];
+    }
+    recordIndex[position] = offset;
+    recordIndexLength++;
+
+    return true;
+}
+
+u16 RecordStorage::FindRecordIndexPosition(u16 recordId) const
+{
+    u16 low = 0;
+    u16 high = recordIndexLength;
+    while (low < high)
+    {
+        const u16 middle = (low + high) / 2;
+        if (GetIndexedRecord(middle)->recordId < recordId) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+RecordStorageRecord* RecordStorage::GetIndexedRecord(u16 indexPosition) const
+{
+    return (RecordStorageRecord*)(startPage + recordIndex[indexPosition]);
+}
+
+RecordStorageRecord* RecordStorage::FindRecordByScan(u16 recordId) const
 {
     RecordStorageRecord* result = nullptr;
 
@@ -1335,6 +1434,43 @@ void RecordStorage::FlashStorageItemExecuted(FlashStorageTaskItem* task, FlashSt
     }
 }
 
+void RecordStorage::FlashStorageTaskFinishedHandler(const FlashStorageTaskItem& task, FlashStorageError errorCode)
+{
+    if (recordIndexState == RecordIndexState::INVALID || startPage == nullptr) return;
+
+    const u8* destination = nullptr;
+    if (task.header.command == FlashStorageCommand::WRITE_DATA) {
+        destination = (const u8*)task.params.writeData.dataDestination;
+    }
+    else if (task.header.command == FlashStorageCommand::WRITE_AND_CACHE_DATA) {
+        destination = (const u8*)task.params.writeCachedData.dataDestination;
+    }
+    else {
+        //Erasing a page can remove records or a whole page of records
+        recordIndexState = RecordIndexState::INVALID;
+        return;
+    }
+
+    //Writes outside of the record pages do not affect the index
+    if (destination < startPage || destination >= startPage + RECORD_STORAGE_NUM_PAGES * FruityHal::GetCodePageSize()) return;
+
+    RecordStoragePage& page = getPage((destination - startPage) / FruityHal::GetCodePageSize());
+    const u8* pageData = (const u8*)page.data;
+
+    //Records on pages that are not active yet (e.g. the swap page during defragmentation) are not visible
+    if (destination >= pageData && GetPageState(page) != RecordStoragePageState::ACTIVE) return;
+
+    //A single record was written or its header was updated, anything else (e.g. a new page header) requires a rebuild
+    if (errorCode != FlashStorageError::SUCCESS
+        || recordIndexState == RecordIndexState::OVERFLOWED
+        || destination < pageData
+        || !IsRecordValid(page, (RecordStorageRecord const *)destination)
+        || !AddToRecordIndex((RecordStorageRecord const *)destination))
+    {
+        recordIndexState = RecordIndexState::INVALID;
+    }
+}
+
 void RecordStorage::FlashStorageQueueEmptyHandler()
 {
     //Repair and Defragment are only executed once the queue is empty to guarantee success
@@ -265,10 +265,21 @@ enum class RecordStoragePageState : u8
     ACTIVE,
 };
 
+enum class RecordIndexState : u8
+{
+    INVALID,    //Must be rebuilt from flash before it can be used
+    VALID,
+    OVERFLOWED, //Too many records, lookups have to scan the flash pages
+};
+
 class RecordStorageEventListener;
 
 constexpr int RECORD_STORAGE_QUEUE_SIZE = 256;
 
+//Number of records that can be kept in the RAM index (2 byte each), lookups fall back
+//to scanning the flash pages if more records are stored
+constexpr int RECORD_STORAGE_INDEX_SIZE = 128;
+
 /**
  * The RecordStorage is able to manage multiple records in the flash. It is possible to create new
  * records, update records and delete records. It uses the FlashStorage class for storage operations.
@@ -303,6 +314,12 @@ class RecordStorage : public FlashStorageEventListener
 
         bool processQueueInProgress = false;
 
+        //RAM index of the newest version of each recordId, sorted by recordId
+        //Only the offset of a record from the startPage is stored, everything else is read from flash
+        mutable u16 recordIndex[RECORD_STORAGE_INDEX_SIZE] = {};
+        mutable u16 recordIndexLength = 0;
+        mutable RecordIndexState recordIndexState = RecordIndexState::INVALID;
+
         //Stores a record
         void SaveRecordInternal(SaveRecordOperation& op);
         //Removes a record
@@ -338,6 +355,15 @@ class RecordStorage : public FlashStorageEventListener
         RecordStoragePage * FindPageToDefragment() const;
         RecordStoragePage& getPage(u32 index) const;
 
+        //Record index helpers
+        void BuildRecordIndex() const;
+        //Adds the record to the index or replaces an older version of it, returns false if the index is full
+        bool AddToRecordIndex(RecordStorageRecord const* record) const;
+        //Returns the position of the first index entry with a recordId that is not smaller than the given one
+        u16 FindRecordIndexPosition(u16 recordId) const;
+        RecordStorageRecord* GetIndexedRecord(u16 indexPosition) const;
+        RecordStorageRecord* FindRecordByScan(u16 recordId) const;
+
         bool isInit = false;
 
         bool recordStorageLockDown = false;
@@ -384,6 +410,8 @@ class RecordStorage : public FlashStorageEventListener
         //Listener
         void FlashStorageItemExecuted(FlashStorageTaskItem* task, FlashStorageError errorCode) override;
         void FlashStorageQueueEmptyHandler();
+        //Keeps the record index up to date, called by the FlashStorage for each finished task before its callback
+        void FlashStorageTaskFinishedHandler(const FlashStorageTaskItem& task, FlashStorageError errorCode);
 
 };
 
@@ -894,6 +894,12 @@ bool Terminal::GetNextTerminalQueueEntry(TerminalCommandQueueEntry & out)
     }
 }
 
+bool Terminal::HasTerminalQueueEntries()
+{
+    std::unique_lock<std::mutex> guard(terminalMutex);
+    return !terminalCommandQueue.empty();
+}
+
 std::vector<std::string> tokenize(const std::string& message)
 {
     std::vector<std::string> retVal;
@@ -957,14 +963,20 @@ bool Terminal::TryProcessSimulatorCommand(const std::string &command)
     // Please note that the 'sim term ...' command is filtered out by the SocketTerm implementation and
     // processed separately.
 
-    TerminalCommandHandlerReturnType handled = cherrySimInstance->TerminalCommandHandler(tokens);
-    ProcessTerminalCommandHandlerReturnType(handled, 0);
+    // Simulator commands may modify any node, so they are deferred to the end of the step if the nodes are
+    // currently simulated in parallel.
+    cherrySimInstance->RunOrStage([this, tokens]() {
+        TerminalCommandHandlerReturnType handled = cherrySimInstance->TerminalCommandHandler(tokens);
+        ProcessTerminalCommandHandlerReturnType(handled, 0);
+    });
 
     return true;
 }
 
 void Terminal::LogReplayCommand(const std::string &command)
 {
+    cherrySimInstance->AppendToReplayJournal(ReplayJournalRecordType::TERMINAL_COMMAND, cherrySimInstance->currentNode->index, command);
+
     if (cherrySimInstance->simConfig.logReplayCommands)
     {
         std::string executionReplayLine =